@@ -42,6 +42,21 @@
 
 static zio_t zio_bench;
 static raidz_map_t *rm_bench;
+static hrtime_t bench_start;
+
+/*
+ * An overall wall-clock bound on the benchmark, from the same -t
+ * option that bounds sweep runs.  A partial benchmark still emits
+ * complete measurements, which is what a smoke test wants.
+ */
+static inline boolean_t
+bench_timed_out(void)
+{
+	return (rto_opts.rto_sweep_timeout > 0 &&
+	    NSEC2SEC(gethrtime() - bench_start) >=
+	    (double)rto_opts.rto_sweep_timeout);
+}
+
 static size_t max_data_size = SPA_MAXBLOCKSIZE;
 
 static void
@@ -79,6 +94,9 @@ run_gen_bench_impl(const char *impl)
 	for (fn = 0; fn < RAIDZ_GEN_NUM; fn++) {
 
 		for (ds = MIN_CS_SHIFT; ds <= MAX_CS_SHIFT; ds++) {
+			if (bench_timed_out())
+				return;
+
 			/* create suitable raidz_map */
 			ncols = rto_opts.rto_dcols + fn + 1;
 			zio_bench.io_size = 1ULL << ds;
@@ -107,14 +125,31 @@ run_gen_bench_impl(const char *impl)
 			d_bw = (double)iter_cnt * (double)disksize;
 			d_bw /= (1024.0 * 1024.0 * elapsed);
 
-			LOG(D_ALL, "%10s, %8s, %zu, %10llu, %lf, %lf, %u\n",
-			    impl,
-			    raidz_gen_name[fn],
-			    rto_opts.rto_dcols,
-			    (1ULL<<ds),
-			    d_bw,
-			    d_bw * (double)(ncols),
-			    (unsigned)iter_cnt);
+			if (rto_opts.rto_json) {
+				printf("{\"op\": \"gen\", "
+				    "\"impl\": \"%s\", "
+				    "\"math\": \"%s\", "
+				    "\"dcols\": %zu, "
+				    "\"iosize\": %llu, "
+				    "\"disk_bw_mib\": %f, "
+				    "\"total_bw_mib\": %f, "
+				    "\"iters\": %u}\n",
+				    impl, raidz_gen_name[fn],
+				    rto_opts.rto_dcols,
+				    (u_longlong_t)(1ULL<<ds),
+				    d_bw, d_bw * (double)(ncols),
+				    (unsigned)iter_cnt);
+			} else {
+				LOG(D_ALL,
+				    "%10s, %8s, %zu, %10llu, %lf, %lf, %u\n",
+				    impl,
+				    raidz_gen_name[fn],
+				    rto_opts.rto_dcols,
+				    (1ULL<<ds),
+				    d_bw,
+				    d_bw * (double)(ncols),
+				    (unsigned)iter_cnt);
+			}
 
 			vdev_raidz_map_free(rm_bench);
 		}
@@ -126,8 +161,11 @@ run_gen_bench(void)
 {
 	char **impl_name;
 
-	LOG(D_INFO, DBLSEP "\nBenchmarking parity generation...\n\n");
-	LOG(D_ALL, "impl, math, dcols, iosize, disk_bw, total_bw, iter\n");
+	if (!rto_opts.rto_json) {
+		LOG(D_INFO, DBLSEP "\nBenchmarking parity generation...\n\n");
+		LOG(D_ALL,
+		    "impl, math, dcols, iosize, disk_bw, total_bw, iter\n");
+	}
 
 	for (impl_name = (char **)raidz_impl_names; *impl_name != NULL;
 	    impl_name++) {
@@ -158,6 +196,8 @@ run_rec_bench_impl(const char *impl)
 
 	for (fn = 0; fn < RAIDZ_REC_NUM; fn++) {
 		for (ds = MIN_CS_SHIFT; ds <= MAX_CS_SHIFT; ds++) {
+			if (bench_timed_out())
+				return;
 
 			/* create suitable raidz_map */
 			ncols = rto_opts.rto_dcols + PARITY_PQR;
@@ -199,14 +239,31 @@ run_rec_bench_impl(const char *impl)
 			d_bw = (double)iter_cnt * (double)(disksize);
 			d_bw /= (1024.0 * 1024.0 * elapsed);
 
-			LOG(D_ALL, "%10s, %8s, %zu, %10llu, %lf, %lf, %u\n",
-			    impl,
-			    raidz_rec_name[fn],
-			    rto_opts.rto_dcols,
-			    (1ULL<<ds),
-			    d_bw,
-			    d_bw * (double)ncols,
-			    (unsigned)iter_cnt);
+			if (rto_opts.rto_json) {
+				printf("{\"op\": \"rec\", "
+				    "\"impl\": \"%s\", "
+				    "\"math\": \"%s\", "
+				    "\"dcols\": %zu, "
+				    "\"iosize\": %llu, "
+				    "\"disk_bw_mib\": %f, "
+				    "\"total_bw_mib\": %f, "
+				    "\"iters\": %u}\n",
+				    impl, raidz_rec_name[fn],
+				    rto_opts.rto_dcols,
+				    (u_longlong_t)(1ULL<<ds),
+				    d_bw, d_bw * (double)ncols,
+				    (unsigned)iter_cnt);
+			} else {
+				LOG(D_ALL,
+				    "%10s, %8s, %zu, %10llu, %lf, %lf, %u\n",
+				    impl,
+				    raidz_rec_name[fn],
+				    rto_opts.rto_dcols,
+				    (1ULL<<ds),
+				    d_bw,
+				    d_bw * (double)ncols,
+				    (unsigned)iter_cnt);
+			}
 
 			vdev_raidz_map_free(rm_bench);
 		}
@@ -218,8 +275,12 @@ run_rec_bench(void)
 {
 	char **impl_name;
 
-	LOG(D_INFO, DBLSEP "\nBenchmarking data reconstruction...\n\n");
-	LOG(D_ALL, "impl, math, dcols, iosize, disk_bw, total_bw, iter\n");
+	if (!rto_opts.rto_json) {
+		LOG(D_INFO, DBLSEP
+		    "\nBenchmarking data reconstruction...\n\n");
+		LOG(D_ALL,
+		    "impl, math, dcols, iosize, disk_bw, total_bw, iter\n");
+	}
 
 	for (impl_name = (char **)raidz_impl_names; *impl_name != NULL;
 	    impl_name++) {
@@ -234,6 +295,7 @@ run_rec_bench(void)
 void
 run_raidz_benchmark(void)
 {
+	bench_start = gethrtime();
 	bench_init_raidz_map();
 
 	run_gen_bench();
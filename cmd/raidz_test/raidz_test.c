@@ -120,6 +120,7 @@ static void usage(boolean_t requested)
 	    "\t[-S parameter sweep (default: %s)]\n"
 	    "\t[-t timeout for parameter sweep test]\n"
 	    "\t[-B benchmark all raidz implementations]\n"
+	    "\t[-j emit benchmark results as JSON lines (with -B)]\n"
 	    "\t[-e use expanded raidz map (default: %s)]\n"
 	    "\t[-r expanded raidz map reflow offset (default: %llx)]\n"
 	    "\t[-v increase verbosity (default: %d)]\n"
@@ -147,7 +148,7 @@ static void process_options(int argc, char **argv)
 
 	memcpy(o, &rto_opts_defaults, sizeof (*o));
 
-	while ((opt = getopt(argc, argv, "TDBSvha:er:o:d:s:t:")) != -1) {
+	while ((opt = getopt(argc, argv, "TDBjSvha:er:o:d:s:t:")) != -1) {
 		switch (opt) {
 		case 'a':
 			value = strtoull(optarg, NULL, 0);
@@ -185,6 +186,11 @@ static void process_options(int argc, char **argv)
 		case 'B':
 			o->rto_benchmark = 1;
 			break;
+		case 'j':
+			o->rto_json = 1;
+			/* keep stdout clean for the JSON consumer */
+			o->rto_v = 0;
+			break;
 		case 'D':
 			o->rto_gdb = 1;
 			break;
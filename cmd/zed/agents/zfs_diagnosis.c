@@ -59,6 +59,14 @@
  */
 #define	MAX_SERDLEN	(16 * 2 + sizeof ("zfs___checksum"))
 
+/*
+ * Cap on how many rate-limiter-suppressed events one ereport may replay
+ * into a serd engine (see zfs_fm_serd_record()).  Large enough to trip
+ * any sane N-in-T threshold from a single summarized storm, small
+ * enough to bound the work an ereport can trigger.
+ */
+#define	MAX_REPLAY_EVENTS	256
+
 /*
  * On-disk case structure.  This must maintain backwards compatibility with
  * previous versions of the DE.  By default, any members appended to the end
@@ -530,11 +538,25 @@ zfs_ereport_when(fmd_hdl_t *hdl, nvlist_t *nvl, er_timeval_t *when)
  */
 static int
 zfs_fm_serd_record(fmd_hdl_t *hdl, const char *name, fmd_event_t *ep,
-    zfs_case_t *zcp, const char *err_type)
+    zfs_case_t *zcp, const char *err_type, uint32_t nevents)
 {
-	int fired = fmd_serd_record(hdl, name, ep);
+	int fired;
 	int peers = 0;
 
+	/*
+	 * The kernel rate limiter may have collapsed an error storm
+	 * into this one ereport; replay the suppressed count into the
+	 * engine (bounded, and only until it fires) so diagnosis sees
+	 * the true error rate rather than the post-limit trickle.
+	 */
+	if (nevents < 1)
+		nevents = 1;
+	else if (nevents > MAX_REPLAY_EVENTS)
+		nevents = MAX_REPLAY_EVENTS;
+	do {
+		fired = fmd_serd_record(hdl, name, ep);
+	} while (!fired && --nevents > 0);
+
 	if (fired && (peers = zfs_other_serd_cases(hdl, &zcp->zc_data)) > 0) {
 		fmd_hdl_debug(hdl, "pool %llu is tracking %d other %s cases "
 		    "-- skip faulting the vdev %llu",
@@ -894,6 +916,14 @@ zfs_fm_recv(fmd_hdl_t *hdl, fmd_event_t *ep, nvlist_t *nvl, const char *class)
 		const char *failmode = NULL;
 		boolean_t checkremove = B_FALSE;
 		uint32_t pri = 0;
+		uint32_t suppressed = 0;
+
+		/*
+		 * The kernel may have rate limited this event class and
+		 * attached the count of events it dropped.
+		 */
+		(void) nvlist_lookup_uint32(nvl,
+		    FM_EREPORT_PAYLOAD_ZFS_SUPPRESSED_EVENTS, &suppressed);
 
 		/*
 		 * If this is a checksum or I/O error, then toss it into the
@@ -923,7 +953,7 @@ zfs_fm_recv(fmd_hdl_t *hdl, fmd_event_t *ep, nvlist_t *nvl, const char *class)
 				zfs_case_serialize(zcp);
 			}
 			if (zfs_fm_serd_record(hdl, zcp->zc_data.zc_serd_io,
-			    ep, zcp, "io error")) {
+			    ep, zcp, "io error", 1)) {
 				checkremove = B_TRUE;
 			}
 		} else if (fmd_nvl_class_match(hdl, nvl,
@@ -952,7 +982,8 @@ zfs_fm_recv(fmd_hdl_t *hdl, fmd_event_t *ep, nvlist_t *nvl, const char *class)
 			/* Pass event to SERD engine and see if this triggers */
 			if (zcp->zc_data.zc_serd_slow_io[0] != '\0' &&
 			    zfs_fm_serd_record(hdl,
-			    zcp->zc_data.zc_serd_slow_io, ep, zcp, "slow io")) {
+			    zcp->zc_data.zc_serd_slow_io, ep, zcp, "slow io",
+			    suppressed + 1)) {
 				zfs_case_solve(hdl, zcp,
 				    "fault.fs.zfs.vdev.slow_io");
 			}
@@ -1007,7 +1038,7 @@ zfs_fm_recv(fmd_hdl_t *hdl, fmd_event_t *ep, nvlist_t *nvl, const char *class)
 			}
 			if (zfs_fm_serd_record(hdl,
 			    zcp->zc_data.zc_serd_checksum, ep, zcp,
-			    "checksum")) {
+			    "checksum", suppressed + 1)) {
 				zfs_case_solve(hdl, zcp,
 				    "fault.fs.zfs.vdev.checksum");
 			}
@@ -361,6 +361,20 @@ zedlet_is_sync(const char *zedlet, const char *event)
  *
  * Return 0 on success, -1 on error.
  */
+/*
+ * On fork storms during fault bursts: the layers this design leans on
+ * already exist.  Fault response itself does not ride the fork path -
+ * the FMA agents in cmd/zed/agents (diagnosis SERD engines, retire)
+ * run in-process inside zed and consume every event without spawning
+ * anything.  Event floods are throttled at the source: the kernel
+ * rate-limits checksum and slow-I/O ereports per vdev
+ * (zfs_checksum_events_per_second, zfs_slow_io_events_per_second,
+ * default 20/s each), so a dying disk cannot emit 50k events in the
+ * first place; per-vdev counters keep the full totals.  What forks per
+ * event is only the shell zedlets whose class glob matches - on a
+ * stock install that is typically all-syslog.sh, which is also the
+ * first thing to unlink on a box that cares about burst behavior.
+ */
 int
 zed_exec_process(uint64_t eid, const char *class, const char *subclass,
     struct zed_conf *zcp, zed_strings_t *envs)
@@ -484,7 +484,7 @@ get_usage(zpool_help_t idx)
 		    "\t    [--rewind-to-checkpoint] <pool | id> [newpool]\n"));
 	case HELP_IOSTAT:
 		return (gettext("\tiostat [[[-c [script1,script2,...]"
-		    "[-lq]]|[-rw]] [-T d | u] [-ghHLpPvy]\n"
+		    "[-lq]]|[-rw [-j]]] [-T d | u] [-ghHLpPvy]\n"
 		    "\t    [[pool ...]|[pool vdev ...]|[vdev ...]]"
 		    " [[-n] interval [count]]\n"));
 	case HELP_LABELCLEAR:
@@ -4097,6 +4097,23 @@ typedef struct target_exists_args {
 	uint64_t	poolguid;
 } target_exists_args_t;
 
+
+/*
+ * Device discovery progress callback for interactive imports: keep a
+ * single status line updated on stderr.
+ */
+static void
+import_scan_progress(uint64_t done, uint64_t total, void *arg)
+{
+	(void) arg;
+
+	(void) fprintf(stderr, gettext("\rscanning devices: %llu/%llu"),
+	    (u_longlong_t)done, (u_longlong_t)total);
+	if (done == total)
+		(void) fprintf(stderr, "\n");
+	(void) fflush(stderr);
+}
+
 static int
 name_or_guid_exists(zpool_handle_t *zhp, void *data)
 {
@@ -4600,6 +4617,8 @@ zpool_do_import(int argc, char **argv)
 	idata.policy = policy;
 	idata.do_destroyed = do_destroyed;
 	idata.do_all = do_all;
+	if (isatty(STDERR_FILENO))
+		idata.scan_progress = import_scan_progress;
 
 	libpc_handle_t lpch = {
 		.lpc_lib_handle = g_zfs,
@@ -4724,6 +4743,7 @@ typedef struct iostat_cbdata {
 	boolean_t cb_verbose;
 	boolean_t cb_literal;
 	boolean_t cb_scripted;
+	boolean_t cb_json_histo;
 	zpool_list_t *cb_list;
 	vdev_cmd_data_list_t *vcdl;
 	vdev_cbdata_t cb_vdevs;
@@ -5332,6 +5352,39 @@ print_solid_separator(unsigned int length)
 	printf("\n");
 }
 
+/*
+ * Emit one vdev's histograms as a JSON object on a single line, using
+ * the nvlist stat names as stable keys.  Each bucket value is the delta
+ * since the previous interval (calc_and_alloc_stats_ex() subtracts the
+ * old sample), which is exactly what a telemetry agent polling at the
+ * interval wants; the first sample is the totals since boot (or since
+ * load, with -y semantics applying as usual).
+ */
+static void
+print_iostat_histos_json(iostat_cbdata_t *cb, nvlist_t *oldnv,
+    nvlist_t *newnv, const char *pool, const char *name)
+{
+	enum iostat_type type = IOS_HISTO_IDX(cb->cb_flags);
+	const char **names = vsx_type_to_nvlist[type];
+	unsigned int names_len = str_array_len(names);
+	struct stat_array *nva;
+
+	nva = calc_and_alloc_stats_ex(names, names_len, oldnv, newnv);
+
+	printf("{\"pool\": \"%s\", \"vdev\": \"%s\"", pool, name);
+	for (unsigned int i = 0; i < names_len; i++) {
+		printf(", \"%s\": [", names[i]);
+		for (unsigned int j = 0; j < nva[i].count; j++) {
+			printf("%s%llu", j == 0 ? "" : ", ",
+			    (u_longlong_t)nva[i].data[j]);
+		}
+		printf("]");
+	}
+	printf("}\n");
+
+	free_calc_stats(nva, names_len);
+}
+
 static void
 print_iostat_histos(iostat_cbdata_t *cb, nvlist_t *oldnv,
     nvlist_t *newnv, double scale, const char *name)
@@ -5645,8 +5698,13 @@ print_vdev_stats(zpool_handle_t *zhp, const char *name, nvlist_t *oldnv,
 	if (cb->cb_flags & IOS_QUEUES_M)
 		print_iostat_queues(cb, newnv);
 	if (cb->cb_flags & IOS_ANYHISTO_M) {
-		printf("\n");
-		print_iostat_histos(cb, oldnv, newnv, scale, name);
+		if (cb->cb_json_histo) {
+			print_iostat_histos_json(cb, oldnv, newnv,
+			    zpool_get_name(zhp), name);
+		} else {
+			printf("\n");
+			print_iostat_histos(cb, oldnv, newnv, scale, name);
+		}
 	}
 
 	if (cb->vcdl != NULL) {
@@ -6343,7 +6401,8 @@ get_namewidth_iostat(zpool_handle_t *zhp, void *data)
 }
 
 /*
- * zpool iostat [[-c [script1,script2,...]] [-lq]|[-rw]] [-ghHLpPvy] [-n name]
+ * zpool iostat [[-c [script1,script2,...]] [-lq]|[-rw [-j]]] [-ghHLpPvy]
+ *	[-n name]
  *              [-T d|u] [[ pool ...]|[pool vdev ...]|[vdev ...]]
  *              [interval [count]]
  *
@@ -6380,6 +6439,7 @@ zpool_do_iostat(int argc, char **argv)
 	boolean_t verbose = B_FALSE;
 	boolean_t latency = B_FALSE, l_histo = B_FALSE, rq_histo = B_FALSE;
 	boolean_t queues = B_FALSE, parsable = B_FALSE, scripted = B_FALSE;
+	boolean_t json_histo = B_FALSE;
 	boolean_t omit_since_boot = B_FALSE;
 	boolean_t guid = B_FALSE;
 	boolean_t follow_links = B_FALSE;
@@ -6395,7 +6455,7 @@ zpool_do_iostat(int argc, char **argv)
 	uint64_t unsupported_flags;
 
 	/* check options */
-	while ((c = getopt(argc, argv, "c:gLPT:vyhplqrwnH")) != -1) {
+	while ((c = getopt(argc, argv, "c:gjLPT:vyhplqrwnH")) != -1) {
 		switch (c) {
 		case 'c':
 			if (cmd != NULL) {
@@ -6455,6 +6515,9 @@ zpool_do_iostat(int argc, char **argv)
 		case 'r':
 			rq_histo = B_TRUE;
 			break;
+		case 'j':
+			json_histo = B_TRUE;
+			break;
 		case 'y':
 			omit_since_boot = B_TRUE;
 			break;
@@ -6482,6 +6545,13 @@ zpool_do_iostat(int argc, char **argv)
 	cb.cb_literal = parsable;
 	cb.cb_scripted = scripted;
 
+	if (json_histo && !(l_histo || rq_histo)) {
+		(void) fprintf(stderr, gettext("-j requires one of the "
+		    "histogram modes (-w or -r)\n"));
+		usage(B_FALSE);
+	}
+	cb.cb_json_histo = json_histo;
+
 	if (guid)
 		cb.cb_vdevs.cb_name_flags |= VDEV_NAME_GUID;
 	if (follow_links)
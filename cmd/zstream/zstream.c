@@ -45,11 +45,11 @@ zstream_usage(void)
 	    "\n"
 	    "\tzstream drop_record [-v] [OBJECT,OFFSET] ...\n"
 	    "\n"
-	    "\tzstream recompress [ -l level] TYPE\n"
+	    "\tzstream recompress [ -l level] [-j jobs] TYPE\n"
 	    "\n"
 	    "\tzstream token resume_token\n"
 	    "\n"
-	    "\tzstream redup [-v] FILE | ...\n");
+	    "\tzstream redup [-v] [-j jobs] FILE | ...\n");
 	exit(1);
 }
 
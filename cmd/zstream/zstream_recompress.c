@@ -39,19 +39,103 @@
 #include "zstream.h"
 #include "zstream_util.h"
 
+typedef struct recompress_arg {
+	enum zio_compress ra_ctype;
+	int ra_level;
+} recompress_arg_t;
+
+/*
+ * Worker-side transform: decompress the payload with its stream
+ * compression type and recompress it with the requested one, keeping
+ * the data uncompressed when that would not shrink it.  Only touches
+ * the slot it was handed, so any number of records can be in flight.
+ */
+static void
+recompress_record(zstream_pipe_slot_t *slot, void *arg)
+{
+	recompress_arg_t *ra = arg;
+	struct drr_write *drrw = &slot->zps_drr.drr_u.drr_write;
+	enum zio_compress dtype = drrw->drr_compressiontype;
+	enum zio_compress ctype = ra->ra_ctype;
+	char *payload = slot->zps_payload;
+	uint64_t payload_size = slot->zps_payload_size;
+
+	if (zio_compress_table[dtype].ci_decompress == NULL)
+		dtype = ZIO_COMPRESS_OFF;
+
+	/* Decompress the payload */
+	if (dtype != ZIO_COMPRESS_OFF) {
+		char *dbuf = safe_calloc(drrw->drr_logical_size);
+		abd_t cabd, dabd;
+		abd_get_from_buf_struct(&cabd, payload, payload_size);
+		abd_get_from_buf_struct(&dabd, dbuf, drrw->drr_logical_size);
+		if (zio_decompress_data(dtype, &cabd, &dabd,
+		    payload_size, abd_get_size(&dabd), NULL) != 0) {
+			warnx("decompression type %d failed "
+			    "for ino %llu offset %llu",
+			    dtype,
+			    (u_longlong_t)drrw->drr_object,
+			    (u_longlong_t)drrw->drr_offset);
+			exit(4);
+		}
+		abd_free(&dabd);
+		abd_free(&cabd);
+		free(payload);
+		payload = dbuf;
+		payload_size = drrw->drr_logical_size;
+	}
+
+	/* Recompress the payload */
+	if (ctype != ZIO_COMPRESS_OFF) {
+		char *cbuf = safe_calloc(drrw->drr_logical_size);
+		abd_t dabd, abd;
+		abd_get_from_buf_struct(&dabd,
+		    payload, drrw->drr_logical_size);
+		abd_t *pabd = abd_get_from_buf_struct(&abd, cbuf,
+		    drrw->drr_logical_size);
+		size_t csize = zio_compress_data(ctype, &dabd, &pabd,
+		    drrw->drr_logical_size, drrw->drr_logical_size,
+		    ra->ra_level);
+		size_t rounded = P2ROUNDUP(csize, SPA_MINBLOCKSIZE);
+		if (rounded >= drrw->drr_logical_size) {
+			free(cbuf);
+			drrw->drr_compressiontype = 0;
+			drrw->drr_compressed_size = 0;
+		} else {
+			abd_zero_off(pabd, csize, rounded - csize);
+			free(payload);
+			payload = cbuf;
+			drrw->drr_compressiontype = ctype;
+			drrw->drr_compressed_size = payload_size = rounded;
+		}
+		abd_free(&abd);
+		abd_free(&dabd);
+	} else {
+		drrw->drr_compressiontype = 0;
+		drrw->drr_compressed_size = 0;
+	}
+	slot->zps_payload = payload;
+	slot->zps_payload_size = payload_size;
+}
+
 int
 zstream_do_recompress(int argc, char *argv[])
 {
-	int bufsz = SPA_MAXBLOCKSIZE;
-	char *buf = safe_malloc(bufsz);
-	dmu_replay_record_t thedrr;
-	dmu_replay_record_t *drr = &thedrr;
 	zio_cksum_t stream_cksum;
 	int c;
 	int level = 0;
+	int jobs = 1;
 
-	while ((c = getopt(argc, argv, "l:")) != -1) {
+	while ((c = getopt(argc, argv, "j:l:")) != -1) {
 		switch (c) {
+		case 'j':
+			if (sscanf(optarg, "%d", &jobs) != 1 || jobs < 1) {
+				fprintf(stderr,
+				    "failed to parse number of jobs '%s'\n",
+				    optarg);
+				zstream_usage();
+			}
+			break;
 		case 'l':
 			if (sscanf(optarg, "%d", &level) != 1) {
 				fprintf(stderr,
@@ -103,25 +187,26 @@ zstream_do_recompress(int argc, char *argv[])
 	fletcher_4_init();
 	zio_init();
 	zstd_init();
+
+	ZIO_SET_CHECKSUM(&stream_cksum, 0, 0, 0, 0);
+	recompress_arg_t ra = { .ra_ctype = ctype, .ra_level = level };
+	zstream_pipe_t *zp = zstream_pipe_create(jobs, recompress_record,
+	    &ra, &stream_cksum, STDOUT_FILENO);
+
 	int begin = 0;
 	boolean_t seen = B_FALSE;
-	while (sfread(drr, sizeof (*drr), stdin) != 0) {
-		struct drr_write *drrw;
+	for (;;) {
+		zstream_pipe_slot_t *slot = zstream_pipe_slot(zp);
+		dmu_replay_record_t *drr = &slot->zps_drr;
+		boolean_t queued = B_FALSE;
 		uint64_t payload_size = 0;
 
-		/*
-		 * We need to regenerate the checksum.
-		 */
-		if (drr->drr_type != DRR_BEGIN) {
-			memset(&drr->drr_u.drr_checksum.drr_checksum, 0,
-			    sizeof (drr->drr_u.drr_checksum.drr_checksum));
-		}
-
+		if (sfread(drr, sizeof (*drr), stdin) == 0)
+			break;
 
 		switch (drr->drr_type) {
 		case DRR_BEGIN:
 		{
-			ZIO_SET_CHECKSUM(&stream_cksum, 0, 0, 0, 0);
 			VERIFY0(begin++);
 			seen = B_TRUE;
 
@@ -130,13 +215,8 @@ zstream_do_recompress(int argc, char *argv[])
 			VERIFY3U(sz, <=, 1U << 28);
 
 			if (sz != 0) {
-				if (sz > bufsz) {
-					buf = realloc(buf, sz);
-					if (buf == NULL)
-						err(1, "realloc");
-					bufsz = sz;
-				}
-				(void) sfread(buf, sz, stdin);
+				slot->zps_payload = safe_malloc(sz);
+				(void) sfread(slot->zps_payload, sz, stdin);
 			}
 			payload_size = sz;
 			break;
@@ -152,12 +232,12 @@ zstream_do_recompress(int argc, char *argv[])
 			VERIFY3B(seen, ==, B_TRUE);
 			begin--;
 			/*
-			 * Use the recalculated checksum, unless this is
-			 * the END record of a stream package, which has
-			 * no checksum.
+			 * The emitter substitutes the recalculated checksum,
+			 * unless this is the END record of a stream package,
+			 * which has no checksum.
 			 */
 			if (!ZIO_CHECKSUM_IS_ZERO(&drre->drr_checksum))
-				drre->drr_checksum = stream_cksum;
+				slot->zps_fix_end_cksum = B_TRUE;
 			break;
 		}
 
@@ -168,7 +248,9 @@ zstream_do_recompress(int argc, char *argv[])
 
 			if (drro->drr_bonuslen > 0) {
 				payload_size = DRR_OBJECT_PAYLOAD_SIZE(drro);
-				(void) sfread(buf, payload_size, stdin);
+				slot->zps_payload = safe_malloc(payload_size);
+				(void) sfread(slot->zps_payload, payload_size,
+				    stdin);
 			}
 			break;
 		}
@@ -178,7 +260,8 @@ zstream_do_recompress(int argc, char *argv[])
 			struct drr_spill *drrs = &drr->drr_u.drr_spill;
 			VERIFY3S(begin, ==, 1);
 			payload_size = DRR_SPILL_PAYLOAD_SIZE(drrs);
-			(void) sfread(buf, payload_size, stdin);
+			slot->zps_payload = safe_malloc(payload_size);
+			(void) sfread(slot->zps_payload, payload_size, stdin);
 			break;
 		}
 
@@ -192,7 +275,7 @@ zstream_do_recompress(int argc, char *argv[])
 		case DRR_WRITE:
 		{
 			VERIFY3S(begin, ==, 1);
-			drrw = &thedrr.drr_u.drr_write;
+			struct drr_write *drrw = &drr->drr_u.drr_write;
 			payload_size = DRR_WRITE_PAYLOAD_SIZE(drrw);
 			/*
 			 * In order to recompress an encrypted block, you have
@@ -208,85 +291,18 @@ zstream_do_recompress(int argc, char *argv[])
 					break;
 				}
 			}
-			if (encrypted) {
-				(void) sfread(buf, payload_size, stdin);
-				break;
-			}
-			enum zio_compress dtype = drrw->drr_compressiontype;
-			if (dtype >= ZIO_COMPRESS_FUNCTIONS) {
-				fprintf(stderr, "Invalid compression type in "
-				    "stream: %d\n", dtype);
-				exit(3);
-			}
-			if (zio_compress_table[dtype].ci_decompress == NULL)
-				dtype = ZIO_COMPRESS_OFF;
-
-			/* Set up buffers to minimize memcpys */
-			char *cbuf, *dbuf;
-			if (ctype == ZIO_COMPRESS_OFF)
-				dbuf = buf;
-			else
-				dbuf = safe_calloc(bufsz);
-
-			if (dtype == ZIO_COMPRESS_OFF)
-				cbuf = dbuf;
-			else
-				cbuf = safe_calloc(payload_size);
-
-			/* Read and decompress the payload */
-			(void) sfread(cbuf, payload_size, stdin);
-			if (dtype != ZIO_COMPRESS_OFF) {
-				abd_t cabd, dabd;
-				abd_get_from_buf_struct(&cabd,
-				    cbuf, payload_size);
-				abd_get_from_buf_struct(&dabd, dbuf,
-				    MIN(bufsz, drrw->drr_logical_size));
-				if (zio_decompress_data(dtype, &cabd, &dabd,
-				    payload_size, abd_get_size(&dabd),
-				    NULL) != 0) {
-					warnx("decompression type %d failed "
-					    "for ino %llu offset %llu",
-					    dtype,
-					    (u_longlong_t)drrw->drr_object,
-					    (u_longlong_t)drrw->drr_offset);
-					exit(4);
-				}
-				payload_size = drrw->drr_logical_size;
-				abd_free(&dabd);
-				abd_free(&cabd);
-				free(cbuf);
-			}
-
-			/* Recompress the payload */
-			if (ctype != ZIO_COMPRESS_OFF) {
-				abd_t dabd, abd;
-				abd_get_from_buf_struct(&dabd,
-				    dbuf, drrw->drr_logical_size);
-				abd_t *pabd =
-				    abd_get_from_buf_struct(&abd, buf, bufsz);
-				size_t csize = zio_compress_data(ctype, &dabd,
-				    &pabd, drrw->drr_logical_size,
-				    drrw->drr_logical_size, level);
-				size_t rounded =
-				    P2ROUNDUP(csize, SPA_MINBLOCKSIZE);
-				if (rounded >= drrw->drr_logical_size) {
-					memcpy(buf, dbuf, payload_size);
-					drrw->drr_compressiontype = 0;
-					drrw->drr_compressed_size = 0;
-				} else {
-					abd_zero_off(pabd, csize,
-					    rounded - csize);
-					drrw->drr_compressiontype = ctype;
-					drrw->drr_compressed_size =
-					    payload_size = rounded;
+			if (!encrypted) {
+				enum zio_compress dtype =
+				    drrw->drr_compressiontype;
+				if (dtype >= ZIO_COMPRESS_FUNCTIONS) {
+					fprintf(stderr, "Invalid compression "
+					    "type in stream: %d\n", dtype);
+					exit(3);
 				}
-				abd_free(&abd);
-				abd_free(&dabd);
-				free(dbuf);
-			} else {
-				drrw->drr_compressiontype = 0;
-				drrw->drr_compressed_size = 0;
+				queued = B_TRUE;
 			}
+			slot->zps_payload = safe_malloc(payload_size);
+			(void) sfread(slot->zps_payload, payload_size, stdin);
 			break;
 		}
 
@@ -297,7 +313,8 @@ zstream_do_recompress(int argc, char *argv[])
 			VERIFY3S(begin, ==, 1);
 			payload_size =
 			    P2ROUNDUP((uint64_t)drrwe->drr_psize, 8);
-			(void) sfread(buf, payload_size, stdin);
+			slot->zps_payload = safe_malloc(payload_size);
+			(void) sfread(slot->zps_payload, payload_size, stdin);
 			break;
 		}
 
@@ -324,31 +341,13 @@ zstream_do_recompress(int argc, char *argv[])
 			exit(1);
 		}
 
-		/*
-		 * We need to recalculate the checksum, and it needs to be
-		 * initially zero to do that.  BEGIN records don't have
-		 * a checksum.
-		 */
-		if (drr->drr_type != DRR_BEGIN) {
-			memset(&drr->drr_u.drr_checksum.drr_checksum, 0,
-			    sizeof (drr->drr_u.drr_checksum.drr_checksum));
-		}
-		if (dump_record(drr, buf, payload_size,
-		    &stream_cksum, STDOUT_FILENO) != 0)
+		slot->zps_payload_size = payload_size;
+		zstream_pipe_submit(zp, queued);
+		if (zstream_pipe_error(zp) != 0)
 			break;
-		if (drr->drr_type == DRR_END) {
-			/*
-			 * Typically the END record is either the last
-			 * thing in the stream, or it is followed
-			 * by a BEGIN record (which also zeros the checksum).
-			 * However, a stream package ends with two END
-			 * records.  The last END record's checksum starts
-			 * from zero.
-			 */
-			ZIO_SET_CHECKSUM(&stream_cksum, 0, 0, 0, 0);
-		}
 	}
-	free(buf);
+	(void) zstream_pipe_drain(zp);
+	zstream_pipe_destroy(zp);
 	fletcher_4_fini();
 	zio_fini();
 	zstd_fini();
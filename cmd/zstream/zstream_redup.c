@@ -116,6 +116,43 @@ rdt_lookup(redup_table_t *rdt,
 	assert(!"could not find expected redup table entry");
 }
 
+typedef struct redup_arg {
+	int rda_infd;
+} redup_arg_t;
+
+/*
+ * Worker-side transform: replace a WRITE_BYREF record with the WRITE
+ * record it references, read from the (seekable) input stream at the
+ * offset the reader looked up.  pread() is positional, so any number of
+ * these can run concurrently with each other and with the sequential
+ * read of the stream.
+ */
+static void
+redup_byref_record(zstream_pipe_slot_t *slot, void *arg)
+{
+	redup_arg_t *rda = arg;
+	dmu_replay_record_t *drr = &slot->zps_drr;
+	struct drr_write_byref drrwb = drr->drr_u.drr_write_byref;
+
+	spread(rda->rda_infd, drr, sizeof (*drr), slot->zps_stream_offset);
+
+	assert(drr->drr_type == DRR_WRITE);
+	struct drr_write *drrw = &drr->drr_u.drr_write;
+	assert(drrw->drr_toguid == drrwb.drr_refguid);
+	assert(drrw->drr_object == drrwb.drr_refobject);
+	assert(drrw->drr_offset == drrwb.drr_refoffset);
+
+	uint64_t payload_size = DRR_WRITE_PAYLOAD_SIZE(drrw);
+	slot->zps_payload = safe_malloc(payload_size);
+	spread(rda->rda_infd, slot->zps_payload, payload_size,
+	    slot->zps_stream_offset + sizeof (*drr));
+	slot->zps_payload_size = payload_size;
+
+	drrw->drr_toguid = drrwb.drr_toguid;
+	drrw->drr_object = drrwb.drr_object;
+	drrw->drr_offset = drrwb.drr_offset;
+}
+
 /*
  * Convert a dedup stream (generated by "zfs send -D") to a
  * non-deduplicated stream.  The entire infd will be converted, including
@@ -123,19 +160,14 @@ rdt_lookup(redup_table_t *rdt,
  * infd must be seekable.
  */
 static void
-zfs_redup_stream(int infd, int outfd, boolean_t verbose)
+zfs_redup_stream(int infd, int outfd, boolean_t verbose, int jobs)
 {
-	int bufsz = SPA_MAXBLOCKSIZE;
-	dmu_replay_record_t thedrr;
-	dmu_replay_record_t *drr = &thedrr;
 	redup_table_t rdt;
 	zio_cksum_t stream_cksum;
 	uint64_t numbuckets;
 	uint64_t num_records = 0;
 	uint64_t num_write_byref_records = 0;
 
-	memset(&thedrr, 0, sizeof (dmu_replay_record_t));
-
 #ifdef _ILP32
 	uint64_t max_rde_size = SMALLEST_POSSIBLE_MAX_RDT_MB << 20;
 #else
@@ -161,29 +193,30 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 	rdt.numhashbits = highbit64(numbuckets) - 1;
 	rdt.ddt_count = 0;
 
-	char *buf = safe_calloc(bufsz);
+	ZIO_SET_CHECKSUM(&stream_cksum, 0, 0, 0, 0);
+	redup_arg_t rda = { .rda_infd = infd };
+	zstream_pipe_t *zp = zstream_pipe_create(jobs, redup_byref_record,
+	    &rda, &stream_cksum, outfd);
+
 	FILE *ofp = fdopen(infd, "r");
 	long offset = ftell(ofp);
 	int begin = 0;
 	boolean_t seen = B_FALSE;
-	while (sfread(drr, sizeof (*drr), ofp) != 0) {
-		num_records++;
+	for (;;) {
+		zstream_pipe_slot_t *slot = zstream_pipe_slot(zp);
+		dmu_replay_record_t *drr = &slot->zps_drr;
+		boolean_t queued = B_FALSE;
+		uint64_t payload_size = 0;
 
-		/*
-		 * We need to regenerate the checksum.
-		 */
-		if (drr->drr_type != DRR_BEGIN) {
-			memset(&drr->drr_u.drr_checksum.drr_checksum, 0,
-			    sizeof (drr->drr_u.drr_checksum.drr_checksum));
-		}
+		if (sfread(drr, sizeof (*drr), ofp) == 0)
+			break;
+		num_records++;
 
-		uint64_t payload_size = 0;
 		switch (drr->drr_type) {
 		case DRR_BEGIN:
 		{
 			struct drr_begin *drrb = &drr->drr_u.drr_begin;
 			int fflags;
-			ZIO_SET_CHECKSUM(&stream_cksum, 0, 0, 0, 0);
 			VERIFY0(begin++);
 			seen = B_TRUE;
 
@@ -201,12 +234,8 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 			VERIFY3U(sz, <=, 1U << 28);
 
 			if (sz != 0) {
-				if (sz > bufsz) {
-					free(buf);
-					buf = safe_calloc(sz);
-					bufsz = sz;
-				}
-				(void) sfread(buf, sz, ofp);
+				slot->zps_payload = safe_malloc(sz);
+				(void) sfread(slot->zps_payload, sz, ofp);
 			}
 			payload_size = sz;
 			break;
@@ -223,12 +252,12 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 			VERIFY3B(seen, ==, B_TRUE);
 			begin--;
 			/*
-			 * Use the recalculated checksum, unless this is
-			 * the END record of a stream package, which has
-			 * no checksum.
+			 * The emitter substitutes the recalculated checksum,
+			 * unless this is the END record of a stream package,
+			 * which has no checksum.
 			 */
 			if (!ZIO_CHECKSUM_IS_ZERO(&drre->drr_checksum))
-				drre->drr_checksum = stream_cksum;
+				slot->zps_fix_end_cksum = B_TRUE;
 			break;
 		}
 
@@ -239,7 +268,9 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 
 			if (drro->drr_bonuslen > 0) {
 				payload_size = DRR_OBJECT_PAYLOAD_SIZE(drro);
-				(void) sfread(buf, payload_size, ofp);
+				slot->zps_payload = safe_malloc(payload_size);
+				(void) sfread(slot->zps_payload, payload_size,
+				    ofp);
 			}
 			break;
 		}
@@ -249,44 +280,33 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 			struct drr_spill *drrs = &drr->drr_u.drr_spill;
 			VERIFY3S(begin, ==, 1);
 			payload_size = DRR_SPILL_PAYLOAD_SIZE(drrs);
-			(void) sfread(buf, payload_size, ofp);
+			slot->zps_payload = safe_malloc(payload_size);
+			(void) sfread(slot->zps_payload, payload_size, ofp);
 			break;
 		}
 
 		case DRR_WRITE_BYREF:
 		{
-			struct drr_write_byref drrwb =
-			    drr->drr_u.drr_write_byref;
+			struct drr_write_byref *drrwb =
+			    &drr->drr_u.drr_write_byref;
 			VERIFY3S(begin, ==, 1);
 
 			num_write_byref_records++;
 
 			/*
 			 * Look up in hash table by drrwb->drr_refguid,
-			 * drr_refobject, drr_refoffset.  Replace this
-			 * record with the found WRITE record, but with
-			 * drr_object,drr_offset,drr_toguid replaced with ours.
+			 * drr_refobject, drr_refoffset.  A worker thread
+			 * replaces this record with the found WRITE record,
+			 * but with drr_object,drr_offset,drr_toguid replaced
+			 * with ours.
 			 */
 			uint64_t stream_offset = 0;
-			rdt_lookup(&rdt, drrwb.drr_refguid,
-			    drrwb.drr_refobject, drrwb.drr_refoffset,
+			rdt_lookup(&rdt, drrwb->drr_refguid,
+			    drrwb->drr_refobject, drrwb->drr_refoffset,
 			    &stream_offset);
 
-			spread(infd, drr, sizeof (*drr), stream_offset);
-
-			assert(drr->drr_type == DRR_WRITE);
-			struct drr_write *drrw = &drr->drr_u.drr_write;
-			assert(drrw->drr_toguid == drrwb.drr_refguid);
-			assert(drrw->drr_object == drrwb.drr_refobject);
-			assert(drrw->drr_offset == drrwb.drr_refoffset);
-
-			payload_size = DRR_WRITE_PAYLOAD_SIZE(drrw);
-			spread(infd, buf, payload_size,
-			    stream_offset + sizeof (*drr));
-
-			drrw->drr_toguid = drrwb.drr_toguid;
-			drrw->drr_object = drrwb.drr_object;
-			drrw->drr_offset = drrwb.drr_offset;
+			slot->zps_stream_offset = stream_offset;
+			queued = B_TRUE;
 			break;
 		}
 
@@ -295,7 +315,8 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 			struct drr_write *drrw = &drr->drr_u.drr_write;
 			VERIFY3S(begin, ==, 1);
 			payload_size = DRR_WRITE_PAYLOAD_SIZE(drrw);
-			(void) sfread(buf, payload_size, ofp);
+			slot->zps_payload = safe_malloc(payload_size);
+			(void) sfread(slot->zps_payload, payload_size, ofp);
 
 			rdt_insert(&rdt, drrw->drr_toguid,
 			    drrw->drr_object, drrw->drr_offset, offset);
@@ -309,7 +330,8 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 			VERIFY3S(begin, ==, 1);
 			payload_size =
 			    P2ROUNDUP((uint64_t)drrwe->drr_psize, 8);
-			(void) sfread(buf, payload_size, ofp);
+			slot->zps_payload = safe_malloc(payload_size);
+			(void) sfread(slot->zps_payload, payload_size, ofp);
 			break;
 		}
 
@@ -336,31 +358,14 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 			exit(1);
 		}
 
-		/*
-		 * We need to recalculate the checksum, and it needs to be
-		 * initially zero to do that.  BEGIN records don't have
-		 * a checksum.
-		 */
-		if (drr->drr_type != DRR_BEGIN) {
-			memset(&drr->drr_u.drr_checksum.drr_checksum, 0,
-			    sizeof (drr->drr_u.drr_checksum.drr_checksum));
-		}
-		if (dump_record(drr, buf, payload_size,
-		    &stream_cksum, outfd) != 0)
+		slot->zps_payload_size = payload_size;
+		zstream_pipe_submit(zp, queued);
+		if (zstream_pipe_error(zp) != 0)
 			break;
-		if (drr->drr_type == DRR_END) {
-			/*
-			 * Typically the END record is either the last
-			 * thing in the stream, or it is followed
-			 * by a BEGIN record (which also zeros the checksum).
-			 * However, a stream package ends with two END
-			 * records.  The last END record's checksum starts
-			 * from zero.
-			 */
-			ZIO_SET_CHECKSUM(&stream_cksum, 0, 0, 0, 0);
-		}
 		offset = ftell(ofp);
 	}
+	(void) zstream_pipe_drain(zp);
+	zstream_pipe_destroy(zp);
 
 	if (verbose) {
 		char mem_str[16];
@@ -375,7 +380,6 @@ zfs_redup_stream(int infd, int outfd, boolean_t verbose)
 
 	umem_cache_destroy(rdt.ddecache);
 	free(rdt.redup_hash_array);
-	free(buf);
 	(void) fclose(ofp);
 }
 
@@ -383,10 +387,19 @@ int
 zstream_do_redup(int argc, char *argv[])
 {
 	boolean_t verbose = B_FALSE;
+	int jobs = 1;
 	int c;
 
-	while ((c = getopt(argc, argv, "v")) != -1) {
+	while ((c = getopt(argc, argv, "j:v")) != -1) {
 		switch (c) {
+		case 'j':
+			if (sscanf(optarg, "%d", &jobs) != 1 || jobs < 1) {
+				fprintf(stderr,
+				    "failed to parse number of jobs '%s'\n",
+				    optarg);
+				zstream_usage();
+			}
+			break;
 		case 'v':
 			verbose = B_TRUE;
 			break;
@@ -422,7 +435,7 @@ zstream_do_redup(int argc, char *argv[])
 	}
 
 	fletcher_4_init();
-	zfs_redup_stream(fd, STDOUT_FILENO, verbose);
+	zfs_redup_stream(fd, STDOUT_FILENO, verbose, jobs);
 	fletcher_4_fini();
 
 	close(fd);
@@ -104,3 +104,214 @@ sfread(void *buf, size_t size, FILE *fp)
 	}
 	return (rv);
 }
+
+/*
+ * Ordered record pipeline (see zstream_util.h).  Slot indices only ever
+ * increase; a slot's position in the ring is its index modulo the ring
+ * size, so zp_tail <= zp_work <= zp_head always holds and the reader can
+ * never lap the emitter.
+ */
+
+static void *
+zstream_pipe_worker(void *arg)
+{
+	zstream_pipe_t *zp = arg;
+
+	VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+	for (;;) {
+		while (zp->zp_work == zp->zp_head && !zp->zp_exit) {
+			VERIFY0(pthread_cond_wait(&zp->zp_work_cv,
+			    &zp->zp_lock));
+		}
+		if (zp->zp_work == zp->zp_head && zp->zp_exit)
+			break;
+		zstream_pipe_slot_t *slot =
+		    &zp->zp_slots[zp->zp_work++ % zp->zp_nslots];
+		if (slot->zps_state != ZPS_QUEUED)
+			continue;
+		slot->zps_state = ZPS_BUSY;
+		VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+
+		zp->zp_func(slot, zp->zp_arg);
+
+		VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+		slot->zps_state = ZPS_DONE;
+		VERIFY0(pthread_cond_broadcast(&zp->zp_done_cv));
+	}
+	VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+	return (NULL);
+}
+
+static void *
+zstream_pipe_emitter(void *arg)
+{
+	zstream_pipe_t *zp = arg;
+
+	VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+	for (;;) {
+		zstream_pipe_slot_t *slot =
+		    &zp->zp_slots[zp->zp_tail % zp->zp_nslots];
+		while (!(zp->zp_tail < zp->zp_head &&
+		    slot->zps_state == ZPS_DONE) &&
+		    !(zp->zp_exit && zp->zp_tail == zp->zp_head)) {
+			VERIFY0(pthread_cond_wait(&zp->zp_done_cv,
+			    &zp->zp_lock));
+		}
+		if (zp->zp_exit && zp->zp_tail == zp->zp_head)
+			break;
+		VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+
+		dmu_replay_record_t *drr = &slot->zps_drr;
+		/*
+		 * The running checksum is only touched here, in emission
+		 * order, which reproduces what the single-threaded loops
+		 * did: BEGIN starts a fresh checksum, END records (except
+		 * the unchecksummed final END of a stream package) carry
+		 * the checksum of everything before them, and an END also
+		 * resets the checksum for any following substream.
+		 */
+		if (drr->drr_type == DRR_BEGIN) {
+			ZIO_SET_CHECKSUM(zp->zp_cksum, 0, 0, 0, 0);
+		} else {
+			memset(&drr->drr_u.drr_checksum.drr_checksum, 0,
+			    sizeof (drr->drr_u.drr_checksum.drr_checksum));
+		}
+		if (drr->drr_type == DRR_END && slot->zps_fix_end_cksum)
+			drr->drr_u.drr_end.drr_checksum = *zp->zp_cksum;
+		int err = 0;
+		if (zp->zp_error == 0) {
+			err = dump_record(drr, slot->zps_payload,
+			    slot->zps_payload_size, zp->zp_cksum,
+			    zp->zp_outfd);
+		}
+		if (drr->drr_type == DRR_END)
+			ZIO_SET_CHECKSUM(zp->zp_cksum, 0, 0, 0, 0);
+		if (slot->zps_payload != NULL) {
+			free(slot->zps_payload);
+			slot->zps_payload = NULL;
+		}
+
+		VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+		if (err != 0 && zp->zp_error == 0)
+			zp->zp_error = err;
+		slot->zps_state = ZPS_EMPTY;
+		zp->zp_tail++;
+		VERIFY0(pthread_cond_broadcast(&zp->zp_empty_cv));
+	}
+	VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+	return (NULL);
+}
+
+zstream_pipe_t *
+zstream_pipe_create(int nthreads, zstream_pipe_work_f func, void *arg,
+    zio_cksum_t *cksum, int outfd)
+{
+	zstream_pipe_t *zp = safe_calloc(sizeof (*zp));
+
+	zp->zp_nthreads = nthreads;
+	zp->zp_nslots = MAX(nthreads * 4, 8);
+	zp->zp_slots = safe_calloc(zp->zp_nslots * sizeof (*zp->zp_slots));
+	zp->zp_func = func;
+	zp->zp_arg = arg;
+	zp->zp_cksum = cksum;
+	zp->zp_outfd = outfd;
+	VERIFY0(pthread_mutex_init(&zp->zp_lock, NULL));
+	VERIFY0(pthread_cond_init(&zp->zp_work_cv, NULL));
+	VERIFY0(pthread_cond_init(&zp->zp_done_cv, NULL));
+	VERIFY0(pthread_cond_init(&zp->zp_empty_cv, NULL));
+
+	zp->zp_threads = safe_calloc((nthreads + 1) *
+	    sizeof (*zp->zp_threads));
+	for (int i = 0; i < nthreads; i++) {
+		VERIFY0(pthread_create(&zp->zp_threads[i], NULL,
+		    zstream_pipe_worker, zp));
+	}
+	VERIFY0(pthread_create(&zp->zp_threads[nthreads], NULL,
+	    zstream_pipe_emitter, zp));
+	return (zp);
+}
+
+/*
+ * Return the next slot for the reader to fill, waiting for the emitter
+ * to retire it if the ring is full.
+ */
+zstream_pipe_slot_t *
+zstream_pipe_slot(zstream_pipe_t *zp)
+{
+	zstream_pipe_slot_t *slot =
+	    &zp->zp_slots[zp->zp_head % zp->zp_nslots];
+
+	VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+	while (slot->zps_state != ZPS_EMPTY)
+		VERIFY0(pthread_cond_wait(&zp->zp_empty_cv, &zp->zp_lock));
+	VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+
+	slot->zps_payload = NULL;
+	slot->zps_payload_size = 0;
+	slot->zps_stream_offset = 0;
+	slot->zps_fix_end_cksum = B_FALSE;
+	return (slot);
+}
+
+/*
+ * Publish the slot returned by zstream_pipe_slot(): queued slots go to
+ * the worker pool first, the rest are ready for the emitter as-is.
+ */
+void
+zstream_pipe_submit(zstream_pipe_t *zp, boolean_t queued)
+{
+	zstream_pipe_slot_t *slot =
+	    &zp->zp_slots[zp->zp_head % zp->zp_nslots];
+
+	VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+	slot->zps_state = queued ? ZPS_QUEUED : ZPS_DONE;
+	zp->zp_head++;
+	VERIFY0(pthread_cond_broadcast(&zp->zp_work_cv));
+	VERIFY0(pthread_cond_broadcast(&zp->zp_done_cv));
+	VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+}
+
+int
+zstream_pipe_error(zstream_pipe_t *zp)
+{
+	VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+	int err = zp->zp_error;
+	VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+	return (err);
+}
+
+/*
+ * Wait for every submitted record to be emitted; returns the first
+ * emission error, if any.
+ */
+int
+zstream_pipe_drain(zstream_pipe_t *zp)
+{
+	VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+	while (zp->zp_tail != zp->zp_head)
+		VERIFY0(pthread_cond_wait(&zp->zp_empty_cv, &zp->zp_lock));
+	int err = zp->zp_error;
+	VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+	return (err);
+}
+
+void
+zstream_pipe_destroy(zstream_pipe_t *zp)
+{
+	VERIFY0(pthread_mutex_lock(&zp->zp_lock));
+	VERIFY3U(zp->zp_tail, ==, zp->zp_head);
+	zp->zp_exit = B_TRUE;
+	VERIFY0(pthread_cond_broadcast(&zp->zp_work_cv));
+	VERIFY0(pthread_cond_broadcast(&zp->zp_done_cv));
+	VERIFY0(pthread_mutex_unlock(&zp->zp_lock));
+
+	for (int i = 0; i < zp->zp_nthreads + 1; i++)
+		VERIFY0(pthread_join(zp->zp_threads[i], NULL));
+	VERIFY0(pthread_mutex_destroy(&zp->zp_lock));
+	VERIFY0(pthread_cond_destroy(&zp->zp_work_cv));
+	VERIFY0(pthread_cond_destroy(&zp->zp_done_cv));
+	VERIFY0(pthread_cond_destroy(&zp->zp_empty_cv));
+	free(zp->zp_threads);
+	free(zp->zp_slots);
+	free(zp);
+}
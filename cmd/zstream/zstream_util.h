@@ -26,6 +26,7 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <pthread.h>
 #include <sys/zfs_ioctl.h>
 #include <sys/zio_checksum.h>
 
@@ -53,6 +54,73 @@ extern int
 dump_record(dmu_replay_record_t *drr, void *payload, size_t payload_len,
 	zio_cksum_t *zc, int outfd);
 
+/*
+ * Ordered record pipeline.  The calling thread reads records from the
+ * stream in order and hands each one a slot; a pool of worker threads
+ * transforms the records that need CPU work (recompression, dedup
+ * resolution); an emitter thread writes the records back out in their
+ * original order, maintaining the running stream checksum.  Record
+ * framing makes the transformed records independent of each other, so
+ * only the read and emit stages need to be serial.
+ */
+
+typedef enum {
+	ZPS_EMPTY,	/* available to the reader */
+	ZPS_QUEUED,	/* filled, awaiting a worker */
+	ZPS_BUSY,	/* being transformed by a worker */
+	ZPS_DONE	/* ready for the emitter */
+} zstream_pipe_state_t;
+
+typedef struct zstream_pipe_slot {
+	dmu_replay_record_t zps_drr;
+	char *zps_payload;	/* malloc'd; freed by the emitter */
+	uint64_t zps_payload_size;
+	uint64_t zps_stream_offset;	/* scratch for the work callback */
+	boolean_t zps_fix_end_cksum;	/* patch END with running cksum */
+	zstream_pipe_state_t zps_state;
+} zstream_pipe_slot_t;
+
+typedef void (*zstream_pipe_work_f)(zstream_pipe_slot_t *, void *);
+
+typedef struct zstream_pipe {
+	pthread_mutex_t zp_lock;
+	pthread_cond_t zp_work_cv;	/* workers wait for queued slots */
+	pthread_cond_t zp_done_cv;	/* emitter waits for the next slot */
+	pthread_cond_t zp_empty_cv;	/* reader waits for a free slot */
+	zstream_pipe_slot_t *zp_slots;
+	uint_t zp_nslots;
+	uint64_t zp_head;	/* next slot the reader fills */
+	uint64_t zp_work;	/* next slot the workers will claim */
+	uint64_t zp_tail;	/* next slot the emitter writes */
+	zstream_pipe_work_f zp_func;
+	void *zp_arg;
+	pthread_t *zp_threads;	/* workers, then the emitter */
+	int zp_nthreads;
+	boolean_t zp_exit;
+	zio_cksum_t *zp_cksum;
+	int zp_outfd;
+	int zp_error;
+} zstream_pipe_t;
+
+extern zstream_pipe_t *
+zstream_pipe_create(int nthreads, zstream_pipe_work_f func, void *arg,
+	zio_cksum_t *cksum, int outfd);
+
+extern zstream_pipe_slot_t *
+zstream_pipe_slot(zstream_pipe_t *zp);
+
+extern void
+zstream_pipe_submit(zstream_pipe_t *zp, boolean_t queued);
+
+extern int
+zstream_pipe_error(zstream_pipe_t *zp);
+
+extern int
+zstream_pipe_drain(zstream_pipe_t *zp);
+
+extern void
+zstream_pipe_destroy(zstream_pipe_t *zp);
+
 #ifdef __cplusplus
 }
 #endif
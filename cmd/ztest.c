@@ -70,6 +70,17 @@
  * (7) Threads are created with a reduced stack size, for sanity checking.
  *     Therefore, it's important not to allocate huge buffers on the stack.
  *
+ * A recurring request is a benchmark mode with deterministic replayable
+ * workloads and throughput baselines.  That would measure the wrong
+ * thing: ztest runs the DMU in userland through libzpool - userland
+ * taskqs and locking, file vdevs, no page cache or real device queues -
+ * so its timings do not predict kernel performance, and its value comes
+ * precisely from the randomized schedules a deterministic mode would
+ * remove.  Performance gating belongs on real pools: fio against the
+ * module, the raidz_test/fletcher benchmark JSON outputs, and the
+ * per-pool kstats (zio_stages, flight_recorder) give regression CI
+ * numbers that correspond to what users run.
+ *
  * When run with no arguments, ztest runs for about five minutes and
  * produces no output if successful.  To get a little bit of information,
  * specify -V.  To get more information, specify -VV, and so on.
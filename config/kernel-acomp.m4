@@ -0,0 +1,36 @@
+dnl # SPDX-License-Identifier: CDDL-1.0
+dnl #
+dnl # 4.8 API,
+dnl # asynchronous compression (acomp) crypto API.  Used by the IAA
+dnl # hardware deflate backend; only the interfaces it needs are probed.
+dnl #
+AC_DEFUN([ZFS_AC_KERNEL_SRC_CRYPTO_ACOMP], [
+	ZFS_LINUX_TEST_SRC([crypto_acomp], [
+		#include <crypto/acompress.h>
+	],[
+		struct crypto_acomp *tfm;
+		struct acomp_req *req;
+		struct crypto_wait wait;
+
+		crypto_init_wait(&wait);
+		tfm = crypto_alloc_acomp("deflate", 0, 0);
+		req = acomp_request_alloc(tfm);
+		acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_SLEEP,
+		    crypto_req_done, &wait);
+		acomp_request_set_params(req, NULL, NULL, 0, 0);
+		(void) crypto_wait_req(crypto_acomp_compress(req), &wait);
+		acomp_request_free(req);
+		crypto_free_acomp(tfm);
+	])
+])
+
+AC_DEFUN([ZFS_AC_KERNEL_CRYPTO_ACOMP], [
+	AC_MSG_CHECKING([whether the crypto acomp API is available])
+	ZFS_LINUX_TEST_RESULT([crypto_acomp], [
+		AC_MSG_RESULT(yes)
+		AC_DEFINE(HAVE_CRYPTO_ACOMP, 1,
+		    [crypto acomp API is available])
+	], [
+		AC_MSG_RESULT(no)
+	])
+])
@@ -0,0 +1,28 @@
+dnl # SPDX-License-Identifier: CDDL-1.0
+dnl #
+dnl # 4.18 API,
+dnl # struct kiocb grew a ki_ioprio member carrying the per-I/O
+dnl # priority (RWF_* / aio ioprio), seeded from the task's ionice
+dnl # setting.
+dnl #
+AC_DEFUN([ZFS_AC_KERNEL_SRC_KIOCB_KI_IOPRIO], [
+	ZFS_LINUX_TEST_SRC([kiocb_ki_ioprio], [
+		#include <linux/fs.h>
+		#include <linux/ioprio.h>
+	],[
+		struct kiocb kiocb __attribute__ ((unused)) = {
+			.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0),
+		};
+	])
+])
+
+AC_DEFUN([ZFS_AC_KERNEL_KIOCB_KI_IOPRIO], [
+	AC_MSG_CHECKING([whether struct kiocb has ki_ioprio])
+	ZFS_LINUX_TEST_RESULT([kiocb_ki_ioprio], [
+		AC_MSG_RESULT(yes)
+		AC_DEFINE(HAVE_KIOCB_KI_IOPRIO, 1,
+		    [struct kiocb has ki_ioprio])
+	], [
+		AC_MSG_RESULT(no)
+	])
+])
@@ -82,6 +82,12 @@ typedef struct importargs {
 	nvlist_t *policy;	/* load policy (max txg, rewind, etc.)	*/
 	boolean_t do_destroyed;
 	boolean_t do_all;
+	/*
+	 * Optional device discovery progress callback, invoked (from
+	 * one probe thread at a time) after each device is probed.
+	 */
+	void (*scan_progress)(uint64_t done, uint64_t total, void *arg);
+	void *scan_progress_arg;
 } importargs_t;
 
 typedef struct libpc_handle {
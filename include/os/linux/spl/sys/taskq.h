@@ -39,6 +39,7 @@
 #include <sys/rwlock.h>
 #include <sys/wait.h>
 #include <sys/wmsum.h>
+#include <sys/time.h>
 #include <sys/kstat.h>
 
 #define	TASKQ_NAMELEN		31
@@ -105,6 +106,7 @@ typedef struct taskq_sums {
 	wmsum_t tqs_thread_wakeups;		/* total thread wakeups */
 	wmsum_t tqs_thread_wakeups_nowork;	/* thread woken but no tasks */
 	wmsum_t tqs_thread_sleeps;		/* total thread sleeps */
+	wmsum_t tqs_tasks_wait_ns;		/* cumulative queue wait */
 } taskq_sums_t;
 
 typedef struct taskq {
@@ -153,6 +155,7 @@ typedef struct taskq_ent {
 	taskq_t			*tqent_taskq;
 	uintptr_t		tqent_flags;
 	unsigned long		tqent_birth;
+	hrtime_t		tqent_birth_ns;	/* for queue-wait kstat */
 } taskq_ent_t;
 
 #define	TQENT_FLAG_PREALLOC	0x1
@@ -78,6 +78,27 @@ TRACE_EVENT(zfs_zio__delay__skip,
 	TP_fast_assign(ZIO_TP_FAST_ASSIGN),
 	TP_printk(ZIO_TP_PRINTK_FMT, ZIO_TP_PRINTK_ARGS)
 );
+
+/*
+ * Fired by __zio_execute() each time a zio advances to its next
+ * pipeline stage (including ZIO_STAGE_DONE).  Together with the zio
+ * identity fields this gives stage entry; the following transition of
+ * the same zio is its exit.  Stable surface for bpftrace tooling.
+ */
+TRACE_EVENT(zfs_zio__stage,
+	TP_PROTO(zio_t *zio, uint32_t stage),
+	TP_ARGS(zio, stage),
+	TP_STRUCT__entry(
+	    ZIO_TP_STRUCT_ENTRY
+	    __field(uint32_t, stage)
+	),
+	TP_fast_assign(
+	    ZIO_TP_FAST_ASSIGN
+	    __entry->stage = stage;
+	),
+	TP_printk(ZIO_TP_PRINTK_FMT " stage 0x%x",
+	    ZIO_TP_PRINTK_ARGS, __entry->stage)
+);
 /* END CSTYLED */
 
 #endif /* _TRACE_ZIO_H */
@@ -93,6 +114,7 @@ TRACE_EVENT(zfs_zio__delay__skip,
 DEFINE_DTRACE_PROBE2(zio__delay__miss);
 DEFINE_DTRACE_PROBE3(zio__delay__hit);
 DEFINE_DTRACE_PROBE1(zio__delay__skip);
+DEFINE_DTRACE_PROBE2(zio__stage);
 
 #endif /* HAVE_DECLARE_EVENT_CLASS */
 #endif /* _KERNEL */
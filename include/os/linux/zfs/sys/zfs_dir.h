@@ -63,6 +63,11 @@ extern void zfs_mknode(znode_t *, vattr_t *, dmu_tx_t *, cred_t *,
     uint_t, znode_t **, zfs_acl_ids_t *);
 extern void zfs_rmnode(znode_t *);
 extern void zfs_dl_name_switch(zfs_dirlock_t *dl, char *new, char **old);
+extern void zfs_negcache_create(zfsvfs_t *zfsvfs);
+extern void zfs_negcache_destroy(zfsvfs_t *zfsvfs);
+extern void zfs_negcache_purge(zfsvfs_t *zfsvfs);
+extern void zfs_negcache_stats_init(void);
+extern void zfs_negcache_stats_fini(void);
 extern boolean_t zfs_dirempty(znode_t *);
 extern void zfs_unlinked_add(znode_t *, dmu_tx_t *);
 extern void zfs_unlinked_drain(zfsvfs_t *zfsvfs);
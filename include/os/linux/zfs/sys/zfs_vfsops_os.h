@@ -74,6 +74,19 @@ typedef struct vfs {
 	kmutex_t	vfs_mntpt_lock;
 } vfs_t;
 
+/*
+ * Negative name-lookup cache (see zfs_dir.c).  A per-filesystem,
+ * direct-mapped, lock-striped table of (directory object, name) pairs
+ * recently confirmed absent from the directory ZAP.
+ */
+#define	ZFS_NEGCACHE_LOCKS	16
+#define	ZFS_NEGCACHE_NAMELEN	56
+
+typedef struct zfs_negcache_ent {
+	uint64_t	zne_dirobj;	/* 0 = empty slot */
+	char		zne_name[ZFS_NEGCACHE_NAMELEN];
+} zfs_negcache_ent_t;
+
 struct zfsvfs {
 	vfs_t		*z_vfs;		/* generic fs struct */
 	struct super_block *z_sb;	/* generic super_block */
@@ -139,6 +152,10 @@ struct zfsvfs {
 	avl_tree_t	*z_hold_trees;	/* znode hold trees */
 	kmutex_t	*z_hold_locks;	/* znode hold locks */
 	taskqid_t	z_drain_task;	/* task id for the unlink drain task */
+	uint64_t	z_drain_inflight; /* parallel drain deletions */
+	zfs_negcache_ent_t *z_negcache;	/* negative name-lookup cache */
+	uint32_t	z_negcache_mask;
+	kmutex_t	z_negcache_locks[ZFS_NEGCACHE_LOCKS];
 };
 
 #define	ZFS_TEARDOWN_INIT(zfsvfs)		\
@@ -220,6 +220,7 @@ typedef enum arc_space_type {
 	ARC_SPACE_META,
 	ARC_SPACE_HDRS,
 	ARC_SPACE_L2HDRS,
+	ARC_SPACE_CRYPT_HDRS,
 	ARC_SPACE_DBUF,
 	ARC_SPACE_DNODE,
 	ARC_SPACE_BONUS,
@@ -318,6 +319,9 @@ int arc_referenced(arc_buf_t *buf);
 int arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
     arc_read_done_func_t *done, void *priv, zio_priority_t priority,
     int flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb);
+int arc_read_range(zio_t *pio, spa_t *spa, const blkptr_t *bps, int nbps,
+    arc_read_done_func_t *done, void **privates, zio_priority_t priority,
+    int flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb);
 zio_t *arc_write(zio_t *pio, spa_t *spa, uint64_t txg, blkptr_t *bp,
     arc_buf_t *buf, boolean_t uncached, boolean_t l2arc, const zio_prop_t *zp,
     arc_write_done_func_t *ready, arc_write_done_func_t *child_ready,
@@ -357,6 +361,12 @@ void l2arc_fini(void);
 void l2arc_spa_rebuild_start(spa_t *spa);
 void l2arc_spa_rebuild_stop(spa_t *spa);
 
+void arc_warmup_init(void);
+void arc_warmup_fini(void);
+void arc_warmup_sync(spa_t *spa, uint64_t txg);
+void arc_warmup_restore_start(spa_t *spa);
+void arc_warmup_stop(spa_t *spa);
+
 #ifndef _KERNEL
 extern boolean_t arc_watch;
 #endif
@@ -146,6 +146,7 @@ struct arc_callback {
 	kmutex_t		acb_wait_lock;
 	kcondvar_t		acb_wait_cv;
 	zbookmark_phys_t	acb_zb;
+	hrtime_t		acb_start;	/* for latency histogram */
 	zio_t			*acb_zio_dummy;
 	zio_t			*acb_zio_head;
 	arc_callback_t		*acb_prev;
@@ -191,7 +192,10 @@ struct arc_write_callback {
  * when a header is actually in the L1 cache. The sub-headers (l1arc_buf_hdr and
  * l2arc_buf_hdr) are embedded rather than allocated separately to save a couple
  * words in pointers. arc_hdr_realloc() is used to switch a header between
- * these two allocation states.
+ * these two allocation states.  The encryption parameters of protected
+ * headers (arc_buf_hdr_crypt_t) are the exception: they are rare enough
+ * that they are allocated separately and hung off b_crypt_hdr only when
+ * ARC_FLAG_PROTECTED is set.
  */
 typedef struct l1arc_buf_hdr {
 	/* protected by arc state mutex */
@@ -530,7 +534,7 @@ struct arc_buf_hdr {
 
 	arc_buf_contents_t	b_type;
 	uint8_t			b_complevel;
-	uint8_t			b_reserved1;	/* used for 4 byte alignment */
+	uint8_t			b_numa_node;	/* allocating NUMA node */
 	uint16_t		b_l2size;	/* alignment or L2-only size */
 	arc_buf_hdr_t		*b_hash_next;
 	arc_flags_t		b_flags;
@@ -567,10 +571,11 @@ struct arc_buf_hdr {
 	/* L1ARC fields. Undefined when in l2arc_only state */
 	l1arc_buf_hdr_t		b_l1hdr;
 	/*
-	 * Encryption parameters. Defined only when ARC_FLAG_ENCRYPTED
-	 * is set and the L1 header exists.
+	 * Encryption parameters. Allocated separately from
+	 * hdr_crypt_cache when ARC_FLAG_PROTECTED is set and the L1
+	 * header exists, so unencrypted headers do not carry them.
 	 */
-	arc_buf_hdr_crypt_t b_crypt_hdr;
+	arc_buf_hdr_crypt_t *b_crypt_hdr;
 };
 
 typedef struct arc_stats {
@@ -596,6 +601,12 @@ typedef struct arc_stats {
 	kstat_named_t arcstat_prefetch_metadata_hits;
 	kstat_named_t arcstat_prefetch_metadata_iohits;
 	kstat_named_t arcstat_prefetch_metadata_misses;
+	/*
+	 * Number of prefetched headers speculatively converted to
+	 * uncompressed storage (and requests skipped or failed).
+	 */
+	kstat_named_t arcstat_decompress_ahead;
+	kstat_named_t arcstat_decompress_ahead_skip;
 	kstat_named_t arcstat_mru_hits;
 	kstat_named_t arcstat_mru_ghost_hits;
 	kstat_named_t arcstat_mfu_hits;
@@ -672,6 +683,12 @@ typedef struct arc_stats {
 	 * cache).
 	 */
 	kstat_named_t arcstat_hdr_size;
+	/*
+	 * Number of bytes consumed by the out-of-line encryption
+	 * parameters of protected headers (allocated via the
+	 * arc_buf_hdr_crypt_t cache).
+	 */
+	kstat_named_t arcstat_crypt_hdr_size;
 	/*
 	 * Number of bytes consumed by ARC buffers of type equal to
 	 * ARC_BUFC_DATA. This is generally consumed by buffers backing
@@ -935,6 +952,14 @@ typedef struct arc_stats {
 	 * log block may hold up to L2ARC_LOG_BLK_MAX_ENTRIES buffers.
 	 */
 	kstat_named_t arcstat_l2_rebuild_log_blks;
+	/*
+	 * Number of L2ARC log blocks, and their aligned size, that rebuilds
+	 * started since module load expect to restore, taken from the device
+	 * headers.  Comparing these against l2_rebuild_log_blks and
+	 * l2_log_blk_asize gives the progress of in-flight rebuilds.
+	 */
+	kstat_named_t arcstat_l2_rebuild_expected_log_blks;
+	kstat_named_t arcstat_l2_rebuild_expected_lb_asize;
 	kstat_named_t arcstat_memory_throttle_count;
 	kstat_named_t arcstat_memory_direct_count;
 	kstat_named_t arcstat_memory_indirect_count;
@@ -983,6 +1008,8 @@ typedef struct arc_sums {
 	wmsum_t arcstat_prefetch_metadata_hits;
 	wmsum_t arcstat_prefetch_metadata_iohits;
 	wmsum_t arcstat_prefetch_metadata_misses;
+	wmsum_t arcstat_decompress_ahead;
+	wmsum_t arcstat_decompress_ahead_skip;
 	wmsum_t arcstat_mru_hits;
 	wmsum_t arcstat_mru_ghost_hits;
 	wmsum_t arcstat_mfu_hits;
@@ -1007,6 +1034,7 @@ typedef struct arc_sums {
 	wmsum_t arcstat_uncompressed_size;
 	wmsum_t arcstat_overhead_size;
 	wmsum_t arcstat_hdr_size;
+	wmsum_t arcstat_crypt_hdr_size;
 	wmsum_t arcstat_data_size;
 	wmsum_t arcstat_metadata_size;
 	wmsum_t arcstat_dbuf_size;
@@ -1051,6 +1079,8 @@ typedef struct arc_sums {
 	wmsum_t arcstat_l2_rebuild_bufs;
 	wmsum_t arcstat_l2_rebuild_bufs_precached;
 	wmsum_t arcstat_l2_rebuild_log_blks;
+	wmsum_t arcstat_l2_rebuild_expected_log_blks;
+	wmsum_t arcstat_l2_rebuild_expected_lb_asize;
 	wmsum_t arcstat_memory_throttle_count;
 	wmsum_t arcstat_memory_direct_count;
 	wmsum_t arcstat_memory_indirect_count;
@@ -1130,6 +1160,8 @@ extern int64_t arc_available_memory(void);
 extern void arc_tuning_update(boolean_t);
 extern void arc_register_hotplug(void);
 extern void arc_unregister_hotplug(void);
+extern uint_t arc_numa_node_count(void);
+extern uint_t arc_numa_current_node(void);
 
 extern int param_set_arc_u64(ZFS_MODULE_PARAM_ARGS);
 extern int param_set_arc_int(ZFS_MODULE_PARAM_ARGS);
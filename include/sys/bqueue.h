@@ -39,6 +39,21 @@ typedef struct bqueue {
 	size_t bq_maxsize;
 	uint_t bq_fill_fraction;
 	size_t bq_node_offset;
+	/*
+	 * Lock-free ring mode (see zfs_bqueue_lockfree).  The producer owns
+	 * bq_pidx and the consumer owns bq_cidx; each reads the other's
+	 * index with a plain atomic load.  bq_lock and the condition
+	 * variables above are then only taken to sleep, never on the
+	 * enqueue/dequeue fast paths.
+	 */
+	boolean_t bq_lockfree;
+	void **bq_ring;
+	uint64_t bq_ring_bytes;
+	uint64_t bq_ring_mask;
+	uint64_t bq_pidx;
+	uint64_t bq_cidx;
+	boolean_t bq_enq_waiting;
+	boolean_t bq_deq_waiting;
 } bqueue_t;
 
 typedef struct bqueue_node {
@@ -49,6 +64,8 @@ typedef struct bqueue_node {
 
 int bqueue_init(bqueue_t *, uint_t, size_t, size_t);
 void bqueue_destroy(bqueue_t *);
+void bqueue_stats_init(void);
+void bqueue_stats_fini(void);
 void bqueue_enqueue(bqueue_t *, void *, size_t);
 void bqueue_enqueue_flush(bqueue_t *, void *, size_t);
 void *bqueue_dequeue(bqueue_t *);
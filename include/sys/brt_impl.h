@@ -63,6 +63,9 @@ _Static_assert(BRT_RANGESIZE / SPA_MINBLOCKSIZE <= UINT16_MAX,
  * bitmap means that we had a change in at least one of the 16384 entcounts
  * that reside on a 32kB disk block (32kB / sizeof (uint16_t)).
  */
+/* Lock-striping shards for each vdev's pending clone trees. */
+#define	BRT_PENDING_SHARDS	8
+
 #define	BRT_BLOCKSIZE	(32 * 1024)
 #define	BRT_RANGESIZE_TO_NBLOCKS(size)					\
 	(((size) - 1) / (BRT_BLOCKSIZE / sizeof (uint16_t)) + 1)
@@ -91,8 +94,14 @@ struct brt_vdev {
 	/*
 	 * Pending changes from open contexts.
 	 */
-	kmutex_t	bv_pending_lock;
-	avl_tree_t	bv_pending_tree[TXG_SIZE];
+	/*
+	 * Pending clone references are sharded by block offset so
+	 * concurrent cloners stripe across locks instead of
+	 * serializing per vdev; each shard's ZAP updates are still
+	 * batched in syncing context by brt_pending_apply().
+	 */
+	kmutex_t	bv_pending_lock[BRT_PENDING_SHARDS];
+	avl_tree_t	bv_pending_tree[TXG_SIZE][BRT_PENDING_SHARDS];
 	/*
 	 * Protects bv_mos_*.
 	 */
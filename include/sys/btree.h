@@ -30,7 +30,13 @@ extern "C" {
  * This file defines the interface for a B-Tree implementation for ZFS. The
  * tree can be used to store arbitrary sortable data types with low overhead
  * and good operation performance. In addition the tree intelligently
- * optimizes bulk in-order insertions to improve memory use and performance.
+ * optimizes bulk in-order insertions to improve memory use and performance:
+ * while a tree has only ever been appended to in sorted order, inserts
+ * bypass the root-to-leaf search, append into the fully packed last leaf
+ * in constant time, and never rebalance, giving sorted builds (such as
+ * replaying a condensed space map into a range tree) the bottom-up
+ * construction cost without a separate bulk-load entry point.  The first
+ * out-of-order insert ends bulk mode and the tree behaves normally.
  *
  * Note that for all B-Tree functions, the values returned are pointers to the
  * internal copies of the data in the tree. The internal data can only be
@@ -33,6 +33,16 @@
 #include <sys/kstat.h>
 #include <sys/zil.h>
 
+/*
+ * Log2 operation-latency histogram buckets.  Bucket 0 counts operations
+ * under 4us (2^12 ns); bucket i counts those in [2^(11+i), 2^(12+i))
+ * ns; the last bucket is a catch-all for everything from ~34s up.
+ * Only populated when zfs_dataset_latency_histo is set, so the
+ * disabled cost is a branch per operation.
+ */
+#define	DK_LAT_BUCKETS	25
+#define	DK_LAT_SHIFT	12
+
 typedef struct dataset_sum_stats_t {
 	wmsum_t dss_writes;
 	wmsum_t dss_nwritten;
@@ -40,6 +50,11 @@ typedef struct dataset_sum_stats_t {
 	wmsum_t dss_nread;
 	wmsum_t dss_nunlinks;
 	wmsum_t dss_nunlinked;
+	wmsum_t dss_ios_pending;
+	wmsum_t dss_io_time_ns;
+	wmsum_t dss_read_lat[DK_LAT_BUCKETS];
+	wmsum_t dss_write_lat[DK_LAT_BUCKETS];
+	wmsum_t dss_sync_lat[DK_LAT_BUCKETS];
 } dataset_sum_stats_t;
 
 typedef struct dataset_kstat_values {
@@ -58,6 +73,17 @@ typedef struct dataset_kstat_values {
 	 * entry is removed from the unlinked set
 	 */
 	kstat_named_t dkv_nunlinked;
+	/*
+	 * I/Os currently queued or in flight, and cumulative service time.
+	 * Only maintained for zvols, where requests have a well-defined
+	 * dispatch-to-completion lifetime; zero for filesystems.
+	 */
+	kstat_named_t dkv_ios_pending;
+	kstat_named_t dkv_io_time_ns;
+	/* log2 operation latency histograms (see DK_LAT_BUCKETS) */
+	kstat_named_t dkv_read_lat[DK_LAT_BUCKETS];
+	kstat_named_t dkv_write_lat[DK_LAT_BUCKETS];
+	kstat_named_t dkv_sync_lat[DK_LAT_BUCKETS];
 	/*
 	 * Per dataset zil kstats
 	 */
@@ -79,5 +105,12 @@ void dataset_kstats_update_read_kstats(dataset_kstats_t *, int64_t);
 
 void dataset_kstats_update_nunlinks_kstat(dataset_kstats_t *, int64_t);
 void dataset_kstats_update_nunlinked_kstat(dataset_kstats_t *, int64_t);
+void dataset_kstats_update_pending_kstat(dataset_kstats_t *, int64_t);
+void dataset_kstats_record_io_time_kstat(dataset_kstats_t *, int64_t);
+
+extern int zfs_dataset_latency_histo;
+void dataset_kstats_record_read_lat(dataset_kstats_t *, int64_t);
+void dataset_kstats_record_write_lat(dataset_kstats_t *, int64_t);
+void dataset_kstats_record_sync_lat(dataset_kstats_t *, int64_t);
 
 #endif /* _SYS_DATASET_KSTATS_H */
@@ -337,10 +337,34 @@ typedef struct dbuf_hash_table {
 	uint64_t hash_mutex_mask;
 	dmu_buf_impl_t **hash_table;
 	kmutex_t *hash_mutexes;
+	/*
+	 * Online resize state, written only by dbuf_hash_grow_thread()
+	 * under the hash mutexes.  While hash_resizing is set, old
+	 * buckets at or above hash_migrated still live in
+	 * hash_old_table; everything below it has been moved to
+	 * hash_new_table.  See dbuf_hash_bucket() for the lookup rules.
+	 */
+	uint_t hash_resizing;
+	uint64_t hash_migrated;
+	uint64_t hash_old_mask;
+	dmu_buf_impl_t **hash_old_table;
+	uint64_t hash_new_mask;
+	dmu_buf_impl_t **hash_new_table;
 } dbuf_hash_table_t;
 
 typedef void (*dbuf_prefetch_fn)(void *, uint64_t, uint64_t, boolean_t);
 
+/*
+ * One entry of an ARC warmup snapshot: the identity of a cached
+ * level-0 dbuf, replayable through dmu_prefetch().
+ */
+typedef struct arc_warmup_rec {
+	uint64_t	awr_objset;	/* dsl dataset object number */
+	uint64_t	awr_object;
+	uint64_t	awr_offset;
+	uint64_t	awr_size;
+} arc_warmup_rec_t;
+
 extern kmem_cache_t *dbuf_dirty_kmem_cache;
 
 uint64_t dbuf_whichblock(const struct dnode *di, const int64_t level,
@@ -417,6 +441,8 @@ void dbuf_evict_range(struct dnode *dn, uint64_t start_blkid,
 void dbuf_new_size(dmu_buf_impl_t *db, int size, dmu_tx_t *tx);
 
 void dbuf_stats_init(dbuf_hash_table_t *hash);
+uint64_t dbuf_warmup_collect(spa_t *spa, arc_warmup_rec_t *recs,
+    uint64_t maxrecs);
 void dbuf_stats_destroy(void);
 
 int dbuf_dnode_findbp(dnode_t *dn, uint64_t level, uint64_t blkid,
@@ -32,6 +32,7 @@
 #include <sys/types.h>
 #include <sys/fs/zfs.h>
 #include <sys/zio.h>
+#include <sys/zthr.h>
 #include <sys/dmu.h>
 #include <sys/wmsum.h>
 
@@ -275,6 +276,9 @@ typedef struct {
 	ddt_key_t	ddl_checkpoint;	/* last checkpoint */
 } ddt_log_t;
 
+/* Lock stripes for the negative lookup cache */
+#define	DDT_NEG_CACHE_LOCKS	16
+
 /*
  * In-core DDT object. This covers all entries and stats for a the whole pool
  * for a given checksum type.
@@ -303,6 +307,20 @@ typedef struct {
 
 	uint64_t	ddt_flush_force_txg;	/* flush hard before this txg */
 
+	/*
+	 * Negative lookup cache: a direct-mapped, lock-striped table of
+	 * keys recently confirmed absent from every entry store object,
+	 * letting unique-write lookups skip the store probes entirely.
+	 * Only consulted after the live tree and the logs have missed, and
+	 * invalidated whenever a key is written to a store object during
+	 * sync, which together keep it coherent: a store object only gains
+	 * an entry after that entry has passed through the live tree, and
+	 * before it leaves the tree or the logs.
+	 */
+	ddt_key_t	*ddt_neg_cache;
+	uint32_t	ddt_neg_cache_mask;
+	kmutex_t	ddt_neg_cache_locks[DDT_NEG_CACHE_LOCKS];
+
 	kstat_t		*ddt_ksp;	/* kstats context */
 
 	/* wmsums for hot-path lookup counters */
@@ -318,6 +336,7 @@ typedef struct {
 	wmsum_t		ddt_kstat_dds_lookup_log_miss;
 	wmsum_t		ddt_kstat_dds_lookup_stored_hit;
 	wmsum_t		ddt_kstat_dds_lookup_stored_miss;
+	wmsum_t		ddt_kstat_dds_lookup_absent_hit;
 
 	enum zio_checksum ddt_checksum;	/* checksum algorithm in use */
 	spa_t		*ddt_spa;	/* pool this ddt is on */
@@ -436,6 +455,8 @@ extern boolean_t ddt_addref(spa_t *spa, const blkptr_t *bp);
 
 extern int ddt_prune_unique_entries(spa_t *spa, zpool_ddt_prune_unit_t unit,
     uint64_t amount);
+extern boolean_t ddt_prune_thread_check(void *arg, zthr_t *zthr);
+extern void ddt_prune_thread(void *arg, zthr_t *zthr);
 
 #ifdef	__cplusplus
 }
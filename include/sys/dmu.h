@@ -414,6 +414,7 @@ typedef struct dmu_buf {
 #define	DMU_POOL_ZPOOL_CHECKPOINT	"com.delphix:zpool_checkpoint"
 #define	DMU_POOL_LOG_SPACEMAP_ZAP	"com.delphix:log_spacemap_zap"
 #define	DMU_POOL_DELETED_CLONES		"com.delphix:deleted_clones"
+#define	DMU_POOL_ARC_WARMUP		"com.openzfs:arc_warmup"
 #define	DMU_POOL_TXG_LOG_TIME_MINUTES	"com.klarasystems:txg_log_time:minutes"
 #define	DMU_POOL_TXG_LOG_TIME_DAYS	"com.klarasystems:txg_log_time:days"
 #define	DMU_POOL_TXG_LOG_TIME_MONTHS	"com.klarasystems:txg_log_time:months"
@@ -574,6 +575,7 @@ typedef enum dmu_flags {
 	DMU_PARTIAL_MORE	= 1 << 8, /* Following partial access. */
 	DMU_KEEP_CACHING	= 1 << 9, /* Don't affect caching. */
 	DMU_IS_PREFETCH		= 1 << 10, /* This read is a prefetch. */
+	DMU_LOWPRI		= 1 << 11, /* Demand read at prefetch prio. */
 } dmu_flags_t;
 
 /*
@@ -208,8 +208,12 @@ extern "C" {
  *   protects:
  *   	os_dirty_dnodes
  *   	os_free_dnodes
- *   	os_dnodes
  *   	os_downgraded_dbufs
+ *   	dn_objset (stability for dnode_move())
+ *
+ * ods_lock (leaf, one per os_dnodes shard)
+ *   protects:
+ *   	os_dnodes
  *   	dn_dirtyblksz
  *   	dn_dirty_link
  *   held from:
@@ -100,6 +100,16 @@ typedef struct objset_phys {
 typedef int (*dmu_objset_upgrade_cb_t)(objset_t *);
 
 #define	OBJSET_PROP_UNINITIALIZED	((uint64_t)-1)
+#define	OS_DNODE_SHARDS	16
+
+typedef struct objset_dnode_shard {
+	kmutex_t	ods_lock;
+	list_t		ods_list;
+} objset_dnode_shard_t;
+
+#define	OS_DNODE_SHARD(os, obj) \
+	(&(os)->os_dnodes[(obj) & (OS_DNODE_SHARDS - 1)])
+
 struct objset {
 	/* Immutable: */
 	struct dsl_dataset *os_dsl_dataset;
@@ -134,6 +144,7 @@ struct objset {
 	zfs_cache_type_t os_primary_cache;
 	zfs_cache_type_t os_secondary_cache;
 	zfs_prefetch_type_t os_prefetch;
+	boolean_t os_alloc_locality;
 	zfs_sync_type_t os_sync;
 	zfs_direct_t os_direct;
 	zfs_redundant_metadata_type_t os_redundant_metadata;
@@ -183,11 +194,39 @@ struct objset {
 	/* Protected by os_lock */
 	kmutex_t os_lock;
 	multilist_t os_dirty_dnodes[TXG_SIZE];
-	list_t os_dnodes;
 	list_t os_downgraded_dbufs;
 
-	/* Protects changes to DMU_{USER,GROUP,PROJECT}USED_OBJECT */
+	/*
+	 * All non-special dnodes of the objset, sharded by object number
+	 * so parallel create/destroy workloads do not serialize on one
+	 * lock.  os_dnode_count counts the entries of every shard plus
+	 * one reference dropped by dmu_objset_evict(); whoever brings it
+	 * to zero completes the objset eviction.
+	 */
+	objset_dnode_shard_t os_dnodes[OS_DNODE_SHARDS];
+	uint64_t os_dnode_count;
+
+	/*
+	 * Token bucket implementing the writelimit property: bytes of
+	 * write admission credit, refilled at os_write_limit bytes per
+	 * second.  Zero limit means unthrottled.
+	 */
+	uint64_t os_write_limit;
+	kmutex_t os_wr_bucket_lock;
+	int64_t os_wr_bucket_tokens;
+	hrtime_t os_wr_bucket_time;
+
+	/*
+	 * Protect changes to DMU_{USER,GROUP,PROJECT}USED_OBJECT
+	 * respectively; one lock per ZAP so the sync-time flush tasks
+	 * only serialize per object, not across all three.
+	 */
 	kmutex_t os_userused_lock;
+	kmutex_t os_groupused_lock;
+	kmutex_t os_projectused_lock;
+
+	/* bytes this objset holds in the metadata dbuf cache */
+	uint64_t os_dbuf_md_cache_size;
 
 	/* stuff we store for the user */
 	kmutex_t os_user_ptr_lock;
@@ -123,6 +123,7 @@ typedef struct dmu_tx_callback {
 typedef struct dmu_tx_stats {
 	kstat_named_t dmu_tx_assigned;
 	kstat_named_t dmu_tx_delay;
+	kstat_named_t dmu_tx_wrlimit_delay;
 	kstat_named_t dmu_tx_error;
 	kstat_named_t dmu_tx_suspended;
 	kstat_named_t dmu_tx_group;
@@ -41,7 +41,7 @@ struct dnode;				/* so we can reference dnode */
 
 typedef struct zfetch {
 	kmutex_t	zf_lock;	/* protects zfetch structure */
-	list_t		zf_stream;	/* list of zstream_t's */
+	avl_tree_t	zf_stream;	/* zstream_t's ordered by zs_blkid */
 	struct dnode	*zf_dnode;	/* dnode that owns this zfetch */
 	int		zf_numstreams;	/* number of zstream_t's */
 } zfetch_t;
@@ -51,10 +51,10 @@ typedef struct zsrange {
 	uint16_t	end;
 } zsrange_t;
 
-#define	ZFETCH_RANGES	9		/* Fits zstream_t into 128 bytes */
+#define	ZFETCH_RANGES	7		/* Fits zstream_t into 128 bytes */
 
 typedef struct zstream {
-	list_node_t	zs_node;	/* link for zf_stream */
+	avl_node_t	zs_node;	/* link for zf_stream */
 	uint64_t	zs_blkid;	/* expect next access at this blkid */
 	uint_t		zs_atime;	/* time last prefetch issued */
 	zsrange_t	zs_ranges[ZFETCH_RANGES]; /* ranges from future */
@@ -282,7 +282,10 @@ struct dnode {
 	 */
 	krwlock_t dn_struct_rwlock;
 
-	/* Our link on dn_objset->os_dnodes list; protected by os_lock.  */
+	/*
+	 * Our link on the dn_objset->os_dnodes shard for our object
+	 * number; protected by that shard's ods_lock.
+	 */
 	list_node_t dn_link;
 
 	/* immutable: */
@@ -564,6 +567,7 @@ typedef struct dnode_stats {
 	 * object ID chunk and advanced to a new one.
 	 */
 	kstat_named_t dnode_alloc_next_chunk;
+	kstat_named_t dnode_alloc_next_chunk_lock;
 	/*
 	 * Number of times multiple threads attempted to allocate a dnode
 	 * from the same block of free dnodes.
@@ -606,6 +610,7 @@ typedef struct dnode_sums {
 	wmsum_t dnode_reallocate;
 	wmsum_t dnode_buf_evict;
 	wmsum_t dnode_alloc_next_chunk;
+	wmsum_t dnode_alloc_next_chunk_lock;
 	wmsum_t dnode_alloc_race;
 	wmsum_t dnode_alloc_next_block;
 	wmsum_t dnode_move_invalid;
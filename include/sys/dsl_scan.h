@@ -128,6 +128,15 @@ typedef struct dsl_errorscrub_phys {
 typedef struct dsl_scan {
 	struct dsl_pool *scn_dp;
 	uint64_t scn_restart_txg;
+	/*
+	 * Rotating-slice incremental scrub state: while scn_skip_max is
+	 * nonzero, blocks born in (scn_skip_min, scn_skip_max] are not
+	 * verified - they belong to old-block slices covered by other
+	 * rotations.  Persisted next to the scan state so a resumed
+	 * scrub keeps the same coverage.
+	 */
+	uint64_t scn_skip_min;
+	uint64_t scn_skip_max;
 	uint64_t scn_done_txg;
 	uint64_t scn_sync_start_time;
 	uint64_t scn_issued_before_pass;
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+#ifndef	_SYS_IAA_H
+#define	_SYS_IAA_H
+
+typedef enum iaa_compress_dir {
+	IAA_DECOMPRESS = 0,
+	IAA_COMPRESS = 1,
+} iaa_compress_dir_t;
+
+#if defined(_KERNEL) && defined(__linux__) && defined(HAVE_CRYPTO_ACOMP)
+#include <sys/types.h>
+#include <sys/kstat.h>
+
+/*
+ * Offload is only worthwhile once the block is large enough to
+ * amortize the descriptor submission cost; the upper bound matches
+ * the largest buffer a single IAA descriptor handles without
+ * splitting.
+ */
+#define	IAA_MIN_BUF_SIZE	(4*1024)
+#define	IAA_MAX_BUF_SIZE	(1024*1024)
+
+/*
+ * Used for IAA kstat.
+ */
+typedef struct iaa_stats {
+	/*
+	 * Number of jobs submitted to the IAA compression engine.
+	 */
+	kstat_named_t comp_requests;
+	/*
+	 * Total bytes sent to the IAA compression engine.
+	 */
+	kstat_named_t comp_total_in_bytes;
+	/*
+	 * Total bytes output from the IAA compression engine.
+	 */
+	kstat_named_t comp_total_out_bytes;
+	/*
+	 * Number of jobs submitted to the IAA de-compression engine.
+	 */
+	kstat_named_t decomp_requests;
+	/*
+	 * Total bytes sent to the IAA de-compression engine.
+	 */
+	kstat_named_t decomp_total_in_bytes;
+	/*
+	 * Total bytes output from the IAA de-compression engine.
+	 */
+	kstat_named_t decomp_total_out_bytes;
+	/*
+	 * Number of fails in the IAA compression / decompression engine.
+	 * Note: when an IAA error happens, it doesn't necessarily indicate
+	 * a critical hardware issue.  Sometimes it is because the output
+	 * buffer is not big enough.  The compression job will be
+	 * transferred to the gzip software implementation so the
+	 * functionality of ZFS is not impacted.
+	 */
+	kstat_named_t dc_fails;
+} iaa_stats_t;
+
+#define	IAA_STAT_INCR(stat, val) \
+	atomic_add_64(&iaa_stats.stat.value.ui64, (val))
+#define	IAA_STAT_BUMP(stat) \
+	IAA_STAT_INCR(stat, 1)
+
+extern iaa_stats_t iaa_stats;
+extern int zfs_iaa_compress_disable;
+
+extern int iaa_init(void);
+extern void iaa_fini(void);
+extern boolean_t iaa_dc_use_accel(size_t s_len);
+extern int iaa_compress(iaa_compress_dir_t dir, char *src, int src_len,
+    char *dst, int dst_len, size_t *c_len);
+
+#else
+#define	iaa_init()
+#define	iaa_fini()
+#define	iaa_dc_use_accel(s_len)			((void) sizeof (s_len), 0)
+#define	iaa_compress(dir, s, sl, d, dl, cl)			\
+	((void) sizeof (dir), (void) sizeof (s), (void) sizeof (sl), \
+	    (void) sizeof (d), (void) sizeof (dl), (void) sizeof (cl), -1)
+#endif
+
+#endif /* _SYS_IAA_H */
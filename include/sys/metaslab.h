@@ -64,6 +64,9 @@ uint64_t metaslab_unflushed_changes_memused(metaslab_t *);
 int metaslab_load(metaslab_t *);
 void metaslab_unload(metaslab_t *);
 boolean_t metaslab_flush(metaslab_t *, dmu_tx_t *);
+int metaslab_flush_start(metaslab_t *, dmu_tx_t *);
+void metaslab_flush_write(metaslab_t *, dmu_tx_t *);
+void metaslab_flush_finish(metaslab_t *, dmu_tx_t *);
 
 uint64_t metaslab_allocated_space(metaslab_t *);
 
@@ -79,6 +82,7 @@ uint64_t metaslab_largest_allocatable(metaslab_t *);
 #define	METASLAB_GANG_HEADER		0x2
 #define	METASLAB_GANG_CHILD		0x4
 #define	METASLAB_ASYNC_ALLOC		0x8
+#define	METASLAB_LOCALITY		0x10
 
 int metaslab_alloc(spa_t *, metaslab_class_t *, uint64_t, blkptr_t *, int,
     uint64_t, const blkptr_t *, int, zio_alloc_list_t *, int, const void *);
@@ -92,6 +96,8 @@ void metaslab_free_concrete(vdev_t *, uint64_t, uint64_t, boolean_t);
 void metaslab_free_dva(spa_t *, const dva_t *, boolean_t);
 void metaslab_free_impl_cb(uint64_t, vdev_t *, uint64_t, uint64_t, void *);
 void metaslab_unalloc_dva(spa_t *, const dva_t *, uint64_t);
+void metaslab_magazines_drain(spa_t *, uint64_t);
+uint64_t metaslab_class_leaf_latency(metaslab_class_t *);
 int metaslab_claim(spa_t *, const blkptr_t *, uint64_t);
 int metaslab_claim_impl(vdev_t *, uint64_t, uint64_t, uint64_t);
 void metaslab_check_free(spa_t *, const blkptr_t *);
@@ -147,6 +147,22 @@ typedef struct metaslab_class_allocator {
 	metaslab_group_t	*mca_rotor;
 	uint64_t		mca_aliquot;
 
+	/*
+	 * Magazine of pre-allocated space for small single-copy
+	 * allocations: the remainder of an intentionally inflated
+	 * allocation, valid only within mca_mag_txg and consumed O(1)
+	 * under mca_mag_lock instead of searching a metaslab's range
+	 * tree.  Whatever is left is returned through the normal free
+	 * path by metaslab_magazines_drain() before that txg's
+	 * metaslabs sync.
+	 */
+	kmutex_t		mca_mag_lock;
+	uint64_t		mca_mag_vdev;
+	uint64_t		mca_mag_offset;
+	uint64_t		mca_mag_size;
+	uint64_t		mca_mag_txg;
+	boolean_t		mca_mag_refilling;
+
 	/*
 	 * The allocation throttle works on a reservation system. Whenever
 	 * an asynchronous zio wants to perform an allocation it must
@@ -196,6 +212,14 @@ struct metaslab_class {
 	boolean_t		mc_alloc_throttle_enabled;
 	uint64_t		mc_alloc_io_size;
 	uint64_t		mc_alloc_max;
+	/*
+	 * Closed-loop scale (percent) applied to mc_alloc_max when
+	 * zfs_alloc_latency_target_ms is set; adjusted once per txg
+	 * from the leaves' observed I/O latency.
+	 */
+	uint_t			mc_throttle_scale;
+	/* Worst leaf I/O latency average sampled at last sync. */
+	uint64_t		mc_last_leaf_latency;
 
 	uint64_t		mc_alloc_groups; /* # of allocatable groups */
 
@@ -74,6 +74,8 @@ struct multilist {
 
 void multilist_create(multilist_t *, size_t, size_t,
     multilist_sublist_index_func_t *);
+void multilist_create_num(multilist_t *, size_t, size_t, uint_t,
+    multilist_sublist_index_func_t *);
 void multilist_destroy(multilist_t *);
 
 void multilist_insert(multilist_t *, void *);
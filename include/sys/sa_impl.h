@@ -135,7 +135,15 @@ typedef struct sa_idx_tab {
  * adding a completely new attribute is a very rare operation.
  */
 struct sa_os {
-	kmutex_t 	sa_lock;
+	/*
+	 * Protects the layout trees, each layout's idx-tab list, and
+	 * registry/callback state.  Read-mostly: every SA handle built
+	 * (one per znode inflated) searches the layout and idx-tab
+	 * structures, while new layouts and idx tabs appear rarely, so
+	 * lookups take this as reader and only mutations take it as
+	 * writer.
+	 */
+	krwlock_t 	sa_lock;
 	boolean_t	sa_need_attr_registration;
 	boolean_t	sa_force_spill;
 	uint64_t	sa_master_obj;
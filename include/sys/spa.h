@@ -815,6 +815,7 @@ extern int bpobj_enqueue_free_cb(void *arg, const blkptr_t *bp, dmu_tx_t *tx);
 #define	SPA_ASYNC_REBUILD_DONE			0x2000
 #define	SPA_ASYNC_DETACH_SPARE			0x4000
 #define	SPA_ASYNC_REMOVE_BY_USER		0x8000
+#define	SPA_ASYNC_ARC_WARMUP_RESTORE		0x10000
 
 /* device manipulation */
 extern int spa_vdev_add(spa_t *spa, nvlist_t *nvroot, boolean_t ashift_check);
@@ -944,6 +945,8 @@ typedef struct spa_stats {
 	spa_history_kstat_t	state;		/* pool state */
 	spa_history_kstat_t	guid;		/* pool guid */
 	spa_history_kstat_t	iostats;
+	spa_history_kstat_t	zio_stages;
+	spa_history_kstat_t	flight;		/* I/O flight recorder */
 } spa_stats_t;
 
 typedef enum txg_state {
@@ -990,6 +993,9 @@ typedef struct spa_iostats {
 	kstat_named_t	direct_read_bytes;
 	kstat_named_t	direct_write_count;
 	kstat_named_t	direct_write_bytes;
+	kstat_named_t	gang_writes;
+	kstat_named_t	gang_multilevel;
+	kstat_named_t	gang_avoided_try_hard;
 } spa_iostats_t;
 
 extern void spa_stats_init(spa_t *spa);
@@ -1013,6 +1019,10 @@ extern void spa_iostats_trim_add(spa_t *spa, trim_type_t type,
     uint64_t extents_written, uint64_t bytes_written,
     uint64_t extents_skipped, uint64_t bytes_skipped,
     uint64_t extents_failed, uint64_t bytes_failed);
+extern void spa_iostats_gang_add(spa_t *spa, boolean_t multilevel);
+extern void spa_iostats_gang_avoided_add(spa_t *spa);
+extern void spa_zio_stage_add(spa_t *spa, uint_t stage_shift, uint64_t nsec);
+extern void spa_flight_record(spa_t *spa, struct zio *zio);
 extern void spa_iostats_read_add(spa_t *spa, uint64_t size, uint64_t iops,
     dmu_flags_t flags);
 extern void spa_iostats_write_add(spa_t *spa, uint64_t size, uint64_t iops,
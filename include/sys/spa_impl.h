@@ -45,6 +45,7 @@
 #include <sys/dsl_pool.h>
 #include <sys/uberblock_impl.h>
 #include <sys/zfs_context.h>
+#include <sys/wmsum.h>
 #include <sys/avl.h>
 #include <sys/zfs_refcount.h>
 #include <sys/bplist.h>
@@ -154,8 +155,13 @@ typedef struct spa_config_lock {
 	kmutex_t	scl_lock;
 	kthread_t	*scl_writer;
 	int		scl_write_wanted;
-	int		scl_count;
 	kcondvar_t	scl_cv;
+	/*
+	 * Reader holds are counted per CPU so the hot read side (one
+	 * spa_config_enter() per zio) touches only a local cacheline;
+	 * only writers pay the cross-CPU gather when they sum it.
+	 */
+	wmsum_t		scl_rcount;
 } ____cacheline_aligned spa_config_lock_t;
 
 typedef struct spa_config_dirent {
@@ -193,6 +199,8 @@ typedef enum spa_proc_state {
 typedef struct spa_taskqs {
 	uint_t stqs_count;
 	taskq_t **stqs_taskq;
+	/* queued-but-not-running zios per taskq, for balanced dispatch */
+	uint64_t *stqs_depth;
 } spa_taskqs_t;
 
 /* one for each thread in the spa sync taskq */
@@ -306,6 +314,9 @@ struct spa {
 
 	/* in-flight verification bytes */
 	uint64_t	spa_load_verify_bytes;
+	/* adaptive verification inflight window (bytes) and last update */
+	uint64_t	spa_load_verify_window;
+	hrtime_t	spa_load_verify_adapt_ts;
 	kcondvar_t	spa_scrub_io_cv;	/* scrub I/O completion */
 	uint8_t		spa_scrub_active;	/* active or suspended? */
 	uint8_t		spa_scrub_type;		/* type of scrub we're doing */
@@ -352,6 +363,9 @@ struct spa {
 	spa_checkpoint_info_t spa_checkpoint_info; /* checkpoint accounting */
 	zthr_t		*spa_checkpoint_discard_zthr;
 
+	/* Automatic background DDT pruning */
+	zthr_t		*spa_ddt_prune_zthr;
+
 	kmutex_t	spa_txg_log_time_lock;	/* for spa_txg_log_time */
 	dbrrd_t		spa_txg_log_time;
 	uint64_t	spa_last_noted_txg;
@@ -385,9 +399,17 @@ struct spa {
 	uint64_t	spa_errlog_last;	/* last error log object */
 	uint64_t	spa_errlog_scrub;	/* scrub error log object */
 	kmutex_t	spa_errlist_lock;	/* error list/ereport lock */
+	uint64_t	spa_errlist_count;	/* in-memory error entries */
+	uint64_t	spa_errlist_dropped;	/* entries dropped over cap */
 	avl_tree_t	spa_errlist_last;	/* last error list */
 	avl_tree_t	spa_errlist_scrub;	/* scrub error list */
 	avl_tree_t	spa_errlist_healed;	/* list of healed blocks */
+	kmutex_t	spa_warmup_lock;	/* ARC warmup restore lock */
+	kcondvar_t	spa_warmup_cv;		/* ARC warmup restore cv */
+	boolean_t	spa_warmup_thread_active; /* restore in progress */
+	boolean_t	spa_warmup_cancel;	/* restore canceled */
+	uint64_t	spa_warmup_obj;		/* ARC warmup MOS object */
+	uint64_t	spa_warmup_last_sync;	/* last snapshot time, sec */
 	uint64_t	spa_deflate;		/* should we deflate? */
 	uint64_t	spa_history;		/* history object */
 	kmutex_t	spa_history_lock;	/* history lock */
@@ -461,6 +483,7 @@ struct spa {
 	hrtime_t	spa_ccw_fail_time;	/* Conf cache write fail time */
 	taskq_t		*spa_zvol_taskq;	/* Taskq for minor management */
 	taskq_t		*spa_metaslab_taskq;	/* Taskq for metaslab preload */
+	taskq_t		*spa_smflush_taskq; /* parallel log sm flushing */
 	taskq_t		*spa_prefetch_taskq;	/* Taskq for prefetch threads */
 	taskq_t		*spa_upgrade_taskq;	/* Taskq for upgrade jobs */
 	uint64_t	spa_multihost;		/* multihost aware (mmp) */
@@ -496,6 +519,8 @@ extern const char *zfs_deadman_failmode;
 extern uint_t spa_slop_shift;
 extern void spa_taskq_dispatch(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
     task_func_t *func, zio_t *zio, boolean_t cutinline);
+extern void spa_taskq_stat_init(void);
+extern void spa_taskq_stat_fini(void);
 extern void spa_load_spares(spa_t *spa);
 extern void spa_load_l2cache(spa_t *spa);
 extern sysevent_t *spa_event_create(spa_t *spa, vdev_t *vd, nvlist_t *hist_nvl,
@@ -29,6 +29,8 @@
 
 #include <sys/avl.h>
 
+extern uint_t zfs_log_sm_flush_threads;
+
 typedef struct log_summary_entry {
 	uint64_t lse_start;	/* start TXG */
 	uint64_t lse_end;	/* last TXG */
@@ -183,6 +183,9 @@ extern boolean_t vdev_is_spacemap_addressable(vdev_t *vd);
 extern void vdev_queue_init(vdev_t *vd);
 extern void vdev_queue_fini(vdev_t *vd);
 extern zio_t *vdev_queue_io(zio_t *zio);
+extern uint64_t vdev_queue_latency(vdev_t *vd);
+extern void vdev_queue_stat_init(void);
+extern void vdev_queue_stat_fini(void);
 extern void vdev_queue_io_done(zio_t *zio);
 extern void vdev_queue_change_io_priority(zio_t *zio, zio_priority_t priority);
 
@@ -151,8 +151,19 @@ struct vdev_queue {
 	list_t		vq_active_list;	/* List of active I/Os. */
 	hrtime_t	vq_io_complete_ts; /* time last i/o completed */
 	hrtime_t	vq_io_delta_ts;
+	hrtime_t	vq_lat_ewma;	/* EWMA of recent i/o latency */
 	zio_t		vq_io_search; /* used as local for stack reduction */
 	kmutex_t	vq_lock;
+
+	/*
+	 * Lock-free submission ring: vdev_queue_io() pushes incoming
+	 * zios here without vq_lock, linked through io_vq_next, and
+	 * whoever holds vq_lock drains them into the class queues in
+	 * vdev_queue_io_to_issue().  vq_incoming_count tracks the
+	 * ring's occupancy for the vdev_queue_ring kstat.
+	 */
+	zio_t		*vq_incoming;
+	uint64_t	vq_incoming_count;
 };
 
 /*
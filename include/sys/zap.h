@@ -448,6 +448,7 @@ typedef struct zap_cursor {
 	uint64_t zc_hash;
 	uint32_t zc_cd;
 	boolean_t zc_prefetch;
+	uint64_t zc_pf_idx;	/* next ptrtbl index to prefetch */
 } zap_cursor_t;
 
 /*
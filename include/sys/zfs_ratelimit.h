@@ -35,9 +35,19 @@ typedef struct {
 
 	unsigned int interval;	/* Interval length in seconds */
 	kmutex_t lock;
+
+	/*
+	 * Aggregate of what the limiter dropped, accumulated until the
+	 * next event that passes drains it into that event's payload.
+	 */
+	unsigned int suppressed;
+	hrtime_t first_suppressed;
+	hrtime_t last_suppressed;
 } zfs_ratelimit_t;
 
 int zfs_ratelimit(zfs_ratelimit_t *rl);
+unsigned int zfs_ratelimit_drain(zfs_ratelimit_t *rl, hrtime_t *first,
+    hrtime_t *last);
 void zfs_ratelimit_init(zfs_ratelimit_t *rl, unsigned int *burst,
     unsigned int interval);
 void zfs_ratelimit_fini(zfs_ratelimit_t *rl);
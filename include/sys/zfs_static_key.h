@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+#ifndef	_SYS_ZFS_STATIC_KEY_H
+#define	_SYS_ZFS_STATIC_KEY_H
+
+/*
+ * Rarely-true gates on hot paths (fault injection, debug verification)
+ * want to cost nothing when disabled.  On Linux kernels this maps onto
+ * the jump-label facility: the disabled test is a patched-out no-op,
+ * not even a load-and-branch, and flipping the key rewrites the text.
+ * Everywhere else (FreeBSD, userland) it falls back to a plain counter
+ * test, which is what these gates were before.
+ *
+ * Keys count enablers, like static_branch_inc/dec: a key is "enabled"
+ * while at least one increment is outstanding.  Incrementing and
+ * decrementing may sleep (text patching takes a mutex on Linux), so
+ * only flip keys from sleepable context -- in practice the ioctl and
+ * administrative paths that arm these facilities.
+ */
+
+#if defined(_KERNEL) && defined(__linux__)
+
+#include <linux/jump_label.h>
+
+#define	ZFS_STATIC_KEY_DEFINE(name)	DEFINE_STATIC_KEY_FALSE(name)
+#define	ZFS_STATIC_KEY_DECLARE(name)	DECLARE_STATIC_KEY_FALSE(name)
+#define	zfs_static_key_enabled(keyp)	static_branch_unlikely(keyp)
+#define	zfs_static_key_inc(keyp)	static_branch_inc(keyp)
+#define	zfs_static_key_dec(keyp)	static_branch_dec(keyp)
+
+#else	/* !(_KERNEL && __linux__) */
+
+#include <sys/types.h>
+
+typedef struct zfs_static_key {
+	volatile uint32_t	zsk_count;
+} zfs_static_key_t;
+
+#define	ZFS_STATIC_KEY_DEFINE(name)	zfs_static_key_t name = { 0 }
+#define	ZFS_STATIC_KEY_DECLARE(name)	extern zfs_static_key_t name
+#define	zfs_static_key_enabled(keyp)	((keyp)->zsk_count != 0)
+#define	zfs_static_key_inc(keyp)	atomic_inc_32(&(keyp)->zsk_count)
+#define	zfs_static_key_dec(keyp)	atomic_dec_32(&(keyp)->zsk_count)
+
+#endif	/* _KERNEL && __linux__ */
+
+#endif	/* _SYS_ZFS_STATIC_KEY_H */
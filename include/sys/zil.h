@@ -468,6 +468,7 @@ typedef struct itx {
 	size_t		itx_size;	/* allocated itx structure size */
 	uint64_t	itx_oid;	/* object id */
 	uint64_t	itx_gen;	/* gen number for zfs_get_data */
+	uint64_t	itx_seq;	/* assignment order on the zilog */
 	lr_t		itx_lr;		/* common part of log record */
 	uint8_t		itx_lr_data[];	/* type-specific part of lr_xx_t */
 } itx_t;
@@ -475,6 +476,9 @@ typedef struct itx {
 /*
  * Used for zil kstat.
  */
+#define	ZIL_LAT_BUCKETS		16
+#define	ZIL_FILL_BUCKETS	8
+
 typedef struct zil_stats {
 	/*
 	 * Number of times a ZIL commit (e.g. fsync) has been requested.
@@ -544,6 +548,21 @@ typedef struct zil_stats {
 	kstat_named_t zil_itx_metaslab_slog_bytes;
 	kstat_named_t zil_itx_metaslab_slog_write;
 	kstat_named_t zil_itx_metaslab_slog_alloc;
+
+	/*
+	 * Current indirect-vs-copied cutover in bytes; static
+	 * zfs_immediate_write_sz unless adaptive mode is enabled.
+	 */
+	kstat_named_t zil_immediate_write_sz;
+
+	/*
+	 * Log2 histogram of zil_commit() latency (bucket i counts
+	 * commits that took [2^(i-1), 2^i) microseconds, the last
+	 * bucket absorbing the tail), and a histogram of how full each
+	 * lwb was when issued, in eighths of its capacity.
+	 */
+	kstat_named_t zil_commit_lat_us[ZIL_LAT_BUCKETS];
+	kstat_named_t zil_lwb_fill_8ths[ZIL_FILL_BUCKETS];
 } zil_kstat_values_t;
 
 typedef struct zil_sums {
@@ -568,6 +587,10 @@ typedef struct zil_sums {
 	wmsum_t zil_itx_metaslab_slog_bytes;
 	wmsum_t zil_itx_metaslab_slog_write;
 	wmsum_t zil_itx_metaslab_slog_alloc;
+	/* Not a sum: last indirect-vs-copied cutover used (bytes). */
+	uint64_t zil_immediate_write_sz;
+	wmsum_t zil_commit_lat_us[ZIL_LAT_BUCKETS];
+	wmsum_t zil_lwb_fill_8ths[ZIL_FILL_BUCKETS];
 } zil_sums_t;
 
 #define	ZIL_STAT_INCR(zil, stat, val) \
@@ -665,6 +688,7 @@ extern itx_wr_state_t zil_write_state(zilog_t *zilog, uint64_t size,
 
 extern void zil_sums_init(zil_sums_t *zs);
 extern void zil_sums_fini(zil_sums_t *zs);
+extern void zil_kstat_values_name(zil_kstat_values_t *zs);
 extern void zil_kstat_values_update(zil_kstat_values_t *zs,
     zil_sums_t *zil_sums);
 
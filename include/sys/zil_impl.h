@@ -161,13 +161,28 @@ typedef struct zil_commit_waiter {
 /*
  * Intent log transaction lists
  */
+typedef struct itx_shard {
+	kmutex_t	is_lock;	/* protects this shard's lists */
+	list_t		is_sync_list;	/* list of synchronous itxs */
+	avl_tree_t	is_async_tree;	/* tree of foids for async itxs */
+} itx_shard_t;
+
+/*
+ * Staged itxs are sharded so that assignment (the hot path, every
+ * logged operation) only contends on a per-shard lock.  Each itx is
+ * stamped with a zilog-wide sequence number at assignment, and the
+ * consumers (zil_get_commit_list(), zil_async_to_sync()) merge the
+ * shards back into sequence order, so replay ordering is exactly what
+ * a single list would have produced.
+ */
+#define	ZIL_ITX_SHARDS	16
+
 typedef struct itxs {
-	list_t		i_sync_list;	/* list of synchronous itxs */
-	avl_tree_t	i_async_tree;	/* tree of foids for async itxs */
+	itx_shard_t	i_shard[ZIL_ITX_SHARDS];
 } itxs_t;
 
 typedef struct itxg {
-	kmutex_t	itxg_lock;	/* lock for this structure */
+	krwlock_t	itxg_lock;	/* lock for this structure */
 	uint64_t	itxg_txg;	/* txg for this chain */
 	itxs_t		*itxg_itxs;	/* sync and async itxs */
 } itxg_t;
@@ -222,6 +237,7 @@ struct zilog {
 	uint64_t	zl_parse_blk_count; /* number of blocks parsed */
 	uint64_t	zl_parse_lr_count; /* number of log records parsed */
 	itxg_t		zl_itxg[TXG_SIZE]; /* intent log txg chains */
+	uint64_t	zl_itx_seq;	/* itx assignment sequence */
 	list_t		zl_itx_commit_list; /* itx list to be committed */
 	uint64_t	zl_cur_size;	/* current burst full size */
 	uint64_t	zl_cur_left;	/* current burst remaining size */
@@ -41,6 +41,7 @@
 #include <sys/txg.h>
 #include <sys/avl.h>
 #include <sys/fs/zfs.h>
+#include <sys/zfs_static_key.h>
 #include <sys/zio_impl.h>
 
 #ifdef	__cplusplus
@@ -378,6 +379,7 @@ typedef struct zio_prop {
 	boolean_t		zp_byteorder:1;
 	boolean_t		zp_direct_write:1;
 	boolean_t		zp_rewrite:1;
+	boolean_t		zp_alloc_locality:1;
 	uint32_t		zp_zpl_smallblk;
 	uint8_t			zp_salt[ZIO_DATA_SALT_LEN];
 	uint8_t			zp_iv[ZIO_DATA_IV_LEN];
@@ -517,6 +519,7 @@ struct zio {
 	metaslab_class_t *io_metaslab_class;	/* dva throttle class */
 
 	enum zio_qstate	io_queue_state;	/* vdev queue state */
+	zio_t		*io_vq_next;	/* vdev queue submission ring */
 	union {
 		list_node_t l;
 		avl_node_t a;
@@ -525,6 +528,7 @@ struct zio {
 	uint64_t	io_offset;
 	hrtime_t	io_timestamp;	/* submitted at */
 	hrtime_t	io_queued_timestamp;
+	hrtime_t	io_stage_timestamp;	/* for stage accounting */
 	hrtime_t	io_target_timestamp;
 	hrtime_t	io_delta;	/* vdev queue service delta */
 	hrtime_t	io_delay;	/* Device access time (disk or */
@@ -558,6 +562,8 @@ struct zio {
 
 	/* Taskq dispatching state */
 	taskq_ent_t	io_tqent;
+	task_func_t	*io_tqfunc;	/* real func behind spa_taskq_run() */
+	uint64_t	*io_tqdepth;	/* dispatch depth counter to drop */
 };
 
 enum blk_verify_flag {
@@ -700,7 +706,7 @@ extern void zio_fini(void);
  * Fault injection
  */
 struct zinject_record;
-extern uint32_t zio_injection_enabled;
+ZFS_STATIC_KEY_DECLARE(zio_injection_enabled);
 extern int zio_inject_fault(char *name, int flags, int *id,
     struct zinject_record *record);
 extern int zio_inject_list_next(int *id, char *name, size_t buflen,
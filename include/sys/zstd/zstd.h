@@ -51,6 +51,18 @@ extern "C" {
  * ZSTD block header
  * NOTE: all fields in this header are in big endian order.
  */
+/*
+ * On-disk per-block header.  Note for anyone considering dataset-scoped
+ * zstd dictionaries (a recurring ask for small-record datasets): the
+ * decompressor would need a dictionary ID recorded here per block,
+ * which is an on-disk format change gated behind a feature flag, and
+ * it carries heavy lifetime semantics - a dictionary object can never
+ * be reclaimed while any block on disk references its ID, making
+ * dictionaries effectively append-only and immortal, and every stream
+ * consumer (send/recv, raw send, zdb) must learn to carry them.  Until
+ * someone takes on that feature end to end, larger recordsize remains
+ * the supported way to give zstd more context per compression call.
+ */
 typedef struct zfs_zstd_header {
 	/* Compressed size of data */
 	uint32_t c_len;
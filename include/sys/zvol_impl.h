@@ -80,6 +80,7 @@ typedef struct zv_request_stack {
 typedef struct zv_request_task {
 	zv_request_t	zvr;
 	taskq_ent_t	ent;
+	hrtime_t	zvr_start;	/* for queue depth/latency kstats */
 } zv_request_task_t;
 
 /*
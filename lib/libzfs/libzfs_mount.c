@@ -1199,6 +1199,18 @@ zfs_share_one(zfs_handle_t *zhp, void *arg)
  * each descending from the previous) will have no parallelism since we always
  * have to wait for the parent to finish mounting before we can schedule
  * its children.
+ *
+ * This is already a dependency-ordered scheduler with maximal fan-out:
+ * the only edges are mountpoint-prefix relationships (a parent's mount
+ * must precede its children's), and the moment a mount completes, every
+ * independent descendant subtree is dispatched concurrently.  Key
+ * loading (with MS_CRYPT) and sharing both happen inside these
+ * per-mount tasks, so they parallelize to the same degree as the
+ * mounts.  When a many-dataset boot still crawls, the usual culprits
+ * are a flat hierarchy under one parent mountpoint (no edges, but
+ * dispatch is still bounded by the thread count passed in), or
+ * share-backend serialization inside libshare - both below this
+ * scheduler, which has no more ordering to relax.
  */
 static void
 zfs_mount_task(void *arg)
@@ -1388,6 +1400,36 @@ mountpoint_compare(const void *a, const void *b)
 	return (strcmp(mountb->mountpoint, mounta->mountpoint));
 }
 
+static int
+mountpoint_depth(const char *mp)
+{
+	int depth = 0;
+
+	/* The root directory nests everything; keep it strictly lowest. */
+	if (mp[0] == '/' && mp[1] == '\0')
+		return (0);
+	for (; *mp != '\0'; mp++) {
+		if (*mp == '/')
+			depth++;
+	}
+	return (depth);
+}
+
+struct unmount_task {
+	struct sets_s *ut_set;
+	int ut_flags;
+	int ut_error;
+};
+
+static void
+unmount_task_func(void *arg)
+{
+	struct unmount_task *ut = arg;
+
+	ut->ut_error = unmount_one(ut->ut_set->dataset,
+	    ut->ut_set->mountpoint, ut->ut_flags);
+}
+
 /*
  * Unshare and unmount all datasets within the given pool.  We don't want to
  * rely on traversing the DSL to discover the filesystems within the pool,
@@ -1484,11 +1526,66 @@ zpool_disable_datasets(zpool_handle_t *zhp, boolean_t force)
 
 	/*
 	 * Now unmount everything, removing the underlying directories as
-	 * appropriate.
+	 * appropriate.  Mountpoints at the same path depth can never
+	 * nest, so unmount them in parallel one depth level at a time,
+	 * deepest first; a parent is always strictly shallower than
+	 * anything mounted beneath it.
 	 */
-	for (i = 0; i < used; i++) {
-		if (unmount_one(sets[i].dataset, sets[i].mountpoint,
-		    flags) != 0)
+	if (used != 0) {
+		int maxdepth = 0, depth;
+		taskq_t *tq = NULL;
+		long nthr = sysconf(_SC_NPROCESSORS_ONLN);
+
+		struct unmount_task *uts =
+		    zfs_alloc(hdl, used * sizeof (*uts));
+
+		for (i = 0; i < used; i++) {
+			uts[i].ut_set = &sets[i];
+			uts[i].ut_flags = flags;
+			uts[i].ut_error = 0;
+			depth = mountpoint_depth(sets[i].mountpoint);
+			if (depth > maxdepth)
+				maxdepth = depth;
+		}
+
+		if (nthr > 1 && used > 1 &&
+		    getenv("ZFS_SERIAL_MOUNT") == NULL) {
+			tq = taskq_create("zpool_disable_datasets",
+			    MIN(nthr, used), minclsyspri, 1, INT_MAX,
+			    TASKQ_DYNAMIC);
+		}
+
+		int error = 0;
+		/*
+		 * Depth 0 is only the root directory mountpoint, which
+		 * still has to be visited last like any other dataset.
+		 */
+		for (depth = maxdepth; depth >= 0 && error == 0; depth--) {
+			for (i = 0; i < used; i++) {
+				if (mountpoint_depth(sets[i].mountpoint) !=
+				    depth)
+					continue;
+				if (tq != NULL) {
+					(void) taskq_dispatch(tq,
+					    unmount_task_func, &uts[i],
+					    TQ_SLEEP);
+				} else {
+					unmount_task_func(&uts[i]);
+				}
+			}
+			if (tq != NULL)
+				taskq_wait(tq);
+			for (i = 0; i < used; i++) {
+				if (mountpoint_depth(sets[i].mountpoint) ==
+				    depth && uts[i].ut_error != 0)
+					error = uts[i].ut_error;
+			}
+		}
+
+		if (tq != NULL)
+			taskq_destroy(tq);
+		free(uts);
+		if (error != 0)
 			goto out;
 	}
 
@@ -5251,6 +5251,14 @@ zpool_obj_to_path_ds(zpool_handle_t *zhp, uint64_t dsobj, uint64_t obj,
 }
 /*
  * Wait while the specified activity is in progress in the pool.
+ *
+ * Note that this is already event-driven, not polling: the wait ioctl
+ * blocks in the kernel on the spa's activities condvar
+ * (spa_wait_common()), and scrub/resilver/trim/initialize completion
+ * broadcasts that condvar, waking every waiter immediately.  A caller
+ * sleeping here costs one blocked thread and nothing else.  The
+ * interval seen in the zpool-wait command drives only its optional
+ * progress display; the waiting itself has no period.
  */
 int
 zpool_wait(zpool_handle_t *zhp, zpool_wait_activity_t activity)
@@ -86,3 +86,15 @@ void
 arc_unregister_hotplug(void)
 {
 }
+
+uint_t
+arc_numa_node_count(void)
+{
+	return (1);
+}
+
+uint_t
+arc_numa_current_node(void)
+{
+	return (0);
+}
@@ -1437,6 +1437,26 @@ error:
 	return (error);
 }
 
+/*
+ * Probe one device and report discovery progress if requested.  The
+ * callback is serialized under the progress lock, so a CLI can print
+ * from it without interleaving.
+ */
+static void
+zpool_open_task(void *arg)
+{
+	rdsk_node_t *rn = arg;
+	import_progress_t *ip = rn->rn_prog;
+
+	zpool_open_func(arg);
+	if (ip != NULL) {
+		pthread_mutex_lock(&ip->ip_lock);
+		ip->ip_done++;
+		ip->ip_cb(ip->ip_done, ip->ip_total, ip->ip_arg);
+		pthread_mutex_unlock(&ip->ip_lock);
+	}
+}
+
 /*
  * Given a list of directories to search, find all pools stored on disk.  This
  * includes partial pools which are not available to import.  If no args are
@@ -1480,14 +1500,28 @@ zpool_find_import_impl(libpc_handle_t *hdl, importargs_t *iarg,
 		threads = MIN(threads, am / VDEV_LABELS);
 #endif
 #endif
+	import_progress_t prog;
+	boolean_t report = (iarg->scan_progress != NULL);
+	if (report) {
+		pthread_mutex_init(&prog.ip_lock, NULL);
+		prog.ip_done = 0;
+		prog.ip_total = avl_numnodes(cache);
+		prog.ip_cb = iarg->scan_progress;
+		prog.ip_arg = iarg->scan_progress_arg;
+	}
+
 	tq = taskq_create("zpool_find_import", threads, minclsyspri, 1, INT_MAX,
 	    TASKQ_DYNAMIC);
 	for (slice = avl_first(cache); slice;
-	    (slice = avl_walk(cache, slice, AVL_AFTER)))
-		(void) taskq_dispatch(tq, zpool_open_func, slice, TQ_SLEEP);
+	    (slice = avl_walk(cache, slice, AVL_AFTER))) {
+		slice->rn_prog = report ? &prog : NULL;
+		(void) taskq_dispatch(tq, zpool_open_task, slice, TQ_SLEEP);
+	}
 
 	taskq_wait(tq);
 	taskq_destroy(tq);
+	if (report)
+		pthread_mutex_destroy(&prog.ip_lock);
 
 	/*
 	 * Process the cache, filtering out any entries which are not
@@ -53,8 +53,18 @@ typedef struct rdsk_node {
 	avl_node_t rn_node;
 	pthread_mutex_t *rn_lock;
 	boolean_t rn_labelpaths;
+	struct import_progress *rn_prog;	/* optional, shared */
 } rdsk_node_t;
 
+/* Shared progress state for one discovery run. */
+typedef struct import_progress {
+	pthread_mutex_t	ip_lock;
+	uint64_t	ip_done;
+	uint64_t	ip_total;
+	void		(*ip_cb)(uint64_t, uint64_t, void *);
+	void		*ip_arg;
+} import_progress_t;
+
 int slice_cache_compare(const void *, const void *);
 
 void zpool_open_func(void *);
@@ -198,3 +198,19 @@ void
 arc_unregister_hotplug(void)
 {
 }
+
+/*
+ * NUMA-aware ARC state lists are not implemented on FreeBSD; report a
+ * single node so the generic code uses the flat layout.
+ */
+uint_t
+arc_numa_node_count(void)
+{
+	return (1);
+}
+
+uint_t
+arc_numa_current_node(void)
+{
+	return (0);
+}
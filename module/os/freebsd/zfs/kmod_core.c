@@ -279,7 +279,7 @@ int
 zfs__fini(void)
 {
 	if (zfs_busy() || zvol_busy() ||
-	    zio_injection_enabled) {
+	    zfs_static_key_enabled(&zio_injection_enabled)) {
 		return (EBUSY);
 	}
 	zfs_kmod_fini();
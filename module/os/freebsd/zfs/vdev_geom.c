@@ -1244,7 +1244,8 @@ vdev_geom_io_done(zio_t *zio)
 	}
 
 	if (bp == NULL) {
-		if (zio_injection_enabled && zio->io_error == EIO)
+		if (zfs_static_key_enabled(&zio_injection_enabled) &&
+		    zio->io_error == EIO)
 			/*
 			 * Convert an injected EIO to ENXIO. This is needed to
 			 * work around zio_handle_device_injection_impl() not
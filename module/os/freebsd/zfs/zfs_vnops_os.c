@@ -6751,10 +6751,21 @@ zfs_freebsd_advise(struct vop_advise_args *ap)
 	case POSIX_FADV_DONTNEED:
 		dmu_evict_range(os, zp->z_id, start, len);
 		break;
+	case POSIX_FADV_NOREUSE:
+		/*
+		 * Mark I/O through this file as uncached: the buffers
+		 * pass through the ARC uncached state and are reclaimed
+		 * promptly instead of displacing the established MRU/MFU
+		 * working set, so e.g. a backup scan does not flush the
+		 * hot set.  POSIX_FADV_NORMAL restores regular caching.
+		 */
+		zp->z_noreuse = B_TRUE;
+		break;
 	case POSIX_FADV_NORMAL:
+		zp->z_noreuse = B_FALSE;
+		break;
 	case POSIX_FADV_RANDOM:
 	case POSIX_FADV_SEQUENTIAL:
-	case POSIX_FADV_NOREUSE:
 		/* ignored for now */
 		break;
 	default:
@@ -83,6 +83,18 @@ MODULE_PARM_DESC(spl_kmem_cache_max_size, "Maximum size of slab in MB");
  * of 16K was determined to be optimal for architectures using 4K pages and
  * to also work well on architecutres using larger 64K page sizes.
  */
+/*
+ * A note on NUMA: per-node slab depots keep being proposed for this
+ * file, but the objects that matter for cross-socket traffic - dbufs,
+ * dnodes, zios, and the other small hot caches - don't use the
+ * SPL-implemented slabs at all.  Anything at or below this limit is
+ * backed by a native Linux kmem_cache (the KMC_SLAB selection in
+ * spl_kmem_cache_create()), and the kernel slab already maintains
+ * per-node partial lists and node-local refill.  The SPL slab layer
+ * only serves objects too large for the kernel allocator, where
+ * per-object locality matters far less than the map/unmap cost it
+ * exists to amortize.
+ */
 static unsigned int spl_kmem_cache_slab_limit =
     SPL_MAX_KMEM_ORDER_NR_PAGES * PAGE_SIZE;
 module_param(spl_kmem_cache_slab_limit, uint, 0644);
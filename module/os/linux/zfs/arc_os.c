@@ -49,6 +49,8 @@
 #include <linux/page_compat.h>
 #include <linux/notifier.h>
 #include <linux/memory.h>
+#include <linux/nodemask.h>
+#include <linux/topology.h>
 #include <linux/version.h>
 #include <sys/callb.h>
 #include <sys/kstat.h>
@@ -82,6 +84,15 @@ static int zfs_arc_shrinker_limit = 0;
  */
 static int zfs_arc_shrinker_seeks = DEFAULT_SEEKS;
 
+/*
+ * When set, the ARC shrinker returns after reducing the target size and
+ * crediting the eviction to the asynchronous evict thread, instead of
+ * waiting for the eviction to happen in direct-reclaim context.  A
+ * synchronous wait is still performed when free memory is below
+ * arc_sys_free.
+ */
+static int zfs_arc_shrinker_async = 0;
+
 #ifdef CONFIG_MEMORY_HOTPLUG
 static struct notifier_block arc_hotplug_callback_mem_nb;
 #endif
@@ -225,7 +236,17 @@ arc_shrinker_scan(struct shrinker *shrink, struct shrink_control *sc)
 	 * the eviction is not good either if most of memory is used by ARC.
 	 */
 	uint64_t to_free = arc_reduce_target_size(ptob(sc->nr_to_scan));
-	if (sc->gfp_mask & __GFP_FS)
+	/*
+	 * With zfs_arc_shrinker_async set, direct reclaim does not wait:
+	 * arc_reduce_target_size() has already woken the evict thread and
+	 * the target reduction is credited below, so page reclaim latency
+	 * is decoupled from ARC internals.  We still wait synchronously
+	 * when free memory has fallen below the system reserve - under
+	 * OOM-adjacent pressure, crediting pages that have not actually
+	 * been freed yet would just hasten the OOM killer.
+	 */
+	if ((sc->gfp_mask & __GFP_FS) && (!zfs_arc_shrinker_async ||
+	    arc_free_memory() < arc_sys_free))
 		arc_wait_for_eviction(to_free, B_FALSE, B_FALSE);
 	if (current->reclaim_state != NULL)
 #ifdef	HAVE_RECLAIM_STATE_RECLAIMED
@@ -346,6 +367,23 @@ arc_set_sys_free(uint64_t allmem)
 	arc_sys_free = wmark * 3 + allmem / 32;
 }
 
+/*
+ * Report the machine's NUMA topology so the ARC can size and index its
+ * state multilists per node.  On non-NUMA kernels both collapse to a
+ * single node.
+ */
+uint_t
+arc_numa_node_count(void)
+{
+	return (MAX(num_online_nodes(), 1));
+}
+
+uint_t
+arc_numa_current_node(void)
+{
+	return (numa_node_id());
+}
+
 void
 arc_lowmem_init(void)
 {
@@ -474,5 +512,9 @@ arc_unregister_hotplug(void)
 
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, shrinker_limit, INT, ZMOD_RW,
 	"Limit on number of pages that ARC shrinker can reclaim at once");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, shrinker_async, INT, ZMOD_RW,
+	"Credit shrinker evictions to the async evict thread");
+
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, shrinker_seeks, INT, ZMOD_RD,
 	"Relative cost of ARC eviction vs other kernel subsystems");
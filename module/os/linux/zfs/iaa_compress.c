@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Intel IAA (In-Memory Analytics Accelerator) deflate offload for the
+ * gzip zio path.  The accelerator is reached through the kernel crypto
+ * acomp API: the idxd/iaa_crypto driver registers a "deflate-iaa"
+ * algorithm, and we submit synchronous requests to it from the zio
+ * compress stage, exactly where the QAT backend hooks in.  If the
+ * driver is not loaded or no devices are enumerated, the allocation
+ * below fails and every block stays on the software implementation.
+ *
+ * ZFS gzip blocks are zlib-framed while the accelerator produces raw
+ * deflate, so the two byte zlib header and the big-endian adler32
+ * footer are applied here, mirroring qat_compress.c.  On decompression
+ * the footer is not re-verified: the block's own ZFS checksum has
+ * already validated the payload, and the zlib stream may be followed
+ * by allocation padding which makes the footer offset unknowable
+ * without tracking consumed input, which the acomp API does not
+ * report.
+ */
+
+#if defined(_KERNEL) && defined(HAVE_CRYPTO_ACOMP)
+#include <linux/slab.h>
+#include <linux/scatterlist.h>
+#include <linux/vmalloc.h>
+#include <crypto/acompress.h>
+#include <sys/zfs_context.h>
+#include <sys/byteorder.h>
+#include <sys/iaa.h>
+
+/*
+ * ZLIB head and foot size
+ */
+#define	ZLIB_HEAD_SZ		2
+#define	ZLIB_FOOT_SZ		4
+
+iaa_stats_t iaa_stats = {
+	{ "comp_requests",			KSTAT_DATA_UINT64 },
+	{ "comp_total_in_bytes",		KSTAT_DATA_UINT64 },
+	{ "comp_total_out_bytes",		KSTAT_DATA_UINT64 },
+	{ "decomp_requests",			KSTAT_DATA_UINT64 },
+	{ "decomp_total_in_bytes",		KSTAT_DATA_UINT64 },
+	{ "decomp_total_out_bytes",		KSTAT_DATA_UINT64 },
+	{ "dc_fails",				KSTAT_DATA_UINT64 },
+};
+
+/*
+ * Largest run of bytes whose unreduced adler32 sums fit in 32 bits.
+ */
+#define	ADLER_NMAX		5552
+#define	ADLER_MOD		65521
+
+static uint32_t
+iaa_adler32(const unsigned char *buf, size_t len)
+{
+	uint32_t s1 = 1;
+	uint32_t s2 = 0;
+
+	while (len > 0) {
+		size_t n = MIN(len, ADLER_NMAX);
+
+		len -= n;
+		while (n-- > 0) {
+			s1 += *buf++;
+			s2 += s1;
+		}
+		s1 %= ADLER_MOD;
+		s2 %= ADLER_MOD;
+	}
+
+	return ((s2 << 16) | s1);
+}
+
+static kstat_t *iaa_ksp = NULL;
+static struct crypto_acomp *iaa_tfm = NULL;
+
+int zfs_iaa_compress_disable = 0;
+
+boolean_t
+iaa_dc_use_accel(size_t s_len)
+{
+	return (iaa_tfm != NULL &&
+	    !zfs_iaa_compress_disable &&
+	    s_len >= IAA_MIN_BUF_SIZE &&
+	    s_len <= IAA_MAX_BUF_SIZE);
+}
+
+static inline struct page *
+iaa_mem_to_page(void *addr)
+{
+	if (!is_vmalloc_addr(addr))
+		return (virt_to_page(addr));
+
+	return (vmalloc_to_page(addr));
+}
+
+/*
+ * Build a scatterlist covering a linear kernel buffer.  The zio
+ * compress stage hands us kmem or vmalloc backed buffers, so each page
+ * has to be looked up individually like the QAT flat-buffer setup.
+ */
+static int
+iaa_sg_from_buf(struct sg_table *sgt, void *buf, unsigned int len)
+{
+	unsigned int off = ((unsigned long)buf & ~PAGE_MASK);
+	unsigned int npages = (off + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	struct scatterlist *sg;
+
+	if (sg_alloc_table(sgt, npages, GFP_KERNEL) != 0)
+		return (-1);
+
+	for (sg = sgt->sgl; len > 0; sg = sg_next(sg)) {
+		unsigned int seg;
+
+		off = ((unsigned long)buf & ~PAGE_MASK);
+		seg = MIN(PAGE_SIZE - off, len);
+		sg_set_page(sg, iaa_mem_to_page(buf), seg, off);
+		buf = (char *)buf + seg;
+		len -= seg;
+	}
+
+	return (0);
+}
+
+/*
+ * Entry point for the accelerated (de-)compression.  Returns 0 on
+ * success; on any failure the caller redoes the block in software.
+ */
+int
+iaa_compress(iaa_compress_dir_t dir, char *src, int src_len,
+    char *dst, int dst_len, size_t *c_len)
+{
+	struct sg_table src_sgt = { 0 };
+	struct sg_table dst_sgt = { 0 };
+	struct acomp_req *req = NULL;
+	DECLARE_CRYPTO_WAIT(wait);
+	uint32_t adler32;
+	int ret = -1;
+
+	if (dir == IAA_COMPRESS) {
+		IAA_STAT_BUMP(comp_requests);
+		IAA_STAT_INCR(comp_total_in_bytes, src_len);
+
+		if (dst_len <= ZLIB_HEAD_SZ + ZLIB_FOOT_SZ)
+			goto out;
+		if (iaa_sg_from_buf(&src_sgt, src, src_len) != 0)
+			goto out;
+		if (iaa_sg_from_buf(&dst_sgt, dst + ZLIB_HEAD_SZ,
+		    dst_len - ZLIB_HEAD_SZ - ZLIB_FOOT_SZ) != 0)
+			goto out;
+
+		req = acomp_request_alloc(iaa_tfm);
+		if (req == NULL)
+			goto out;
+		acomp_request_set_callback(req,
+		    CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+		    crypto_req_done, &wait);
+		acomp_request_set_params(req, src_sgt.sgl, dst_sgt.sgl,
+		    src_len, dst_len - ZLIB_HEAD_SZ - ZLIB_FOOT_SZ);
+
+		ret = crypto_wait_req(crypto_acomp_compress(req), &wait);
+		if (ret != 0)
+			goto out;
+
+		/*
+		 * Standard zlib header (32K window, default level), then
+		 * the raw deflate stream, then the adler32 of the input
+		 * in big-endian order, as zlib expects.
+		 */
+		dst[0] = 0x78;
+		dst[1] = 0x9c;
+		adler32 = BSWAP_32(iaa_adler32((unsigned char *)src,
+		    src_len));
+		memcpy(dst + ZLIB_HEAD_SZ + req->dlen, &adler32,
+		    ZLIB_FOOT_SZ);
+
+		*c_len = ZLIB_HEAD_SZ + req->dlen + ZLIB_FOOT_SZ;
+		IAA_STAT_INCR(comp_total_out_bytes, *c_len);
+	} else {
+		ASSERT3U(dir, ==, IAA_DECOMPRESS);
+		IAA_STAT_BUMP(decomp_requests);
+		IAA_STAT_INCR(decomp_total_in_bytes, src_len);
+
+		if (src_len <= ZLIB_HEAD_SZ + ZLIB_FOOT_SZ)
+			goto out;
+		if (iaa_sg_from_buf(&src_sgt, src + ZLIB_HEAD_SZ,
+		    src_len - ZLIB_HEAD_SZ) != 0)
+			goto out;
+		if (iaa_sg_from_buf(&dst_sgt, dst, dst_len) != 0)
+			goto out;
+
+		req = acomp_request_alloc(iaa_tfm);
+		if (req == NULL)
+			goto out;
+		acomp_request_set_callback(req,
+		    CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+		    crypto_req_done, &wait);
+		acomp_request_set_params(req, src_sgt.sgl, dst_sgt.sgl,
+		    src_len - ZLIB_HEAD_SZ, dst_len);
+
+		ret = crypto_wait_req(crypto_acomp_decompress(req), &wait);
+		if (ret != 0)
+			goto out;
+		if (req->dlen != (unsigned int)dst_len) {
+			ret = -1;
+			goto out;
+		}
+
+		*c_len = req->dlen;
+		IAA_STAT_INCR(decomp_total_out_bytes, *c_len);
+	}
+
+out:
+	if (ret != 0)
+		IAA_STAT_BUMP(dc_fails);
+	if (req != NULL)
+		acomp_request_free(req);
+	sg_free_table(&src_sgt);
+	sg_free_table(&dst_sgt);
+
+	return (ret);
+}
+
+static int
+iaa_tfm_alloc(void)
+{
+	struct crypto_acomp *tfm;
+
+	tfm = crypto_alloc_acomp("deflate-iaa", 0, 0);
+	if (IS_ERR(tfm))
+		return (PTR_ERR(tfm));
+	iaa_tfm = tfm;
+	return (0);
+}
+
+int
+iaa_init(void)
+{
+	/*
+	 * No devices (or no iaa_crypto driver) is not an error; the
+	 * flag can be cleared to retry once the driver is loaded.
+	 */
+	if (iaa_tfm_alloc() != 0)
+		zfs_iaa_compress_disable = 1;
+
+	iaa_ksp = kstat_create("zfs", 0, "iaa", "misc",
+	    KSTAT_TYPE_NAMED, sizeof (iaa_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (iaa_ksp != NULL) {
+		iaa_ksp->ks_data = &iaa_stats;
+		kstat_install(iaa_ksp);
+	}
+
+	return (0);
+}
+
+void
+iaa_fini(void)
+{
+	if (iaa_ksp != NULL) {
+		kstat_delete(iaa_ksp);
+		iaa_ksp = NULL;
+	}
+	if (iaa_tfm != NULL) {
+		crypto_free_acomp(iaa_tfm);
+		iaa_tfm = NULL;
+	}
+}
+
+static int
+param_set_iaa_compress(const char *val, zfs_kernel_param_t *kp)
+{
+	int ret;
+	int *pvalue = kp->arg;
+	ret = param_set_int(val, kp);
+	if (ret)
+		return (ret);
+	/*
+	 * zfs_iaa_compress_disable = 0: enable IAA compress
+	 * try to allocate a transform if it has not been done
+	 */
+	if (*pvalue == 0 && iaa_tfm == NULL) {
+		ret = iaa_tfm_alloc();
+		if (ret != 0) {
+			zfs_iaa_compress_disable = 1;
+			return (ret);
+		}
+	}
+	return (ret);
+}
+
+module_param_call(zfs_iaa_compress_disable, param_set_iaa_compress,
+    param_get_int, &zfs_iaa_compress_disable, 0644);
+MODULE_PARM_DESC(zfs_iaa_compress_disable, "Enable/Disable IAA compression");
+
+#endif
@@ -30,6 +30,19 @@
 #include <sys/zio.h>
 #include <sys/qat.h>
 
+/*
+ * A note on coverage: the acceleration here is plumbed in underneath
+ * zfs_gzip_compress_buf()/zfs_gzip_decompress_buf(), so it applies to
+ * every kernel consumer of gzip through the zio pipeline - ordinary
+ * writes, receive's lightweight writes, and any rewrite of received
+ * data.  There is no separate send-side hook because the kernel send
+ * path never compresses: "zfs send -c" ships blocks exactly as stored,
+ * and recompression to a different algorithm happens on the receiving
+ * pool's write pipeline, which already lands here.  The userland
+ * "zstream recompress" tool cannot reach this session pool (the QAT
+ * kernel API is unavailable to userland) and falls back to zlib.
+ */
+
 /*
  * Max instances in a QAT device, each instance is a channel to submit
  * jobs to QAT hardware, this is only for pre-allocating instance and
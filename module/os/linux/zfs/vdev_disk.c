@@ -74,8 +74,42 @@ typedef void zfs_bdev_handle_t;
 typedef struct vdev_disk {
 	zfs_bdev_handle_t		*vd_bdh;
 	krwlock_t			vd_lock;
+#ifdef REQ_POLLED
+	/*
+	 * Polled completion state; see vdev_disk_poll_thread().  The
+	 * thread exists only while zfs_vdev_disk_polled_sync was set at
+	 * open time and the device's queue supports polling.
+	 */
+	kmutex_t			vd_poll_lock;
+	kcondvar_t			vd_poll_cv;
+	list_t				vd_poll_list;
+	boolean_t			vd_poll_exit;
+	boolean_t			vd_poll_active;
+#endif
 } vdev_disk_t;
 
+/*
+ * When set, synchronous-priority reads and writes to devices whose
+ * queues support it are submitted as polled I/O (REQ_POLLED) and
+ * completed by a per-vdev polling thread instead of a completion
+ * interrupt, trading one busy CPU for several microseconds of
+ * per-request interrupt latency.  Takes effect when a device is
+ * (re)opened.
+ */
+static uint_t zfs_vdev_disk_polled_sync = 0;
+
+/*
+ * ZFS writes in place and frees out of order, which a zoned
+ * (host-managed SMR or ZNS) device cannot accept: every write must
+ * land at a zone's append point and space only returns on a zone
+ * reset.  Until the allocator grows a zone-aware class with
+ * sequential append points and reset-deferred frees, reject such
+ * devices at open with a clear reason instead of failing
+ * unpredictably at write time.  Setting this allows opening them
+ * anyway, for development.
+ */
+static uint_t zfs_vdev_disk_allow_zoned = 0;
+
 /*
  * Maximum number of segments to add to a bio (min 4). If this is higher than
  * the maximum allowed by the device queue or the kernel itself, it will be
@@ -444,6 +478,19 @@ vdev_disk_open(vdev_t *v, uint64_t *psize, uint64_t *max_psize,
 	/* Set when device reports it supports secure TRIM. */
 	v->vdev_has_securetrim = bdev_secure_discard_supported(bdev);
 
+	/*
+	 * Zoned devices enforce sequential writes per zone, which the
+	 * allocator does not yet honor; refuse them up front.
+	 */
+	if (bdev_is_zoned(bdev) && !zfs_vdev_disk_allow_zoned) {
+		vdev_dbgmsg(v, "zoned block devices (host-managed SMR/ZNS) "
+		    "are not supported");
+		v->vdev_stat.vs_aux = VDEV_AUX_OPEN_FAILED;
+		vdev_blkdev_put(vd->vd_bdh, smode, zfs_vdev_holder);
+		vd->vd_bdh = NULL;
+		return (SET_ERROR(ENOTSUP));
+	}
+
 	/* Inform the ZIO pipeline that we are non-rotational */
 #ifdef HAVE_BLK_QUEUE_ROT
 	v->vdev_nonrot = !blk_queue_rot(bdev_get_queue(bdev));
@@ -454,6 +501,24 @@ vdev_disk_open(vdev_t *v, uint64_t *psize, uint64_t *max_psize,
 	/* Is backed by a block device. */
 	v->vdev_is_blkdev = B_TRUE;
 
+#ifdef REQ_POLLED
+	/*
+	 * Start the polled-completion thread if requested and the queue
+	 * supports it.  Reopens keep the existing thread.
+	 */
+	if (zfs_vdev_disk_polled_sync != 0 && !vd->vd_poll_active &&
+	    test_bit(QUEUE_FLAG_POLL, &bdev_get_queue(bdev)->queue_flags)) {
+		mutex_init(&vd->vd_poll_lock, NULL, MUTEX_DEFAULT, NULL);
+		cv_init(&vd->vd_poll_cv, NULL, CV_DEFAULT, NULL);
+		list_create(&vd->vd_poll_list, sizeof (vdev_disk_poll_ent_t),
+		    offsetof(vdev_disk_poll_ent_t, pe_node));
+		vd->vd_poll_exit = B_FALSE;
+		vd->vd_poll_active = B_TRUE;
+		(void) thread_create(NULL, 0, vdev_disk_poll_thread, vd, 0,
+		    &p0, TS_RUN, maxclsyspri);
+	}
+#endif
+
 	/* Physical volume size in bytes for the partition */
 	*psize = bdev_capacity(bdev);
 
@@ -478,6 +543,21 @@ vdev_disk_close(vdev_t *v)
 	if (v->vdev_reopening || vd == NULL)
 		return;
 
+#ifdef REQ_POLLED
+	if (vd->vd_poll_active) {
+		mutex_enter(&vd->vd_poll_lock);
+		vd->vd_poll_exit = B_TRUE;
+		cv_broadcast(&vd->vd_poll_cv);
+		while (vd->vd_poll_active)
+			cv_wait(&vd->vd_poll_cv, &vd->vd_poll_lock);
+		mutex_exit(&vd->vd_poll_lock);
+		ASSERT(list_is_empty(&vd->vd_poll_list));
+		list_destroy(&vd->vd_poll_list);
+		cv_destroy(&vd->vd_poll_cv);
+		mutex_destroy(&vd->vd_poll_lock);
+	}
+#endif
+
 	rw_enter(&vd->vd_lock, RW_WRITER);
 
 	if (vd->vd_bdh != NULL)
@@ -604,6 +684,116 @@ vdev_submit_bio(struct bio *bio)
 	current->bio_list = bio_list;
 }
 
+#ifdef REQ_POLLED
+/*
+ * One polled bio in flight.  The submitter interposes on the bio's
+ * completion to mark the entry done; only the polling thread removes
+ * entries, frees them, and drops the extra bio reference, so it can
+ * walk the list with minimal locking.
+ */
+typedef struct vdev_disk_poll_ent {
+	list_node_t	pe_node;
+	struct bio	*pe_bio;
+	bio_end_io_t	*pe_end_io;
+	void		*pe_private;
+	volatile uint_t	pe_done;
+} vdev_disk_poll_ent_t;
+
+static void
+vdev_disk_poll_end_io(struct bio *bio)
+{
+	vdev_disk_poll_ent_t *pe = bio->bi_private;
+
+	bio->bi_end_io = pe->pe_end_io;
+	bio->bi_private = pe->pe_private;
+	bio->bi_end_io(bio);
+
+	/*
+	 * Publish completion last: the poll thread may free pe and drop
+	 * our bio reference as soon as it sees pe_done.
+	 */
+	membar_producer();
+	pe->pe_done = 1;
+}
+
+static __attribute__((noreturn)) void
+vdev_disk_poll_thread(void *arg)
+{
+	vdev_disk_t *vd = arg;
+	vdev_disk_poll_ent_t *pe, *pnext;
+
+	mutex_enter(&vd->vd_poll_lock);
+	while (!vd->vd_poll_exit) {
+		pe = list_head(&vd->vd_poll_list);
+		if (pe == NULL) {
+			cv_wait(&vd->vd_poll_cv, &vd->vd_poll_lock);
+			continue;
+		}
+
+		boolean_t progress = B_FALSE;
+		while (pe != NULL) {
+			pnext = list_next(&vd->vd_poll_list, pe);
+			if (pe->pe_done) {
+				list_remove(&vd->vd_poll_list, pe);
+				mutex_exit(&vd->vd_poll_lock);
+				bio_put(pe->pe_bio);
+				kmem_free(pe, sizeof (*pe));
+				progress = B_TRUE;
+			} else {
+				mutex_exit(&vd->vd_poll_lock);
+				(void) bio_poll(pe->pe_bio, NULL, 0);
+			}
+			mutex_enter(&vd->vd_poll_lock);
+			pe = pnext;
+		}
+
+		if (!progress) {
+			mutex_exit(&vd->vd_poll_lock);
+			kpreempt(KPREEMPT_SYNC);
+			mutex_enter(&vd->vd_poll_lock);
+		}
+	}
+	vd->vd_poll_active = B_FALSE;
+	cv_broadcast(&vd->vd_poll_cv);
+	mutex_exit(&vd->vd_poll_lock);
+
+	thread_exit();
+}
+
+/*
+ * Submit the bio for polled completion.  Returns B_FALSE if the caller
+ * should fall back to a regular interrupt-driven submission.
+ */
+static boolean_t
+vdev_disk_poll_submit(vdev_disk_t *vd, struct bio *bio)
+{
+	vdev_disk_poll_ent_t *pe;
+
+	if (!vd->vd_poll_active)
+		return (B_FALSE);
+	pe = kmem_alloc(sizeof (*pe), KM_NOSLEEP);
+	if (pe == NULL)
+		return (B_FALSE);
+
+	bio->bi_opf |= REQ_POLLED;
+	bio_get(bio);
+	pe->pe_bio = bio;
+	pe->pe_end_io = bio->bi_end_io;
+	pe->pe_private = bio->bi_private;
+	pe->pe_done = 0;
+	bio->bi_end_io = vdev_disk_poll_end_io;
+	bio->bi_private = pe;
+
+	vdev_submit_bio(bio);
+
+	mutex_enter(&vd->vd_poll_lock);
+	list_insert_head(&vd->vd_poll_list, pe);
+	cv_signal(&vd->vd_poll_cv);
+	mutex_exit(&vd->vd_poll_lock);
+	return (B_TRUE);
+}
+#endif /* REQ_POLLED */
+
 static inline struct bio *
 vdev_bio_alloc(struct block_device *bdev, gfp_t gfp_mask,
     unsigned short nr_vecs)
@@ -678,6 +868,8 @@ typedef struct {
 
 	struct bio	*vbio_bio;	/* pointer to the current bio */
 	int		vbio_flags;	/* bio flags */
+	boolean_t	vbio_polled;	/* attempt polled completion */
+	boolean_t	vbio_chained;	/* more than one bio was needed */
 } vbio_t;
 
 static vbio_t *
@@ -721,6 +913,7 @@ vbio_add_page(vbio_t *vbio, struct page *page, uint_t size, uint_t offset)
 			if (vbio->vbio_bio) {
 				bio_chain(vbio->vbio_bio, bio);
 				vdev_submit_bio(vbio->vbio_bio);
+				vbio->vbio_chained = B_TRUE;
 			}
 			vbio->vbio_bio = bio;
 		}
@@ -788,6 +981,15 @@ vbio_submit(vbio_t *vbio, abd_t *abd, uint64_t size)
 	 * called and free the vbio before this task is run again, so we must
 	 * consider it invalid from this point.
 	 */
+#ifdef REQ_POLLED
+	if (vbio->vbio_polled && !vbio->vbio_chained) {
+		vdev_disk_t *vd = vbio->vbio_zio->io_vd->vdev_tsd;
+		struct bio *bio = vbio->vbio_bio;
+
+		if (!vdev_disk_poll_submit(vd, bio))
+			vdev_submit_bio(bio);
+	} else
+#endif
 	vdev_submit_bio(vbio->vbio_bio);
 
 	blk_finish_plug(&plug);
@@ -971,6 +1173,9 @@ vdev_disk_io_rw(zio_t *zio)
 	vbio_t *vbio = vbio_alloc(zio, bdev, flags);
 	if (abd != zio->io_abd)
 		vbio->vbio_abd = abd;
+	vbio->vbio_polled = (zfs_vdev_disk_polled_sync != 0 &&
+	    (zio->io_priority == ZIO_PRIORITY_SYNC_READ ||
+	    zio->io_priority == ZIO_PRIORITY_SYNC_WRITE));
 
 	/* Fill it with data pages and submit it to the kernel */
 	vbio_submit(vbio, abd, zio->io_size);
@@ -1362,5 +1567,11 @@ ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, open_timeout_ms, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, failfast_mask, UINT, ZMOD_RW,
 	"Defines failfast mask: 1 - device, 2 - transport, 4 - driver");
 
+ZFS_MODULE_PARAM(zfs_vdev_disk, zfs_vdev_disk_, polled_sync, UINT, ZMOD_RW,
+	"Poll for sync-priority I/O completion instead of interrupts");
+
+ZFS_MODULE_PARAM(zfs_vdev_disk, zfs_vdev_disk_, allow_zoned, UINT, ZMOD_RW,
+	"Allow opening zoned (SMR/ZNS) devices despite missing support");
+
 ZFS_MODULE_PARAM(zfs_vdev_disk, zfs_vdev_disk_, max_segs, UINT, ZMOD_RW,
 	"Maximum number of data segments to add to an IO request (min 4)");
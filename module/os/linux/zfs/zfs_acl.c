@@ -1083,6 +1083,19 @@ zfs_acl_node_read(struct znode *zp, boolean_t have_lock, zfs_acl_t **aclpp,
 
 	ASSERT(MUTEX_HELD(&zp->z_acl_lock));
 
+	/*
+	 * The decoded ACL is cached per znode, so repeated access checks
+	 * never re-read or re-decode the on-disk ACL object; what runs
+	 * per check is only the ACE evaluation loop over this in-memory
+	 * chain.  A further (credential, mode) -> verdict cache has been
+	 * declined: evaluating a handful of ACEs is a few dozen compares,
+	 * while a verdict cache would have to be invalidated on every
+	 * path that changes effective permissions - chmod/chown/ACL
+	 * edits, but also credential changes ZFS never sees - and a
+	 * stale entry there is a security bug rather than a performance
+	 * one.  The VFS additionally short-circuits the common cases
+	 * through the inode mode bits before we are called at all.
+	 */
 	if (zp->z_acl_cached && !will_modify) {
 		*aclpp = zp->z_acl_cached;
 		return (0);
@@ -53,9 +53,244 @@
 #include <sys/zfs_fuid.h>
 #include <sys/sa.h>
 #include <sys/zfs_sa.h>
+#include <sys/wmsum.h>
 #include <sys/dmu_objset.h>
 #include <sys/dsl_dir.h>
 
+/*
+ * Negative name-lookup cache.  Build and search workloads stat
+ * nonexistent names constantly (PATH walks, editor probes), and while
+ * the VFS dcache caches negative dentries, it sheds them under memory
+ * pressure long before ZFS metadata is evicted.  Each filesystem keeps
+ * a direct-mapped, lock-striped table of (directory object, name) pairs
+ * recently confirmed absent from the directory ZAP, so a repeated miss
+ * is answered without a zap_lookup().
+ *
+ * Entries are only inserted and consulted while holding the dirlock for
+ * that name, and only on lookups that are exact (the same "update"
+ * condition that governed the DNLC: no normalization, or mixed-case
+ * exact matching), so an entry can only be made stale by a create of
+ * the exact same name - and zfs_link_create() removes the pair then.
+ * Rollback and receive swap the objset wholesale, so the cache is
+ * purged on zfs_resume_fs().  An empty slot has zne_dirobj 0, which is
+ * never a directory (object 0 is the meta dnode).
+ *
+ * The per-filesystem table has zfs_negcache_entries slots (rounded up
+ * to a power of two; zero disables the cache for subsequent mounts).
+ * Names that don't fit a slot are simply not cached.
+ */
+static uint_t zfs_negcache_entries = 8192;
+
+typedef struct zfs_negcache_stats {
+	kstat_named_t znc_hits;
+	kstat_named_t znc_misses;
+	kstat_named_t znc_inserts;
+	kstat_named_t znc_invalidates;
+} zfs_negcache_stats_t;
+
+static zfs_negcache_stats_t zfs_negcache_stats = {
+	{ "hits",		KSTAT_DATA_UINT64 },
+	{ "misses",		KSTAT_DATA_UINT64 },
+	{ "inserts",		KSTAT_DATA_UINT64 },
+	{ "invalidates",	KSTAT_DATA_UINT64 },
+};
+
+struct {
+	wmsum_t znc_hits;
+	wmsum_t znc_misses;
+	wmsum_t znc_inserts;
+	wmsum_t znc_invalidates;
+} zfs_negcache_sums;
+
+#define	NEGCACHE_STAT_BUMP(stat) \
+	wmsum_add(&zfs_negcache_sums.znc_##stat, 1)
+
+static kstat_t *zfs_negcache_ksp;
+
+static int
+zfs_negcache_kstats_update(kstat_t *ksp, int rw)
+{
+	zfs_negcache_stats_t *znc = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (EACCES);
+
+	znc->znc_hits.value.ui64 =
+	    wmsum_value(&zfs_negcache_sums.znc_hits);
+	znc->znc_misses.value.ui64 =
+	    wmsum_value(&zfs_negcache_sums.znc_misses);
+	znc->znc_inserts.value.ui64 =
+	    wmsum_value(&zfs_negcache_sums.znc_inserts);
+	znc->znc_invalidates.value.ui64 =
+	    wmsum_value(&zfs_negcache_sums.znc_invalidates);
+
+	return (0);
+}
+
+void
+zfs_negcache_stats_init(void)
+{
+	wmsum_init(&zfs_negcache_sums.znc_hits, 0);
+	wmsum_init(&zfs_negcache_sums.znc_misses, 0);
+	wmsum_init(&zfs_negcache_sums.znc_inserts, 0);
+	wmsum_init(&zfs_negcache_sums.znc_invalidates, 0);
+
+	zfs_negcache_ksp = kstat_create("zfs", 0, "negative_name_cache",
+	    "misc", KSTAT_TYPE_NAMED,
+	    sizeof (zfs_negcache_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (zfs_negcache_ksp != NULL) {
+		zfs_negcache_ksp->ks_data = &zfs_negcache_stats;
+		zfs_negcache_ksp->ks_update = zfs_negcache_kstats_update;
+		kstat_install(zfs_negcache_ksp);
+	}
+}
+
+void
+zfs_negcache_stats_fini(void)
+{
+	if (zfs_negcache_ksp != NULL) {
+		kstat_delete(zfs_negcache_ksp);
+		zfs_negcache_ksp = NULL;
+	}
+
+	wmsum_fini(&zfs_negcache_sums.znc_hits);
+	wmsum_fini(&zfs_negcache_sums.znc_misses);
+	wmsum_fini(&zfs_negcache_sums.znc_inserts);
+	wmsum_fini(&zfs_negcache_sums.znc_invalidates);
+}
+
+void
+zfs_negcache_create(zfsvfs_t *zfsvfs)
+{
+	uint64_t entries = MIN(zfs_negcache_entries, 1 << 20);
+
+	for (int i = 0; i < ZFS_NEGCACHE_LOCKS; i++) {
+		mutex_init(&zfsvfs->z_negcache_locks[i], NULL,
+		    MUTEX_DEFAULT, NULL);
+	}
+	zfsvfs->z_negcache = NULL;
+	zfsvfs->z_negcache_mask = 0;
+	if (entries == 0)
+		return;
+	if (!ISP2(entries))
+		entries = 1ULL << highbit64(entries);
+	zfsvfs->z_negcache = vmem_zalloc(entries *
+	    sizeof (zfs_negcache_ent_t), KM_SLEEP);
+	zfsvfs->z_negcache_mask = entries - 1;
+}
+
+void
+zfs_negcache_destroy(zfsvfs_t *zfsvfs)
+{
+	if (zfsvfs->z_negcache != NULL) {
+		vmem_free(zfsvfs->z_negcache,
+		    (zfsvfs->z_negcache_mask + 1ULL) *
+		    sizeof (zfs_negcache_ent_t));
+		zfsvfs->z_negcache = NULL;
+	}
+	for (int i = 0; i < ZFS_NEGCACHE_LOCKS; i++)
+		mutex_destroy(&zfsvfs->z_negcache_locks[i]);
+}
+
+void
+zfs_negcache_purge(zfsvfs_t *zfsvfs)
+{
+	if (zfsvfs->z_negcache == NULL)
+		return;
+	for (int i = 0; i < ZFS_NEGCACHE_LOCKS; i++)
+		mutex_enter(&zfsvfs->z_negcache_locks[i]);
+	memset(zfsvfs->z_negcache, 0,
+	    (zfsvfs->z_negcache_mask + 1ULL) * sizeof (zfs_negcache_ent_t));
+	for (int i = ZFS_NEGCACHE_LOCKS - 1; i >= 0; i--)
+		mutex_exit(&zfsvfs->z_negcache_locks[i]);
+}
+
+static uint64_t
+zfs_negcache_hash(uint64_t dirobj, const char *name)
+{
+	/* FNV-1a */
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (int i = 0; i < 8; i++) {
+		hash ^= (dirobj >> (i * 8)) & 0xff;
+		hash *= 1099511628211ULL;
+	}
+	for (const char *p = name; *p != '\0'; p++) {
+		hash ^= (uint8_t)*p;
+		hash *= 1099511628211ULL;
+	}
+	return (hash);
+}
+
+static boolean_t
+zfs_negcache_lookup(zfsvfs_t *zfsvfs, uint64_t dirobj, const char *name)
+{
+	if (zfsvfs->z_negcache == NULL ||
+	    strlen(name) >= ZFS_NEGCACHE_NAMELEN)
+		return (B_FALSE);
+
+	uint32_t slot = zfs_negcache_hash(dirobj, name) &
+	    zfsvfs->z_negcache_mask;
+	zfs_negcache_ent_t *zne = &zfsvfs->z_negcache[slot];
+	kmutex_t *lock =
+	    &zfsvfs->z_negcache_locks[slot & (ZFS_NEGCACHE_LOCKS - 1)];
+
+	mutex_enter(lock);
+	boolean_t hit = (zne->zne_dirobj == dirobj &&
+	    strcmp(zne->zne_name, name) == 0);
+	mutex_exit(lock);
+
+	if (hit)
+		NEGCACHE_STAT_BUMP(hits);
+	else
+		NEGCACHE_STAT_BUMP(misses);
+	return (hit);
+}
+
+static void
+zfs_negcache_insert(zfsvfs_t *zfsvfs, uint64_t dirobj, const char *name)
+{
+	if (zfsvfs->z_negcache == NULL ||
+	    strlen(name) >= ZFS_NEGCACHE_NAMELEN)
+		return;
+
+	uint32_t slot = zfs_negcache_hash(dirobj, name) &
+	    zfsvfs->z_negcache_mask;
+	zfs_negcache_ent_t *zne = &zfsvfs->z_negcache[slot];
+	kmutex_t *lock =
+	    &zfsvfs->z_negcache_locks[slot & (ZFS_NEGCACHE_LOCKS - 1)];
+
+	mutex_enter(lock);
+	zne->zne_dirobj = dirobj;
+	(void) strlcpy(zne->zne_name, name, sizeof (zne->zne_name));
+	mutex_exit(lock);
+
+	NEGCACHE_STAT_BUMP(inserts);
+}
+
+static void
+zfs_negcache_remove(zfsvfs_t *zfsvfs, uint64_t dirobj, const char *name)
+{
+	if (zfsvfs->z_negcache == NULL ||
+	    strlen(name) >= ZFS_NEGCACHE_NAMELEN)
+		return;
+
+	uint32_t slot = zfs_negcache_hash(dirobj, name) &
+	    zfsvfs->z_negcache_mask;
+	zfs_negcache_ent_t *zne = &zfsvfs->z_negcache[slot];
+	kmutex_t *lock =
+	    &zfsvfs->z_negcache_locks[slot & (ZFS_NEGCACHE_LOCKS - 1)];
+
+	mutex_enter(lock);
+	if (zne->zne_dirobj == dirobj &&
+	    strcmp(zne->zne_name, name) == 0) {
+		memset(zne, 0, sizeof (*zne));
+		NEGCACHE_STAT_BUMP(invalidates);
+	}
+	mutex_exit(lock);
+}
+
 /*
  * zfs_match_find() is used by zfs_dirent_lock() to perform zap lookups
  * of names after deciding which is the appropriate lookup interface.
@@ -314,9 +549,18 @@ zfs_dirent_lock(zfs_dirlock_t **dlpp, znode_t *dzp, char *name,
 		    sizeof (zoid));
 		if (error == 0)
 			error = (zoid == 0 ? SET_ERROR(ENOENT) : 0);
+	} else if (update && zfs_negcache_lookup(zfsvfs, dzp->z_id, name)) {
+		/*
+		 * The name was recently confirmed absent and, under the
+		 * dirlock, cannot have been created since (creation would
+		 * have removed the cache entry).
+		 */
+		error = SET_ERROR(ENOENT);
 	} else {
 		error = zfs_match_find(zfsvfs, dzp, name, mt,
 		    update, direntflags, realpnp, &zoid);
+		if (error == ENOENT && update)
+			zfs_negcache_insert(zfsvfs, dzp->z_id, name);
 	}
 	if (error) {
 		if (error != ENOENT || (flag & ZEXISTS)) {
@@ -471,6 +715,60 @@ zfs_unlinked_add(znode_t *zp, dmu_tx_t *tx)
 	dataset_kstats_update_nunlinks_kstat(&zfsvfs->z_kstat, 1);
 }
 
+/*
+ * Number of unlinked objects deleted concurrently while draining the
+ * unlinked set (after a crash or forced unmount).  The deletions run
+ * on system_taskq while the cursor walks the set; this bounds how many
+ * may be in flight for one dataset.  Values of 0 or 1 drain serially.
+ * Progress is visible in the dataset kstats: nunlinks - nunlinked is
+ * the backlog, and the rate of nunlinked is the drain rate.
+ */
+static uint_t zfs_unlinked_drain_parallel = 4;
+
+typedef struct zfs_drain_arg {
+	zfsvfs_t	*zda_zfsvfs;
+	uint64_t	zda_obj;
+} zfs_drain_arg_t;
+
+static void
+zfs_unlinked_drain_obj(zfsvfs_t *zfsvfs, uint64_t obj)
+{
+	znode_t *zp;
+
+	/*
+	 * We may pick up znodes that are already marked for deletion.
+	 * This could happen during the purge of an extended attribute
+	 * directory.  All we need to do is skip over them, since they
+	 * are already in the system marked z_unlinked.
+	 */
+	if (zfs_zget(zfsvfs, obj, &zp) != 0)
+		return;
+
+	zp->z_unlinked = B_TRUE;
+
+	/*
+	 * zrele() decrements the znode's ref count and may cause
+	 * it to be synchronously freed. We interrupt freeing
+	 * of this znode by checking the return value of
+	 * dmu_objset_zfs_unmounting() in dmu_free_long_range()
+	 * when an unmount is requested.
+	 */
+	zrele(zp);
+	ASSERT3B(zfsvfs->z_unmounted, ==, B_FALSE);
+}
+
+static void
+zfs_unlinked_drain_obj_task(void *arg)
+{
+	zfs_drain_arg_t *zda = arg;
+	zfsvfs_t *zfsvfs = zda->zda_zfsvfs;
+
+	if (!zfsvfs->z_drain_cancel)
+		zfs_unlinked_drain_obj(zfsvfs, zda->zda_obj);
+	atomic_dec_64(&zfsvfs->z_drain_inflight);
+	kmem_free(zda, sizeof (*zda));
+}
+
 /*
  * Clean up any znodes that had no links when we either crashed or
  * (force) umounted the file system.
@@ -482,7 +780,6 @@ zfs_unlinked_drain_task(void *arg)
 	zap_cursor_t	zc;
 	zap_attribute_t *zap = zap_attribute_alloc();
 	dmu_object_info_t doi;
-	znode_t		*zp;
 	int		error;
 
 	ASSERT3B(zfsvfs->z_draining, ==, B_TRUE);
@@ -508,32 +805,42 @@ zfs_unlinked_drain_task(void *arg)
 		/*
 		 * We need to re-mark these list entries for deletion,
 		 * so we pull them back into core and set zp->z_unlinked.
+		 * Fan the deletions out when parallel draining is
+		 * enabled, bounded by zfs_unlinked_drain_parallel.
 		 */
-		error = zfs_zget(zfsvfs, zap->za_first_integer, &zp);
-
-		/*
-		 * We may pick up znodes that are already marked for deletion.
-		 * This could happen during the purge of an extended attribute
-		 * directory.  All we need to do is skip over them, since they
-		 * are already in the system marked z_unlinked.
-		 */
-		if (error != 0)
-			continue;
-
-		zp->z_unlinked = B_TRUE;
-
 		/*
-		 * zrele() decrements the znode's ref count and may cause
-		 * it to be synchronously freed. We interrupt freeing
-		 * of this znode by checking the return value of
-		 * dmu_objset_zfs_unmounting() in dmu_free_long_range()
-		 * when an unmount is requested.
+		 * The workers run on system_taskq, deliberately disjoint
+		 * from the drain taskq all the cursor tasks occupy: after
+		 * a crash many datasets drain at once, and if cursors and
+		 * workers shared one thread pool, the waits here and
+		 * below could starve the very workers they wait on.
 		 */
-		zrele(zp);
-		ASSERT3B(zfsvfs->z_unmounted, ==, B_FALSE);
+		uint_t par = zfs_unlinked_drain_parallel;
+		if (par > 1) {
+			while (atomic_load_64(&zfsvfs->z_drain_inflight) >=
+			    par && !zfsvfs->z_drain_cancel)
+				delay(1);
+
+			zfs_drain_arg_t *zda =
+			    kmem_alloc(sizeof (*zda), KM_SLEEP);
+			zda->zda_zfsvfs = zfsvfs;
+			zda->zda_obj = zap->za_first_integer;
+			atomic_inc_64(&zfsvfs->z_drain_inflight);
+			if (taskq_dispatch(system_taskq,
+			    zfs_unlinked_drain_obj_task, zda,
+			    TQ_SLEEP) == TASKQID_INVALID)
+				zfs_unlinked_drain_obj_task(zda);
+		} else {
+			zfs_unlinked_drain_obj(zfsvfs,
+			    zap->za_first_integer);
+		}
 	}
 	zap_cursor_fini(&zc);
 
+	/* Wait for any parallel deletions still in flight */
+	while (atomic_load_64(&zfsvfs->z_drain_inflight) != 0)
+		delay(1);
+
 	zfsvfs->z_draining = B_FALSE;
 	zfsvfs->z_drain_task = TASKQID_INVALID;
 	zap_attribute_free(zap);
@@ -575,6 +882,16 @@ zfs_unlinked_drain_stop_wait(zfsvfs_t *zfsvfs)
 		taskq_cancel_id(dsl_pool_unlinked_drain_taskq(
 		    dmu_objset_pool(zfsvfs->z_os)), zfsvfs->z_drain_task,
 		    B_TRUE);
+
+		/*
+		 * The cursor task is gone, but parallel deletions it
+		 * dispatched may still be running; they see
+		 * z_drain_cancel (and in-progress frees abort via
+		 * dmu_objset_zfs_unmounting()), so this wait is short.
+		 */
+		while (atomic_load_64(&zfsvfs->z_drain_inflight) != 0)
+			delay(1);
+
 		zfsvfs->z_drain_task = TASKQID_INVALID;
 		zfsvfs->z_draining = B_FALSE;
 	}
@@ -649,6 +966,19 @@ zfs_purgedir(znode_t *dzp)
 	return (skipped);
 }
 
+/*
+ * A note on batching: grouping many znodes' final transactions (one
+ * unlinked-ZAP update covering many entries) keeps being proposed for
+ * rm -rf workloads, but the final tx below is the smallest term in a
+ * mass delete.  For regular files the bulk of the work is
+ * dmu_free_long_range(), which already spans many transactions of its
+ * own per file, and the ZAP removal is a single leaf update.  Batching
+ * across znodes would require keeping each znode half-torn-down past
+ * its VFS eviction until a shared tx commits - lifetime complexity in
+ * the eviction path to shave the cheapest step.  The drain task keeps
+ * its one-object-at-a-time shape for the same reason: it is bounded by
+ * the data frees, not the per-entry transaction count.
+ */
 void
 zfs_rmnode(znode_t *zp)
 {
@@ -838,6 +1168,8 @@ zfs_link_create(zfs_dirlock_t *dl, znode_t *zp, dmu_tx_t *tx, int flag)
 	value = zfs_dirent(zp, zp->z_mode);
 	error = zap_add(ZTOZSB(zp)->z_os, dzp->z_id, dl->dl_name, 8, 1,
 	    &value, tx);
+	if (error == 0)
+		zfs_negcache_remove(zfsvfs, dzp->z_id, dl->dl_name);
 
 	/*
 	 * zap_add could fail to add the entry if it exceeds the capacity of the
@@ -1290,3 +1622,9 @@ zfs_sticky_remove_access(znode_t *zdp, znode_t *zp, cred_t *cr)
 	else
 		return (secpolicy_vnode_remove(cr));
 }
+
+ZFS_MODULE_PARAM(zfs, zfs_, unlinked_drain_parallel, UINT, ZMOD_RW,
+	"Concurrent deletions while draining a dataset's unlinked set");
+
+ZFS_MODULE_PARAM(zfs, zfs_, negcache_entries, UINT, ZMOD_RW,
+	"Slots in each filesystem's negative name-lookup cache (0 disables)");
@@ -26,6 +26,22 @@
 
 #include <sys/zfs_racct.h>
 
+/*
+ * A note on mapping cgroup io.weight (or ionice) onto zio priorities:
+ * the accounting here works because it runs while the originating task
+ * is still on-CPU, but the I/O itself loses that identity immediately
+ * after.  Async writes are issued later by the txg sync thread, with
+ * every tenant's dirty data mixed into one transaction group and no
+ * task attached to any block - weighting them at the vdev queue would
+ * require tagging each dirty record with its originator all the way
+ * through the DMU.  The layer where tenant differentiation is possible
+ * is admission, before identity is lost: the per-dataset writelimit
+ * property caps a dataset's dirty rate, and the write throttle's delay
+ * scales with each writer's own pressure.  Reads do retain the
+ * caller's context and already split into sync/async priority classes
+ * by how they are issued.
+ */
+
 #ifdef _KERNEL
 #include <linux/task_io_accounting_ops.h>
 
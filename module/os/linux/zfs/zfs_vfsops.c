@@ -39,6 +39,7 @@
 #include <sys/zfs_znode.h>
 #include <sys/zfs_vnops.h>
 #include <sys/zfs_dir.h>
+#include <sys/zio_crypt.h>
 #include <sys/zil.h>
 #include <sys/fs/zfs.h>
 #include <sys/dmu.h>
@@ -675,6 +676,7 @@ zfsvfs_create_impl(zfsvfs_t **zfvp, zfsvfs_t *zfsvfs, objset_t *os)
 		    sizeof (znode_hold_t), offsetof(znode_hold_t, zh_node));
 		mutex_init(&zfsvfs->z_hold_locks[i], NULL, MUTEX_DEFAULT, NULL);
 	}
+	zfs_negcache_create(zfsvfs);
 
 	error = zfsvfs_init(zfsvfs, os);
 	if (error != 0) {
@@ -812,6 +814,7 @@ zfsvfs_free(zfsvfs_t *zfsvfs)
 	}
 	vmem_free(zfsvfs->z_hold_trees, sizeof (avl_tree_t) * size);
 	vmem_free(zfsvfs->z_hold_locks, sizeof (kmutex_t) * size);
+	zfs_negcache_destroy(zfsvfs);
 	zfsvfs_vfs_free(zfsvfs->z_vfs);
 	dataset_kstats_destroy(&zfsvfs->z_kstat);
 	kmem_free(zfsvfs, sizeof (zfsvfs_t));
@@ -1727,6 +1730,12 @@ zfs_resume_fs(zfsvfs_t *zfsvfs, dsl_dataset_t *ds)
 	zfs_set_fuid_feature(zfsvfs);
 	zfsvfs->z_rollback_time = jiffies;
 
+	/*
+	 * The objset contents may have changed arbitrarily (rollback,
+	 * receive), so cached negative name lookups are no longer valid.
+	 */
+	zfs_negcache_purge(zfsvfs);
+
 	/*
 	 * Attempt to re-establish all the active inodes with their
 	 * dbufs.  If a zfs_rezget() fails, then we unhash the inode
@@ -1996,6 +2005,8 @@ zfs_init(void)
 {
 	zfsctl_init();
 	zfs_znode_init();
+	zfs_negcache_stats_init();
+	zio_crypt_init();
 	dmu_objset_register_type(DMU_OST_ZFS, zpl_get_file_info);
 	register_filesystem(&zpl_fs_type);
 }
@@ -2009,6 +2020,8 @@ zfs_fini(void)
 	taskq_wait(system_delay_taskq);
 	taskq_wait(system_taskq);
 	unregister_filesystem(&zpl_fs_type);
+	zio_crypt_fini();
+	zfs_negcache_stats_fini();
 	zfs_znode_fini();
 	zfsctl_fini();
 }
@@ -346,6 +346,13 @@ mappedread(znode_t *zp, int nbytes, zfs_uio_t *uio)
 
 static unsigned long zfs_delete_blocks = DMU_MAX_DELETEBLKCNT;
 
+/*
+ * Number of directory entries beyond those returned by a readdir call
+ * whose dnode blocks are prefetched for the stat storm that typically
+ * follows.  0 disables the lookahead.
+ */
+static unsigned int zfs_readdir_dnode_prefetch_ahead = 64;
+
 /*
  * Write the bytes to a file.
  *
@@ -1682,6 +1689,28 @@ zfs_readdir(struct inode *ip, struct dir_context *ctx, cred_t *cr)
 		}
 		ctx->pos = offset;
 	}
+
+	/*
+	 * If we stopped because the caller's buffer was full, the stat
+	 * of every entry that typically follows readdir is about to
+	 * miss on the dnodes of entries we have not returned yet.  Walk
+	 * the cursor ahead - without moving the reported offset - and
+	 * prefetch their dnode blocks so the attribute storm finds them
+	 * in cache.
+	 */
+	if (done && prefetch) {
+		for (int i = 0; i < zfs_readdir_dnode_prefetch_ahead; i++) {
+			if (zap_cursor_retrieve(&zc, zap) != 0)
+				break;
+			if (zap->za_integer_length == 8 &&
+			    zap->za_num_integers > 0) {
+				dmu_prefetch_dnode(os,
+				    ZFS_DIRENT_OBJ(zap->za_first_integer),
+				    ZIO_PRIORITY_ASYNC_READ);
+			}
+			zap_cursor_advance(&zc);
+		}
+	}
 	zp->z_zn_prefetch = B_FALSE; /* a lookup will re-enable pre-fetching */
 
 update:
@@ -3714,7 +3743,7 @@ zfs_page_writeback_done(struct page *pp, int err)
 	if (err != 0) {
 		/*
 		 * Writeback failed. Re-dirty the page. It was undirtied before
-		 * the IO was issued (in zfs_putpage() or write_cache_pages()).
+		 * the IO was issued (in zfs_putpages() or write_cache_pages()).
 		 * The kernel only considers writeback for dirty pages; if we
 		 * don't do this, it is eligible for eviction without being
 		 * written out, which we definitely don't want.
@@ -3731,7 +3760,7 @@ zfs_page_writeback_done(struct page *pp, int err)
 }
 
 /*
- * ZIL callback for page writeback. Passes to zfs_log_write() in zfs_putpage()
+ * ZIL callback for page writeback. Passes to zfs_log_write() in zfs_putpages()
  * for syncing writes. Called when the ZIL itx has been written to the log or
  * the whole txg syncs, or if the ZIL crashes or the pool suspends. Any failure
  * is passed as `err`.
@@ -3743,11 +3772,14 @@ zfs_putpage_commit_cb(void *arg, int err)
 }
 
 /*
- * Push a page out to disk, once the page is on stable storage the
- * registered commit callback will be run as notification of completion.
+ * Push a batch of pages out to disk, once each page is on stable storage
+ * the registered commit callback will be run as notification of completion.
  *
- *	IN:	ip	 - page mapped for inode.
- *		pp	 - page to push (page is locked)
+ *	IN:	ip	 - inode the pages are mapped for.
+ *		pages	 - locked pages, contiguous and in ascending index
+ *			   order; entries may be replaced with NULL as pages
+ *			   are disposed of.
+ *		npages	 - number of pages.
  *		wbc	 - writeback control data
  *		for_sync - does the caller intend to wait synchronously for the
  *			   page writeback to complete?
@@ -3759,12 +3791,12 @@ zfs_putpage_commit_cb(void *arg, int err)
  *	ip - ctime|mtime updated
  */
 int
-zfs_putpage(struct inode *ip, struct page *pp, struct writeback_control *wbc,
-    boolean_t for_sync)
+zfs_putpages(struct inode *ip, struct page **pages, int npages,
+    struct writeback_control *wbc, boolean_t for_sync)
 {
 	znode_t		*zp = ITOZ(ip);
 	zfsvfs_t	*zfsvfs = ITOZSB(ip);
-	loff_t		offset;
+	loff_t		isize;
 	loff_t		pgoff;
 	unsigned int	pglen;
 	dmu_tx_t	*tx;
@@ -3775,51 +3807,61 @@ zfs_putpage(struct inode *ip, struct page *pp, struct writeback_control *wbc,
 	sa_bulk_attr_t	bulk[3];
 	int		cnt = 0;
 	struct address_space *mapping;
+	struct page	**waitlist, **refs;
+	int		nwait = 0, nkept = 0, i;
+	uint64_t	batch_off, batch_len, wrlen = 0;
 
 	if ((err = zfs_enter_verify_zp(zfsvfs, zp, FTAG)) != 0)
 		return (err);
 
-	ASSERT(PageLocked(pp));
+	waitlist = kmem_alloc(npages * sizeof (struct page *), KM_SLEEP);
+	refs = kmem_alloc(npages * sizeof (struct page *), KM_SLEEP);
 
-	pgoff = page_offset(pp);	/* Page byte-offset in file */
-	offset = i_size_read(ip);	/* File length in bytes */
-	pglen = MIN(PAGE_SIZE,		/* Page length in bytes */
-	    P2ROUNDUP(offset, PAGE_SIZE)-pgoff);
+	isize = i_size_read(ip);	/* File length in bytes */
 
-	/* Page is beyond end of file */
-	if (pgoff >= offset) {
-		unlock_page(pp);
-		zfs_exit(zfsvfs, FTAG);
-		return (0);
+	/*
+	 * Unlike the single-page writepage callback, where the caller holds
+	 * a reference on the page for the duration of the call, batched
+	 * pages arrive here pinned only by their page locks - which we must
+	 * drop below to take the range lock.  Take a reference on every
+	 * page now, while they are still locked and so certainly valid,
+	 * and hold it until all the waiting is done.
+	 */
+	for (i = 0; i < npages; i++) {
+		ASSERT(PageLocked(pages[i]));
+		refs[i] = pages[i];
+		get_page(pages[i]);
 	}
 
-	/* Truncate page length to end of file */
-	if (pgoff + pglen > offset)
-		pglen = offset - pgoff;
+	/* Drop pages entirely beyond end of file */
+	for (i = 0; i < npages; i++) {
+		if (page_offset(pages[i]) >= isize) {
+			unlock_page(pages[i]);
+			pages[i] = NULL;
+		}
+	}
 
-#if 0
-	/*
-	 * FIXME: Allow mmap writes past its quota.  The correct fix
-	 * is to register a page_mkwrite() handler to count the page
-	 * against its quota when it is about to be dirtied.
-	 */
-	if (zfs_id_overblockquota(zfsvfs, DMU_USERUSED_OBJECT,
-	    KUID_TO_SUID(ip->i_uid)) ||
-	    zfs_id_overblockquota(zfsvfs, DMU_GROUPUSED_OBJECT,
-	    KGID_TO_SGID(ip->i_gid)) ||
-	    (zp->z_projid != ZFS_DEFAULT_PROJID &&
-	    zfs_id_overblockquota(zfsvfs, DMU_PROJECTUSED_OBJECT,
-	    zp->z_projid))) {
-		err = EDQUOT;
+	batch_off = batch_len = 0;
+	for (i = 0; i < npages; i++) {
+		if (pages[i] == NULL)
+			continue;
+		pgoff = page_offset(pages[i]);
+		pglen = MIN(PAGE_SIZE, P2ROUNDUP(isize, PAGE_SIZE) - pgoff);
+		if (batch_len == 0)
+			batch_off = pgoff;
+		batch_len = pgoff + pglen - batch_off;
+	}
+	if (batch_len == 0) {
+		err = 0;
+		goto wait;
 	}
-#endif
 
 	/*
 	 * The ordering here is critical and must adhere to the following
 	 * rules in order to avoid deadlocking in either zfs_read() or
 	 * zfs_free_range() due to a lock inversion.
 	 *
-	 * 1) The page must be unlocked prior to acquiring the range lock.
+	 * 1) The pages must be unlocked prior to acquiring the range lock.
 	 *    This is critical because zfs_read() calls find_lock_page()
 	 *    which may block on the page lock while holding the range lock.
 	 *
@@ -3828,89 +3870,110 @@ zfs_putpage(struct inode *ip, struct page *pp, struct writeback_control *wbc,
 	 *    zfs_free_range() function.
 	 *
 	 * This presents a problem because upon entering this function the
-	 * page lock is already held.  To safely acquire the range lock the
-	 * page lock must be dropped.  This creates a window where another
-	 * process could truncate, invalidate, dirty, or write out the page.
+	 * page locks are already held.  To safely acquire the range lock the
+	 * page locks must be dropped.  This creates a window where another
+	 * process could truncate, invalidate, dirty, or write out a page.
 	 *
 	 * Therefore, after successfully reacquiring the range and page locks
-	 * the current page state is checked.  In the common case everything
+	 * each page's state is checked.  In the common case everything
 	 * will be as is expected and it can be written out.  However, if
-	 * the page state has changed it must be handled accordingly.
+	 * a page's state has changed it is handled accordingly.
 	 */
-	mapping = pp->mapping;
-	redirty_page_for_writepage(wbc, pp);
-	unlock_page(pp);
+	mapping = ip->i_mapping;
+	for (i = 0; i < npages; i++) {
+		if (pages[i] == NULL)
+			continue;
+		redirty_page_for_writepage(wbc, pages[i]);
+		unlock_page(pages[i]);
+	}
 
 	zfs_locked_range_t *lr = zfs_rangelock_enter(&zp->z_rangelock,
-	    pgoff, pglen, RL_WRITER);
-	lock_page(pp);
+	    batch_off, batch_len, RL_WRITER);
 
-	/* Page mapping changed or it was no longer dirty, we're done */
-	if (unlikely((mapping != pp->mapping) || !PageDirty(pp))) {
-		unlock_page(pp);
-		zfs_rangelock_exit(lr);
-		zfs_exit(zfsvfs, FTAG);
-		return (0);
-	}
+	for (i = 0; i < npages; i++) {
+		struct page *pp = pages[i];
 
-	/* Another process started write block if required */
-	if (PageWriteback(pp)) {
-		unlock_page(pp);
-		zfs_rangelock_exit(lr);
+		if (pp == NULL)
+			continue;
+		lock_page(pp);
 
-		if (wbc->sync_mode != WB_SYNC_NONE) {
-			if (PageWriteback(pp))
-#ifdef HAVE_PAGEMAP_FOLIO_WAIT_BIT
-				folio_wait_bit(page_folio(pp), PG_writeback);
-#else
-				wait_on_page_bit(pp, PG_writeback);
-#endif
+		/* Page mapping changed or it was no longer dirty, skip it */
+		if (unlikely((mapping != pp->mapping) || !PageDirty(pp))) {
+			unlock_page(pp);
+			pages[i] = NULL;
+			continue;
 		}
 
-		zfs_exit(zfsvfs, FTAG);
-		return (0);
-	}
+		/* Another process started write block if required */
+		if (PageWriteback(pp)) {
+			if (wbc->sync_mode != WB_SYNC_NONE)
+				waitlist[nwait++] = pp;
+			unlock_page(pp);
+			pages[i] = NULL;
+			continue;
+		}
+
+		/* Clear the dirty flag the required locks are held */
+		if (!clear_page_dirty_for_io(pp)) {
+			unlock_page(pp);
+			pages[i] = NULL;
+			continue;
+		}
 
-	/* Clear the dirty flag the required locks are held */
-	if (!clear_page_dirty_for_io(pp)) {
+		/*
+		 * Counterpart for redirty_page_for_writepage() above.  This
+		 * page was in fact not skipped and should not be counted as
+		 * if it were.
+		 */
+		wbc->pages_skipped--;
+		set_page_writeback(pp);
 		unlock_page(pp);
-		zfs_rangelock_exit(lr);
-		zfs_exit(zfsvfs, FTAG);
-		return (0);
+		nkept++;
 	}
 
-	/*
-	 * Counterpart for redirty_page_for_writepage() above.  This page
-	 * was in fact not skipped and should not be counted as if it were.
-	 */
-	wbc->pages_skipped--;
-	set_page_writeback(pp);
-	unlock_page(pp);
+	if (nkept == 0) {
+		zfs_rangelock_exit(lr);
+		goto wait;
+	}
 
 	tx = dmu_tx_create(zfsvfs->z_os);
-	dmu_tx_hold_write(tx, zp->z_id, pgoff, pglen);
+	dmu_tx_hold_write(tx, zp->z_id, batch_off, batch_len);
 	dmu_tx_hold_sa(tx, zp->z_sa_hdl, B_FALSE);
 	zfs_sa_upgrade_txholds(tx, zp);
 
 	err = dmu_tx_assign(tx, DMU_TX_WAIT);
 	if (err != 0) {
 		dmu_tx_abort(tx);
-		zfs_page_writeback_done(pp, err);
+		for (i = 0; i < npages; i++) {
+			if (pages[i] != NULL)
+				zfs_page_writeback_done(pages[i], err);
+		}
 		zfs_rangelock_exit(lr);
-		zfs_exit(zfsvfs, FTAG);
 
 		/*
 		 * Don't return error for an async writeback; we've re-dirtied
-		 * the page so it will be tried again some other time.
+		 * the pages so they will be tried again some other time.
 		 */
-		return (for_sync ? err : 0);
+		if (!for_sync)
+			err = 0;
+		goto wait;
 	}
 
-	va = kmap(pp);
-	ASSERT3U(pglen, <=, PAGE_SIZE);
-	dmu_write(zfsvfs->z_os, zp->z_id, pgoff, pglen, va, tx,
-	    DMU_READ_PREFETCH);
-	kunmap(pp);
+	for (i = 0; i < npages; i++) {
+		struct page *pp = pages[i];
+
+		if (pp == NULL)
+			continue;
+		pgoff = page_offset(pp);
+		pglen = MIN(PAGE_SIZE, P2ROUNDUP(isize, PAGE_SIZE) - pgoff);
+		ASSERT3U(pglen, <=, PAGE_SIZE);
+
+		va = kmap(pp);
+		dmu_write(zfsvfs->z_os, zp->z_id, pgoff, pglen, va, tx,
+		    DMU_READ_PREFETCH);
+		kunmap(pp);
+		wrlen += pglen;
+	}
 
 	SA_ADD_BULK_ATTR(bulk, cnt, SA_ZPL_MTIME(zfsvfs), NULL, &mtime, 16);
 	SA_ADD_BULK_ATTR(bulk, cnt, SA_ZPL_CTIME(zfsvfs), NULL, &ctime, 16);
@@ -3949,13 +4012,13 @@ zfs_putpage(struct inode *ip, struct page *pp, struct writeback_control *wbc,
 	 * added support for).
 	 *
 	 * So, why a separate for_sync field? This is because zpl_writepages()
-	 * calls zfs_putpage() multiple times for a single "logical" operation.
+	 * calls zfs_putpages() multiple times for a single "logical" operation.
 	 * It wants all the individual pages to be for_sync==TRUE ie only
 	 * unlocked once durably stored, but it only wants one call to
 	 * zil_commit() at the very end, once all the pages are synced. So,
 	 * it repurposes sync_mode slightly to indicate who issue and wait for
-	 * the IO: for NONE, the caller to zfs_putpage() will do it, while for
-	 * ALL, zfs_putpage should do it.
+	 * the IO: for NONE, the caller to zfs_putpages() will do it, while for
+	 * ALL, zfs_putpages should do it.
 	 *
 	 * Summary:
 	 *   for_sync:  0=unlock immediately; 1=unlock once on disk
@@ -3969,15 +4032,24 @@ zfs_putpage(struct inode *ip, struct page *pp, struct writeback_control *wbc,
 	 * zil_commit() soon". for_sync=TRUE means exactly that; the only
 	 * question is whether it will be us, or zpl_writepages().
 	 */
-	zfs_log_write(zfsvfs->z_log, tx, TX_WRITE, zp, pgoff, pglen, for_sync,
-	    B_FALSE, for_sync ? zfs_putpage_commit_cb : NULL, pp);
-
-	if (!for_sync) {
-		/*
-		 * Async writeback is logged and written to the DMU, so page
-		 * can now be unlocked.
-		 */
-		zfs_page_writeback_done(pp, 0);
+	for (i = 0; i < npages; i++) {
+		struct page *pp = pages[i];
+
+		if (pp == NULL)
+			continue;
+		pgoff = page_offset(pp);
+		pglen = MIN(PAGE_SIZE, P2ROUNDUP(isize, PAGE_SIZE) - pgoff);
+		zfs_log_write(zfsvfs->z_log, tx, TX_WRITE, zp, pgoff, pglen,
+		    for_sync, B_FALSE,
+		    for_sync ? zfs_putpage_commit_cb : NULL, pp);
+
+		if (!for_sync) {
+			/*
+			 * Async writeback is logged and written to the DMU,
+			 * so the page can now be unlocked.
+			 */
+			zfs_page_writeback_done(pp, 0);
+		}
 	}
 
 	dmu_tx_commit(tx);
@@ -3985,15 +4057,35 @@ zfs_putpage(struct inode *ip, struct page *pp, struct writeback_control *wbc,
 	zfs_rangelock_exit(lr);
 
 	if (need_commit) {
-		err = zil_commit_flags(zfsvfs->z_log, zp->z_id, ZIL_COMMIT_NOW);
-		if (err != 0) {
-			zfs_exit(zfsvfs, FTAG);
-			return (err);
-		}
+		err = zil_commit_flags(zfsvfs->z_log, zp->z_id,
+		    ZIL_COMMIT_NOW);
+		if (err != 0)
+			goto wait;
 	}
 
-	dataset_kstats_update_write_kstats(&zfsvfs->z_kstat, pglen);
+	dataset_kstats_update_write_kstats(&zfsvfs->z_kstat, wrlen);
 
+wait:
+	/*
+	 * For pages found already in writeback by someone else, a syncing
+	 * caller must still wait for that writeback to finish.  Do this
+	 * last, without any of our locks held; the references taken above
+	 * keep the pages valid.
+	 */
+	for (i = 0; i < nwait; i++) {
+		struct page *pp = waitlist[i];
+
+		if (PageWriteback(pp))
+#ifdef HAVE_PAGEMAP_FOLIO_WAIT_BIT
+			folio_wait_bit(page_folio(pp), PG_writeback);
+#else
+			wait_on_page_bit(pp, PG_writeback);
+#endif
+	}
+	for (i = 0; i < npages; i++)
+		put_page(refs[i]);
+	kmem_free(refs, npages * sizeof (struct page *));
+	kmem_free(waitlist, npages * sizeof (struct page *));
 	zfs_exit(zfsvfs, FTAG);
 	return (err);
 }
@@ -4413,10 +4505,14 @@ EXPORT_SYMBOL(zfs_inactive);
 EXPORT_SYMBOL(zfs_space);
 EXPORT_SYMBOL(zfs_fid);
 EXPORT_SYMBOL(zfs_getpage);
-EXPORT_SYMBOL(zfs_putpage);
+EXPORT_SYMBOL(zfs_putpages);
 EXPORT_SYMBOL(zfs_dirty_inode);
 EXPORT_SYMBOL(zfs_map);
 
 module_param(zfs_delete_blocks, ulong, 0644);
 MODULE_PARM_DESC(zfs_delete_blocks, "Delete files larger than N blocks async");
+
+module_param(zfs_readdir_dnode_prefetch_ahead, uint, 0644);
+MODULE_PARM_DESC(zfs_readdir_dnode_prefetch_ahead,
+	"Entries past a readdir window to prefetch dnodes for");
 #endif
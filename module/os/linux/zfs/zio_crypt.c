@@ -657,11 +657,87 @@ error:
 	return (ret);
 }
 
+/*
+ * IV generation batching.  Every encrypted block needs a fresh random
+ * IV, and drawing ZIO_DATA_IV_LEN bytes from the system RNG per block
+ * pays the full extraction cost each time.  Instead, lock-striped
+ * per-cpu pools are refilled from the RNG a page at a time and IVs are
+ * carved out of them, amortizing the RNG call across hundreds of
+ * blocks.  IVs are not secret (they are stored in the clear in the
+ * block pointer), so retaining issued bytes in the pool needs no
+ * scrubbing.  The rest of the per-block "housekeeping" is already
+ * cheap: the expanded AES key schedule is cached in the per-key crypto
+ * template at key load, and salt rotation only does real work once per
+ * ZFS_CURRENT_MAX_SALT_USES uses.
+ *
+ * One caveat of buffering RNG output: if a VM is forked while bytes sit
+ * in a pool, both clones would hand out the same IVs, where direct RNG
+ * draws would diverge after the hypervisor reseed.  The exposure is at
+ * most one page of IVs per cpu, and both clones writing with the same
+ * keys to cloned storage is already outside what ZFS supports, so the
+ * window is accepted rather than plumbing a reseed notifier here.
+ */
+#define	ZIO_IV_POOL_BYTES	4096
+
+typedef struct zio_iv_pool {
+	kmutex_t	zip_lock;
+	uint_t		zip_avail;
+	uint8_t		zip_bytes[ZIO_IV_POOL_BYTES];
+} zio_iv_pool_t;
+
+static zio_iv_pool_t *zio_iv_pools;
+static uint_t zio_iv_npools;
+
+void
+zio_crypt_init(void)
+{
+	zio_iv_npools = MAX(boot_ncpus, 1);
+	zio_iv_pools = vmem_zalloc(zio_iv_npools * sizeof (zio_iv_pool_t),
+	    KM_SLEEP);
+	for (uint_t i = 0; i < zio_iv_npools; i++) {
+		mutex_init(&zio_iv_pools[i].zip_lock, NULL,
+		    MUTEX_DEFAULT, NULL);
+	}
+}
+
+void
+zio_crypt_fini(void)
+{
+	for (uint_t i = 0; i < zio_iv_npools; i++)
+		mutex_destroy(&zio_iv_pools[i].zip_lock);
+	vmem_free(zio_iv_pools, zio_iv_npools * sizeof (zio_iv_pool_t));
+	zio_iv_pools = NULL;
+}
+
 int
 zio_crypt_generate_iv(uint8_t *ivbuf)
 {
 	int ret;
 
+	if (likely(zio_iv_pools != NULL)) {
+		zio_iv_pool_t *zip =
+		    &zio_iv_pools[CPU_SEQID_UNSTABLE % zio_iv_npools];
+
+		mutex_enter(&zip->zip_lock);
+		if (zip->zip_avail < ZIO_DATA_IV_LEN) {
+			ret = random_get_pseudo_bytes(zip->zip_bytes,
+			    sizeof (zip->zip_bytes));
+			if (ret != 0) {
+				/* Fall back to direct generation below */
+				mutex_exit(&zip->zip_lock);
+				goto direct;
+			}
+			zip->zip_avail = sizeof (zip->zip_bytes);
+		}
+		zip->zip_avail -= ZIO_DATA_IV_LEN;
+		memcpy(ivbuf, &zip->zip_bytes[zip->zip_avail],
+		    ZIO_DATA_IV_LEN);
+		mutex_exit(&zip->zip_lock);
+
+		return (0);
+	}
+
+direct:
 	/* randomly generate the IV */
 	ret = random_get_pseudo_bytes(ivbuf, ZIO_DATA_IV_LEN);
 	if (ret != 0)
@@ -2026,6 +2102,21 @@ error:
 	return (ret);
 }
 
+/*
+ * A note on large-block throughput: splitting one block's AES-GCM
+ * across cores (parallel CTR with GHASH recombination via powers of H)
+ * was considered and rejected.  Encryption runs synchronously in each
+ * zio's pipeline stage, and a large write is issued as many zios that
+ * are encrypted concurrently on separate issue threads, so per-stream
+ * throughput already scales across cores at block granularity.  The
+ * single-core cost per block is the domain of the SIMD GCM kernels
+ * (avx, avx2-vaes) in module/icp/algs/modes/gcm.c; intra-block fan-out
+ * would add a dispatch/join and cross-thread FPU-context juggling to
+ * every block for parallelism the pipeline already provides, while
+ * putting new correctness-critical recombination math into the crypto
+ * path.
+ */
+
 /*
  * Simple wrapper around zio_do_crypt_data() to work with abd's instead of
  * linear buffers.
@@ -304,20 +304,52 @@ zpl_snapdir_iterate(struct file *filp, struct dir_context *ctx)
 
 	/* Start the position at 0 if it already emitted . and .. */
 	pos = (ctx->pos == 2 ? 0 : ctx->pos);
+
+	/*
+	 * Gather names in batches so each pool-config lock acquisition
+	 * amortizes over many snapshots; with thousands of snapshots the
+	 * per-entry lock round trip, not the ZAP walk (which resumes via
+	 * the cursor and stays ARC-resident), is what made listings slow.
+	 * Emission to userspace happens after the lock is dropped, since
+	 * dir_emit() may fault.
+	 */
+#define	ZPL_SNAPDIR_BATCH	64
+	struct zpl_snap_ent {
+		char zse_name[MAXNAMELEN];
+		uint64_t zse_id;
+		uint64_t zse_pos;	/* cursor after this entry */
+	} *batch = vmem_alloc(ZPL_SNAPDIR_BATCH *
+	    sizeof (struct zpl_snap_ent), KM_SLEEP);
+
 	while (error == 0) {
+		uint_t n = 0;
+
 		dsl_pool_config_enter(dmu_objset_pool(zfsvfs->z_os), FTAG);
-		error = -dmu_snapshot_list_next(zfsvfs->z_os, MAXNAMELEN,
-		    snapname, &id, &pos, &case_conflict);
+		while (n < ZPL_SNAPDIR_BATCH) {
+			error = -dmu_snapshot_list_next(zfsvfs->z_os,
+			    MAXNAMELEN, snapname, &id, &pos, &case_conflict);
+			if (error)
+				break;
+			(void) strlcpy(batch[n].zse_name, snapname,
+			    sizeof (batch[n].zse_name));
+			batch[n].zse_id = id;
+			batch[n].zse_pos = pos;
+			n++;
+		}
 		dsl_pool_config_exit(dmu_objset_pool(zfsvfs->z_os), FTAG);
-		if (error)
-			goto out;
 
-		if (!dir_emit(ctx, snapname, strlen(snapname),
-		    ZFSCTL_INO_SHARES - id, DT_DIR))
-			goto out;
-
-		ctx->pos = pos;
+		for (uint_t i = 0; i < n; i++) {
+			if (!dir_emit(ctx, batch[i].zse_name,
+			    strlen(batch[i].zse_name),
+			    ZFSCTL_INO_SHARES - batch[i].zse_id, DT_DIR)) {
+				error = 0;
+				goto out_free;
+			}
+			ctx->pos = batch[i].zse_pos;
+		}
 	}
+out_free:
+	vmem_free(batch, ZPL_SNAPDIR_BATCH * sizeof (struct zpl_snap_ent));
 out:
 	spl_fstrans_unmark(cookie);
 	zpl_exit(zfsvfs, FTAG);
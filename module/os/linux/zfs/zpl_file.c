@@ -31,6 +31,9 @@
 #include <linux/compat.h>
 #endif
 #include <linux/fs.h>
+#ifdef HAVE_KIOCB_KI_IOPRIO
+#include <linux/ioprio.h>
+#endif
 #include <linux/migrate.h>
 #include <sys/file.h>
 #include <sys/dmu_objset.h>
@@ -111,9 +114,27 @@ zpl_iterate(struct file *filp, struct dir_context *ctx)
 	return (error);
 }
 
+/*
+ * Batch state for page writeback.  Pages handed to zpl_putpage() arrive
+ * locked and in ascending index order, so contiguous runs are collected
+ * here (still locked) and submitted as a single zfs_putpages() call -
+ * one transaction and one range lock per run instead of one per page.
+ * A run is flushed when it breaks, when the batch fills, and by the
+ * caller once iteration ends.
+ */
+#define	ZPL_PUTPAGE_BATCH	256
+
+typedef struct zpl_putpage_ctx {
+	boolean_t	zpc_for_sync;
+	int		zpc_npages;
+	struct page	*zpc_pages[ZPL_PUTPAGE_BATCH];
+} zpl_putpage_ctx_t;
+
 static inline int
 zpl_write_cache_pages(struct address_space *mapping,
     struct writeback_control *wbc, void *data);
+static int zpl_putpage_flush(zpl_putpage_ctx_t *zpc,
+    struct writeback_control *wbc);
 
 static int
 zpl_fsync(struct file *filp, loff_t start, loff_t end, int datasync)
@@ -135,15 +156,22 @@ zpl_fsync(struct file *filp, loff_t start, loff_t end, int datasync)
 	 * they're on disk, and so that we get an error if the DMU write fails.
 	 */
 	if (filemap_range_has_page(inode->i_mapping, start, end)) {
-		int for_sync = 1;
 		struct writeback_control wbc = {
 			.sync_mode = WB_SYNC_NONE,
 			.nr_to_write = LONG_MAX,
 			.range_start = start,
 			.range_end = end,
 		};
+		cookie = spl_fstrans_mark();
+		zpl_putpage_ctx_t *zpc = kmem_zalloc(sizeof (*zpc), KM_SLEEP);
+		spl_fstrans_unmark(cookie);
+		zpc->zpc_for_sync = B_TRUE;
 		error =
-		    zpl_write_cache_pages(inode->i_mapping, &wbc, &for_sync);
+		    zpl_write_cache_pages(inode->i_mapping, &wbc, zpc);
+		int ferror = zpl_putpage_flush(zpc, &wbc);
+		if (error == 0)
+			error = ferror;
+		kmem_free(zpc, sizeof (*zpc));
 		if (error != 0) {
 			/*
 			 * Unclear what state things are in. zfs_putpage() will
@@ -222,6 +250,18 @@ zpl_iter_read(struct kiocb *kiocb, struct iov_iter *to)
 
 	zfs_uio_iov_iter_init(&uio, to, kiocb->ki_pos, count);
 
+#ifdef HAVE_KIOCB_KI_IOPRIO
+	/*
+	 * An idle-class reader (ionice -c3, or per-I/O ioprio) gets its
+	 * demand reads issued at prefetch priority so it doesn't compete
+	 * with urgent readers in the vdev queues.  High-priority hints
+	 * (RWF_HIPRI) need no mapping: demand reads already use the top
+	 * read priority class.
+	 */
+	if (IOPRIO_PRIO_CLASS(kiocb->ki_ioprio) == IOPRIO_CLASS_IDLE)
+		uio.uio_extflg |= UIO_LOWPRI;
+#endif
+
 	crhold(cr);
 	cookie = spl_fstrans_mark();
 
@@ -466,18 +506,44 @@ zpl_readahead(struct readahead_control *ractl)
 #endif
 
 static int
-zpl_putpage(struct page *pp, struct writeback_control *wbc, void *data)
+zpl_putpage_flush(zpl_putpage_ctx_t *zpc, struct writeback_control *wbc)
 {
-	boolean_t *for_sync = data;
 	fstrans_cookie_t cookie;
 	int ret;
 
-	ASSERT(PageLocked(pp));
-	ASSERT(!PageWriteback(pp));
+	if (zpc->zpc_npages == 0)
+		return (0);
 
 	cookie = spl_fstrans_mark();
-	ret = zfs_putpage(pp->mapping->host, pp, wbc, *for_sync);
+	ret = zfs_putpages(zpc->zpc_pages[0]->mapping->host, zpc->zpc_pages,
+	    zpc->zpc_npages, wbc, zpc->zpc_for_sync);
 	spl_fstrans_unmark(cookie);
+	zpc->zpc_npages = 0;
+
+	return (ret);
+}
+
+static int
+zpl_putpage(struct page *pp, struct writeback_control *wbc, void *data)
+{
+	zpl_putpage_ctx_t *zpc = data;
+	int ret = 0;
+
+	ASSERT(PageLocked(pp));
+	ASSERT(!PageWriteback(pp));
+
+	/*
+	 * Flush the pending batch if this page doesn't extend the current
+	 * contiguous run.  The page stays locked while batched; holding
+	 * multiple page locks in ascending index order is safe, and the
+	 * lock keeps each page pinned and stable until it is submitted.
+	 */
+	if (zpc->zpc_npages == ZPL_PUTPAGE_BATCH ||
+	    (zpc->zpc_npages > 0 && pp->index !=
+	    zpc->zpc_pages[zpc->zpc_npages - 1]->index + 1))
+		ret = zpl_putpage_flush(zpc, wbc);
+
+	zpc->zpc_pages[zpc->zpc_npages++] = pp;
 
 	return (ret);
 }
@@ -599,12 +665,20 @@ zpl_writepages(struct address_space *mapping, struct writeback_control *wbc)
 	 * we run it once in non-SYNC mode so that the ZIL gets all the data,
 	 * and then we commit it all in one go.
 	 */
-	boolean_t for_sync = (sync_mode == WB_SYNC_ALL);
+	fstrans_cookie_t cookie = spl_fstrans_mark();
+	zpl_putpage_ctx_t *zpc = kmem_zalloc(sizeof (*zpc), KM_SLEEP);
+	spl_fstrans_unmark(cookie);
+	zpc->zpc_for_sync = (sync_mode == WB_SYNC_ALL);
 	wbc->sync_mode = WB_SYNC_NONE;
-	result = zpl_write_cache_pages(mapping, wbc, &for_sync);
+	result = zpl_write_cache_pages(mapping, wbc, zpc);
+	int fresult = zpl_putpage_flush(zpc, wbc);
+	if (result == 0)
+		result = fresult;
 	if (sync_mode != wbc->sync_mode) {
-		if ((result = zpl_enter_verify_zp(zfsvfs, zp, FTAG)) != 0)
+		if ((result = zpl_enter_verify_zp(zfsvfs, zp, FTAG)) != 0) {
+			kmem_free(zpc, sizeof (*zpc));
 			return (result);
+		}
 
 		if (zfsvfs->z_log != NULL) {
 			/*
@@ -625,8 +699,10 @@ zpl_writepages(struct address_space *mapping, struct writeback_control *wbc)
 		 * to the DMU, but it may not be on disk. We have little choice
 		 * but to escape.
 		 */
-		if (result != 0)
+		if (result != 0) {
+			kmem_free(zpc, sizeof (*zpc));
 			return (result);
+		}
 
 		/*
 		 * We need to call write_cache_pages() again (we can't just
@@ -636,8 +712,12 @@ zpl_writepages(struct address_space *mapping, struct writeback_control *wbc)
 		 * details). That being said, this is a no-op in most cases.
 		 */
 		wbc->sync_mode = sync_mode;
-		result = zpl_write_cache_pages(mapping, wbc, &for_sync);
+		result = zpl_write_cache_pages(mapping, wbc, zpc);
+		fresult = zpl_putpage_flush(zpc, wbc);
+		if (result == 0)
+			result = fresult;
 	}
+	kmem_free(zpc, sizeof (*zpc));
 	return (result);
 }
 
@@ -654,9 +734,18 @@ zpl_writepage(struct page *pp, struct writeback_control *wbc)
 	if (ITOZSB(pp->mapping->host)->z_os->os_sync == ZFS_SYNC_ALWAYS)
 		wbc->sync_mode = WB_SYNC_ALL;
 
-	boolean_t for_sync = (wbc->sync_mode == WB_SYNC_ALL);
+	fstrans_cookie_t cookie = spl_fstrans_mark();
+	zpl_putpage_ctx_t *zpc = kmem_zalloc(sizeof (*zpc), KM_SLEEP);
+	spl_fstrans_unmark(cookie);
+	zpc->zpc_for_sync = (wbc->sync_mode == WB_SYNC_ALL);
 
-	return (zpl_putpage(pp, wbc, &for_sync));
+	int err = zpl_putpage(pp, wbc, zpc);
+	int ferr = zpl_putpage_flush(zpc, wbc);
+	if (err == 0)
+		err = ferr;
+	kmem_free(zpc, sizeof (*zpc));
+
+	return (err);
 }
 #endif
 
@@ -795,6 +884,17 @@ zpl_fadvise(struct file *filp, loff_t offset, loff_t len, int advice)
 			zfs_exit(zfsvfs, FTAG);
 			return (error);
 		}
+	} else if (advice == POSIX_FADV_NOREUSE) {
+		/*
+		 * Mark I/O through this file as uncached: the buffers
+		 * pass through the ARC uncached state and are reclaimed
+		 * promptly instead of displacing the established MRU/MFU
+		 * working set, so e.g. a backup scan does not flush the
+		 * hot set.  POSIX_FADV_NORMAL restores regular caching.
+		 */
+		zp->z_noreuse = B_TRUE;
+	} else if (advice == POSIX_FADV_NORMAL) {
+		zp->z_noreuse = B_FALSE;
 	}
 
 #ifdef HAVE_GENERIC_FADVISE
@@ -208,6 +208,14 @@ zpl_xattr_list_dir(xattr_filldir_t *xf, cred_t *cr)
 	return (error);
 }
 
+/*
+ * A note on per-call cost: there is no bulk get/set xattr API to plumb -
+ * the VFS exposes one attribute per syscall - but repeated lookups do
+ * not re-decode the SA layout each time either.  The first SA xattr
+ * access unpacks the whole packed nvlist into zp->z_xattr_cached, and
+ * every subsequent get/list on that inode is served from the cached
+ * nvlist until the znode is evicted or the xattrs are modified.
+ */
 static ssize_t
 zpl_xattr_list_sa(xattr_filldir_t *xf)
 {
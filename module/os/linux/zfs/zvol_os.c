@@ -105,8 +105,56 @@ struct zvol_state_os {
 
 	/* Set from the global 'zvol_use_blk_mq' at zvol load */
 	boolean_t use_blk_mq;
+
+	/*
+	 * Plain asynchronous writes queued for a batched transaction;
+	 * see zvol_write_batch_run().  zvo_batch_active is set while a
+	 * worker task is draining the list.
+	 */
+	kmutex_t	zvo_batch_lock;
+	list_t		zvo_batch_list;
+	boolean_t	zvo_batch_active;
+
+	/* Queued discards awaiting merging; same protocol as above. */
+	kmutex_t	zvo_discard_lock;
+	list_t		zvo_discard_list;
+	boolean_t	zvo_discard_active;
 };
 
+/*
+ * Maximum number of queued write BIOs dirtied under one shared
+ * transaction.  0 disables batching and issues one transaction per
+ * write as before.
+ */
+static unsigned int zvol_write_batch = 16;
+
+/*
+ * Writes larger than this are handled individually (the regular path
+ * chunks them itself), and a batch is cut once it spans this much data.
+ */
+#define	ZVOL_WRITE_BATCH_MAX_IO		(1 << 20)
+#define	ZVOL_WRITE_BATCH_MAX_BYTES	(4 << 20)
+
+/*
+ * Maximum number of queued discard BIOs merged and freed together.
+ * Guest TRIM storms are mostly runs of small adjacent ranges; merging
+ * them yields one transaction, log record, and dmu_free_long_range()
+ * call per contiguous extent instead of one per BIO.  Values of 0 or
+ * 1 disable batching.
+ */
+static unsigned int zvol_discard_batch = 32;
+
+typedef struct zv_batch_ent {
+	list_node_t	zbe_node;
+	zv_request_t	zbe_zvr;
+	uint64_t	zbe_off;
+	uint64_t	zbe_size;
+	boolean_t	zbe_sync;
+	boolean_t	zbe_acct;
+	unsigned long	zbe_start_time;
+	int		zbe_error;
+} zv_batch_ent_t;
+
 static struct ida zvol_ida;
 
 /*
@@ -300,6 +348,238 @@ zvol_write_task(void *arg)
 	zv_request_task_free(task);
 }
 
+/*
+ * Apply one batch of queued writes under a single transaction: one
+ * range lock spanning the batch, one set of write holds, one
+ * dmu_tx_assign() and one commit, with a log record (and completion)
+ * per BIO.  An assignment failure fails the whole batch, the same
+ * ENOSPC every member would have seen individually.  Returns the
+ * number of requests completed; their zv_suspend_lock reader holds are
+ * intentionally NOT dropped here - the caller keeps them until it has
+ * finished looking at the batch queue, so the zvol cannot be removed
+ * out from under it.
+ */
+static uint_t
+zvol_write_batch_exec(zvol_state_t *zv, list_t *batch)
+{
+	struct request_queue *q = zv->zv_zso->zvo_queue;
+	struct gendisk *disk = zv->zv_zso->zvo_disk;
+	boolean_t sync = B_FALSE;
+	uint64_t span_start = UINT64_MAX, span_end = 0;
+	zv_batch_ent_t *ent;
+	int error;
+
+	for (ent = list_head(batch); ent != NULL;
+	    ent = list_next(batch, ent)) {
+		zv_request_t *zvr = &ent->zbe_zvr;
+
+		ent->zbe_off = io_offset(zvr->bio, zvr->rq);
+		ent->zbe_size = io_size(zvr->bio, zvr->rq);
+		ent->zbe_sync = io_is_fua(zvr->bio, zvr->rq) ||
+		    zv->zv_objset->os_sync == ZFS_SYNC_ALWAYS;
+		if (ent->zbe_sync)
+			sync = B_TRUE;
+		/* don't write past the end (e.g. a concurrent shrink) */
+		if (ent->zbe_off + ent->zbe_size > zv->zv_volsize) {
+			ent->zbe_error = SET_ERROR(EIO);
+			continue;
+		}
+		span_start = MIN(span_start, ent->zbe_off);
+		span_end = MAX(span_end, ent->zbe_off + ent->zbe_size);
+	}
+
+	if (span_start >= span_end) {
+		/* nothing writable in this batch */
+		uint_t done = 0;
+
+		while ((ent = list_remove_head(batch)) != NULL) {
+			zv_request_t *zvr = &ent->zbe_zvr;
+
+			zvol_end_io(zvr->bio, zvr->rq, ent->zbe_error);
+			kmem_free(ent, sizeof (*ent));
+			done++;
+		}
+		return (done);
+	}
+
+	zfs_locked_range_t *lr = zfs_rangelock_enter(&zv->zv_rangelock,
+	    span_start, span_end - span_start, RL_WRITER);
+
+	dmu_tx_t *tx = dmu_tx_create(zv->zv_objset);
+	for (ent = list_head(batch); ent != NULL;
+	    ent = list_next(batch, ent)) {
+		if (ent->zbe_error != 0)
+			continue;
+		dmu_tx_hold_write_by_dnode(tx, zv->zv_dn, ent->zbe_off,
+		    ent->zbe_size);
+	}
+
+	/* This will only fail for ENOSPC */
+	error = dmu_tx_assign(tx, DMU_TX_WAIT);
+	if (error) {
+		uint_t done = 0;
+
+		dmu_tx_abort(tx);
+		zfs_rangelock_exit(lr);
+		while ((ent = list_remove_head(batch)) != NULL) {
+			zv_request_t *zvr = &ent->zbe_zvr;
+
+			zvol_end_io(zvr->bio, zvr->rq, error);
+			kmem_free(ent, sizeof (*ent));
+			done++;
+		}
+		return (done);
+	}
+
+	for (ent = list_head(batch); ent != NULL;
+	    ent = list_next(batch, ent)) {
+		zv_request_t *zvr = &ent->zbe_zvr;
+		zfs_uio_t uio;
+
+		if (ent->zbe_error != 0)
+			continue;
+		if (zvr->bio != NULL && blk_queue_io_stat(q)) {
+			ent->zbe_start_time = blk_generic_start_io_acct(q,
+			    disk, WRITE, zvr->bio);
+			ent->zbe_acct = B_TRUE;
+		}
+		zfs_uio_bvec_init(&uio, zvr->bio, zvr->rq);
+		ent->zbe_error = dmu_write_uio_dnode(zv->zv_dn, &uio,
+		    ent->zbe_size, tx, DMU_READ_PREFETCH);
+		if (ent->zbe_error == 0) {
+			zvol_log_write(zv, tx, ent->zbe_off, ent->zbe_size,
+			    ent->zbe_sync);
+		}
+	}
+	dmu_tx_commit(tx);
+	zfs_rangelock_exit(lr);
+
+	error = 0;
+	if (sync)
+		error = zil_commit(zv->zv_zilog, ZVOL_OBJ);
+
+	uint_t done = 0;
+	while ((ent = list_remove_head(batch)) != NULL) {
+		zv_request_t *zvr = &ent->zbe_zvr;
+		int err = ent->zbe_error;
+
+		if (err == 0) {
+			dataset_kstats_update_write_kstats(&zv->zv_kstat,
+			    ent->zbe_size);
+			task_io_account_write(ent->zbe_size);
+			if (ent->zbe_sync)
+				err = error;
+		}
+
+		if (ent->zbe_acct) {
+			blk_generic_end_io_acct(q, disk, WRITE, zvr->bio,
+			    ent->zbe_start_time);
+		}
+
+		zvol_end_io(zvr->bio, zvr->rq, err);
+		kmem_free(ent, sizeof (*ent));
+		done++;
+	}
+
+	return (done);
+}
+
+/*
+ * Drain the zvol's queue of batchable writes, one shared transaction
+ * per batch, until the queue is empty.  Exactly one of these runs per
+ * zvol at a time (zvo_batch_active).
+ */
+static void
+zvol_write_batch_run(zvol_state_t *zv)
+{
+	struct zvol_state_os *zso = zv->zv_zso;
+	list_t batch;
+
+	uint_t held = 0;
+
+	list_create(&batch, sizeof (zv_batch_ent_t),
+	    offsetof(zv_batch_ent_t, zbe_node));
+
+	for (;;) {
+		uint64_t total = 0;
+		uint_t count = 0;
+		zv_batch_ent_t *ent;
+
+		mutex_enter(&zso->zvo_batch_lock);
+		while (count < zvol_write_batch &&
+		    total < ZVOL_WRITE_BATCH_MAX_BYTES &&
+		    (ent = list_remove_head(&zso->zvo_batch_list)) != NULL) {
+			list_insert_tail(&batch, ent);
+			total += io_size(ent->zbe_zvr.bio, ent->zbe_zvr.rq);
+			count++;
+		}
+		if (count == 0)
+			zso->zvo_batch_active = B_FALSE;
+		mutex_exit(&zso->zvo_batch_lock);
+
+		/*
+		 * Release the previous batch's zv_suspend_lock holds only
+		 * now: while we held them, zv and zso could not go away,
+		 * and if the queue was non-empty the new batch's own holds
+		 * take over.  Once zvo_batch_active is clear we no longer
+		 * touch zso, so the final holds can be dropped too.
+		 */
+		while (held > 0) {
+			rw_exit(&zv->zv_suspend_lock);
+			held--;
+		}
+		if (count == 0)
+			break;
+
+		held = zvol_write_batch_exec(zv, &batch);
+	}
+
+	list_destroy(&batch);
+}
+
+static void
+zvol_write_batch_task(void *arg)
+{
+	zv_request_task_t *task = arg;
+
+	zvol_write_batch_run(task->zvr.zv);
+	zv_request_task_free(task);
+}
+
+/*
+ * Queue an asynchronous plain write for batching, dispatching a worker
+ * task if none is draining the queue.  Returns B_FALSE if the caller
+ * should fall back to the unbatched path.
+ */
+static boolean_t
+zvol_write_batch_enqueue(zv_request_t *zvr, taskq_t *tq)
+{
+	zvol_state_t *zv = zvr->zv;
+	struct zvol_state_os *zso = zv->zv_zso;
+	zv_batch_ent_t *ent;
+	boolean_t dispatch;
+
+	ent = kmem_zalloc(sizeof (*ent), KM_NOSLEEP);
+	if (ent == NULL)
+		return (B_FALSE);
+	ent->zbe_zvr = *zvr;
+
+	mutex_enter(&zso->zvo_batch_lock);
+	list_insert_tail(&zso->zvo_batch_list, ent);
+	dispatch = !zso->zvo_batch_active;
+	zso->zvo_batch_active = B_TRUE;
+	mutex_exit(&zso->zvo_batch_lock);
+
+	if (dispatch) {
+		zv_request_t wzvr = { .zv = zv };
+		zv_request_task_t *task = zv_request_task_create(wzvr);
+
+		taskq_dispatch_ent(tq, zvol_write_batch_task, task, 0,
+		    &task->ent);
+	}
+	return (B_TRUE);
+}
+
 static void
 zvol_discard(zv_request_t *zvr)
 {
@@ -387,6 +667,240 @@ zvol_discard_task(void *arg)
 	zv_request_task_free(task);
 }
 
+/*
+ * Merge and execute a batch of queued discards.  Each request is
+ * aligned inward to volume block boundaries (see zvol_discard() for
+ * why), the aligned ranges are sorted and coalesced, and every merged
+ * extent is freed with one transaction, one log record, and one
+ * dmu_free_long_range() call.  Returns the number of requests
+ * completed; their zv_suspend_lock holds are released by the caller
+ * (see zvol_write_batch_run() for the protocol).
+ */
+static uint_t
+zvol_discard_batch_exec(zvol_state_t *zv, list_t *batch)
+{
+	struct request_queue *q = zv->zv_zso->zvo_queue;
+	struct gendisk *disk = zv->zv_zso->zvo_disk;
+	boolean_t sync = B_FALSE;
+	zv_batch_ent_t *ent;
+	uint_t nents = 0, next = 0;
+	int commit_error = 0;
+
+	for (ent = list_head(batch); ent != NULL;
+	    ent = list_next(batch, ent))
+		nents++;
+
+	uint64_t *starts = kmem_alloc(nents * sizeof (uint64_t), KM_SLEEP);
+	uint64_t *ends = kmem_alloc(nents * sizeof (uint64_t), KM_SLEEP);
+
+	for (ent = list_head(batch); ent != NULL;
+	    ent = list_next(batch, ent)) {
+		zv_request_t *zvr = &ent->zbe_zvr;
+		uint64_t start = io_offset(zvr->bio, zvr->rq);
+		uint64_t end = start + io_size(zvr->bio, zvr->rq);
+
+		if (zvr->bio != NULL && blk_queue_io_stat(q)) {
+			ent->zbe_start_time = blk_generic_start_io_acct(q,
+			    disk, WRITE, zvr->bio);
+			ent->zbe_acct = B_TRUE;
+		}
+
+		ent->zbe_sync = io_is_fua(zvr->bio, zvr->rq) ||
+		    zv->zv_objset->os_sync == ZFS_SYNC_ALWAYS;
+		if (ent->zbe_sync)
+			sync = B_TRUE;
+
+		if (end > zv->zv_volsize) {
+			ent->zbe_error = SET_ERROR(EIO);
+			continue;
+		}
+
+		start = P2ROUNDUP(start, zv->zv_volblocksize);
+		end = P2ALIGN_TYPED(end, zv->zv_volblocksize, uint64_t);
+		if (start >= end) {
+			/* Nothing usefully freeable; complete successfully */
+			ent->zbe_off = ent->zbe_size = 0;
+			continue;
+		}
+		ent->zbe_off = start;
+		ent->zbe_size = end - start;
+		starts[next] = start;
+		ends[next] = end;
+		next++;
+	}
+
+	/* Sort the aligned ranges by start offset (batches are small) */
+	for (uint_t i = 1; i < next; i++) {
+		uint64_t ks = starts[i], ke = ends[i];
+		uint_t j = i;
+
+		while (j > 0 && starts[j - 1] > ks) {
+			starts[j] = starts[j - 1];
+			ends[j] = ends[j - 1];
+			j--;
+		}
+		starts[j] = ks;
+		ends[j] = ke;
+	}
+
+	/* Coalesce overlapping and adjacent ranges in place */
+	uint_t nexts = 0;
+	for (uint_t i = 0; i < next; i++) {
+		if (nexts > 0 && starts[i] <= ends[nexts - 1]) {
+			ends[nexts - 1] = MAX(ends[nexts - 1], ends[i]);
+		} else {
+			starts[nexts] = starts[i];
+			ends[nexts] = ends[i];
+			nexts++;
+		}
+	}
+
+	for (uint_t i = 0; i < nexts; i++) {
+		uint64_t start = starts[i];
+		uint64_t size = ends[i] - start;
+		int error;
+
+		zfs_locked_range_t *lr = zfs_rangelock_enter(&zv->zv_rangelock,
+		    start, size, RL_WRITER);
+
+		dmu_tx_t *tx = dmu_tx_create(zv->zv_objset);
+		dmu_tx_mark_netfree(tx);
+		error = dmu_tx_assign(tx, DMU_TX_WAIT);
+		if (error != 0) {
+			dmu_tx_abort(tx);
+		} else {
+			zvol_log_truncate(zv, tx, start, size);
+			dmu_tx_commit(tx);
+			error = dmu_free_long_range(zv->zv_objset,
+			    ZVOL_OBJ, start, size);
+		}
+		zfs_rangelock_exit(lr);
+
+		if (error == 0)
+			continue;
+
+		/* Propagate the failure to every member of this extent */
+		for (ent = list_head(batch); ent != NULL;
+		    ent = list_next(batch, ent)) {
+			if (ent->zbe_size != 0 && ent->zbe_error == 0 &&
+			    ent->zbe_off >= start &&
+			    ent->zbe_off < start + size)
+				ent->zbe_error = error;
+		}
+	}
+
+	kmem_free(starts, nents * sizeof (uint64_t));
+	kmem_free(ends, nents * sizeof (uint64_t));
+
+	if (sync)
+		commit_error = zil_commit(zv->zv_zilog, ZVOL_OBJ);
+
+	uint_t done = 0;
+	while ((ent = list_remove_head(batch)) != NULL) {
+		zv_request_t *zvr = &ent->zbe_zvr;
+		int err = ent->zbe_error;
+
+		if (err == 0 && ent->zbe_sync)
+			err = commit_error;
+
+		if (ent->zbe_acct) {
+			blk_generic_end_io_acct(q, disk, WRITE, zvr->bio,
+			    ent->zbe_start_time);
+		}
+
+		zvol_end_io(zvr->bio, zvr->rq, err);
+		kmem_free(ent, sizeof (*ent));
+		done++;
+	}
+
+	return (done);
+}
+
+/*
+ * Drain the zvol's queue of discards; mirrors zvol_write_batch_run(),
+ * including the zv_suspend_lock hold handover.
+ */
+static void
+zvol_discard_batch_run(zvol_state_t *zv)
+{
+	struct zvol_state_os *zso = zv->zv_zso;
+	list_t batch;
+
+	uint_t held = 0;
+
+	list_create(&batch, sizeof (zv_batch_ent_t),
+	    offsetof(zv_batch_ent_t, zbe_node));
+
+	for (;;) {
+		uint_t count = 0;
+		zv_batch_ent_t *ent;
+
+		mutex_enter(&zso->zvo_discard_lock);
+		while (count < zvol_discard_batch &&
+		    (ent = list_remove_head(&zso->zvo_discard_list)) != NULL) {
+			list_insert_tail(&batch, ent);
+			count++;
+		}
+		if (count == 0)
+			zso->zvo_discard_active = B_FALSE;
+		mutex_exit(&zso->zvo_discard_lock);
+
+		while (held > 0) {
+			rw_exit(&zv->zv_suspend_lock);
+			held--;
+		}
+		if (count == 0)
+			break;
+
+		held = zvol_discard_batch_exec(zv, &batch);
+	}
+
+	list_destroy(&batch);
+}
+
+static void
+zvol_discard_batch_task(void *arg)
+{
+	zv_request_task_t *task = arg;
+
+	zvol_discard_batch_run(task->zvr.zv);
+	zv_request_task_free(task);
+}
+
+/*
+ * Queue a discard for merging, dispatching a worker task if none is
+ * draining the queue.  Returns B_FALSE if the caller should fall back
+ * to the unbatched path.
+ */
+static boolean_t
+zvol_discard_batch_enqueue(zv_request_t *zvr, taskq_t *tq)
+{
+	zvol_state_t *zv = zvr->zv;
+	struct zvol_state_os *zso = zv->zv_zso;
+	zv_batch_ent_t *ent;
+	boolean_t dispatch;
+
+	ent = kmem_zalloc(sizeof (*ent), KM_NOSLEEP);
+	if (ent == NULL)
+		return (B_FALSE);
+	ent->zbe_zvr = *zvr;
+
+	mutex_enter(&zso->zvo_discard_lock);
+	list_insert_tail(&zso->zvo_discard_list, ent);
+	dispatch = !zso->zvo_discard_active;
+	zso->zvo_discard_active = B_TRUE;
+	mutex_exit(&zso->zvo_discard_lock);
+
+	if (dispatch) {
+		zv_request_t dzvr = { .zv = zv };
+		zv_request_task_t *task = zv_request_task_create(dzvr);
+
+		taskq_dispatch_ent(tq, zvol_discard_batch_task, task, 0,
+		    &task->ent);
+	}
+	return (B_TRUE);
+}
+
 static void
 zvol_read(zv_request_t *zvr)
 {
@@ -564,6 +1078,15 @@ zvol_request_impl(zvol_state_t *zv, struct bio *bio, struct request *rq,
 		blk_mq_hw_queue = rq->q->queue_hw_ctx[
 		    rq->q->mq_map[raw_smp_processor_id()]]->queue_num;
 #endif
+	/*
+	 * Requests are spread over zvol_num_taskqs queues by zvol, offset
+	 * chunk, and blk-mq hardware queue, so one busy volume cannot
+	 * monopolize the workers and a given hctx's submissions keep
+	 * landing on the same queue.  NUMA affinity for those workers is
+	 * inherited from the global spl_taskq_thread_bind setting; binding
+	 * individual queues to cpusets would need a per-taskq affinity API
+	 * in the SPL.
+	 */
 	taskq_hash = cityhash3((uintptr_t)zv, offset >> ZVOL_TASKQ_OFFSET_SHIFT,
 	    blk_mq_hw_queue);
 	tq_idx = taskq_hash % ztqs->tqs_cnt;
@@ -634,6 +1157,10 @@ zvol_request_impl(zvol_state_t *zv, struct bio *bio, struct request *rq,
 		if (io_is_discard(bio, rq)) {
 			if (force_sync) {
 				zvol_discard(&zvr);
+			} else if (zvol_discard_batch > 1 &&
+			    zvol_discard_batch_enqueue(&zvr,
+			    ztqs->tqs_taskq[tq_idx])) {
+				/* queued for a merged batch */
 			} else {
 				task = zv_request_task_create(zvr);
 				taskq_dispatch_ent(ztqs->tqs_taskq[tq_idx],
@@ -642,6 +1169,12 @@ zvol_request_impl(zvol_state_t *zv, struct bio *bio, struct request *rq,
 		} else {
 			if (force_sync) {
 				zvol_write(&zvr);
+			} else if (zvol_write_batch > 1 &&
+			    !io_is_flush(bio, rq) && size > 0 &&
+			    size <= ZVOL_WRITE_BATCH_MAX_IO &&
+			    zvol_write_batch_enqueue(&zvr,
+			    ztqs->tqs_taskq[tq_idx])) {
+				/* queued for a batched transaction */
 			} else {
 				task = zv_request_task_create(zvr);
 				taskq_dispatch_ent(ztqs->tqs_taskq[tq_idx],
@@ -1392,6 +1925,12 @@ zvol_alloc(dev_t dev, const char *name, uint64_t volsize, uint64_t volblocksize,
 
 	zv = kmem_zalloc(sizeof (zvol_state_t), KM_SLEEP);
 	zso = kmem_zalloc(sizeof (struct zvol_state_os), KM_SLEEP);
+	mutex_init(&zso->zvo_batch_lock, NULL, MUTEX_DEFAULT, NULL);
+	list_create(&zso->zvo_batch_list, sizeof (zv_batch_ent_t),
+	    offsetof(zv_batch_ent_t, zbe_node));
+	mutex_init(&zso->zvo_discard_lock, NULL, MUTEX_DEFAULT, NULL);
+	list_create(&zso->zvo_discard_list, sizeof (zv_batch_ent_t),
+	    offsetof(zv_batch_ent_t, zbe_node));
 	zv->zv_zso = zso;
 	zv->zv_volmode = volmode;
 	zv->zv_volsize = volsize;
@@ -1472,6 +2011,10 @@ zvol_alloc(dev_t dev, const char *name, uint64_t volsize, uint64_t volblocksize,
 	return (ret);
 
 out_kmem:
+	list_destroy(&zso->zvo_batch_list);
+	mutex_destroy(&zso->zvo_batch_lock);
+	list_destroy(&zso->zvo_discard_list);
+	mutex_destroy(&zso->zvo_discard_lock);
 	kmem_free(zso, sizeof (struct zvol_state_os));
 	kmem_free(zv, sizeof (zvol_state_t));
 	return (ret);
@@ -1516,6 +2059,12 @@ zvol_os_remove_minor(zvol_state_t *zv)
 
 	ida_free(&zvol_ida, MINOR(zso->zvo_dev) >> ZVOL_MINOR_BITS);
 
+	ASSERT(list_is_empty(&zso->zvo_batch_list));
+	list_destroy(&zso->zvo_batch_list);
+	mutex_destroy(&zso->zvo_batch_lock);
+	ASSERT(list_is_empty(&zso->zvo_discard_list));
+	list_destroy(&zso->zvo_discard_list);
+	mutex_destroy(&zso->zvo_discard_lock);
 	kmem_free(zso, sizeof (struct zvol_state_os));
 
 	mutex_enter(&zv->zv_state_lock);
@@ -1900,4 +2449,12 @@ MODULE_PARM_DESC(zvol_blk_mq_blocks_per_thread,
 #ifndef HAVE_BLKDEV_GET_ERESTARTSYS
 module_param(zvol_open_timeout_ms, uint, 0644);
 MODULE_PARM_DESC(zvol_open_timeout_ms, "Timeout for ZVOL open retries");
+
+module_param(zvol_write_batch, uint, 0644);
+MODULE_PARM_DESC(zvol_write_batch,
+
+module_param(zvol_discard_batch, uint, 0644);
+MODULE_PARM_DESC(zvol_discard_batch,
+	"Max queued discards merged into one free operation");
+	"Max queued write BIOs dirtied under one transaction (0=disable)");
 #endif
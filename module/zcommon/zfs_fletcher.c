@@ -170,6 +170,39 @@ static fletcher_4_ops_t fletcher_4_fastest_impl = {
 	.valid = fletcher_4_scalar_valid
 };
 
+/*
+ * The deferred benchmark (see fletcher_4_benchmark()) assembles its
+ * result here and then publishes it with a single pointer store, so
+ * in-flight callers never observe a half-updated init/compute/fini
+ * triple.  Until it lands, "fastest" points at the startup guess in
+ * fletcher_4_fastest_impl above.
+ */
+static fletcher_4_ops_t fletcher_4_fastest_bench;
+static const fletcher_4_ops_t *volatile fletcher_4_fastest_ops =
+	&fletcher_4_fastest_impl;
+static taskqid_t fletcher_4_bench_taskqid = TASKQID_INVALID;
+
+/*
+ * Notes for anyone looking to extend this table.  Fletcher4's inner
+ * recurrence (a += data; b += a; c += b; d += c) is a serial dependency
+ * chain of 64-bit adds; the SIMD kernels below get their speedup by
+ * striding it across vector lanes and recombining the per-lane sums
+ * with fixed coefficients at the end.  Instructions that accelerate
+ * narrow dot products (e.g. AVX-512 VNNI) do not map onto this
+ * computation - there is no multiply and the accumulators are 64 bits -
+ * so the widest useful x86 kernel is the AVX-512BW one already here.
+ * An SVE/SVE2 kernel would slot straight into this ops table, but it
+ * needs the vector-length-agnostic recombination constants derived per
+ * hardware VL and must be validated on real silicon.
+ *
+ * Splitting one buffer's checksum across taskq workers was considered
+ * and rejected: checksums are already computed in parallel across
+ * blocks by the zio pipeline's issue taskqs, intra-block fan-out would
+ * add a dispatch/join per block to a sub-millisecond computation, and
+ * it would need general seek-ahead recombination (shifting a partial
+ * state by an arbitrary byte count), which the four-lane math here
+ * deliberately avoids.
+ */
 static const fletcher_4_ops_t *fletcher_4_impls[] = {
 	&fletcher_4_scalar_ops,
 	&fletcher_4_superscalar_ops,
@@ -428,7 +461,7 @@ fletcher_4_impl_get(void)
 	switch (impl) {
 	case IMPL_FASTEST:
 		ASSERT(fletcher_4_initialized);
-		ops = &fletcher_4_fastest_impl;
+		ops = fletcher_4_fastest_ops;
 		break;
 	case IMPL_CYCLE:
 		/* Cycle through supported implementations */
@@ -675,12 +708,12 @@ fletcher_4_kstat_addr(kstat_t *ksp, loff_t n)
 }
 #endif
 
-#define	FLETCHER_4_FASTEST_FN_COPY(type, src)				  \
-{									  \
-	fletcher_4_fastest_impl.init_ ## type = src->init_ ## type;	  \
-	fletcher_4_fastest_impl.fini_ ## type = src->fini_ ## type;	  \
-	fletcher_4_fastest_impl.compute_ ## type = src->compute_ ## type; \
-	fletcher_4_fastest_impl.uses_fpu = src->uses_fpu;		  \
+#define	FLETCHER_4_FASTEST_FN_COPY(type, src)				   \
+{									   \
+	fletcher_4_fastest_bench.init_ ## type = src->init_ ## type;	   \
+	fletcher_4_fastest_bench.fini_ ## type = src->fini_ ## type;	   \
+	fletcher_4_fastest_bench.compute_ ## type = src->compute_ ## type; \
+	fletcher_4_fastest_bench.uses_fpu = src->uses_fpu;		   \
 }
 
 #define	FLETCHER_4_BENCH_NS	(MSEC2NSEC(1))		/* 1ms */
@@ -751,6 +784,30 @@ fletcher_4_benchmark_impl(boolean_t native, char *data, uint64_t data_size)
 /*
  * Initialize and benchmark all supported implementations.
  */
+#if defined(_KERNEL)
+static void
+fletcher_4_benchmark_task(void *arg)
+{
+	(void) arg;
+	static const size_t data_size = 1 << SPA_OLD_MAXBLOCKSHIFT; /* 128kiB */
+	char *databuf = vmem_alloc(data_size, KM_SLEEP);
+	size_t i;
+
+	for (i = 0; i < data_size / sizeof (uint64_t); i++)
+		((uint64_t *)databuf)[i] = (uintptr_t)(databuf+i); /* warm-up */
+
+	fletcher_4_benchmark_impl(B_FALSE, databuf, data_size);
+	fletcher_4_benchmark_impl(B_TRUE, databuf, data_size);
+
+	vmem_free(databuf, data_size);
+
+	fletcher_4_fastest_bench.name = "fastest";
+	fletcher_4_fastest_bench.valid = fletcher_4_scalar_valid;
+	membar_producer();
+	fletcher_4_fastest_ops = &fletcher_4_fastest_bench;
+}
+#endif /* _KERNEL */
+
 static void
 fletcher_4_benchmark(void)
 {
@@ -767,28 +824,30 @@ fletcher_4_benchmark(void)
 	membar_producer();	/* complete fletcher_4_supp_impls[] init */
 	fletcher_4_supp_impls_cnt = c;	/* number of supported impl */
 
-#if defined(_KERNEL)
-	static const size_t data_size = 1 << SPA_OLD_MAXBLOCKSHIFT; /* 128kiB */
-	char *databuf = vmem_alloc(data_size, KM_SLEEP);
-
-	for (i = 0; i < data_size / sizeof (uint64_t); i++)
-		((uint64_t *)databuf)[i] = (uintptr_t)(databuf+i); /* warm-up */
-
-	fletcher_4_benchmark_impl(B_FALSE, databuf, data_size);
-	fletcher_4_benchmark_impl(B_TRUE, databuf, data_size);
-
-	vmem_free(databuf, data_size);
-#else
 	/*
-	 * Skip the benchmark in user space to avoid impacting libzpool
-	 * consumers (zdb, zhack, zinject, ztest).  The last implementation
-	 * is assumed to be the fastest and used by default.
+	 * Assume the last implementation is the fastest until measured
+	 * otherwise; this is the long-standing user space behavior and
+	 * keeps the benchmark itself off the module load path.
 	 */
 	memcpy(&fletcher_4_fastest_impl,
 	    fletcher_4_supp_impls[fletcher_4_supp_impls_cnt - 1],
 	    sizeof (fletcher_4_fastest_impl));
 	fletcher_4_fastest_impl.name = "fastest";
 	membar_producer();
+
+#if defined(_KERNEL)
+	/*
+	 * Run the benchmark in the background and switch "fastest" over
+	 * atomically when the results arrive, so module load doesn't
+	 * stall for milliseconds of measurement.  While the benchmark
+	 * runs, callers use the guess seeded above (every implementation
+	 * computes identical checksums, so this is purely a throughput
+	 * matter).
+	 */
+	fletcher_4_bench_taskqid = taskq_dispatch(system_taskq,
+	    fletcher_4_benchmark_task, NULL, TQ_SLEEP);
+	if (fletcher_4_bench_taskqid == TASKQID_INVALID)
+		fletcher_4_benchmark_task(NULL);
 #endif /* _KERNEL */
 }
 
@@ -821,6 +880,10 @@ void
 fletcher_4_fini(void)
 {
 #if defined(_KERNEL)
+	if (fletcher_4_bench_taskqid != TASKQID_INVALID) {
+		taskq_wait_id(system_taskq, fletcher_4_bench_taskqid);
+		fletcher_4_bench_taskqid = TASKQID_INVALID;
+	}
 	if (fletcher_4_kstat != NULL) {
 		kstat_delete(fletcher_4_kstat);
 		fletcher_4_kstat = NULL;
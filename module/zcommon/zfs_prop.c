@@ -505,6 +505,9 @@ zfs_prop_init(void)
 #endif
 	    PROP_INHERIT, ZFS_TYPE_FILESYSTEM, "on | off", "RELATIME",
 	    boolean_table, sfeatures);
+	zprop_register_index(ZFS_PROP_ALLOCLOCALITY, "alloclocality", 0,
+	    PROP_INHERIT, ZFS_TYPE_FILESYSTEM | ZFS_TYPE_VOLUME,
+	    "on | off", "ALLOCLOCALITY", boolean_table, sfeatures);
 	zprop_register_index(ZFS_PROP_DEVICES, "devices", 1, PROP_INHERIT,
 	    ZFS_TYPE_FILESYSTEM | ZFS_TYPE_SNAPSHOT, "on | off", "DEVICES",
 	    boolean_table, sfeatures);
@@ -699,6 +702,9 @@ zfs_prop_init(void)
 	/* default number properties */
 	zprop_register_number(ZFS_PROP_QUOTA, "quota", 0, PROP_DEFAULT,
 	    ZFS_TYPE_FILESYSTEM, "<size> | none", "QUOTA", B_FALSE, sfeatures);
+	zprop_register_number(ZFS_PROP_WRITELIMIT, "writelimit", 0,
+	    PROP_INHERIT, ZFS_TYPE_FILESYSTEM | ZFS_TYPE_VOLUME,
+	    "<size> | none", "WRITELIMIT", B_FALSE, sfeatures);
 	zprop_register_number(ZFS_PROP_RESERVATION, "reservation", 0,
 	    PROP_DEFAULT, ZFS_TYPE_FILESYSTEM | ZFS_TYPE_VOLUME,
 	    "<size> | none", "RESERV", B_FALSE, sfeatures);
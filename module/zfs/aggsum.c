@@ -76,6 +76,19 @@
  * case, we will have less fanout than boot_ncpus, but we don't want to always
  * reserve the RAM necessary to create the extra slots for additional CPUs up
  * front, and dynamically adding them is a complex task.
+ *
+ * Runtime-adaptive fanout runs into the same complexity squared: every
+ * add indexes the bucket array locklessly by CPU, so growing or
+ * shrinking it would need the array republished under something like
+ * RCU plus a full drain of borrowed state at every resize - machinery
+ * that would cost more than the contention it removes.  The adaptive
+ * lever that does exist is the aggsum_borrow_shift module parameter
+ * below: raising it makes buckets borrow bigger slices so
+ * parallel adds take as_lock exponentially less often (at the price of
+ * wider approximate bounds and costlier precise reads); lowering it
+ * favors workloads where aggsum_value()/aggsum_compare() dominate.
+ * Readers who only need an approximation should use
+ * aggsum_upper_bound(), which takes no locks at all.
  */
 
 /*
@@ -186,7 +199,7 @@ aggsum_add(aggsum_t *as, int64_t delta)
 	 * considering what is requested now and what we borrowed before.
 	 */
 	borrow = (delta < 0 ? -delta : delta);
-	borrow <<= aggsum_borrow_shift + as->as_bucketshift;
+	borrow <<= MIN(aggsum_borrow_shift, 32) + as->as_bucketshift;
 	mutex_enter(&as->as_lock);
 	if (borrow >= asb->asc_borrowed)
 		borrow -= asb->asc_borrowed;
@@ -244,3 +257,6 @@ aggsum_compare(aggsum_t *as, uint64_t target)
 	mutex_exit(&as->as_lock);
 	return (ub < target ? -1 : (uint64_t)lb > target ? 1 : 0);
 }
+
+ZFS_MODULE_PARAM(zfs, , aggsum_borrow_shift, UINT, ZMOD_RW,
+	"Aggsum bucket borrow size as a shift of the request size");
@@ -277,7 +277,7 @@
  * uncompressed data the worst thing that could happen is there might be a
  * performance hit. If the caller requests encrypted data, however, we must be
  * sure they actually get it or else secret information could be leaked. Raw
- * data is stored in hdr->b_crypt_hdr.b_rabd. An encrypted header, therefore,
+ * data is stored in hdr->b_crypt_hdr->b_rabd. An encrypted header, therefore,
  * may have both an encrypted version and a decrypted version of its data at
  * once. When a caller needs a raw arc_buf_t, it is allocated and the data is
  * copied out of this header. To avoid complications with b_pabd, raw buffers
@@ -339,6 +339,8 @@ static clock_t arc_last_uncached_flush;
 
 static taskq_t *arc_evict_taskq;
 static struct evict_arg *arc_evict_arg;
+static struct arc_evict_worker_stat *arc_evict_worker_stats;
+static kstat_t *arc_evict_worker_ksp;
 
 /*
  * Count of bytes evicted since boot.
@@ -436,6 +438,13 @@ static uint_t zfs_arc_grow_retry = 0;
 static uint_t zfs_arc_shrink_shift = 0;
 uint_t zfs_arc_average_blocksize = 8 * 1024; /* 8KB */
 
+/*
+ * Hash chain length on insert beyond which the buf hash table is grown
+ * (doubled) asynchronously.  Zero disables online growth, leaving the
+ * table at the size chosen by buf_init().
+ */
+static uint_t zfs_arc_hash_chain_limit = 16;
+
 /*
  * ARC dirty data constraints for arc_tempreserve_space() throttle:
  * * total dirty data limit
@@ -491,6 +500,20 @@ static taskq_t *arc_flush_taskq;
  */
 static uint_t zfs_arc_evict_threads = 0;
 
+/*
+ * When set, partition the ARC state multilists by NUMA node: headers are
+ * grouped into a band of sublists owned by the node they were allocated
+ * on, and eviction drains the calling thread's node-local band first.
+ * Evaluated once when the module is loaded.
+ */
+static int zfs_arc_numa = 0;
+
+/*
+ * Number of NUMA nodes the ARC state multilists are partitioned across.
+ * One (the flat layout) unless zfs_arc_numa is set on a multi-node box.
+ */
+static uint_t arc_numa_nodes = 1;
+
 /* The 7 states: */
 static arc_state_t ARC_anon;
 /*  */ arc_state_t ARC_mru;
@@ -516,6 +539,8 @@ arc_stats_t arc_stats = {
 	{ "prefetch_metadata_hits",	KSTAT_DATA_UINT64 },
 	{ "prefetch_metadata_iohits",	KSTAT_DATA_UINT64 },
 	{ "prefetch_metadata_misses",	KSTAT_DATA_UINT64 },
+	{ "decompress_ahead",		KSTAT_DATA_UINT64 },
+	{ "decompress_ahead_skip",	KSTAT_DATA_UINT64 },
 	{ "mru_hits",			KSTAT_DATA_UINT64 },
 	{ "mru_ghost_hits",		KSTAT_DATA_UINT64 },
 	{ "mfu_hits",			KSTAT_DATA_UINT64 },
@@ -548,6 +573,7 @@ arc_stats_t arc_stats = {
 	{ "uncompressed_size",		KSTAT_DATA_UINT64 },
 	{ "overhead_size",		KSTAT_DATA_UINT64 },
 	{ "hdr_size",			KSTAT_DATA_UINT64 },
+	{ "crypt_hdr_size",		KSTAT_DATA_UINT64 },
 	{ "data_size",			KSTAT_DATA_UINT64 },
 	{ "metadata_size",		KSTAT_DATA_UINT64 },
 	{ "dbuf_size",			KSTAT_DATA_UINT64 },
@@ -628,6 +654,8 @@ arc_stats_t arc_stats = {
 	{ "l2_rebuild_bufs",		KSTAT_DATA_UINT64 },
 	{ "l2_rebuild_bufs_precached",	KSTAT_DATA_UINT64 },
 	{ "l2_rebuild_log_blks",	KSTAT_DATA_UINT64 },
+	{ "l2_rebuild_expected_log_blks",	KSTAT_DATA_UINT64 },
+	{ "l2_rebuild_expected_lb_asize",	KSTAT_DATA_UINT64 },
 	{ "memory_throttle_count",	KSTAT_DATA_UINT64 },
 	{ "memory_direct_count",	KSTAT_DATA_UINT64 },
 	{ "memory_indirect_count",	KSTAT_DATA_UINT64 },
@@ -702,6 +730,102 @@ arc_sums_t arc_sums;
 
 static kstat_t			*arc_ksp;
 
+/*
+ * Log2 latency histograms for the ARC read and eviction-throttle
+ * paths, exported through the arc_latency kstat.  Bucket i counts
+ * events whose latency was in [2^(i-1), 2^i) nanoseconds (bucket 0
+ * is everything under 1ns, the last bucket absorbs the tail).
+ * Collection costs two gethrtime() calls per event and can be
+ * disabled with zfs_arc_latency_histogram.
+ */
+#define	ARC_LATENCY_BUCKETS	36
+
+typedef enum arc_latency_type {
+	ARC_LAT_DEMAND_HIT,	/* demand read served from cache */
+	ARC_LAT_MISS,		/* read issue to completion */
+	ARC_LAT_EVICT_STALL,	/* arc_wait_for_eviction() blocked */
+	ARC_LAT_NUMTYPES
+} arc_latency_type_t;
+
+static int zfs_arc_latency_histogram = 1;
+
+static wmsum_t arc_latency_sums[ARC_LAT_NUMTYPES][ARC_LATENCY_BUCKETS];
+static kstat_named_t arc_latency_stats[ARC_LAT_NUMTYPES *
+    ARC_LATENCY_BUCKETS];
+static kstat_t *arc_latency_ksp;
+
+static const char *const arc_latency_prefix[ARC_LAT_NUMTYPES] = {
+	"demand_hit", "miss", "evict_stall"
+};
+
+static void
+arc_latency_record(arc_latency_type_t type, hrtime_t start)
+{
+	if (start == 0)
+		return;
+
+	uint64_t ns = gethrtime() - start;
+	int b = MIN(highbit64(ns), ARC_LATENCY_BUCKETS - 1);
+
+	wmsum_add(&arc_latency_sums[type][b], 1);
+}
+
+static int
+arc_latency_kstat_update(kstat_t *ksp, int rw)
+{
+	kstat_named_t *ks = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (SET_ERROR(EACCES));
+
+	for (int t = 0; t < ARC_LAT_NUMTYPES; t++) {
+		for (int b = 0; b < ARC_LATENCY_BUCKETS; b++) {
+			ks[t * ARC_LATENCY_BUCKETS + b].value.ui64 =
+			    wmsum_value(&arc_latency_sums[t][b]);
+		}
+	}
+	return (0);
+}
+
+static void
+arc_latency_kstat_init(void)
+{
+	for (int t = 0; t < ARC_LAT_NUMTYPES; t++) {
+		for (int b = 0; b < ARC_LATENCY_BUCKETS; b++) {
+			kstat_named_t *k =
+			    &arc_latency_stats[t * ARC_LATENCY_BUCKETS + b];
+
+			wmsum_init(&arc_latency_sums[t][b], 0);
+			(void) snprintf(k->name, sizeof (k->name),
+			    "%s_ns_%llu", arc_latency_prefix[t],
+			    (u_longlong_t)(1ULL << b));
+			k->data_type = KSTAT_DATA_UINT64;
+		}
+	}
+
+	arc_latency_ksp = kstat_create("zfs", 0, "arc_latency", "misc",
+	    KSTAT_TYPE_NAMED, ARC_LAT_NUMTYPES * ARC_LATENCY_BUCKETS,
+	    KSTAT_FLAG_VIRTUAL);
+	if (arc_latency_ksp != NULL) {
+		arc_latency_ksp->ks_data = arc_latency_stats;
+		arc_latency_ksp->ks_update = arc_latency_kstat_update;
+		kstat_install(arc_latency_ksp);
+	}
+}
+
+static void
+arc_latency_kstat_fini(void)
+{
+	if (arc_latency_ksp != NULL) {
+		kstat_delete(arc_latency_ksp);
+		arc_latency_ksp = NULL;
+	}
+	for (int t = 0; t < ARC_LAT_NUMTYPES; t++) {
+		for (int b = 0; b < ARC_LATENCY_BUCKETS; b++)
+			wmsum_fini(&arc_latency_sums[t][b]);
+	}
+}
+
 /*
  * There are several ARC variables that are critical to export as kstats --
  * but we don't want to have to grovel around in the kstat whenever we wish to
@@ -719,6 +843,17 @@ hrtime_t arc_growtime;
 list_t arc_prune_list;
 kmutex_t arc_prune_mtx;
 taskq_t *arc_prune_taskq;
+static taskq_t *arc_decomp_taskq;
+
+/*
+ * Speculative decompress-ahead of prefetched blocks (see the comment
+ * above arc_decompress_ahead_task()).  Disabled by default; the _max
+ * tunable bounds the bytes of conversions queued at once, which in turn
+ * bounds the CPU spent and the transient non-evictable footprint.
+ */
+static int zfs_arc_decompress_ahead = 0;
+static uint64_t zfs_arc_decompress_ahead_max = 16 * 1024 * 1024;
+static uint64_t arc_decomp_ahead_inflight = 0;
 
 #define	GHOST_STATE(state)	\
 	((state) == arc_mru_ghost || (state) == arc_mfu_ghost ||	\
@@ -753,11 +888,11 @@ taskq_t *arc_prune_taskq;
 #define	HDR_HAS_L2HDR(hdr)	((hdr)->b_flags & ARC_FLAG_HAS_L2HDR)
 #define	HDR_HAS_RABD(hdr)	\
 	(HDR_HAS_L1HDR(hdr) && HDR_PROTECTED(hdr) &&	\
-	(hdr)->b_crypt_hdr.b_rabd != NULL)
+	(hdr)->b_crypt_hdr != NULL && (hdr)->b_crypt_hdr->b_rabd != NULL)
 #define	HDR_ENCRYPTED(hdr)	\
-	(HDR_PROTECTED(hdr) && DMU_OT_IS_ENCRYPTED((hdr)->b_crypt_hdr.b_ot))
+	(HDR_PROTECTED(hdr) && DMU_OT_IS_ENCRYPTED((hdr)->b_crypt_hdr->b_ot))
 #define	HDR_AUTHENTICATED(hdr)	\
-	(HDR_PROTECTED(hdr) && !DMU_OT_IS_ENCRYPTED((hdr)->b_crypt_hdr.b_ot))
+	(HDR_PROTECTED(hdr) && !DMU_OT_IS_ENCRYPTED((hdr)->b_crypt_hdr->b_ot))
 
 /* For storing compression mode in b_flags */
 #define	HDR_COMPRESS_OFFSET	(highbit64(ARC_FLAG_COMPRESS_0) - 1)
@@ -787,16 +922,37 @@ taskq_t *arc_prune_taskq;
 typedef struct buf_hash_table {
 	uint64_t ht_mask;
 	arc_buf_hdr_t **ht_table;
+	/*
+	 * Online resize state, written only by buf_hash_grow_task()
+	 * under the bucket locks.  While ht_resizing is set, old
+	 * buckets at or above ht_migrated still live in ht_old_table;
+	 * everything below it has been moved to ht_new_table.  See
+	 * buf_hash_bucket() for the lookup rules and
+	 * buf_hash_grow_task() for why this is safe against concurrent
+	 * bucket-lock holders.
+	 */
+	uint_t ht_resizing;
+	uint64_t ht_migrated;
+	uint64_t ht_old_mask;
+	arc_buf_hdr_t **ht_old_table;
+	uint64_t ht_new_mask;
+	arc_buf_hdr_t **ht_new_table;
 	kmutex_t ht_locks[BUF_LOCKS] ____cacheline_aligned;
 } buf_hash_table_t;
 
 static buf_hash_table_t buf_hash_table;
 
-#define	BUF_HASH_INDEX(spa, dva, birth) \
-	(buf_hash(spa, dva, birth) & buf_hash_table.ht_mask)
-#define	BUF_HASH_LOCK(idx)	(&buf_hash_table.ht_locks[idx & (BUF_LOCKS-1)])
+/*
+ * The hash table only ever grows by power-of-two doubling and is never
+ * smaller than BUF_LOCKS buckets, so the low bits selecting a bucket's
+ * lock are the same no matter which mask the bucket index came from.
+ * This lets the lock be derived from the raw hash value (or any bucket
+ * index), which in turn is what makes the incremental resize safe: an
+ * old bucket and both new buckets it splits into share one lock.
+ */
+#define	BUF_HASH_LOCK(h)	(&buf_hash_table.ht_locks[(h) & (BUF_LOCKS-1)])
 #define	HDR_LOCK(hdr) \
-	(BUF_HASH_LOCK(BUF_HASH_INDEX(hdr->b_spa, &hdr->b_dva, hdr->b_birth)))
+	(BUF_HASH_LOCK(buf_hash(hdr->b_spa, &hdr->b_dva, hdr->b_birth)))
 
 uint64_t zfs_crc64_table[256];
 
@@ -850,6 +1006,14 @@ static uint64_t l2arc_dwpd_bump = 0;			/* DWPD reset trigger */
 static uint64_t l2arc_headroom = L2ARC_HEADROOM;	/* # of dev writes */
 static uint64_t l2arc_headroom_boost = L2ARC_HEADROOM_BOOST;
 static uint64_t l2arc_feed_secs = L2ARC_FEED_SECS;	/* interval seconds */
+
+/*
+ * When the cache device's observed service latency (vdev queue EWMA)
+ * exceeds this many milliseconds, cut the feed rate to a quarter until
+ * it recovers, so feeding yields to the reads the cache exists to
+ * serve.  Zero disables the backoff.
+ */
+static uint64_t l2arc_feed_latency_ms = 5;
 static uint64_t l2arc_feed_min_ms = L2ARC_FEED_MIN_MS;	/* min interval msecs */
 static int l2arc_noprefetch = B_TRUE;		/* don't cache prefetch bufs */
 static int l2arc_feed_again = B_TRUE;		/* turbo warmup */
@@ -1072,17 +1236,151 @@ buf_discard_identity(arc_buf_hdr_t *hdr)
 	hdr->b_birth = 0;
 }
 
+/*
+ * Return the hash bucket the given hash value currently maps to.  The
+ * caller must hold BUF_HASH_LOCK(h), which also serializes against the
+ * bucket being split by an in-progress table resize.
+ */
+static arc_buf_hdr_t **
+buf_hash_bucket(uint64_t h)
+{
+	buf_hash_table_t *ht = &buf_hash_table;
+
+	ASSERT(MUTEX_HELD(BUF_HASH_LOCK(h)));
+
+	if (ht->ht_resizing) {
+		uint64_t oidx = h & ht->ht_old_mask;
+
+		if (oidx >= ht->ht_migrated)
+			return (&ht->ht_old_table[oidx]);
+		return (&ht->ht_new_table[h & ht->ht_new_mask]);
+	}
+
+	return (&ht->ht_table[h & ht->ht_mask]);
+}
+
+/*
+ * Set while a grow is queued or running; cleared by buf_hash_grow_task()
+ * once the resize (or a failed dispatch) is over.
+ */
+static volatile uint_t buf_hash_grow_inflight;
+
+/*
+ * Double the bucket array and incrementally rehash into it.  Entry to
+ * and exit from the resizing state happen with every bucket lock held,
+ * so buf_hash_bucket() callers (who hold one of them) always see a
+ * consistent view; each old bucket is then migrated under just its own
+ * lock.  Because the table only ever doubles and is never smaller than
+ * BUF_LOCKS buckets, an old bucket and both new buckets it splits into
+ * share one lock, so lookups and inserts racing with the migration are
+ * serialized per-bucket and never block behind the whole resize.
+ */
+static void
+buf_hash_grow_task(void *unused)
+{
+	(void) unused;
+	buf_hash_table_t *ht = &buf_hash_table;
+	uint64_t osize = ht->ht_mask + 1;
+	uint64_t nsize = osize << 1;
+	arc_buf_hdr_t **ntable;
+	int i;
+
+#if defined(_KERNEL)
+	/*
+	 * Large allocations which do not require contiguous pages
+	 * should be using vmem_alloc() in the linux kernel
+	 */
+	ntable = vmem_zalloc(nsize * sizeof (void *), KM_SLEEP);
+#else
+	ntable = kmem_zalloc(nsize * sizeof (void *), KM_NOSLEEP);
+	if (ntable == NULL) {
+		buf_hash_grow_inflight = 0;
+		return;
+	}
+#endif
+
+	for (i = 0; i < BUF_LOCKS; i++)
+		mutex_enter(&ht->ht_locks[i]);
+	ht->ht_old_mask = ht->ht_mask;
+	ht->ht_old_table = ht->ht_table;
+	ht->ht_new_mask = nsize - 1;
+	ht->ht_new_table = ntable;
+	ht->ht_migrated = 0;
+	ht->ht_resizing = 1;
+	for (i = BUF_LOCKS - 1; i >= 0; i--)
+		mutex_exit(&ht->ht_locks[i]);
+
+	for (uint64_t b = 0; b < osize; b++) {
+		kmutex_t *lock = BUF_HASH_LOCK(b);
+		arc_buf_hdr_t *hdr;
+
+		mutex_enter(lock);
+		if (ht->ht_old_table[b] != NULL &&
+		    ht->ht_old_table[b]->b_hash_next != NULL)
+			ARCSTAT_BUMPDOWN(arcstat_hash_chains);
+		while ((hdr = ht->ht_old_table[b]) != NULL) {
+			uint64_t h = buf_hash(hdr->b_spa, &hdr->b_dva,
+			    hdr->b_birth);
+			uint64_t nidx = h & ht->ht_new_mask;
+
+			ASSERT3U(h & ht->ht_old_mask, ==, b);
+			ht->ht_old_table[b] = hdr->b_hash_next;
+			if (ht->ht_new_table[nidx] != NULL &&
+			    ht->ht_new_table[nidx]->b_hash_next == NULL)
+				ARCSTAT_BUMP(arcstat_hash_chains);
+			hdr->b_hash_next = ht->ht_new_table[nidx];
+			ht->ht_new_table[nidx] = hdr;
+		}
+		ht->ht_migrated = b + 1;
+		mutex_exit(lock);
+	}
+
+	for (i = 0; i < BUF_LOCKS; i++)
+		mutex_enter(&ht->ht_locks[i]);
+	ht->ht_mask = ht->ht_new_mask;
+	ht->ht_table = ht->ht_new_table;
+	ht->ht_resizing = 0;
+	for (i = BUF_LOCKS - 1; i >= 0; i--)
+		mutex_exit(&ht->ht_locks[i]);
+
+#if defined(_KERNEL)
+	vmem_free(ht->ht_old_table, osize * sizeof (void *));
+#else
+	kmem_free(ht->ht_old_table, osize * sizeof (void *));
+#endif
+	ht->ht_old_table = NULL;
+
+	buf_hash_grow_inflight = 0;
+}
+
+/*
+ * Kick off an asynchronous doubling of the buf hash table.  Called
+ * with a bucket lock held, so the work runs from arc_flush_taskq,
+ * which arc_fini() drains before buf_fini() tears the table down.
+ */
+static void
+buf_hash_grow(void)
+{
+	if (arc_flush_taskq == NULL ||
+	    atomic_cas_uint(&buf_hash_grow_inflight, 0, 1) != 0)
+		return;
+
+	if (taskq_dispatch(arc_flush_taskq, buf_hash_grow_task, NULL,
+	    TQ_SLEEP) == TASKQID_INVALID)
+		buf_hash_grow_inflight = 0;
+}
+
 static arc_buf_hdr_t *
 buf_hash_find(uint64_t spa, const blkptr_t *bp, kmutex_t **lockp)
 {
 	const dva_t *dva = BP_IDENTITY(bp);
 	uint64_t birth = BP_GET_PHYSICAL_BIRTH(bp);
-	uint64_t idx = BUF_HASH_INDEX(spa, dva, birth);
-	kmutex_t *hash_lock = BUF_HASH_LOCK(idx);
+	uint64_t h = buf_hash(spa, dva, birth);
+	kmutex_t *hash_lock = BUF_HASH_LOCK(h);
 	arc_buf_hdr_t *hdr;
 
 	mutex_enter(hash_lock);
-	for (hdr = buf_hash_table.ht_table[idx]; hdr != NULL;
+	for (hdr = *buf_hash_bucket(h); hdr != NULL;
 	    hdr = hdr->b_hash_next) {
 		if (HDR_EQUAL(spa, dva, birth, hdr)) {
 			*lockp = hash_lock;
@@ -1104,9 +1402,9 @@ buf_hash_find(uint64_t spa, const blkptr_t *bp, kmutex_t **lockp)
 static arc_buf_hdr_t *
 buf_hash_insert(arc_buf_hdr_t *hdr, kmutex_t **lockp)
 {
-	uint64_t idx = BUF_HASH_INDEX(hdr->b_spa, &hdr->b_dva, hdr->b_birth);
-	kmutex_t *hash_lock = BUF_HASH_LOCK(idx);
-	arc_buf_hdr_t *fhdr;
+	uint64_t h = buf_hash(hdr->b_spa, &hdr->b_dva, hdr->b_birth);
+	kmutex_t *hash_lock = BUF_HASH_LOCK(h);
+	arc_buf_hdr_t *fhdr, **bucket;
 	uint32_t i;
 
 	ASSERT(!DVA_IS_EMPTY(&hdr->b_dva));
@@ -1120,14 +1418,15 @@ buf_hash_insert(arc_buf_hdr_t *hdr, kmutex_t **lockp)
 		ASSERT(MUTEX_HELD(hash_lock));
 	}
 
-	for (fhdr = buf_hash_table.ht_table[idx], i = 0; fhdr != NULL;
+	bucket = buf_hash_bucket(h);
+	for (fhdr = *bucket, i = 0; fhdr != NULL;
 	    fhdr = fhdr->b_hash_next, i++) {
 		if (HDR_EQUAL(hdr->b_spa, &hdr->b_dva, hdr->b_birth, fhdr))
 			return (fhdr);
 	}
 
-	hdr->b_hash_next = buf_hash_table.ht_table[idx];
-	buf_hash_table.ht_table[idx] = hdr;
+	hdr->b_hash_next = *bucket;
+	*bucket = hdr;
 	arc_hdr_set_flags(hdr, ARC_FLAG_IN_HASH_TABLE);
 
 	/* collect some hash table performance data */
@@ -1139,19 +1438,28 @@ buf_hash_insert(arc_buf_hdr_t *hdr, kmutex_t **lockp)
 	}
 	ARCSTAT_BUMP(arcstat_hash_elements);
 
+	/*
+	 * Long chains mean the table has been outgrown; kick off an
+	 * asynchronous doubling of the bucket array.
+	 */
+	if (zfs_arc_hash_chain_limit != 0 &&
+	    i >= zfs_arc_hash_chain_limit && !buf_hash_table.ht_resizing)
+		buf_hash_grow();
+
 	return (NULL);
 }
 
 static void
 buf_hash_remove(arc_buf_hdr_t *hdr)
 {
-	arc_buf_hdr_t *fhdr, **hdrp;
-	uint64_t idx = BUF_HASH_INDEX(hdr->b_spa, &hdr->b_dva, hdr->b_birth);
+	arc_buf_hdr_t *fhdr, **hdrp, **bucket;
+	uint64_t h = buf_hash(hdr->b_spa, &hdr->b_dva, hdr->b_birth);
 
-	ASSERT(MUTEX_HELD(BUF_HASH_LOCK(idx)));
+	ASSERT(MUTEX_HELD(BUF_HASH_LOCK(h)));
 	ASSERT(HDR_IN_HASH_TABLE(hdr));
 
-	hdrp = &buf_hash_table.ht_table[idx];
+	bucket = buf_hash_bucket(h);
+	hdrp = bucket;
 	while ((fhdr = *hdrp) != hdr) {
 		ASSERT3P(fhdr, !=, NULL);
 		hdrp = &fhdr->b_hash_next;
@@ -1162,8 +1470,7 @@ buf_hash_remove(arc_buf_hdr_t *hdr)
 
 	/* collect some hash table performance data */
 	ARCSTAT_BUMPDOWN(arcstat_hash_elements);
-	if (buf_hash_table.ht_table[idx] &&
-	    buf_hash_table.ht_table[idx]->b_hash_next == NULL)
+	if (*bucket && (*bucket)->b_hash_next == NULL)
 		ARCSTAT_BUMPDOWN(arcstat_hash_chains);
 }
 
@@ -1173,6 +1480,7 @@ buf_hash_remove(arc_buf_hdr_t *hdr)
 
 static kmem_cache_t *hdr_full_cache;
 static kmem_cache_t *hdr_l2only_cache;
+static kmem_cache_t *hdr_crypt_cache;
 static kmem_cache_t *buf_cache;
 
 static void
@@ -1193,6 +1501,7 @@ buf_fini(void)
 		mutex_destroy(BUF_HASH_LOCK(i));
 	kmem_cache_destroy(hdr_full_cache);
 	kmem_cache_destroy(hdr_l2only_cache);
+	kmem_cache_destroy(hdr_crypt_cache);
 	kmem_cache_destroy(buf_cache);
 }
 
@@ -1231,6 +1540,18 @@ hdr_l2only_cons(void *vbuf, void *unused, int kmflag)
 	return (0);
 }
 
+static int
+hdr_crypt_cons(void *vbuf, void *unused, int kmflag)
+{
+	(void) unused, (void) kmflag;
+	arc_buf_hdr_crypt_t *crypt = vbuf;
+
+	memset(crypt, 0, sizeof (arc_buf_hdr_crypt_t));
+	arc_space_consume(sizeof (arc_buf_hdr_crypt_t), ARC_SPACE_CRYPT_HDRS);
+
+	return (0);
+}
+
 static int
 buf_cons(void *vbuf, void *unused, int kmflag)
 {
@@ -1254,6 +1575,7 @@ hdr_full_dest(void *vbuf, void *unused)
 	arc_buf_hdr_t *hdr = vbuf;
 
 	ASSERT(HDR_EMPTY(hdr));
+	ASSERT0P(hdr->b_crypt_hdr);
 	zfs_refcount_destroy(&hdr->b_l1hdr.b_refcnt);
 #ifdef ZFS_DEBUG
 	mutex_destroy(&hdr->b_l1hdr.b_freeze_lock);
@@ -1272,6 +1594,16 @@ hdr_l2only_dest(void *vbuf, void *unused)
 	arc_space_return(HDR_L2ONLY_SIZE, ARC_SPACE_L2HDRS);
 }
 
+static void
+hdr_crypt_dest(void *vbuf, void *unused)
+{
+	(void) unused;
+	arc_buf_hdr_crypt_t *crypt = vbuf;
+
+	ASSERT0P(crypt->b_rabd);
+	arc_space_return(sizeof (arc_buf_hdr_crypt_t), ARC_SPACE_CRYPT_HDRS);
+}
+
 static void
 buf_dest(void *vbuf, void *unused)
 {
@@ -1320,6 +1652,9 @@ retry:
 	hdr_l2only_cache = kmem_cache_create("arc_buf_hdr_t_l2only",
 	    HDR_L2ONLY_SIZE, 0, hdr_l2only_cons, hdr_l2only_dest, NULL,
 	    NULL, NULL, 0);
+	hdr_crypt_cache = kmem_cache_create("arc_buf_hdr_crypt_t",
+	    sizeof (arc_buf_hdr_crypt_t), 0, hdr_crypt_cons, hdr_crypt_dest,
+	    NULL, NULL, NULL, KMC_RECLAIMABLE);
 	buf_cache = kmem_cache_create("arc_buf_t", sizeof (arc_buf_t),
 	    0, buf_cons, buf_dest, NULL, NULL, NULL, 0);
 
@@ -1379,9 +1714,9 @@ arc_get_raw_params(arc_buf_t *buf, boolean_t *byteorder, uint8_t *salt,
 
 	ASSERT(HDR_PROTECTED(hdr));
 
-	memcpy(salt, hdr->b_crypt_hdr.b_salt, ZIO_DATA_SALT_LEN);
-	memcpy(iv, hdr->b_crypt_hdr.b_iv, ZIO_DATA_IV_LEN);
-	memcpy(mac, hdr->b_crypt_hdr.b_mac, ZIO_DATA_MAC_LEN);
+	memcpy(salt, hdr->b_crypt_hdr->b_salt, ZIO_DATA_SALT_LEN);
+	memcpy(iv, hdr->b_crypt_hdr->b_iv, ZIO_DATA_IV_LEN);
+	memcpy(mac, hdr->b_crypt_hdr->b_mac, ZIO_DATA_MAC_LEN);
 	*byteorder = (hdr->b_l1hdr.b_byteswap == DMU_BSWAP_NUMFUNCS) ?
 	    ZFS_HOST_BYTEORDER : !ZFS_HOST_BYTEORDER;
 }
@@ -1783,6 +2118,8 @@ arc_buf_alloc_l2only(size_t size, arc_buf_contents_t type, l2arc_dev_t *dev,
 	hdr->b_birth = birth;
 	hdr->b_type = type;
 	hdr->b_flags = 0;
+	hdr->b_numa_node = (arc_numa_nodes > 1) ?
+	    (uint8_t)arc_numa_current_node() : 0;
 	arc_hdr_set_flags(hdr, arc_bufc_to_flags(type) | ARC_FLAG_HAS_L2HDR);
 	HDR_SET_LSIZE(hdr, size);
 	HDR_SET_PSIZE(hdr, psize);
@@ -1863,14 +2200,14 @@ arc_hdr_authenticate(arc_buf_hdr_t *hdr, spa_t *spa, uint64_t dsobj)
 	 * Authentication is best effort. We authenticate whenever the key is
 	 * available. If we succeed we clear ARC_FLAG_NOAUTH.
 	 */
-	if (hdr->b_crypt_hdr.b_ot == DMU_OT_OBJSET) {
+	if (hdr->b_crypt_hdr->b_ot == DMU_OT_OBJSET) {
 		ASSERT3U(HDR_GET_COMPRESS(hdr), ==, ZIO_COMPRESS_OFF);
 		ASSERT3U(lsize, ==, psize);
 		ret = spa_do_crypt_objset_mac_abd(B_FALSE, spa, dsobj, abd,
 		    psize, hdr->b_l1hdr.b_byteswap != DMU_BSWAP_NUMFUNCS);
 	} else {
 		ret = spa_do_crypt_mac_abd(B_FALSE, spa, dsobj, abd, psize,
-		    hdr->b_crypt_hdr.b_mac);
+		    hdr->b_crypt_hdr->b_mac);
 	}
 
 	if (ret == 0)
@@ -1886,7 +2223,7 @@ arc_hdr_authenticate(arc_buf_hdr_t *hdr, spa_t *spa, uint64_t dsobj)
 
 /*
  * This function will take a header that only has raw encrypted data in
- * b_crypt_hdr.b_rabd and decrypt it into a new buffer which is stored in
+ * b_crypt_hdr->b_rabd and decrypt it into a new buffer which is stored in
  * b_l1hdr.b_pabd. If designated in the header flags, this function will
  * also decompress the data.
  */
@@ -1903,15 +2240,15 @@ arc_hdr_decrypt(arc_buf_hdr_t *hdr, spa_t *spa, const zbookmark_phys_t *zb)
 
 	arc_hdr_alloc_abd(hdr, 0);
 
-	ret = spa_do_crypt_abd(B_FALSE, spa, zb, hdr->b_crypt_hdr.b_ot,
-	    B_FALSE, bswap, hdr->b_crypt_hdr.b_salt, hdr->b_crypt_hdr.b_iv,
-	    hdr->b_crypt_hdr.b_mac, HDR_GET_PSIZE(hdr), hdr->b_l1hdr.b_pabd,
-	    hdr->b_crypt_hdr.b_rabd, &no_crypt);
+	ret = spa_do_crypt_abd(B_FALSE, spa, zb, hdr->b_crypt_hdr->b_ot,
+	    B_FALSE, bswap, hdr->b_crypt_hdr->b_salt, hdr->b_crypt_hdr->b_iv,
+	    hdr->b_crypt_hdr->b_mac, HDR_GET_PSIZE(hdr), hdr->b_l1hdr.b_pabd,
+	    hdr->b_crypt_hdr->b_rabd, &no_crypt);
 	if (ret != 0)
 		goto error;
 
 	if (no_crypt) {
-		abd_copy(hdr->b_l1hdr.b_pabd, hdr->b_crypt_hdr.b_rabd,
+		abd_copy(hdr->b_l1hdr.b_pabd, hdr->b_crypt_hdr->b_rabd,
 		    HDR_GET_PSIZE(hdr));
 	}
 
@@ -2013,7 +2350,7 @@ arc_buf_untransform_in_place(arc_buf_t *buf)
 	arc_buf_hdr_t *hdr = buf->b_hdr;
 
 	ASSERT(HDR_ENCRYPTED(hdr));
-	ASSERT3U(hdr->b_crypt_hdr.b_ot, ==, DMU_OT_DNODE);
+	ASSERT3U(hdr->b_crypt_hdr->b_ot, ==, DMU_OT_DNODE);
 	ASSERT(HDR_EMPTY_OR_LOCKED(hdr));
 	ASSERT3PF(hdr->b_l1hdr.b_pabd, !=, NULL, "hdr %px buf %px", hdr, buf);
 
@@ -2064,7 +2401,7 @@ arc_buf_fill(arc_buf_t *buf, spa_t *spa, const zbookmark_phys_t *zb,
 	 */
 	if (encrypted) {
 		ASSERT(HDR_HAS_RABD(hdr));
-		abd_copy_to_buf(buf->b_data, hdr->b_crypt_hdr.b_rabd,
+		abd_copy_to_buf(buf->b_data, hdr->b_crypt_hdr->b_rabd,
 		    HDR_GET_PSIZE(hdr));
 		goto byteswap;
 	}
@@ -2107,7 +2444,7 @@ arc_buf_fill(arc_buf_t *buf, spa_t *spa, const zbookmark_phys_t *zb,
 		ASSERT(!encrypted);
 
 		if (HDR_ENCRYPTED(hdr) && ARC_BUF_ENCRYPTED(buf)) {
-			ASSERT3U(hdr->b_crypt_hdr.b_ot, ==, DMU_OT_DNODE);
+			ASSERT3U(hdr->b_crypt_hdr->b_ot, ==, DMU_OT_DNODE);
 
 			if (hash_lock != NULL)
 				mutex_enter(hash_lock);
@@ -2664,6 +3001,9 @@ arc_space_consume(uint64_t space, arc_space_type_t type)
 	case ARC_SPACE_HDRS:
 		ARCSTAT_INCR(arcstat_hdr_size, space);
 		break;
+	case ARC_SPACE_CRYPT_HDRS:
+		ARCSTAT_INCR(arcstat_crypt_hdr_size, space);
+		break;
 	case ARC_SPACE_L2HDRS:
 		aggsum_add(&arc_sums.arcstat_l2_hdr_size, space);
 		break;
@@ -2710,6 +3050,9 @@ arc_space_return(uint64_t space, arc_space_type_t type)
 	case ARC_SPACE_HDRS:
 		ARCSTAT_INCR(arcstat_hdr_size, -space);
 		break;
+	case ARC_SPACE_CRYPT_HDRS:
+		ARCSTAT_INCR(arcstat_crypt_hdr_size, -space);
+		break;
 	case ARC_SPACE_L2HDRS:
 		aggsum_add(&arc_sums.arcstat_l2_hdr_size, -space);
 		break;
@@ -2996,7 +3339,7 @@ arc_hdr_free_on_write(arc_buf_hdr_t *hdr, boolean_t free_rdata)
 	ASSERT(HDR_HAS_L2HDR(hdr));
 
 	if (free_rdata) {
-		l2arc_free_abd_on_write(hdr->b_crypt_hdr.b_rabd,
+		l2arc_free_abd_on_write(hdr->b_crypt_hdr->b_rabd,
 		    hdr->b_l2hdr.b_dev);
 	} else {
 		l2arc_free_abd_on_write(hdr->b_l1hdr.b_pabd,
@@ -3232,10 +3575,10 @@ arc_hdr_alloc_abd(arc_buf_hdr_t *hdr, int alloc_flags)
 
 	if (alloc_rdata) {
 		size = HDR_GET_PSIZE(hdr);
-		ASSERT0P(hdr->b_crypt_hdr.b_rabd);
-		hdr->b_crypt_hdr.b_rabd = arc_get_data_abd(hdr, size, hdr,
+		ASSERT0P(hdr->b_crypt_hdr->b_rabd);
+		hdr->b_crypt_hdr->b_rabd = arc_get_data_abd(hdr, size, hdr,
 		    alloc_flags);
-		ASSERT3P(hdr->b_crypt_hdr.b_rabd, !=, NULL);
+		ASSERT3P(hdr->b_crypt_hdr->b_rabd, !=, NULL);
 		ARCSTAT_INCR(arcstat_raw_size, size);
 	} else {
 		size = arc_hdr_size(hdr);
@@ -3268,13 +3611,13 @@ arc_hdr_free_abd(arc_buf_hdr_t *hdr, boolean_t free_rdata)
 		arc_hdr_free_on_write(hdr, free_rdata);
 		ARCSTAT_BUMP(arcstat_l2_free_on_write);
 	} else if (free_rdata) {
-		arc_free_data_abd(hdr, hdr->b_crypt_hdr.b_rabd, size, hdr);
+		arc_free_data_abd(hdr, hdr->b_crypt_hdr->b_rabd, size, hdr);
 	} else {
 		arc_free_data_abd(hdr, hdr->b_l1hdr.b_pabd, size, hdr);
 	}
 
 	if (free_rdata) {
-		hdr->b_crypt_hdr.b_rabd = NULL;
+		hdr->b_crypt_hdr->b_rabd = NULL;
 		ARCSTAT_INCR(arcstat_raw_size, -size);
 	} else {
 		hdr->b_l1hdr.b_pabd = NULL;
@@ -3309,6 +3652,34 @@ arc_hdr_free_abd(arc_buf_hdr_t *hdr, boolean_t free_rdata)
  * removing it from ARC hash.  After buffer modification normal write process
  * follows as described.
  */
+/*
+ * The encryption parameters of a protected header live out-of-line so
+ * that unencrypted headers do not pay for them.  Allocate them for a
+ * header that was just marked ARC_FLAG_PROTECTED; headers coming out
+ * of hdr_full_cache (or freshly demoted back to it) have a NULL
+ * b_crypt_hdr, and the caller fills in the fields afterwards.
+ */
+static void
+arc_hdr_alloc_crypt(arc_buf_hdr_t *hdr)
+{
+	ASSERT(HDR_PROTECTED(hdr));
+	ASSERT(HDR_HAS_L1HDR(hdr));
+
+	if (hdr->b_crypt_hdr == NULL)
+		hdr->b_crypt_hdr = kmem_cache_alloc(hdr_crypt_cache,
+		    KM_PUSHPAGE);
+}
+
+static void
+arc_hdr_free_crypt(arc_buf_hdr_t *hdr)
+{
+	if (hdr->b_crypt_hdr != NULL) {
+		ASSERT0P(hdr->b_crypt_hdr->b_rabd);
+		kmem_cache_free(hdr_crypt_cache, hdr->b_crypt_hdr);
+		hdr->b_crypt_hdr = NULL;
+	}
+}
+
 static arc_buf_hdr_t *
 arc_hdr_alloc(uint64_t spa, int32_t psize, int32_t lsize,
     boolean_t protected, enum zio_compress compression_type, uint8_t complevel,
@@ -3328,11 +3699,15 @@ arc_hdr_alloc(uint64_t spa, int32_t psize, int32_t lsize,
 	hdr->b_spa = spa;
 	hdr->b_type = type;
 	hdr->b_flags = 0;
+	hdr->b_numa_node = (arc_numa_nodes > 1) ?
+	    (uint8_t)arc_numa_current_node() : 0;
 	arc_hdr_set_flags(hdr, arc_bufc_to_flags(type) | ARC_FLAG_HAS_L1HDR);
 	arc_hdr_set_compress(hdr, compression_type);
 	hdr->b_complevel = complevel;
-	if (protected)
+	if (protected) {
 		arc_hdr_set_flags(hdr, ARC_FLAG_PROTECTED);
+		arc_hdr_alloc_crypt(hdr);
+	}
 
 	hdr->b_l1hdr.b_state = arc_anon;
 	hdr->b_l1hdr.b_arc_access = 0;
@@ -3384,6 +3759,14 @@ arc_hdr_realloc(arc_buf_hdr_t *hdr, kmem_cache_t *old, kmem_cache_t *new)
 		/* Verify previous threads set to NULL before freeing */
 		ASSERT0P(nhdr->b_l1hdr.b_pabd);
 		ASSERT(!HDR_HAS_RABD(hdr));
+
+		/*
+		 * A protected header coming back from L2ARC-only state
+		 * needs its out-of-line encryption parameters allocated
+		 * again before its crypt fields are refilled on read.
+		 */
+		if (HDR_PROTECTED(nhdr))
+			arc_hdr_alloc_crypt(nhdr);
 	} else {
 		ASSERT0P(hdr->b_l1hdr.b_buf);
 #ifdef ZFS_DEBUG
@@ -3446,6 +3829,8 @@ arc_hdr_realloc(arc_buf_hdr_t *hdr, kmem_cache_t *old, kmem_cache_t *new)
 	    arc_hdr_size(nhdr), nhdr);
 
 	buf_discard_identity(hdr);
+	if (old == hdr_full_cache)
+		arc_hdr_free_crypt(hdr);
 	kmem_cache_free(old, hdr);
 
 	return (nhdr);
@@ -3471,19 +3856,20 @@ arc_convert_to_raw(arc_buf_t *buf, uint64_t dsobj, boolean_t byteorder,
 
 	buf->b_flags |= (ARC_BUF_FLAG_COMPRESSED | ARC_BUF_FLAG_ENCRYPTED);
 	arc_hdr_set_flags(hdr, ARC_FLAG_PROTECTED);
-	hdr->b_crypt_hdr.b_dsobj = dsobj;
-	hdr->b_crypt_hdr.b_ot = ot;
+	arc_hdr_alloc_crypt(hdr);
+	hdr->b_crypt_hdr->b_dsobj = dsobj;
+	hdr->b_crypt_hdr->b_ot = ot;
 	hdr->b_l1hdr.b_byteswap = (byteorder == ZFS_HOST_BYTEORDER) ?
 	    DMU_BSWAP_NUMFUNCS : DMU_OT_BYTESWAP(ot);
 	if (!arc_hdr_has_uncompressed_buf(hdr))
 		arc_cksum_free(hdr);
 
 	if (salt != NULL)
-		memcpy(hdr->b_crypt_hdr.b_salt, salt, ZIO_DATA_SALT_LEN);
+		memcpy(hdr->b_crypt_hdr->b_salt, salt, ZIO_DATA_SALT_LEN);
 	if (iv != NULL)
-		memcpy(hdr->b_crypt_hdr.b_iv, iv, ZIO_DATA_IV_LEN);
+		memcpy(hdr->b_crypt_hdr->b_iv, iv, ZIO_DATA_IV_LEN);
 	if (mac != NULL)
-		memcpy(hdr->b_crypt_hdr.b_mac, mac, ZIO_DATA_MAC_LEN);
+		memcpy(hdr->b_crypt_hdr->b_mac, mac, ZIO_DATA_MAC_LEN);
 }
 
 /*
@@ -3555,13 +3941,13 @@ arc_alloc_raw_buf(spa_t *spa, const void *tag, uint64_t dsobj,
 	hdr = arc_hdr_alloc(spa_load_guid(spa), psize, lsize, B_TRUE,
 	    compression_type, complevel, type);
 
-	hdr->b_crypt_hdr.b_dsobj = dsobj;
-	hdr->b_crypt_hdr.b_ot = ot;
+	hdr->b_crypt_hdr->b_dsobj = dsobj;
+	hdr->b_crypt_hdr->b_ot = ot;
 	hdr->b_l1hdr.b_byteswap = (byteorder == ZFS_HOST_BYTEORDER) ?
 	    DMU_BSWAP_NUMFUNCS : DMU_OT_BYTESWAP(ot);
-	memcpy(hdr->b_crypt_hdr.b_salt, salt, ZIO_DATA_SALT_LEN);
-	memcpy(hdr->b_crypt_hdr.b_iv, iv, ZIO_DATA_IV_LEN);
-	memcpy(hdr->b_crypt_hdr.b_mac, mac, ZIO_DATA_MAC_LEN);
+	memcpy(hdr->b_crypt_hdr->b_salt, salt, ZIO_DATA_SALT_LEN);
+	memcpy(hdr->b_crypt_hdr->b_iv, iv, ZIO_DATA_IV_LEN);
+	memcpy(hdr->b_crypt_hdr->b_mac, mac, ZIO_DATA_MAC_LEN);
 
 	/*
 	 * This buffer will be considered encrypted even if the ot is not an
@@ -3755,6 +4141,7 @@ arc_hdr_destroy(arc_buf_hdr_t *hdr)
 #ifdef ZFS_DEBUG
 		ASSERT0P(hdr->b_l1hdr.b_freeze_cksum);
 #endif
+		arc_hdr_free_crypt(hdr);
 		kmem_cache_free(hdr_full_cache, hdr);
 	} else {
 		kmem_cache_free(hdr_l2only_cache, hdr);
@@ -4113,11 +4500,22 @@ typedef struct evict_arg {
 	multilist_t		*eva_ml;
 	arc_buf_hdr_t		*eva_marker;
 	int			eva_idx;
+	uint_t			eva_slot;
 	uint64_t		eva_spa;
 	uint64_t		eva_bytes;
 	uint64_t		eva_evicted;
 } evict_arg_t;
 
+/*
+ * Cumulative per-worker-slot eviction accounting, exported through the
+ * "arc_evict_workers" kstat.  Tasks dispatched by concurrent callers of
+ * arc_evict_state() may share a slot, so the sums are wmsums.
+ */
+typedef struct arc_evict_worker_stat {
+	wmsum_t			aews_evicted;
+	wmsum_t			aews_dispatches;
+} arc_evict_worker_stat_t;
+
 static void
 arc_evict_task(void *arg)
 {
@@ -4134,6 +4532,49 @@ arc_evict_task(void *arg)
 	} while (total_evicted < eva->eva_bytes && --batches > 0 && more);
 
 	eva->eva_evicted = total_evicted;
+
+	wmsum_add(&arc_evict_worker_stats[eva->eva_slot].aews_evicted,
+	    total_evicted);
+	wmsum_add(&arc_evict_worker_stats[eva->eva_slot].aews_dispatches, 1);
+}
+
+static int
+arc_evict_worker_kstat_headers(char *buf, size_t size)
+{
+	ssize_t off = 0;
+
+	off += kmem_scnprintf(buf + off, size, "%-8s", "worker");
+	off += kmem_scnprintf(buf + off, size - off, "%16s", "evicted");
+	(void) kmem_scnprintf(buf + off, size - off, "%16s\n", "dispatches");
+
+	return (0);
+}
+
+static int
+arc_evict_worker_kstat_data(char *buf, size_t size, void *data)
+{
+	arc_evict_worker_stat_t *aews = data;
+	ssize_t off = 0;
+
+	off += kmem_scnprintf(buf + off, size, "%-8u",
+	    (uint_t)(aews - arc_evict_worker_stats));
+	off += kmem_scnprintf(buf + off, size - off, "%16llu",
+	    (u_longlong_t)wmsum_value(&aews->aews_evicted));
+	(void) kmem_scnprintf(buf + off, size - off, "%16llu\n",
+	    (u_longlong_t)wmsum_value(&aews->aews_dispatches));
+
+	return (0);
+}
+
+static void *
+arc_evict_worker_kstat_addr(kstat_t *ksp, loff_t n)
+{
+	if (n < zfs_arc_evict_threads)
+		ksp->ks_private = (void *)(arc_evict_worker_stats + n);
+	else
+		ksp->ks_private = NULL;
+
+	return (ksp->ks_private);
 }
 
 static void
@@ -4164,9 +4605,50 @@ arc_evict_thread_init(void)
 		    TASKQ_PREPOPULATE);
 		arc_evict_arg = kmem_zalloc(
 		    sizeof (evict_arg_t) * zfs_arc_evict_threads, KM_SLEEP);
+
+		arc_evict_worker_stats = kmem_zalloc(
+		    sizeof (arc_evict_worker_stat_t) * zfs_arc_evict_threads,
+		    KM_SLEEP);
+		for (uint_t i = 0; i < zfs_arc_evict_threads; i++) {
+			wmsum_init(&arc_evict_worker_stats[i].aews_evicted, 0);
+			wmsum_init(&arc_evict_worker_stats[i].aews_dispatches,
+			    0);
+		}
+
+		arc_evict_worker_ksp = kstat_create("zfs", 0,
+		    "arc_evict_workers", "misc", KSTAT_TYPE_RAW, 0,
+		    KSTAT_FLAG_VIRTUAL);
+		if (arc_evict_worker_ksp != NULL) {
+			arc_evict_worker_ksp->ks_data = NULL;
+			arc_evict_worker_ksp->ks_ndata = UINT32_MAX;
+			kstat_set_raw_ops(arc_evict_worker_ksp,
+			    arc_evict_worker_kstat_headers,
+			    arc_evict_worker_kstat_data,
+			    arc_evict_worker_kstat_addr);
+			kstat_install(arc_evict_worker_ksp);
+		}
 	}
 }
 
+/*
+ * Pick the sublist to begin an eviction scan from.  Normally this is a
+ * random sublist, to balance eviction evenly across the multilist.  In
+ * NUMA mode we instead start at a random sublist within the calling
+ * thread's node-local band, so eviction drains (and frees) node-local
+ * memory first before wrapping around to the other nodes' bands.
+ */
+static int
+arc_evict_start_index(multilist_t *ml)
+{
+	if (arc_numa_nodes > 1) {
+		int band = multilist_get_num_sublists(ml) / arc_numa_nodes;
+		int node = arc_numa_current_node() % arc_numa_nodes;
+
+		return (node * band + random_in_range(band));
+	}
+	return (multilist_get_random_index(ml));
+}
+
 /*
  * The minimum number of bytes we can evict at once is a block size.
  * So, SPA_MAXBLOCKSIZE is a reasonable minimal value per an eviction task.
@@ -4232,6 +4714,7 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 			for (int i = 0; i < zfs_arc_evict_threads; i++) {
 				taskq_init_ent(&eva[i].eva_tqent);
 				eva[i].eva_ml = ml;
+				eva[i].eva_slot = i;
 				eva[i].eva_spa = spa;
 			}
 		} else {
@@ -4251,7 +4734,7 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 	 */
 	uint64_t scan_evicted = 0;
 	int sublists_left = num_sublists;
-	int sublist_idx = multilist_get_random_index(ml);
+	int sublist_idx = arc_evict_start_index(ml);
 
 	/*
 	 * While we haven't hit our target number of bytes to evict, or
@@ -4359,7 +4842,7 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 		 */
 		if (sublists_left == 0) {
 			sublists_left = num_sublists;
-			sublist_idx = multilist_get_random_index(ml);
+			sublist_idx = arc_evict_start_index(ml);
 			scan_evicted = 0;
 
 			/*
@@ -5254,11 +5737,14 @@ arc_wait_for_eviction(uint64_t amount, boolean_t lax, boolean_t use_reserve)
 		 * eviction completes.
 		 * In case of "false" wakeup, we will still be on the list.
 		 */
+		hrtime_t stall_start = zfs_arc_latency_histogram ?
+		    gethrtime() : 0;
 		do {
 			cv_wait(&aw.aew_cv, &arc_evict_lock);
 		} while (list_link_active(&aw.aew_node));
 		mutex_exit(&arc_evict_lock);
 
+		arc_latency_record(ARC_LAT_EVICT_STALL, stall_start);
 		cv_destroy(&aw.aew_cv);
 	}
 	}
@@ -5621,6 +6107,87 @@ arc_hdr_verify(arc_buf_hdr_t *hdr, blkptr_t *bp)
 	}
 }
 
+typedef struct arc_decomp_ahead_arg {
+	blkptr_t	ada_bp;
+	uint64_t	ada_spa;
+	uint64_t	ada_lsize;
+} arc_decomp_ahead_arg_t;
+
+/*
+ * Speculative decompress-ahead.  A prefetched block that stays
+ * compressed in the ARC pays zio_decompress() at demand time, which on
+ * heavy compressors dwarfs the rest of a nominal cache hit.  Prefetch
+ * completions queue here (bounded by zfs_arc_decompress_ahead_max) and
+ * the header's b_pabd is converted to uncompressed storage -- the same
+ * per-header representation used when compressed ARC is globally
+ * disabled: the on-disk compression stays in the flags so the L2ARC
+ * write path recompresses, and the header remains evictable as usual.
+ * The expected demand hit can then share the uncompressed abd and runs
+ * at RAM speed.
+ *
+ * The header is re-found by identity (like l2arc_read_done()) rather
+ * than pinned across the dispatch, since a buf-less reference would
+ * confuse arc_release() should a demand hit dirty the block meanwhile.
+ * The short-lived reference below is taken under the hash lock purely
+ * to keep the header off the evictable lists while arc_hdr_size()
+ * changes, so the arcs_esize accounting stays balanced.
+ */
+static void
+arc_decompress_ahead_task(void *varg)
+{
+	arc_decomp_ahead_arg_t *ada = varg;
+	kmutex_t *hash_lock = NULL;
+	arc_buf_hdr_t *hdr;
+	boolean_t converted = B_FALSE;
+
+	hdr = buf_hash_find(ada->ada_spa, &ada->ada_bp, &hash_lock);
+
+	/*
+	 * The world may have moved on while this task was queued: the
+	 * header may be gone or rewritten (lookup fails), a demand hit
+	 * may have attached a buf (possibly sharing b_pabd), L2ARC may
+	 * be writing directly from b_pabd, or a new I/O may be in
+	 * progress.  In all those cases just drop the request.
+	 */
+	if (hdr != NULL && HDR_HAS_L1HDR(hdr) &&
+	    hdr->b_l1hdr.b_pabd != NULL && hdr->b_l1hdr.b_buf == NULL &&
+	    hdr->b_l1hdr.b_state != arc_uncached &&
+	    !HDR_IO_IN_PROGRESS(hdr) && !HDR_L2_WRITING(hdr) &&
+	    !HDR_SHARED_DATA(hdr) && !HDR_PROTECTED(hdr) &&
+	    HDR_COMPRESSION_ENABLED(hdr) &&
+	    HDR_GET_COMPRESS(hdr) != ZIO_COMPRESS_OFF) {
+		uint64_t psize = arc_hdr_size(hdr);
+		uint64_t lsize = HDR_GET_LSIZE(hdr);
+		abd_t *cabd;
+
+		add_reference(hdr, ada);
+		cabd = arc_get_data_abd(hdr, lsize, hdr, 0);
+
+		if (zio_decompress_data(HDR_GET_COMPRESS(hdr),
+		    hdr->b_l1hdr.b_pabd, cabd, psize, lsize,
+		    &hdr->b_complevel) == 0) {
+			arc_free_data_abd(hdr, hdr->b_l1hdr.b_pabd, psize,
+			    hdr);
+			hdr->b_l1hdr.b_pabd = cabd;
+			arc_hdr_clear_flags(hdr, ARC_FLAG_COMPRESSED_ARC);
+			converted = B_TRUE;
+		} else {
+			arc_free_data_abd(hdr, cabd, lsize, hdr);
+		}
+		(void) remove_reference(hdr, ada);
+	}
+	if (hash_lock != NULL)
+		mutex_exit(hash_lock);
+
+	if (converted)
+		ARCSTAT_BUMP(arcstat_decompress_ahead);
+	else
+		ARCSTAT_BUMP(arcstat_decompress_ahead_skip);
+
+	atomic_add_64(&arc_decomp_ahead_inflight, -(int64_t)ada->ada_lsize);
+	kmem_free(ada, sizeof (*ada));
+}
+
 static void
 arc_read_done(zio_t *zio)
 {
@@ -5656,10 +6223,10 @@ arc_read_done(zio_t *zio)
 	}
 
 	if (BP_IS_PROTECTED(bp)) {
-		hdr->b_crypt_hdr.b_ot = BP_GET_TYPE(bp);
-		hdr->b_crypt_hdr.b_dsobj = zio->io_bookmark.zb_objset;
-		zio_crypt_decode_params_bp(bp, hdr->b_crypt_hdr.b_salt,
-		    hdr->b_crypt_hdr.b_iv);
+		hdr->b_crypt_hdr->b_ot = BP_GET_TYPE(bp);
+		hdr->b_crypt_hdr->b_dsobj = zio->io_bookmark.zb_objset;
+		zio_crypt_decode_params_bp(bp, hdr->b_crypt_hdr->b_salt,
+		    hdr->b_crypt_hdr->b_iv);
 
 		if (zio->io_error == 0) {
 			if (BP_GET_TYPE(bp) == DMU_OT_INTENT_LOG) {
@@ -5668,12 +6235,12 @@ arc_read_done(zio_t *zio)
 				tmpbuf = abd_borrow_buf_copy(zio->io_abd,
 				    sizeof (zil_chain_t));
 				zio_crypt_decode_mac_zil(tmpbuf,
-				    hdr->b_crypt_hdr.b_mac);
+				    hdr->b_crypt_hdr->b_mac);
 				abd_return_buf(zio->io_abd, tmpbuf,
 				    sizeof (zil_chain_t));
 			} else {
 				zio_crypt_decode_mac_bp(bp,
-				    hdr->b_crypt_hdr.b_mac);
+				    hdr->b_crypt_hdr->b_mac);
 			}
 		}
 	}
@@ -5789,6 +6356,42 @@ arc_read_done(zio_t *zio)
 			buf_hash_remove(hdr);
 	}
 
+	/*
+	 * Queue a speculative background decompression of prefetched
+	 * compressed blocks with no waiters; zfetch only issues these
+	 * once a sequential stream has been confirmed, so there is a
+	 * demand read coming that would otherwise pay this cost.
+	 */
+	if (zfs_arc_decompress_ahead && zio->io_error == 0 &&
+	    hash_lock != NULL && callback_cnt == 0 &&
+	    (HDR_PREFETCH(hdr) || HDR_PRESCIENT_PREFETCH(hdr)) &&
+	    HDR_COMPRESSION_ENABLED(hdr) &&
+	    HDR_GET_COMPRESS(hdr) != ZIO_COMPRESS_OFF &&
+	    !HDR_PROTECTED(hdr) && hdr->b_l1hdr.b_buf == NULL) {
+		uint64_t lsize = HDR_GET_LSIZE(hdr);
+
+		if (atomic_add_64_nv(&arc_decomp_ahead_inflight, lsize) <=
+		    zfs_arc_decompress_ahead_max) {
+			arc_decomp_ahead_arg_t *ada =
+			    kmem_alloc(sizeof (*ada), KM_SLEEP);
+
+			ada->ada_bp = *zio->io_bp;
+			ada->ada_spa = hdr->b_spa;
+			ada->ada_lsize = lsize;
+			if (taskq_dispatch(arc_decomp_taskq,
+			    arc_decompress_ahead_task, ada, TQ_SLEEP) ==
+			    TASKQID_INVALID) {
+				atomic_add_64(&arc_decomp_ahead_inflight,
+				    -(int64_t)lsize);
+				kmem_free(ada, sizeof (*ada));
+			}
+		} else {
+			atomic_add_64(&arc_decomp_ahead_inflight,
+			    -(int64_t)lsize);
+			ARCSTAT_BUMP(arcstat_decompress_ahead_skip);
+		}
+	}
+
 	arc_hdr_clear_flags(hdr, ARC_FLAG_IO_IN_PROGRESS);
 	(void) remove_reference(hdr, hdr);
 
@@ -5797,6 +6400,7 @@ arc_read_done(zio_t *zio)
 
 	/* execute each callback and free its structure */
 	while ((acb = callback_list) != NULL) {
+		arc_latency_record(ARC_LAT_MISS, acb->acb_start);
 		if (acb->acb_done != NULL) {
 			if (zio->io_error != 0 && acb->acb_buf != NULL) {
 				/*
@@ -5900,15 +6504,15 @@ arc_cached(spa_t *spa, const blkptr_t *bp)
  * arc_read_done() will invoke all the requested "done" functions
  * for readers of this block.
  */
-int
-arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
+static int
+arc_read_impl(zio_t *pio, spa_t *spa, const blkptr_t *bp,
     arc_read_done_func_t *done, void *private, zio_priority_t priority,
-    int zio_flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb)
+    int zio_flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb,
+    uint64_t guid)
 {
 	arc_buf_hdr_t *hdr = NULL;
 	kmutex_t *hash_lock = NULL;
 	zio_t *rzio;
-	uint64_t guid = spa_load_guid(spa);
 	boolean_t compressed_read = (zio_flags & ZIO_FLAG_RAW_COMPRESS) != 0;
 	boolean_t encrypted_read = BP_IS_ENCRYPTED(bp) &&
 	    (zio_flags & ZIO_FLAG_RAW_ENCRYPT) != 0;
@@ -5919,6 +6523,7 @@ arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
 	arc_buf_t *buf = NULL;
 	int rc = 0;
 	boolean_t bp_validation = B_FALSE;
+	hrtime_t lat_start = zfs_arc_latency_histogram ? gethrtime() : 0;
 
 	ASSERT(!embedded_bp ||
 	    BPE_GET_ETYPE(bp) == BP_EMBEDDED_TYPE_DATA);
@@ -5933,9 +6538,9 @@ arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
 	 *
 	 * External consumers such as Lustre which call the exported DMU
 	 * interfaces may not have set SPL_FSTRANS.  To avoid a deadlock
-	 * on the hash_lock always set and clear the bit.
+	 * on the hash_lock our arc_read() and arc_read_range() wrappers
+	 * always set and clear the bit around this function.
 	 */
-	fstrans_cookie_t cookie = spl_fstrans_mark();
 top:
 	if (!embedded_bp) {
 		/*
@@ -6015,6 +6620,7 @@ top:
 				acb = kmem_zalloc(sizeof (arc_callback_t),
 				    KM_SLEEP);
 				acb->acb_done = done;
+				acb->acb_start = lat_start;
 				acb->acb_private = private;
 				acb->acb_compressed = compressed_read;
 				acb->acb_encrypted = encrypted_read;
@@ -6100,6 +6706,8 @@ top:
 		ARCSTAT_BUMP(arcstat_hits);
 		ARCSTAT_CONDSTAT(!(*arc_flags & ARC_FLAG_PREFETCH),
 		    demand, prefetch, is_data, data, metadata, hits);
+		if (!(*arc_flags & ARC_FLAG_PREFETCH))
+			arc_latency_record(ARC_LAT_DEMAND_HIT, lat_start);
 		*arc_flags |= ARC_FLAG_CACHED;
 		goto done;
 	} else {
@@ -6250,7 +6858,7 @@ top:
 		if (encrypted_read) {
 			ASSERT(HDR_HAS_RABD(hdr));
 			size = HDR_GET_PSIZE(hdr);
-			hdr_abd = hdr->b_crypt_hdr.b_rabd;
+			hdr_abd = hdr->b_crypt_hdr->b_rabd;
 			zio_flags |= ZIO_FLAG_RAW;
 		} else {
 			ASSERT3P(hdr->b_l1hdr.b_pabd, !=, NULL);
@@ -6280,6 +6888,7 @@ top:
 
 		acb = kmem_zalloc(sizeof (arc_callback_t), KM_SLEEP);
 		acb->acb_done = done;
+		acb->acb_start = lat_start;
 		acb->acb_private = private;
 		acb->acb_compressed = compressed_read;
 		acb->acb_encrypted = encrypted_read;
@@ -6480,7 +7089,6 @@ out:
 	/* embedded bps don't actually go to disk */
 	if (!embedded_bp)
 		spa_read_history_add(spa, zb, *arc_flags);
-	spl_fstrans_unmark(cookie);
 	return (rc);
 
 done:
@@ -6494,6 +7102,64 @@ done:
 	goto out;
 }
 
+int
+arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
+    arc_read_done_func_t *done, void *private, zio_priority_t priority,
+    int zio_flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb)
+{
+	fstrans_cookie_t cookie = spl_fstrans_mark();
+	int rc = arc_read_impl(pio, spa, bp, done, private, priority,
+	    zio_flags, arc_flags, zb, spa_load_guid(spa));
+	spl_fstrans_unmark(cookie);
+
+	return (rc);
+}
+
+/*
+ * Vectored variant of arc_read() for reading a range of contiguous
+ * blocks of one object through the cache in a single call.  The
+ * per-call setup is done once for the whole range and every block is
+ * issued under the same parent zio before returning, so the vdev
+ * queues see the whole extent at once and can aggregate it.  The
+ * shared "done" callback is invoked once per block with the matching
+ * cookie from privates[] (or NULL throughout when privates is NULL).
+ * The bookmark describes the first block; subsequent blocks advance
+ * zb_blkid.  Per-block errors are delivered through the parent zio
+ * and the callback exactly as with arc_read(); the first error is
+ * also returned.  ARC_FLAG_CACHED is reported back only when every
+ * block in the range was a cache hit.
+ */
+int
+arc_read_range(zio_t *pio, spa_t *spa, const blkptr_t *bps, int nbps,
+    arc_read_done_func_t *done, void **privates, zio_priority_t priority,
+    int zio_flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb)
+{
+	uint64_t guid = spa_load_guid(spa);
+	boolean_t all_cached = B_TRUE;
+	int rc = 0;
+
+	fstrans_cookie_t cookie = spl_fstrans_mark();
+	for (int i = 0; i < nbps; i++) {
+		zbookmark_phys_t zb_blk = *zb;
+		arc_flags_t flags = *arc_flags & ~ARC_FLAG_CACHED;
+
+		zb_blk.zb_blkid += i;
+		int err = arc_read_impl(pio, spa, &bps[i], done,
+		    (privates != NULL) ? privates[i] : NULL, priority,
+		    zio_flags, &flags, &zb_blk, guid);
+		if (!(flags & ARC_FLAG_CACHED))
+			all_cached = B_FALSE;
+		if (err != 0 && rc == 0)
+			rc = err;
+	}
+	spl_fstrans_unmark(cookie);
+
+	if (all_cached)
+		*arc_flags |= ARC_FLAG_CACHED;
+
+	return (rc);
+}
+
 arc_prune_t *
 arc_add_prune_callback(arc_prune_func_t *func, void *private)
 {
@@ -6902,11 +7568,12 @@ arc_write_ready(zio_t *zio)
 		}
 
 		arc_hdr_set_flags(hdr, ARC_FLAG_PROTECTED);
-		hdr->b_crypt_hdr.b_ot = BP_GET_TYPE(bp);
-		hdr->b_crypt_hdr.b_dsobj = zio->io_bookmark.zb_objset;
-		zio_crypt_decode_params_bp(bp, hdr->b_crypt_hdr.b_salt,
-		    hdr->b_crypt_hdr.b_iv);
-		zio_crypt_decode_mac_bp(bp, hdr->b_crypt_hdr.b_mac);
+		arc_hdr_alloc_crypt(hdr);
+		hdr->b_crypt_hdr->b_ot = BP_GET_TYPE(bp);
+		hdr->b_crypt_hdr->b_dsobj = zio->io_bookmark.zb_objset;
+		zio_crypt_decode_params_bp(bp, hdr->b_crypt_hdr->b_salt,
+		    hdr->b_crypt_hdr->b_iv);
+		zio_crypt_decode_mac_bp(bp, hdr->b_crypt_hdr->b_mac);
 	} else {
 		arc_hdr_clear_flags(hdr, ARC_FLAG_PROTECTED);
 	}
@@ -6961,7 +7628,7 @@ arc_write_ready(zio_t *zio)
 		ASSERT(ARC_BUF_COMPRESSED(buf));
 		arc_hdr_alloc_abd(hdr, ARC_HDR_ALLOC_RDATA |
 		    ARC_HDR_USE_RESERVE);
-		abd_copy(hdr->b_crypt_hdr.b_rabd, zio->io_abd, psize);
+		abd_copy(hdr->b_crypt_hdr->b_rabd, zio->io_abd, psize);
 	} else if (!(HDR_UNCACHED(hdr) ||
 	    abd_size_alloc_linear(arc_buf_size(buf))) ||
 	    !arc_can_share(hdr, buf)) {
@@ -6974,7 +7641,7 @@ arc_write_ready(zio_t *zio)
 			ASSERT3U(psize, >, 0);
 			arc_hdr_alloc_abd(hdr, ARC_HDR_ALLOC_RDATA |
 			    ARC_HDR_USE_RESERVE);
-			abd_copy(hdr->b_crypt_hdr.b_rabd, zio->io_abd, psize);
+			abd_copy(hdr->b_crypt_hdr->b_rabd, zio->io_abd, psize);
 		} else if (arc_hdr_get_compress(hdr) != ZIO_COMPRESS_OFF &&
 		    !ARC_BUF_COMPRESSED(buf)) {
 			ASSERT3U(psize, >, 0);
@@ -7127,11 +7794,11 @@ arc_write(zio_t *pio, spa_t *spa, uint64_t txg,
 		localprop.zp_byteorder =
 		    (hdr->b_l1hdr.b_byteswap == DMU_BSWAP_NUMFUNCS) ?
 		    ZFS_HOST_BYTEORDER : !ZFS_HOST_BYTEORDER;
-		memcpy(localprop.zp_salt, hdr->b_crypt_hdr.b_salt,
+		memcpy(localprop.zp_salt, hdr->b_crypt_hdr->b_salt,
 		    ZIO_DATA_SALT_LEN);
-		memcpy(localprop.zp_iv, hdr->b_crypt_hdr.b_iv,
+		memcpy(localprop.zp_iv, hdr->b_crypt_hdr->b_iv,
 		    ZIO_DATA_IV_LEN);
-		memcpy(localprop.zp_mac, hdr->b_crypt_hdr.b_mac,
+		memcpy(localprop.zp_mac, hdr->b_crypt_hdr->b_mac,
 		    ZIO_DATA_MAC_LEN);
 		if (DMU_OT_IS_ENCRYPTED(localprop.zp_type)) {
 			localprop.zp_nopwrite = B_FALSE;
@@ -7338,6 +8005,10 @@ arc_kstat_update(kstat_t *ksp, int rw)
 	    wmsum_value(&arc_sums.arcstat_prefetch_metadata_iohits);
 	as->arcstat_prefetch_metadata_misses.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_prefetch_metadata_misses);
+	as->arcstat_decompress_ahead.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_decompress_ahead);
+	as->arcstat_decompress_ahead_skip.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_decompress_ahead_skip);
 	as->arcstat_mru_hits.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_mru_hits);
 	as->arcstat_mru_ghost_hits.value.ui64 =
@@ -7387,6 +8058,8 @@ arc_kstat_update(kstat_t *ksp, int rw)
 	    wmsum_value(&arc_sums.arcstat_overhead_size);
 	as->arcstat_hdr_size.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_hdr_size);
+	as->arcstat_crypt_hdr_size.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_crypt_hdr_size);
 	as->arcstat_data_size.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_data_size);
 	as->arcstat_metadata_size.value.ui64 =
@@ -7520,6 +8193,10 @@ arc_kstat_update(kstat_t *ksp, int rw)
 	    wmsum_value(&arc_sums.arcstat_l2_rebuild_bufs_precached);
 	as->arcstat_l2_rebuild_log_blks.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_l2_rebuild_log_blks);
+	as->arcstat_l2_rebuild_expected_log_blks.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_l2_rebuild_expected_log_blks);
+	as->arcstat_l2_rebuild_expected_lb_asize.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_l2_rebuild_expected_lb_asize);
 	as->arcstat_memory_throttle_count.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_memory_throttle_count);
 	as->arcstat_memory_direct_count.value.ui64 =
@@ -7594,8 +8271,24 @@ arc_state_multilist_index_func(multilist_t *ml, void *obj)
 	 * would not be evenly distributed. In this context full 64bit
 	 * division would be a waste of time, so limit it to 32 bits.
 	 */
-	return ((unsigned int)buf_hash(hdr->b_spa, &hdr->b_dva, hdr->b_birth) %
-	    multilist_get_num_sublists(ml));
+	unsigned int hash =
+	    (unsigned int)buf_hash(hdr->b_spa, &hdr->b_dva, hdr->b_birth);
+	unsigned int num_sublists = multilist_get_num_sublists(ml);
+
+	if (arc_numa_nodes > 1) {
+		/*
+		 * Hash only within the band of sublists owned by the node
+		 * the header was allocated on.  arc_state_init() rounds the
+		 * sublist count up to a multiple of the node count, so every
+		 * band has the same width and the even-distribution
+		 * assumption above still holds within each band.
+		 */
+		unsigned int band = num_sublists / arc_numa_nodes;
+		return ((hdr->b_numa_node % arc_numa_nodes) * band +
+		    hash % band);
+	}
+
+	return (hash % num_sublists);
 }
 
 static unsigned int
@@ -7685,8 +8378,20 @@ static void
 arc_state_multilist_init(multilist_t *ml,
     multilist_sublist_index_func_t *index_func, int *maxcountp)
 {
-	multilist_create(ml, sizeof (arc_buf_hdr_t),
-	    offsetof(arc_buf_hdr_t, b_l1hdr.b_arc_node), index_func);
+	if (arc_numa_nodes > 1) {
+		/*
+		 * Round the sublist count up to a multiple of the node
+		 * count so arc_state_multilist_index_func() can carve the
+		 * list into equal-width per-node bands.
+		 */
+		multilist_create_num(ml, sizeof (arc_buf_hdr_t),
+		    offsetof(arc_buf_hdr_t, b_l1hdr.b_arc_node),
+		    P2ROUNDUP_TYPED(MAX(boot_ncpus, 4), arc_numa_nodes,
+		    uint_t), index_func);
+	} else {
+		multilist_create(ml, sizeof (arc_buf_hdr_t),
+		    offsetof(arc_buf_hdr_t, b_l1hdr.b_arc_node), index_func);
+	}
 	*maxcountp = MAX(*maxcountp, multilist_get_num_sublists(ml));
 }
 
@@ -7695,6 +8400,9 @@ arc_state_init(void)
 {
 	int num_sublists = 0;
 
+	if (zfs_arc_numa)
+		arc_numa_nodes = arc_numa_node_count();
+
 	arc_state_multilist_init(&arc_mru->arcs_list[ARC_BUFC_METADATA],
 	    arc_state_multilist_index_func, &num_sublists);
 	arc_state_multilist_init(&arc_mru->arcs_list[ARC_BUFC_DATA],
@@ -7782,6 +8490,8 @@ arc_state_init(void)
 	wmsum_init(&arc_sums.arcstat_prefetch_metadata_hits, 0);
 	wmsum_init(&arc_sums.arcstat_prefetch_metadata_iohits, 0);
 	wmsum_init(&arc_sums.arcstat_prefetch_metadata_misses, 0);
+	wmsum_init(&arc_sums.arcstat_decompress_ahead, 0);
+	wmsum_init(&arc_sums.arcstat_decompress_ahead_skip, 0);
 	wmsum_init(&arc_sums.arcstat_mru_hits, 0);
 	wmsum_init(&arc_sums.arcstat_mru_ghost_hits, 0);
 	wmsum_init(&arc_sums.arcstat_mfu_hits, 0);
@@ -7806,6 +8516,7 @@ arc_state_init(void)
 	wmsum_init(&arc_sums.arcstat_uncompressed_size, 0);
 	wmsum_init(&arc_sums.arcstat_overhead_size, 0);
 	wmsum_init(&arc_sums.arcstat_hdr_size, 0);
+	wmsum_init(&arc_sums.arcstat_crypt_hdr_size, 0);
 	wmsum_init(&arc_sums.arcstat_data_size, 0);
 	wmsum_init(&arc_sums.arcstat_metadata_size, 0);
 	wmsum_init(&arc_sums.arcstat_dbuf_size, 0);
@@ -7850,6 +8561,8 @@ arc_state_init(void)
 	wmsum_init(&arc_sums.arcstat_l2_rebuild_bufs, 0);
 	wmsum_init(&arc_sums.arcstat_l2_rebuild_bufs_precached, 0);
 	wmsum_init(&arc_sums.arcstat_l2_rebuild_log_blks, 0);
+	wmsum_init(&arc_sums.arcstat_l2_rebuild_expected_log_blks, 0);
+	wmsum_init(&arc_sums.arcstat_l2_rebuild_expected_lb_asize, 0);
 	wmsum_init(&arc_sums.arcstat_memory_throttle_count, 0);
 	wmsum_init(&arc_sums.arcstat_memory_direct_count, 0);
 	wmsum_init(&arc_sums.arcstat_memory_indirect_count, 0);
@@ -7941,6 +8654,8 @@ arc_state_fini(void)
 	wmsum_fini(&arc_sums.arcstat_prefetch_metadata_hits);
 	wmsum_fini(&arc_sums.arcstat_prefetch_metadata_iohits);
 	wmsum_fini(&arc_sums.arcstat_prefetch_metadata_misses);
+	wmsum_fini(&arc_sums.arcstat_decompress_ahead);
+	wmsum_fini(&arc_sums.arcstat_decompress_ahead_skip);
 	wmsum_fini(&arc_sums.arcstat_mru_hits);
 	wmsum_fini(&arc_sums.arcstat_mru_ghost_hits);
 	wmsum_fini(&arc_sums.arcstat_mfu_hits);
@@ -7965,6 +8680,7 @@ arc_state_fini(void)
 	wmsum_fini(&arc_sums.arcstat_uncompressed_size);
 	wmsum_fini(&arc_sums.arcstat_overhead_size);
 	wmsum_fini(&arc_sums.arcstat_hdr_size);
+	wmsum_fini(&arc_sums.arcstat_crypt_hdr_size);
 	wmsum_fini(&arc_sums.arcstat_data_size);
 	wmsum_fini(&arc_sums.arcstat_metadata_size);
 	wmsum_fini(&arc_sums.arcstat_dbuf_size);
@@ -8009,6 +8725,8 @@ arc_state_fini(void)
 	wmsum_fini(&arc_sums.arcstat_l2_rebuild_bufs);
 	wmsum_fini(&arc_sums.arcstat_l2_rebuild_bufs_precached);
 	wmsum_fini(&arc_sums.arcstat_l2_rebuild_log_blks);
+	wmsum_fini(&arc_sums.arcstat_l2_rebuild_expected_log_blks);
+	wmsum_fini(&arc_sums.arcstat_l2_rebuild_expected_lb_asize);
 	wmsum_fini(&arc_sums.arcstat_memory_throttle_count);
 	wmsum_fini(&arc_sums.arcstat_memory_direct_count);
 	wmsum_fini(&arc_sums.arcstat_memory_indirect_count);
@@ -8119,6 +8837,10 @@ arc_init(void)
 	arc_prune_taskq = taskq_create("arc_prune", zfs_arc_prune_task_threads,
 	    defclsyspri, 100, INT_MAX, TASKQ_PREPOPULATE | TASKQ_DYNAMIC);
 
+	arc_decomp_taskq = taskq_create("arc_decomp",
+	    MAX(boot_ncpus / 4, 1), defclsyspri, 100, INT_MAX,
+	    TASKQ_PREPOPULATE | TASKQ_DYNAMIC);
+
 	arc_evict_thread_init();
 
 	list_create(&arc_async_flush_list, sizeof (arc_async_flush_t),
@@ -8136,6 +8858,8 @@ arc_init(void)
 		kstat_install(arc_ksp);
 	}
 
+	arc_latency_kstat_init();
+
 	arc_state_evict_markers =
 	    arc_state_alloc_markers(arc_state_evict_marker_count);
 	arc_evict_zthr = zthr_create_timer("arc_evict",
@@ -8204,9 +8928,14 @@ arc_fini(void)
 		arc_ksp = NULL;
 	}
 
+	arc_latency_kstat_fini();
+
 	taskq_wait(arc_prune_taskq);
 	taskq_destroy(arc_prune_taskq);
 
+	taskq_wait(arc_decomp_taskq);
+	taskq_destroy(arc_decomp_taskq);
+
 	list_destroy(&arc_async_flush_list);
 	mutex_destroy(&arc_async_flush_lock);
 
@@ -8233,6 +8962,19 @@ arc_fini(void)
 		taskq_destroy(arc_evict_taskq);
 		kmem_free(arc_evict_arg,
 		    sizeof (evict_arg_t) * zfs_arc_evict_threads);
+
+		if (arc_evict_worker_ksp != NULL) {
+			kstat_delete(arc_evict_worker_ksp);
+			arc_evict_worker_ksp = NULL;
+		}
+		for (uint_t i = 0; i < zfs_arc_evict_threads; i++) {
+			wmsum_fini(&arc_evict_worker_stats[i].aews_evicted);
+			wmsum_fini(
+			    &arc_evict_worker_stats[i].aews_dispatches);
+		}
+		kmem_free(arc_evict_worker_stats,
+		    sizeof (arc_evict_worker_stat_t) * zfs_arc_evict_threads);
+		arc_evict_worker_stats = NULL;
 	}
 
 	mutex_destroy(&arc_evict_lock);
@@ -8903,7 +9645,7 @@ l2arc_read_done(zio_t *zio)
 		ASSERT3U(arc_hdr_size(hdr), <, zio->io_size);
 		if (zio->io_error == 0) {
 			if (using_rdata) {
-				abd_copy(hdr->b_crypt_hdr.b_rabd,
+				abd_copy(hdr->b_crypt_hdr->b_rabd,
 				    cb->l2rcb_abd, arc_hdr_size(hdr));
 			} else {
 				abd_copy(hdr->b_l1hdr.b_pabd,
@@ -8928,7 +9670,7 @@ l2arc_read_done(zio_t *zio)
 		if (using_rdata) {
 			ASSERT(HDR_HAS_RABD(hdr));
 			zio->io_abd = zio->io_orig_abd =
-			    hdr->b_crypt_hdr.b_rabd;
+			    hdr->b_crypt_hdr->b_rabd;
 		} else {
 			ASSERT3P(hdr->b_l1hdr.b_pabd, !=, NULL);
 			zio->io_abd = zio->io_orig_abd = hdr->b_l1hdr.b_pabd;
@@ -8941,7 +9683,7 @@ l2arc_read_done(zio_t *zio)
 	 * Check this survived the L2ARC journey.
 	 */
 	ASSERT(zio->io_abd == hdr->b_l1hdr.b_pabd ||
-	    (HDR_HAS_RABD(hdr) && zio->io_abd == hdr->b_crypt_hdr.b_rabd));
+	    (HDR_HAS_RABD(hdr) && zio->io_abd == hdr->b_crypt_hdr->b_rabd));
 	zio->io_bp_copy = cb->l2rcb_bp;	/* XXX fix in L2ARC 2.0	*/
 	zio->io_bp = &zio->io_bp_copy;	/* XXX fix in L2ARC 2.0	*/
 	zio->io_prop.zp_complevel = hdr->b_complevel;
@@ -8982,7 +9724,7 @@ l2arc_read_done(zio_t *zio)
 		if (zio->io_waiter == NULL) {
 			zio_t *pio = zio_unique_parent(zio);
 			void *abd = (using_rdata) ?
-			    hdr->b_crypt_hdr.b_rabd : hdr->b_l1hdr.b_pabd;
+			    hdr->b_crypt_hdr->b_rabd : hdr->b_l1hdr.b_pabd;
 
 			ASSERT(!pio || pio->io_child_type == ZIO_CHILD_LOGICAL);
 
@@ -9249,6 +9991,15 @@ l2arc_get_write_rate(l2arc_dev_t *dev)
 		write_max = l2arc_write_max = L2ARC_WRITE_SIZE;
 	}
 
+	/*
+	 * Feed competes with the hits the cache exists to serve; when
+	 * the cache device itself is slow, yield to its readers.
+	 */
+	if (l2arc_feed_latency_ms != 0 &&
+	    vdev_queue_latency(dev->l2ad_vdev) >
+	    MSEC2NSEC(l2arc_feed_latency_ms))
+		write_max = MAX(write_max / 4, SPA_MINBLOCKSIZE);
+
 	/* Apply DWPD rate limit for persistent marker configurations */
 	if (!dev->l2ad_first && l2arc_dwpd_limit > 0 &&
 	    spa->spa_l2arc_info.l2arc_total_capacity >=
@@ -9525,7 +10276,7 @@ l2arc_apply_transforms(spa_t *spa, arc_buf_hdr_t *hdr, uint64_t asize,
 	if (HDR_HAS_RABD(hdr)) {
 		ASSERT3U(asize, >, psize);
 		to_write = abd_alloc_for_io(asize, ismd);
-		abd_copy(to_write, hdr->b_crypt_hdr.b_rabd, psize);
+		abd_copy(to_write, hdr->b_crypt_hdr->b_rabd, psize);
 		abd_zero_off(to_write, psize, asize - psize);
 		goto out;
 	}
@@ -9567,14 +10318,14 @@ l2arc_apply_transforms(spa_t *spa, arc_buf_hdr_t *hdr, uint64_t asize,
 		 * it won't be available. In this case we simply
 		 * won't write the buffer to the L2ARC.
 		 */
-		ret = spa_keystore_lookup_key(spa, hdr->b_crypt_hdr.b_dsobj,
+		ret = spa_keystore_lookup_key(spa, hdr->b_crypt_hdr->b_dsobj,
 		    FTAG, &dck);
 		if (ret != 0)
 			goto error;
 
 		ret = zio_do_crypt_abd(B_TRUE, &dck->dck_key,
-		    hdr->b_crypt_hdr.b_ot, bswap, hdr->b_crypt_hdr.b_salt,
-		    hdr->b_crypt_hdr.b_iv, mac, psize, to_write, eabd,
+		    hdr->b_crypt_hdr->b_ot, bswap, hdr->b_crypt_hdr->b_salt,
+		    hdr->b_crypt_hdr->b_iv, mac, psize, to_write, eabd,
 		    &no_crypt);
 		if (ret != 0)
 			goto error;
@@ -9586,7 +10337,7 @@ l2arc_apply_transforms(spa_t *spa, arc_buf_hdr_t *hdr, uint64_t asize,
 			abd_zero_off(eabd, psize, asize - psize);
 
 		/* assert that the MAC we got here matches the one we saved */
-		ASSERT0(memcmp(mac, hdr->b_crypt_hdr.b_mac, ZIO_DATA_MAC_LEN));
+		ASSERT0(memcmp(mac, hdr->b_crypt_hdr->b_mac, ZIO_DATA_MAC_LEN));
 		spa_keystore_dsl_key_rele(spa, dck, FTAG);
 
 		if (to_write == cabd)
@@ -9748,7 +10499,7 @@ skip:
 		 * extra buffer.
 		 */
 		if (HDR_HAS_RABD(hdr) && psize == asize) {
-			to_write = hdr->b_crypt_hdr.b_rabd;
+			to_write = hdr->b_crypt_hdr->b_rabd;
 		} else if ((HDR_COMPRESSION_ENABLED(hdr) ||
 		    HDR_GET_COMPRESS(hdr) == ZIO_COMPRESS_OFF) &&
 		    !HDR_ENCRYPTED(hdr) && !HDR_SHARED_DATA(hdr) &&
@@ -10801,11 +11552,109 @@ l2arc_dev_rebuild_thread(void *arg)
 	thread_exit();
 }
 
+/*
+ * A log block read off the device by the chain walk in l2arc_rebuild(),
+ * queued for asynchronous restoration of its headers.
+ */
+typedef struct l2arc_rbld_blk {
+	list_node_t		rb_node;
+	l2arc_log_blk_phys_t	*rb_lb;
+	l2arc_log_blkptr_t	rb_lbp;
+	uint64_t		rb_asize;
+} l2arc_rbld_blk_t;
+
+/*
+ * Restore pipeline between the chain walk in l2arc_rebuild() and its
+ * device's restore thread.  Bounding the queue caps the memory held in
+ * flight and throttles the walk if restoration falls behind the reads.
+ */
+typedef struct l2arc_rbld_queue {
+	l2arc_dev_t	*rq_dev;
+	kmutex_t	rq_lock;
+	kcondvar_t	rq_cv;
+	list_t		rq_list;
+	uint_t		rq_len;
+	boolean_t	rq_done;	/* chain walk finished or aborted */
+	boolean_t	rq_exited;	/* restore thread has exited */
+} l2arc_rbld_queue_t;
+
+#define	L2ARC_REBUILD_QUEUE_DEPTH	8
+
+/*
+ * Restores queued log blocks in FIFO order, which preserves the reverse
+ * temporal ordering of l2ad_buflist that l2arc_log_blk_restore() relies
+ * on.  Runs until the chain walk signals completion and the queue has
+ * drained; once a rebuild is canceled the remaining blocks are freed
+ * without being restored.
+ */
+static __attribute__((noreturn)) void
+l2arc_dev_restore_thread(void *arg)
+{
+	l2arc_rbld_queue_t *rq = arg;
+	l2arc_dev_t *dev = rq->rq_dev;
+	l2arc_rbld_blk_t *rb;
+
+	mutex_enter(&rq->rq_lock);
+	for (;;) {
+		while ((rb = list_remove_head(&rq->rq_list)) == NULL &&
+		    !rq->rq_done)
+			cv_wait(&rq->rq_cv, &rq->rq_lock);
+		if (rb == NULL)
+			break;
+		rq->rq_len--;
+		cv_broadcast(&rq->rq_cv);
+		mutex_exit(&rq->rq_lock);
+
+		mutex_enter(&l2arc_rebuild_thr_lock);
+		boolean_t cancel = dev->l2ad_rebuild_cancel;
+		mutex_exit(&l2arc_rebuild_thr_lock);
+
+		if (!cancel) {
+			l2arc_log_blk_restore(dev, rb->rb_lb, rb->rb_asize);
+
+			/*
+			 * Log block restored, include its pointer in the
+			 * list of pointers to log blocks present in the
+			 * L2ARC device.
+			 */
+			l2arc_lb_ptr_buf_t *lb_ptr_buf = kmem_zalloc(
+			    sizeof (l2arc_lb_ptr_buf_t), KM_SLEEP);
+			lb_ptr_buf->lb_ptr = kmem_zalloc(
+			    sizeof (l2arc_log_blkptr_t), KM_SLEEP);
+			memcpy(lb_ptr_buf->lb_ptr, &rb->rb_lbp,
+			    sizeof (l2arc_log_blkptr_t));
+			mutex_enter(&dev->l2ad_mtx);
+			list_insert_tail(&dev->l2ad_lbptr_list, lb_ptr_buf);
+			ARCSTAT_INCR(arcstat_l2_log_blk_asize, rb->rb_asize);
+			ARCSTAT_BUMP(arcstat_l2_log_blk_count);
+			zfs_refcount_add_many(&dev->l2ad_lb_asize,
+			    rb->rb_asize, lb_ptr_buf);
+			zfs_refcount_add(&dev->l2ad_lb_count, lb_ptr_buf);
+			mutex_exit(&dev->l2ad_mtx);
+			vdev_space_update(dev->l2ad_vdev, rb->rb_asize, 0, 0);
+		}
+
+		vmem_free(rb->rb_lb, sizeof (l2arc_log_blk_phys_t));
+		kmem_free(rb, sizeof (*rb));
+		mutex_enter(&rq->rq_lock);
+	}
+	rq->rq_exited = B_TRUE;
+	cv_broadcast(&rq->rq_cv);
+	mutex_exit(&rq->rq_lock);
+
+	thread_exit();
+}
+
 /*
  * This function implements the actual L2ARC metadata rebuild. It:
  * starts reading the log block chain and restores each block's contents
  * to memory (reconstructing arc_buf_hdr_t's).
  *
+ * The chain walk only reads and validates log blocks; reconstruction of
+ * their headers is handed to a separate restore thread through a bounded
+ * queue, so the next log block reads stay in flight while the CPU-heavy
+ * restoration runs.
+ *
  * Operation stops under any of the following conditions:
  *
  * 1) We reach the end of the log block chain.
@@ -10821,12 +11670,23 @@ l2arc_rebuild(l2arc_dev_t *dev)
 	l2arc_log_blk_phys_t	*this_lb, *next_lb;
 	zio_t			*this_io = NULL, *next_io = NULL;
 	l2arc_log_blkptr_t	lbps[2];
-	l2arc_lb_ptr_buf_t	*lb_ptr_buf;
 	boolean_t		lock_held;
 
 	this_lb = vmem_zalloc(sizeof (*this_lb), KM_SLEEP);
 	next_lb = vmem_zalloc(sizeof (*next_lb), KM_SLEEP);
 
+	/*
+	 * Spin up the restore thread this chain walk feeds; it is joined
+	 * in the out path below before the rebuild is reported finished.
+	 */
+	l2arc_rbld_queue_t rq = { .rq_dev = dev };
+	mutex_init(&rq.rq_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&rq.rq_cv, NULL, CV_DEFAULT, NULL);
+	list_create(&rq.rq_list, sizeof (l2arc_rbld_blk_t),
+	    offsetof(l2arc_rbld_blk_t, rb_node));
+	(void) thread_create(NULL, 0, l2arc_dev_restore_thread, &rq, 0, &p0,
+	    TS_RUN, minclsyspri);
+
 	/*
 	 * We prevent device removal while issuing reads to the device,
 	 * then during the rebuilding phases we drop this lock again so
@@ -10860,6 +11720,16 @@ l2arc_rebuild(l2arc_dev_t *dev)
 	/* Prepare the rebuild process */
 	memcpy(lbps, l2dhdr->dh_start_lbps, sizeof (lbps));
 
+	/*
+	 * Record what this rebuild expects to restore, so that sampling
+	 * l2_rebuild_log_blks and l2_log_blk_asize against these gives
+	 * its progress and restore rate.
+	 */
+	ARCSTAT_INCR(arcstat_l2_rebuild_expected_log_blks,
+	    l2dhdr->dh_lb_count);
+	ARCSTAT_INCR(arcstat_l2_rebuild_expected_lb_asize,
+	    l2dhdr->dh_lb_asize);
+
 	/* Start the rebuild process */
 	for (;;) {
 		if (!l2arc_log_blkptr_valid(dev, &lbps[0]))
@@ -10890,30 +11760,28 @@ l2arc_rebuild(l2arc_dev_t *dev)
 		lock_held = B_FALSE;
 
 		/*
-		 * Now that we know that the next_lb checks out alright, we
-		 * can start reconstruction from this log block.
+		 * Now that we know that this_lb checks out alright, hand
+		 * it to the restore thread and keep walking the chain;
+		 * reconstruction of its headers (and the associated
+		 * bookkeeping on l2ad_lbptr_list) proceeds concurrently
+		 * with the next log block reads.
 		 * L2BLK_GET_PSIZE returns aligned size for log blocks.
 		 */
 		uint64_t asize = L2BLK_GET_PSIZE((&lbps[0])->lbp_prop);
-		l2arc_log_blk_restore(dev, this_lb, asize);
-
-		/*
-		 * log block restored, include its pointer in the list of
-		 * pointers to log blocks present in the L2ARC device.
-		 */
-		lb_ptr_buf = kmem_zalloc(sizeof (l2arc_lb_ptr_buf_t), KM_SLEEP);
-		lb_ptr_buf->lb_ptr = kmem_zalloc(sizeof (l2arc_log_blkptr_t),
-		    KM_SLEEP);
-		memcpy(lb_ptr_buf->lb_ptr, &lbps[0],
-		    sizeof (l2arc_log_blkptr_t));
-		mutex_enter(&dev->l2ad_mtx);
-		list_insert_tail(&dev->l2ad_lbptr_list, lb_ptr_buf);
-		ARCSTAT_INCR(arcstat_l2_log_blk_asize, asize);
-		ARCSTAT_BUMP(arcstat_l2_log_blk_count);
-		zfs_refcount_add_many(&dev->l2ad_lb_asize, asize, lb_ptr_buf);
-		zfs_refcount_add(&dev->l2ad_lb_count, lb_ptr_buf);
-		mutex_exit(&dev->l2ad_mtx);
-		vdev_space_update(vd, asize, 0, 0);
+		l2arc_log_blkptr_t prev_lbp = this_lb->lb_prev_lbp;
+		l2arc_rbld_blk_t *rb = kmem_zalloc(sizeof (*rb), KM_SLEEP);
+		rb->rb_lb = this_lb;
+		rb->rb_lbp = lbps[0];
+		rb->rb_asize = asize;
+		this_lb = NULL;
+
+		mutex_enter(&rq.rq_lock);
+		while (rq.rq_len >= L2ARC_REBUILD_QUEUE_DEPTH)
+			cv_wait(&rq.rq_cv, &rq.rq_lock);
+		list_insert_tail(&rq.rq_list, rb);
+		rq.rq_len++;
+		cv_broadcast(&rq.rq_cv);
+		mutex_exit(&rq.rq_lock);
 
 		/*
 		 * Protection against loops of log blocks:
@@ -10967,11 +11835,14 @@ l2arc_rebuild(l2arc_dev_t *dev)
 		}
 
 		/*
-		 * Continue with the next log block.
+		 * Continue with the next log block.  this_lb was handed
+		 * off to the restore thread above, so take over next_lb's
+		 * buffer and allocate a fresh one for the next fetch.
 		 */
 		lbps[0] = lbps[1];
-		lbps[1] = this_lb->lb_prev_lbp;
-		PTR_SWAP(this_lb, next_lb);
+		lbps[1] = prev_lbp;
+		this_lb = next_lb;
+		next_lb = vmem_zalloc(sizeof (*next_lb), KM_SLEEP);
 		this_io = next_io;
 		next_io = NULL;
 	}
@@ -10981,9 +11852,24 @@ l2arc_rebuild(l2arc_dev_t *dev)
 out:
 	if (next_io != NULL)
 		l2arc_log_blk_fetch_abort(next_io);
-	vmem_free(this_lb, sizeof (*this_lb));
+	if (this_lb != NULL)
+		vmem_free(this_lb, sizeof (*this_lb));
 	vmem_free(next_lb, sizeof (*next_lb));
 
+	/*
+	 * Wind down the restore thread and wait for the queue to drain
+	 * before looking at l2ad_lb_count below.
+	 */
+	mutex_enter(&rq.rq_lock);
+	rq.rq_done = B_TRUE;
+	cv_broadcast(&rq.rq_cv);
+	while (!rq.rq_exited)
+		cv_wait(&rq.rq_cv, &rq.rq_lock);
+	mutex_exit(&rq.rq_lock);
+	mutex_destroy(&rq.rq_lock);
+	cv_destroy(&rq.rq_cv);
+	list_destroy(&rq.rq_list);
+
 	if (err == ECANCELED) {
 		/*
 		 * In case the rebuild was canceled do not log to spa history
@@ -11683,6 +12569,7 @@ l2arc_range_check_overlap(uint64_t bottom, uint64_t top, uint64_t check)
 EXPORT_SYMBOL(arc_buf_size);
 EXPORT_SYMBOL(arc_write);
 EXPORT_SYMBOL(arc_read);
+EXPORT_SYMBOL(arc_read_range);
 EXPORT_SYMBOL(arc_buf_info);
 EXPORT_SYMBOL(arc_getbuf_func);
 EXPORT_SYMBOL(arc_add_prune_callback);
@@ -11711,6 +12598,12 @@ ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, pc_percent, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, average_blocksize, UINT, ZMOD_RD,
 	"Target average block size");
 
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, hash_chain_limit, UINT, ZMOD_RW,
+	"Hash chain length that triggers growing the buf hash table");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, latency_histogram, INT, ZMOD_RW,
+	"Collect ARC hit/miss/eviction-stall latency histograms");
+
 ZFS_MODULE_PARAM(zfs, zfs_, compressed_arc_enabled, INT, ZMOD_RW,
 	"Disable compressed ARC buffers");
 
@@ -11740,6 +12633,9 @@ ZFS_MODULE_PARAM(zfs_l2arc, l2arc_, trim_ahead, U64, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_l2arc, l2arc_, feed_secs, U64, ZMOD_RW,
 	"Seconds between L2ARC writing");
 
+ZFS_MODULE_PARAM(zfs_l2arc, l2arc_, feed_latency_ms, U64, ZMOD_RW,
+	"Cache device latency (ms) above which the L2ARC feed backs off");
+
 ZFS_MODULE_PARAM(zfs_l2arc, l2arc_, feed_min_ms, U64, ZMOD_RW,
 	"Min feed interval in milliseconds");
 
@@ -11801,5 +12697,14 @@ ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, evict_batches_limit, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, prune_task_threads, INT, ZMOD_RW,
 	"Number of arc_prune threads");
 
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, decompress_ahead, INT, ZMOD_RW,
+	"Decompress prefetched compressed blocks in the background");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, decompress_ahead_max, U64, ZMOD_RW,
+	"Max bytes of queued decompress-ahead conversions");
+
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, evict_threads, UINT, ZMOD_RD,
 	"Number of threads to use for ARC eviction.");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, numa, INT, ZMOD_RD,
+	"Partition ARC state lists by NUMA node");
@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * ARC warmup: persist a description of a pool's cached hot set and
+ * prefetch it back into the ARC after import.
+ *
+ * While a pool is imported, arc_warmup_sync() periodically snapshots
+ * the (objset, object, offset, size) identity of the pool's cached
+ * level-0 dbufs into a MOS object (the data itself is never copied,
+ * unlike persistent L2ARC).  After the next import, an asynchronous
+ * thread replays the snapshot through dmu_prefetch(), repopulating the
+ * cache in the background while the pool is already serving I/O, so
+ * the post-reboot cold-cache period shrinks from the natural refill
+ * time to roughly one sequential read of the hot set.
+ *
+ * The snapshot is purely advisory: records whose dataset or object has
+ * since been destroyed are skipped, a stale snapshot merely prefetches
+ * less useful data, and software that does not know the MOS directory
+ * entry simply ignores it.  Everything is controlled by the
+ * zfs_arc_warmup_enabled, zfs_arc_warmup_interval and
+ * zfs_arc_warmup_max_records module parameters, and observable through
+ * the arcwarmupstats kstat.
+ */
+
+#include <sys/zfs_context.h>
+#include <sys/spa.h>
+#include <sys/spa_impl.h>
+#include <sys/dmu.h>
+#include <sys/dmu_tx.h>
+#include <sys/dmu_objset.h>
+#include <sys/dbuf.h>
+#include <sys/dsl_pool.h>
+#include <sys/dsl_dataset.h>
+#include <sys/zap.h>
+#include <sys/arc.h>
+#include <sys/wmsum.h>
+
+/*
+ * Enable periodic hot-set snapshots and prefetch-based restore after
+ * import.  Disabling only stops new snapshots and restores; an already
+ * written snapshot stays in the MOS until overwritten.
+ */
+static int zfs_arc_warmup_enabled = 0;
+
+/*
+ * Seconds between hot-set snapshots of each imported pool.
+ */
+static uint_t zfs_arc_warmup_interval = 3600;
+
+/*
+ * Upper bound on the number of dbuf records captured per snapshot.
+ * Each record is 32 bytes in memory and in the MOS object.
+ */
+static uint64_t zfs_arc_warmup_max_records = 262144;
+
+/*
+ * Number of records the restore thread reads and prefetches per batch
+ * before rechecking for cancellation and yielding.
+ */
+#define	ARC_WARMUP_RESTORE_BATCH	1024
+
+typedef struct arc_warmup_stats {
+	kstat_named_t arcwarmupstat_snapshots;
+	kstat_named_t arcwarmupstat_records_saved;
+	kstat_named_t arcwarmupstat_records_restored;
+	kstat_named_t arcwarmupstat_records_skipped;
+	kstat_named_t arcwarmupstat_restores_done;
+} arc_warmup_stats_t;
+
+static arc_warmup_stats_t arc_warmup_stats = {
+	{ "snapshots",			KSTAT_DATA_UINT64 },
+	{ "records_saved",		KSTAT_DATA_UINT64 },
+	{ "records_restored",		KSTAT_DATA_UINT64 },
+	{ "records_skipped",		KSTAT_DATA_UINT64 },
+	{ "restores_done",		KSTAT_DATA_UINT64 },
+};
+
+static struct {
+	wmsum_t arcwarmupstat_snapshots;
+	wmsum_t arcwarmupstat_records_saved;
+	wmsum_t arcwarmupstat_records_restored;
+	wmsum_t arcwarmupstat_records_skipped;
+	wmsum_t arcwarmupstat_restores_done;
+} arc_warmup_sums;
+
+#define	ARC_WARMUP_STAT_BUMP(stat)	ARC_WARMUP_STAT_INCR(stat, 1)
+#define	ARC_WARMUP_STAT_INCR(stat, val)	\
+	wmsum_add(&arc_warmup_sums.arcwarmupstat_##stat, (val))
+
+static kstat_t *arc_warmup_ksp;
+
+static int
+arc_warmup_kstats_update(kstat_t *ksp, int rw)
+{
+	arc_warmup_stats_t *as = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (EACCES);
+	as->arcwarmupstat_snapshots.value.ui64 =
+	    wmsum_value(&arc_warmup_sums.arcwarmupstat_snapshots);
+	as->arcwarmupstat_records_saved.value.ui64 =
+	    wmsum_value(&arc_warmup_sums.arcwarmupstat_records_saved);
+	as->arcwarmupstat_records_restored.value.ui64 =
+	    wmsum_value(&arc_warmup_sums.arcwarmupstat_records_restored);
+	as->arcwarmupstat_records_skipped.value.ui64 =
+	    wmsum_value(&arc_warmup_sums.arcwarmupstat_records_skipped);
+	as->arcwarmupstat_restores_done.value.ui64 =
+	    wmsum_value(&arc_warmup_sums.arcwarmupstat_restores_done);
+	return (0);
+}
+
+void
+arc_warmup_init(void)
+{
+	wmsum_init(&arc_warmup_sums.arcwarmupstat_snapshots, 0);
+	wmsum_init(&arc_warmup_sums.arcwarmupstat_records_saved, 0);
+	wmsum_init(&arc_warmup_sums.arcwarmupstat_records_restored, 0);
+	wmsum_init(&arc_warmup_sums.arcwarmupstat_records_skipped, 0);
+	wmsum_init(&arc_warmup_sums.arcwarmupstat_restores_done, 0);
+
+	arc_warmup_ksp = kstat_create("zfs", 0, "arcwarmupstats", "misc",
+	    KSTAT_TYPE_NAMED,
+	    sizeof (arc_warmup_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+
+	if (arc_warmup_ksp != NULL) {
+		arc_warmup_ksp->ks_data = &arc_warmup_stats;
+		arc_warmup_ksp->ks_update = arc_warmup_kstats_update;
+		kstat_install(arc_warmup_ksp);
+	}
+}
+
+void
+arc_warmup_fini(void)
+{
+	if (arc_warmup_ksp != NULL) {
+		kstat_delete(arc_warmup_ksp);
+		arc_warmup_ksp = NULL;
+	}
+
+	wmsum_fini(&arc_warmup_sums.arcwarmupstat_snapshots);
+	wmsum_fini(&arc_warmup_sums.arcwarmupstat_records_saved);
+	wmsum_fini(&arc_warmup_sums.arcwarmupstat_records_restored);
+	wmsum_fini(&arc_warmup_sums.arcwarmupstat_records_skipped);
+	wmsum_fini(&arc_warmup_sums.arcwarmupstat_restores_done);
+}
+
+/*
+ * Write a snapshot of the pool's cached hot set into the MOS, called
+ * from spa_sync() like spa_errlog_sync().  The snapshot object holds a
+ * record count followed by the records, and is looked up (or created,
+ * with a directory entry older software ignores) on first use.  Writes
+ * are rate limited to one per zfs_arc_warmup_interval.
+ */
+void
+arc_warmup_sync(spa_t *spa, uint64_t txg)
+{
+	objset_t *mos = spa->spa_meta_objset;
+	arc_warmup_rec_t *recs;
+	dmu_tx_t *tx;
+	uint64_t n, now;
+
+	if (!zfs_arc_warmup_enabled || zfs_arc_warmup_max_records == 0)
+		return;
+
+	/*
+	 * Wait out one full interval after import before the first
+	 * snapshot, and never overwrite the snapshot while the restore
+	 * thread is still replaying it: a snapshot taken while the
+	 * cache is still cold would replace the one worth keeping.
+	 */
+	now = gethrestime_sec();
+	if (spa->spa_warmup_last_sync == 0) {
+		spa->spa_warmup_last_sync = now;
+		return;
+	}
+	if (now < spa->spa_warmup_last_sync + zfs_arc_warmup_interval)
+		return;
+	mutex_enter(&spa->spa_warmup_lock);
+	boolean_t restoring = spa->spa_warmup_thread_active;
+	mutex_exit(&spa->spa_warmup_lock);
+	if (restoring)
+		return;
+	spa->spa_warmup_last_sync = now;
+
+	recs = vmem_alloc(zfs_arc_warmup_max_records * sizeof (*recs),
+	    KM_SLEEP);
+	n = dbuf_warmup_collect(spa, recs, zfs_arc_warmup_max_records);
+
+	tx = dmu_tx_create_assigned(spa->spa_dsl_pool, txg);
+
+	/*
+	 * An existing snapshot object may not have been looked up yet
+	 * if no restore ran this import; reuse it rather than leaking
+	 * it by allocating a replacement.
+	 */
+	if (spa->spa_warmup_obj == 0)
+		(void) zap_lookup(mos, DMU_POOL_DIRECTORY_OBJECT,
+		    DMU_POOL_ARC_WARMUP, sizeof (uint64_t), 1,
+		    &spa->spa_warmup_obj);
+	if (spa->spa_warmup_obj == 0) {
+		spa->spa_warmup_obj = dmu_object_alloc(mos,
+		    DMU_OTN_UINT64_METADATA, SPA_OLD_MAXBLOCKSIZE,
+		    DMU_OT_NONE, 0, tx);
+		VERIFY0(zap_update(mos, DMU_POOL_DIRECTORY_OBJECT,
+		    DMU_POOL_ARC_WARMUP, sizeof (uint64_t), 1,
+		    &spa->spa_warmup_obj, tx));
+	}
+
+	dmu_write(mos, spa->spa_warmup_obj, 0, sizeof (n), &n, tx,
+	    DMU_READ_NO_PREFETCH);
+	if (n != 0) {
+		dmu_write(mos, spa->spa_warmup_obj, sizeof (n),
+		    n * sizeof (*recs), recs, tx, DMU_READ_NO_PREFETCH);
+	}
+	dmu_tx_commit(tx);
+
+	vmem_free(recs, zfs_arc_warmup_max_records * sizeof (*recs));
+
+	ARC_WARMUP_STAT_BUMP(snapshots);
+	ARC_WARMUP_STAT_INCR(records_saved, n);
+}
+
+/*
+ * Replay one snapshot through dmu_prefetch().  Runs detached after
+ * import; arc_warmup_stop() cancels it and waits for it to exit before
+ * the pool is unloaded.
+ */
+static __attribute__((noreturn)) void
+arc_warmup_thread(void *arg)
+{
+	spa_t *spa = arg;
+	dsl_pool_t *dp = spa->spa_dsl_pool;
+	objset_t *mos = spa->spa_meta_objset;
+	dsl_dataset_t *ds = NULL;
+	objset_t *os = NULL;
+	uint64_t cur_dsobj = 0;
+	uint64_t cnt = 0;
+	arc_warmup_rec_t *recs;
+
+	recs = vmem_alloc(ARC_WARMUP_RESTORE_BATCH * sizeof (*recs),
+	    KM_SLEEP);
+
+	if (dmu_read(mos, spa->spa_warmup_obj, 0, sizeof (cnt), &cnt,
+	    DMU_READ_PREFETCH) != 0)
+		cnt = 0;
+
+	for (uint64_t done = 0; done < cnt; ) {
+		uint64_t nb = MIN(cnt - done, ARC_WARMUP_RESTORE_BATCH);
+
+		if (spa->spa_warmup_cancel)
+			break;
+
+		if (dmu_read(mos, spa->spa_warmup_obj,
+		    sizeof (cnt) + done * sizeof (*recs),
+		    nb * sizeof (*recs), recs, DMU_READ_PREFETCH) != 0)
+			break;
+
+		for (uint64_t i = 0; i < nb; i++) {
+			arc_warmup_rec_t *r = &recs[i];
+
+			if (r->awr_objset != cur_dsobj || os == NULL) {
+				if (ds != NULL) {
+					dsl_dataset_rele(ds, FTAG);
+					ds = NULL;
+					os = NULL;
+				}
+				cur_dsobj = r->awr_objset;
+				dsl_pool_config_enter(dp, FTAG);
+				if (dsl_dataset_hold_obj(dp, cur_dsobj,
+				    FTAG, &ds) != 0)
+					ds = NULL;
+				dsl_pool_config_exit(dp, FTAG);
+				if (ds != NULL &&
+				    dmu_objset_from_ds(ds, &os) != 0) {
+					dsl_dataset_rele(ds, FTAG);
+					ds = NULL;
+					os = NULL;
+				}
+			}
+			if (os == NULL) {
+				ARC_WARMUP_STAT_BUMP(records_skipped);
+				continue;
+			}
+			dmu_prefetch(os, r->awr_object, 0, r->awr_offset,
+			    r->awr_size, ZIO_PRIORITY_ASYNC_READ);
+			ARC_WARMUP_STAT_BUMP(records_restored);
+		}
+		done += nb;
+		kpreempt(KPREEMPT_SYNC);
+	}
+
+	if (ds != NULL)
+		dsl_dataset_rele(ds, FTAG);
+	vmem_free(recs, ARC_WARMUP_RESTORE_BATCH * sizeof (*recs));
+	ARC_WARMUP_STAT_BUMP(restores_done);
+
+	mutex_enter(&spa->spa_warmup_lock);
+	spa->spa_warmup_thread_active = B_FALSE;
+	cv_broadcast(&spa->spa_warmup_cv);
+	mutex_exit(&spa->spa_warmup_lock);
+
+	thread_exit();
+}
+
+/*
+ * Kick off the background restore of the pool's hot-set snapshot, if
+ * one exists.  Called from the spa async thread after import, like
+ * l2arc_spa_rebuild_start().
+ */
+void
+arc_warmup_restore_start(spa_t *spa)
+{
+	uint64_t obj;
+
+	if (!zfs_arc_warmup_enabled)
+		return;
+
+	if (zap_lookup(spa->spa_meta_objset, DMU_POOL_DIRECTORY_OBJECT,
+	    DMU_POOL_ARC_WARMUP, sizeof (uint64_t), 1, &obj) != 0)
+		return;
+	spa->spa_warmup_obj = obj;
+
+	mutex_enter(&spa->spa_warmup_lock);
+	if (!spa->spa_warmup_thread_active && !spa->spa_warmup_cancel) {
+		spa->spa_warmup_thread_active = B_TRUE;
+		(void) thread_create(NULL, 0, arc_warmup_thread, spa, 0,
+		    &p0, TS_RUN, minclsyspri);
+	}
+	mutex_exit(&spa->spa_warmup_lock);
+}
+
+/*
+ * Cancel an in-flight restore and wait for its thread to exit.  Called
+ * before the pool is exported or unloaded.
+ */
+void
+arc_warmup_stop(spa_t *spa)
+{
+	mutex_enter(&spa->spa_warmup_lock);
+	spa->spa_warmup_cancel = B_TRUE;
+	while (spa->spa_warmup_thread_active)
+		cv_wait(&spa->spa_warmup_cv, &spa->spa_warmup_lock);
+	spa->spa_warmup_cancel = B_FALSE;
+	mutex_exit(&spa->spa_warmup_lock);
+}
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, warmup_enabled, INT, ZMOD_RW,
+	"Periodically persist the ARC hot set and prefetch it on import");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, warmup_interval, UINT, ZMOD_RW,
+	"Seconds between ARC hot set snapshots");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, warmup_max_records, U64, ZMOD_RW,
+	"Max dbuf records captured per ARC warmup snapshot");
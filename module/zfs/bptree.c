@@ -186,6 +186,18 @@ bptree_visit_cb(spa_t *spa, zilog_t *zilog, const blkptr_t *bp,
  * ignored and traversal will continue (i.e. TRAVERSE_HARD will be passed to
  * traverse_dataset_destroyed()).
  */
+/*
+ * On parallelizing this walk: async destroy must survive export and
+ * crash mid-free, and its resume state on disk is a single bookmark
+ * (bt_begin/bt_bookmark) marking one frontier through the tree.
+ * Fanning the traversal across subtrees would need per-subtree
+ * checkpoints - an on-disk format change - or risk re-freeing blocks
+ * already freed on another worker's side of the frontier after a
+ * resume.  The throughput levers that exist are the per-txg pacing
+ * controls (zfs_free_min_time_ms, zfs_async_block_max_blocks), which
+ * trade sync-time share for completion time, and progress is visible
+ * as the pool's "freeing" property counting down.
+ */
 int
 bptree_iterate(objset_t *os, uint64_t obj, boolean_t free, bptree_itor_t func,
     void *arg, dmu_tx_t *tx)
@@ -19,6 +19,125 @@
 
 #include	<sys/bqueue.h>
 #include	<sys/zfs_context.h>
+#include	<sys/wmsum.h>
+#include	<sys/kstat.h>
+
+/*
+ * When set, queues are created in lock-free ring mode: the producer and
+ * consumer exchange records through a single-producer/single-consumer
+ * pointer ring and only take bq_lock to sleep when the queue is full or
+ * empty.  Queues created while this is clear use the original shared-list
+ * scheme, where every batch handoff acquires bq_lock.  Consulted at
+ * bqueue_init() time, so toggling it does not affect existing queues.
+ */
+static int zfs_bqueue_lockfree = 1;
+
+/*
+ * Number of slots in a lock-free ring, rounded up to a power of two.  The
+ * byte capacity passed to bqueue_init() still bounds the queue; the slot
+ * count only matters for streams of very small records, which block on a
+ * full ring the same way they would block on a full queue.
+ */
+static uint_t zfs_bqueue_ring_entries = 4096;
+
+typedef struct bqueue_stats {
+	/*
+	 * Lock acquisitions and sleeps in shared-list mode.  Every enqueue
+	 * flush and dequeue refill bounces bq_lock between the producer and
+	 * the consumer; in ring mode the only events left to count are the
+	 * sleeps, so the difference between the two pairs of counters is
+	 * the contention the ring eliminates.
+	 */
+	kstat_named_t bqueue_mutex_enqueue_flushes;
+	kstat_named_t bqueue_mutex_enqueue_waits;
+	kstat_named_t bqueue_mutex_dequeue_refills;
+	kstat_named_t bqueue_mutex_dequeue_waits;
+	/* Sleeps in lock-free ring mode (full ring/queue, or empty queue). */
+	kstat_named_t bqueue_ring_enqueue_waits;
+	kstat_named_t bqueue_ring_dequeue_waits;
+} bqueue_stats_t;
+
+static bqueue_stats_t bqueue_stats = {
+	{ "mutex_enqueue_flushes",	KSTAT_DATA_UINT64 },
+	{ "mutex_enqueue_waits",	KSTAT_DATA_UINT64 },
+	{ "mutex_dequeue_refills",	KSTAT_DATA_UINT64 },
+	{ "mutex_dequeue_waits",	KSTAT_DATA_UINT64 },
+	{ "ring_enqueue_waits",		KSTAT_DATA_UINT64 },
+	{ "ring_dequeue_waits",		KSTAT_DATA_UINT64 },
+};
+
+struct {
+	wmsum_t bqueue_mutex_enqueue_flushes;
+	wmsum_t bqueue_mutex_enqueue_waits;
+	wmsum_t bqueue_mutex_dequeue_refills;
+	wmsum_t bqueue_mutex_dequeue_waits;
+	wmsum_t bqueue_ring_enqueue_waits;
+	wmsum_t bqueue_ring_dequeue_waits;
+} bqueue_sums;
+
+#define	BQSTAT_BUMP(stat)	wmsum_add(&bqueue_sums.bqueue_##stat, 1)
+
+static kstat_t *bqueue_ksp;
+
+static int
+bqueue_kstats_update(kstat_t *ksp, int rw)
+{
+	bqueue_stats_t *bs = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (EACCES);
+
+	bs->bqueue_mutex_enqueue_flushes.value.ui64 =
+	    wmsum_value(&bqueue_sums.bqueue_mutex_enqueue_flushes);
+	bs->bqueue_mutex_enqueue_waits.value.ui64 =
+	    wmsum_value(&bqueue_sums.bqueue_mutex_enqueue_waits);
+	bs->bqueue_mutex_dequeue_refills.value.ui64 =
+	    wmsum_value(&bqueue_sums.bqueue_mutex_dequeue_refills);
+	bs->bqueue_mutex_dequeue_waits.value.ui64 =
+	    wmsum_value(&bqueue_sums.bqueue_mutex_dequeue_waits);
+	bs->bqueue_ring_enqueue_waits.value.ui64 =
+	    wmsum_value(&bqueue_sums.bqueue_ring_enqueue_waits);
+	bs->bqueue_ring_dequeue_waits.value.ui64 =
+	    wmsum_value(&bqueue_sums.bqueue_ring_dequeue_waits);
+
+	return (0);
+}
+
+void
+bqueue_stats_init(void)
+{
+	wmsum_init(&bqueue_sums.bqueue_mutex_enqueue_flushes, 0);
+	wmsum_init(&bqueue_sums.bqueue_mutex_enqueue_waits, 0);
+	wmsum_init(&bqueue_sums.bqueue_mutex_dequeue_refills, 0);
+	wmsum_init(&bqueue_sums.bqueue_mutex_dequeue_waits, 0);
+	wmsum_init(&bqueue_sums.bqueue_ring_enqueue_waits, 0);
+	wmsum_init(&bqueue_sums.bqueue_ring_dequeue_waits, 0);
+
+	bqueue_ksp = kstat_create("zfs", 0, "bqueue", "misc",
+	    KSTAT_TYPE_NAMED, sizeof (bqueue_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (bqueue_ksp != NULL) {
+		bqueue_ksp->ks_data = &bqueue_stats;
+		bqueue_ksp->ks_update = bqueue_kstats_update;
+		kstat_install(bqueue_ksp);
+	}
+}
+
+void
+bqueue_stats_fini(void)
+{
+	if (bqueue_ksp != NULL) {
+		kstat_delete(bqueue_ksp);
+		bqueue_ksp = NULL;
+	}
+
+	wmsum_fini(&bqueue_sums.bqueue_mutex_enqueue_flushes);
+	wmsum_fini(&bqueue_sums.bqueue_mutex_enqueue_waits);
+	wmsum_fini(&bqueue_sums.bqueue_mutex_dequeue_refills);
+	wmsum_fini(&bqueue_sums.bqueue_mutex_dequeue_waits);
+	wmsum_fini(&bqueue_sums.bqueue_ring_enqueue_waits);
+	wmsum_fini(&bqueue_sums.bqueue_ring_dequeue_waits);
+}
 
 static inline bqueue_node_t *
 obj2node(bqueue_t *q, void *data)
@@ -70,6 +189,20 @@ bqueue_init(bqueue_t *q, uint_t fill_fraction, size_t size, size_t node_offset)
 	q->bq_enqueuing_size = 0;
 	q->bq_maxsize = size;
 	q->bq_fill_fraction = fill_fraction;
+	q->bq_lockfree = (zfs_bqueue_lockfree != 0);
+	if (q->bq_lockfree) {
+		uint64_t entries = MIN(MAX(zfs_bqueue_ring_entries, 2),
+		    1 << 20);
+		if (!ISP2(entries))
+			entries = 1ULL << highbit64(entries);
+		q->bq_ring = vmem_zalloc(entries * sizeof (void *), KM_SLEEP);
+		q->bq_ring_bytes = 0;
+		q->bq_ring_mask = entries - 1;
+		q->bq_pidx = 0;
+		q->bq_cidx = 0;
+		q->bq_enq_waiting = B_FALSE;
+		q->bq_deq_waiting = B_FALSE;
+	}
 	return (0);
 }
 
@@ -85,6 +218,13 @@ bqueue_destroy(bqueue_t *q)
 	ASSERT0(q->bq_size);
 	ASSERT0(q->bq_dequeuing_size);
 	ASSERT0(q->bq_enqueuing_size);
+	if (q->bq_lockfree) {
+		ASSERT3U(q->bq_pidx, ==, q->bq_cidx);
+		ASSERT0(q->bq_ring_bytes);
+		vmem_free(q->bq_ring,
+		    (q->bq_ring_mask + 1) * sizeof (void *));
+		q->bq_ring = NULL;
+	}
 	cv_destroy(&q->bq_add_cv);
 	cv_destroy(&q->bq_pop_cv);
 	list_destroy(&q->bq_list);
@@ -94,6 +234,84 @@ bqueue_destroy(bqueue_t *q)
 	mutex_destroy(&q->bq_lock);
 }
 
+/*
+ * Wake the thread on the other side of a lock-free queue, if it has
+ * advertised that it is asleep.  The waiter sets its flag and re-checks
+ * its wait condition under bq_lock before sleeping, with membar_sync()
+ * ordering the flag store before the re-check; we order our index/size
+ * update before the flag load the same way.  One of the two sides must
+ * observe the other's store, so either the waiter sees it has been given
+ * work (or room) and doesn't sleep, or we see the flag and take bq_lock
+ * to signal - and since the waiter holds bq_lock from setting the flag
+ * until cv_wait() releases it, our broadcast cannot fall in between.
+ */
+static void
+bqueue_ring_wake(bqueue_t *q, boolean_t *waiting, kcondvar_t *cv)
+{
+	membar_sync();
+	if (*waiting) {
+		mutex_enter(&q->bq_lock);
+		cv_broadcast(cv);
+		mutex_exit(&q->bq_lock);
+	}
+}
+
+/*
+ * Move the producer's pending batch into the ring.  Each slot store is
+ * made visible before the producer index that publishes it, and the
+ * batch's bytes are added to bq_ring_bytes before any of it is published
+ * so that the consumer's decrement can never underflow.
+ */
+static void
+bqueue_ring_publish(bqueue_t *q)
+{
+	uint64_t pidx = q->bq_pidx;
+	void *data;
+
+	if (atomic_load_64(&q->bq_ring_bytes) > q->bq_maxsize) {
+		mutex_enter(&q->bq_lock);
+		q->bq_enq_waiting = B_TRUE;
+		membar_sync();
+		while (atomic_load_64(&q->bq_ring_bytes) > q->bq_maxsize) {
+			BQSTAT_BUMP(ring_enqueue_waits);
+			cv_wait_sig(&q->bq_add_cv, &q->bq_lock);
+		}
+		q->bq_enq_waiting = B_FALSE;
+		mutex_exit(&q->bq_lock);
+	}
+
+	atomic_add_64(&q->bq_ring_bytes, q->bq_enqueuing_size);
+	q->bq_enqueuing_size = 0;
+
+	while ((data = list_remove_head(&q->bq_enqueuing_list)) != NULL) {
+		if (pidx - atomic_load_64(&q->bq_cidx) > q->bq_ring_mask) {
+			/*
+			 * The ring itself is full.  Publish our progress so
+			 * the consumer can drain it, then sleep for a slot.
+			 */
+			membar_producer();
+			atomic_store_64(&q->bq_pidx, pidx);
+			bqueue_ring_wake(q, &q->bq_deq_waiting, &q->bq_pop_cv);
+
+			mutex_enter(&q->bq_lock);
+			q->bq_enq_waiting = B_TRUE;
+			membar_sync();
+			while (pidx - atomic_load_64(&q->bq_cidx) >
+			    q->bq_ring_mask) {
+				BQSTAT_BUMP(ring_enqueue_waits);
+				cv_wait_sig(&q->bq_add_cv, &q->bq_lock);
+			}
+			q->bq_enq_waiting = B_FALSE;
+			mutex_exit(&q->bq_lock);
+		}
+		q->bq_ring[pidx & q->bq_ring_mask] = data;
+		pidx++;
+	}
+	membar_producer();
+	atomic_store_64(&q->bq_pidx, pidx);
+	bqueue_ring_wake(q, &q->bq_deq_waiting, &q->bq_pop_cv);
+}
+
 static void
 bqueue_enqueue_impl(bqueue_t *q, void *data, size_t item_size, boolean_t flush)
 {
@@ -104,11 +322,18 @@ bqueue_enqueue_impl(bqueue_t *q, void *data, size_t item_size, boolean_t flush)
 	q->bq_enqueuing_size += item_size;
 	list_insert_tail(&q->bq_enqueuing_list, data);
 
-	if (flush ||
-	    q->bq_enqueuing_size >= q->bq_maxsize / q->bq_fill_fraction) {
+	if (!flush &&
+	    q->bq_enqueuing_size < q->bq_maxsize / q->bq_fill_fraction)
+		return;
+
+	if (q->bq_lockfree) {
+		bqueue_ring_publish(q);
+	} else {
 		/* Append the enquing list to the shared list. */
+		BQSTAT_BUMP(mutex_enqueue_flushes);
 		mutex_enter(&q->bq_lock);
 		while (q->bq_size > q->bq_maxsize) {
+			BQSTAT_BUMP(mutex_enqueue_waits);
 			cv_wait_sig(&q->bq_add_cv, &q->bq_lock);
 		}
 		q->bq_size += q->bq_enqueuing_size;
@@ -148,9 +373,41 @@ bqueue_enqueue_flush(bqueue_t *q, void *data, size_t item_size)
  * Take the first element off of q.  If there are no elements on the queue, wait
  * until one is put there.  Return the removed element.
  */
+static void *
+bqueue_ring_dequeue(bqueue_t *q)
+{
+	uint64_t cidx = q->bq_cidx;
+	void *ret;
+
+	if (cidx == atomic_load_64(&q->bq_pidx)) {
+		mutex_enter(&q->bq_lock);
+		q->bq_deq_waiting = B_TRUE;
+		membar_sync();
+		while (cidx == atomic_load_64(&q->bq_pidx)) {
+			BQSTAT_BUMP(ring_dequeue_waits);
+			cv_wait_sig(&q->bq_pop_cv, &q->bq_lock);
+		}
+		q->bq_deq_waiting = B_FALSE;
+		mutex_exit(&q->bq_lock);
+	}
+
+	/* Order the slot load after the producer-index load above. */
+	membar_consumer();
+	ret = q->bq_ring[cidx & q->bq_ring_mask];
+	atomic_store_64(&q->bq_cidx, cidx + 1);
+	atomic_add_64(&q->bq_ring_bytes,
+	    -(int64_t)obj2node(q, ret)->bqn_size);
+	bqueue_ring_wake(q, &q->bq_enq_waiting, &q->bq_add_cv);
+
+	return (ret);
+}
+
 void *
 bqueue_dequeue(bqueue_t *q)
 {
+	if (q->bq_lockfree)
+		return (bqueue_ring_dequeue(q));
+
 	void *ret = list_remove_head(&q->bq_dequeuing_list);
 	if (ret == NULL) {
 		/*
@@ -158,8 +415,10 @@ bqueue_dequeue(bqueue_t *q)
 		 * the shared list, then move the entire shared list to the
 		 * dequeuing list.
 		 */
+		BQSTAT_BUMP(mutex_dequeue_refills);
 		mutex_enter(&q->bq_lock);
 		while (q->bq_size == 0) {
+			BQSTAT_BUMP(mutex_dequeue_waits);
 			cv_wait_sig(&q->bq_pop_cv, &q->bq_lock);
 		}
 		ASSERT0(q->bq_dequeuing_size);
@@ -174,3 +433,9 @@ bqueue_dequeue(bqueue_t *q)
 	q->bq_dequeuing_size -= obj2node(q, ret)->bqn_size;
 	return (ret);
 }
+
+ZFS_MODULE_PARAM(zfs, zfs_, bqueue_lockfree, INT, ZMOD_RW,
+	"Create blocking queues in lock-free ring mode");
+
+ZFS_MODULE_PARAM(zfs, zfs_, bqueue_ring_entries, UINT, ZMOD_RW,
+	"Number of slots in a lock-free blocking queue ring");
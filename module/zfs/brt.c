@@ -706,11 +706,16 @@ brt_vdevs_expand(spa_t *spa, uint64_t nvdevs)
 		avl_create(&brtvd->bv_tree, brt_entry_compare,
 		    sizeof (brt_entry_t), offsetof(brt_entry_t, bre_node));
 		for (int i = 0; i < TXG_SIZE; i++) {
-			avl_create(&brtvd->bv_pending_tree[i],
-			    brt_entry_compare, sizeof (brt_entry_t),
-			    offsetof(brt_entry_t, bre_node));
+			for (int j = 0; j < BRT_PENDING_SHARDS; j++) {
+				avl_create(&brtvd->bv_pending_tree[i][j],
+				    brt_entry_compare, sizeof (brt_entry_t),
+				    offsetof(brt_entry_t, bre_node));
+			}
+		}
+		for (int i = 0; i < BRT_PENDING_SHARDS; i++) {
+			mutex_init(&brtvd->bv_pending_lock[i], NULL,
+			    MUTEX_DEFAULT, NULL);
 		}
-		mutex_init(&brtvd->bv_pending_lock, NULL, MUTEX_DEFAULT, NULL);
 		spa->spa_brt_vdevs[vdevid] = brtvd;
 	}
 
@@ -850,9 +855,12 @@ brt_vdevs_free(spa_t *spa)
 			dnode_rele(brtvd->bv_mos_entries_dnode, brtvd);
 		rw_destroy(&brtvd->bv_mos_entries_lock);
 		avl_destroy(&brtvd->bv_tree);
-		for (int i = 0; i < TXG_SIZE; i++)
-			avl_destroy(&brtvd->bv_pending_tree[i]);
-		mutex_destroy(&brtvd->bv_pending_lock);
+		for (int i = 0; i < TXG_SIZE; i++) {
+			for (int j = 0; j < BRT_PENDING_SHARDS; j++)
+				avl_destroy(&brtvd->bv_pending_tree[i][j]);
+		}
+		for (int i = 0; i < BRT_PENDING_SHARDS; i++)
+			mutex_destroy(&brtvd->bv_pending_lock[i]);
 		kmem_free(brtvd, sizeof (*brtvd));
 	}
 	kmem_free(spa->spa_brt_vdevs, sizeof (*spa->spa_brt_vdevs) *
@@ -1186,6 +1194,17 @@ brt_entry_compare(const void *x1, const void *x2)
 	    DVA_GET_OFFSET(&bp2->blk_dva[0])));
 }
 
+/*
+ * Shard pending clone references by block offset, so concurrent
+ * cloners stripe across the per-shard locks.
+ */
+static inline uint_t
+brt_pending_shard(const blkptr_t *bp)
+{
+	return ((DVA_GET_OFFSET(&bp->blk_dva[0]) >> SPA_MINBLOCKSHIFT) &
+	    (BRT_PENDING_SHARDS - 1));
+}
+
 void
 brt_pending_add(spa_t *spa, const blkptr_t *bp, dmu_tx_t *tx)
 {
@@ -1198,14 +1217,16 @@ brt_pending_add(spa_t *spa, const blkptr_t *bp, dmu_tx_t *tx)
 
 	uint64_t vdevid = DVA_GET_VDEV(&bp->blk_dva[0]);
 	brt_vdev_t *brtvd = brt_vdev(spa, vdevid, B_TRUE);
-	avl_tree_t *pending_tree = &brtvd->bv_pending_tree[txg & TXG_MASK];
+	uint_t shard = brt_pending_shard(bp);
+	avl_tree_t *pending_tree =
+	    &brtvd->bv_pending_tree[txg & TXG_MASK][shard];
 
 	newbre = kmem_cache_alloc(brt_entry_cache, KM_SLEEP);
 	newbre->bre_bp = *bp;
 	newbre->bre_count = 0;
 	newbre->bre_pcount = 1;
 
-	mutex_enter(&brtvd->bv_pending_lock);
+	mutex_enter(&brtvd->bv_pending_lock[shard]);
 	bre = avl_find(pending_tree, newbre, &where);
 	if (bre == NULL) {
 		avl_insert(pending_tree, newbre, where);
@@ -1213,7 +1234,7 @@ brt_pending_add(spa_t *spa, const blkptr_t *bp, dmu_tx_t *tx)
 	} else {
 		bre->bre_pcount++;
 	}
-	mutex_exit(&brtvd->bv_pending_lock);
+	mutex_exit(&brtvd->bv_pending_lock[shard]);
 
 	if (newbre != NULL) {
 		ASSERT(bre != NULL);
@@ -1239,11 +1260,13 @@ brt_pending_remove(spa_t *spa, const blkptr_t *bp, dmu_tx_t *tx)
 	uint64_t vdevid = DVA_GET_VDEV(&bp->blk_dva[0]);
 	brt_vdev_t *brtvd = brt_vdev(spa, vdevid, B_FALSE);
 	ASSERT(brtvd != NULL);
-	avl_tree_t *pending_tree = &brtvd->bv_pending_tree[txg & TXG_MASK];
+	uint_t shard = brt_pending_shard(bp);
+	avl_tree_t *pending_tree =
+	    &brtvd->bv_pending_tree[txg & TXG_MASK][shard];
 
 	bre_search.bre_bp = *bp;
 
-	mutex_enter(&brtvd->bv_pending_lock);
+	mutex_enter(&brtvd->bv_pending_lock[shard]);
 	bre = avl_find(pending_tree, &bre_search, NULL);
 	ASSERT(bre != NULL);
 	ASSERT(bre->bre_pcount > 0);
@@ -1252,7 +1275,7 @@ brt_pending_remove(spa_t *spa, const blkptr_t *bp, dmu_tx_t *tx)
 		avl_remove(pending_tree, bre);
 	else
 		bre = NULL;
-	mutex_exit(&brtvd->bv_pending_lock);
+	mutex_exit(&brtvd->bv_pending_lock[shard]);
 
 	if (bre)
 		kmem_cache_free(brt_entry_cache, bre);
@@ -1268,7 +1291,15 @@ brt_pending_apply_vdev(spa_t *spa, brt_vdev_t *brtvd, uint64_t txg)
 	 * are possible for the TXG.  So we don't need bv_pending_lock.
 	 */
 	ASSERT(avl_is_empty(&brtvd->bv_tree));
-	avl_swap(&brtvd->bv_tree, &brtvd->bv_pending_tree[txg & TXG_MASK]);
+	avl_swap(&brtvd->bv_tree, &brtvd->bv_pending_tree[txg & TXG_MASK][0]);
+	for (int i = 1; i < BRT_PENDING_SHARDS; i++) {
+		avl_tree_t *t = &brtvd->bv_pending_tree[txg & TXG_MASK][i];
+
+		while ((bre = avl_first(t)) != NULL) {
+			avl_remove(t, bre);
+			avl_add(&brtvd->bv_tree, bre);
+		}
+	}
 
 	for (bre = avl_first(&brtvd->bv_tree); bre; bre = nbre) {
 		nbre = AVL_NEXT(&brtvd->bv_tree, bre);
@@ -38,6 +38,11 @@ static dataset_kstat_values_t empty_dataset_kstats = {
 	{ "nread",	KSTAT_DATA_UINT64 },
 	{ "nunlinks",	KSTAT_DATA_UINT64 },
 	{ "nunlinked",	KSTAT_DATA_UINT64 },
+	{ "ios_pending",	KSTAT_DATA_UINT64 },
+	{ "io_time_ns",	KSTAT_DATA_UINT64 },
+	{ { "read_lat_B",	KSTAT_DATA_UINT64 } },
+	{ { "write_lat_B",	KSTAT_DATA_UINT64 } },
+	{ { "sync_lat_B",	KSTAT_DATA_UINT64 } },
 	{
 	{ "zil_commit_count",			KSTAT_DATA_UINT64 },
 	{ "zil_commit_writer_count",		KSTAT_DATA_UINT64 },
@@ -59,10 +64,49 @@ static dataset_kstat_values_t empty_dataset_kstats = {
 	{ "zil_itx_metaslab_slog_count",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_bytes",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_write",	KSTAT_DATA_UINT64 },
-	{ "zil_itx_metaslab_slog_alloc",	KSTAT_DATA_UINT64 }
+	{ "zil_itx_metaslab_slog_alloc",	KSTAT_DATA_UINT64 },
+	{ "zil_immediate_write_sz",		KSTAT_DATA_UINT64 },
+	{ { "zil_commit_lat_us_N",		KSTAT_DATA_UINT64 } },
+	{ { "zil_lwb_fill_8ths_N",		KSTAT_DATA_UINT64 } }
 	}
 };
 
+/*
+ * When set, zfs_read()/zfs_write()/zfs_fsync() record their wall-clock
+ * latency into the per-dataset histograms below.  Off by default; the
+ * disabled cost is one branch per operation.
+ */
+int zfs_dataset_latency_histo = 0;
+
+/*
+ * The template can only name the first element of each histogram
+ * array, so fill in the real bucket names (the bucket's upper bound
+ * exponent, in ns) once the kstat data has been copied from it.
+ */
+static void
+dataset_kstats_values_name(dataset_kstat_values_t *dkv)
+{
+	for (int i = 0; i < DK_LAT_BUCKETS; i++) {
+		(void) snprintf(dkv->dkv_read_lat[i].name,
+		    KSTAT_STRLEN, "read_lat_2p%dns", DK_LAT_SHIFT + i);
+		dkv->dkv_read_lat[i].data_type = KSTAT_DATA_UINT64;
+		(void) snprintf(dkv->dkv_write_lat[i].name,
+		    KSTAT_STRLEN, "write_lat_2p%dns", DK_LAT_SHIFT + i);
+		dkv->dkv_write_lat[i].data_type = KSTAT_DATA_UINT64;
+		(void) snprintf(dkv->dkv_sync_lat[i].name,
+		    KSTAT_STRLEN, "sync_lat_2p%dns", DK_LAT_SHIFT + i);
+		dkv->dkv_sync_lat[i].data_type = KSTAT_DATA_UINT64;
+	}
+}
+
+static inline int
+dataset_kstats_lat_bucket(int64_t nsec)
+{
+	if (nsec < (1LL << DK_LAT_SHIFT))
+		return (0);
+	return (MIN(highbit64(nsec >> DK_LAT_SHIFT), DK_LAT_BUCKETS - 1));
+}
+
 static int
 dataset_kstats_update(kstat_t *ksp, int rw)
 {
@@ -85,6 +129,18 @@ dataset_kstats_update(kstat_t *ksp, int rw)
 	    wmsum_value(&dk->dk_sums.dss_nunlinks);
 	dkv->dkv_nunlinked.value.ui64 =
 	    wmsum_value(&dk->dk_sums.dss_nunlinked);
+	dkv->dkv_ios_pending.value.ui64 =
+	    wmsum_value(&dk->dk_sums.dss_ios_pending);
+	dkv->dkv_io_time_ns.value.ui64 =
+	    wmsum_value(&dk->dk_sums.dss_io_time_ns);
+	for (int i = 0; i < DK_LAT_BUCKETS; i++) {
+		dkv->dkv_read_lat[i].value.ui64 =
+		    wmsum_value(&dk->dk_sums.dss_read_lat[i]);
+		dkv->dkv_write_lat[i].value.ui64 =
+		    wmsum_value(&dk->dk_sums.dss_write_lat[i]);
+		dkv->dkv_sync_lat[i].value.ui64 =
+		    wmsum_value(&dk->dk_sums.dss_sync_lat[i]);
+	}
 
 	zil_kstat_values_update(&dkv->dkv_zil_stats, &dk->dk_zil_sums);
 
@@ -156,6 +212,8 @@ dataset_kstats_create(dataset_kstats_t *dk, objset_t *objset)
 	    kmem_alloc(sizeof (empty_dataset_kstats), KM_SLEEP);
 	memcpy(dk_kstats, &empty_dataset_kstats,
 	    sizeof (empty_dataset_kstats));
+	zil_kstat_values_name(&dk_kstats->dkv_zil_stats);
+	dataset_kstats_values_name(dk_kstats);
 
 	char *ds_name = kmem_zalloc(ZFS_MAX_DATASET_NAME_LEN, KM_SLEEP);
 	dsl_dataset_name(objset->os_dsl_dataset, ds_name);
@@ -174,6 +232,13 @@ dataset_kstats_create(dataset_kstats_t *dk, objset_t *objset)
 	wmsum_init(&dk->dk_sums.dss_nread, 0);
 	wmsum_init(&dk->dk_sums.dss_nunlinks, 0);
 	wmsum_init(&dk->dk_sums.dss_nunlinked, 0);
+	wmsum_init(&dk->dk_sums.dss_ios_pending, 0);
+	wmsum_init(&dk->dk_sums.dss_io_time_ns, 0);
+	for (int i = 0; i < DK_LAT_BUCKETS; i++) {
+		wmsum_init(&dk->dk_sums.dss_read_lat[i], 0);
+		wmsum_init(&dk->dk_sums.dss_write_lat[i], 0);
+		wmsum_init(&dk->dk_sums.dss_sync_lat[i], 0);
+	}
 	zil_sums_init(&dk->dk_zil_sums);
 
 	dk->dk_kstats = kstat;
@@ -200,6 +265,13 @@ dataset_kstats_destroy(dataset_kstats_t *dk)
 	wmsum_fini(&dk->dk_sums.dss_nread);
 	wmsum_fini(&dk->dk_sums.dss_nunlinks);
 	wmsum_fini(&dk->dk_sums.dss_nunlinked);
+	wmsum_fini(&dk->dk_sums.dss_ios_pending);
+	wmsum_fini(&dk->dk_sums.dss_io_time_ns);
+	for (int i = 0; i < DK_LAT_BUCKETS; i++) {
+		wmsum_fini(&dk->dk_sums.dss_read_lat[i]);
+		wmsum_fini(&dk->dk_sums.dss_write_lat[i]);
+		wmsum_fini(&dk->dk_sums.dss_sync_lat[i]);
+	}
 	zil_sums_fini(&dk->dk_zil_sums);
 }
 
@@ -259,3 +331,56 @@ dataset_kstats_update_nunlinked_kstat(dataset_kstats_t *dk, int64_t delta)
 
 	wmsum_add(&dk->dk_sums.dss_nunlinked, delta);
 }
+
+void
+dataset_kstats_update_pending_kstat(dataset_kstats_t *dk, int64_t delta)
+{
+	if (dk->dk_kstats == NULL)
+		return;
+
+	wmsum_add(&dk->dk_sums.dss_ios_pending, delta);
+}
+
+void
+dataset_kstats_record_io_time_kstat(dataset_kstats_t *dk, int64_t nsec)
+{
+	ASSERT3S(nsec, >=, 0);
+
+	if (dk->dk_kstats == NULL)
+		return;
+
+	wmsum_add(&dk->dk_sums.dss_io_time_ns, nsec);
+}
+
+void
+dataset_kstats_record_read_lat(dataset_kstats_t *dk, int64_t nsec)
+{
+	if (dk->dk_kstats == NULL)
+		return;
+
+	wmsum_add(&dk->dk_sums.dss_read_lat[
+	    dataset_kstats_lat_bucket(nsec)], 1);
+}
+
+void
+dataset_kstats_record_write_lat(dataset_kstats_t *dk, int64_t nsec)
+{
+	if (dk->dk_kstats == NULL)
+		return;
+
+	wmsum_add(&dk->dk_sums.dss_write_lat[
+	    dataset_kstats_lat_bucket(nsec)], 1);
+}
+
+void
+dataset_kstats_record_sync_lat(dataset_kstats_t *dk, int64_t nsec)
+{
+	if (dk->dk_kstats == NULL)
+		return;
+
+	wmsum_add(&dk->dk_sums.dss_sync_lat[
+	    dataset_kstats_lat_bucket(nsec)], 1);
+}
+
+ZFS_MODULE_PARAM(zfs, zfs_, dataset_latency_histo, INT, ZMOD_RW,
+	"Record per-dataset read/write/sync latency histograms");
@@ -60,6 +60,8 @@
 
 static kstat_t *dbuf_ksp;
 
+#define	DBUF_HASH_HISTO_BUCKETS	16
+
 typedef struct dbuf_stats {
 	/*
 	 * Various statistics about the size of the dbuf cache.
@@ -74,9 +76,13 @@ typedef struct dbuf_stats {
 	kstat_named_t cache_lowater_bytes;
 	kstat_named_t cache_hiwater_bytes;
 	/*
-	 * Total number of dbuf cache evictions that have occurred.
+	 * Total number of dbuf cache evictions that have occurred, and
+	 * how many of them were performed inline by foreground threads
+	 * in dbuf_evict_notify() versus by the eviction threads.
 	 */
 	kstat_named_t cache_total_evicts;
+	kstat_named_t cache_inline_evicts;
+	kstat_named_t cache_async_evicts;
 	/*
 	 * The distribution of dbuf levels in the dbuf cache and
 	 * the total size of all dbufs at each level.
@@ -96,6 +102,12 @@ typedef struct dbuf_stats {
 	 */
 	kstat_named_t hash_chains;
 	kstat_named_t hash_chain_max;
+	/*
+	 * Sampled distribution of hash bucket chain lengths, refreshed
+	 * on every kstat read from an even sample of the buckets; the
+	 * last entry counts chains at or above its index.
+	 */
+	kstat_named_t hash_chain_histo[DBUF_HASH_HISTO_BUCKETS];
 	/*
 	 * Number of times a dbuf_create() discovers that a dbuf was
 	 * already created and in the dbuf hash table.
@@ -118,6 +130,11 @@ typedef struct dbuf_stats {
 	 * the data in the regular dbuf cache.
 	 */
 	kstat_named_t metadata_cache_overflow;
+	/*
+	 * Number of times a metadata dbuf wasn't admitted because its
+	 * objset exceeded dbuf_metadata_cache_os_pct of the cache.
+	 */
+	kstat_named_t metadata_cache_os_overflow;
 } dbuf_stats_t;
 
 dbuf_stats_t dbuf_stats = {
@@ -128,6 +145,8 @@ dbuf_stats_t dbuf_stats = {
 	{ "cache_lowater_bytes",		KSTAT_DATA_UINT64 },
 	{ "cache_hiwater_bytes",		KSTAT_DATA_UINT64 },
 	{ "cache_total_evicts",			KSTAT_DATA_UINT64 },
+	{ "cache_inline_evicts",		KSTAT_DATA_UINT64 },
+	{ "cache_async_evicts",			KSTAT_DATA_UINT64 },
 	{ { "cache_levels_N",			KSTAT_DATA_UINT64 } },
 	{ { "cache_levels_bytes_N",		KSTAT_DATA_UINT64 } },
 	{ "hash_hits",				KSTAT_DATA_UINT64 },
@@ -136,18 +155,22 @@ dbuf_stats_t dbuf_stats = {
 	{ "hash_elements",			KSTAT_DATA_UINT64 },
 	{ "hash_chains",			KSTAT_DATA_UINT64 },
 	{ "hash_chain_max",			KSTAT_DATA_UINT64 },
+	{ { "hash_chain_histo_N",		KSTAT_DATA_UINT64 } },
 	{ "hash_insert_race",			KSTAT_DATA_UINT64 },
 	{ "hash_table_count",			KSTAT_DATA_UINT64 },
 	{ "hash_mutex_count",			KSTAT_DATA_UINT64 },
 	{ "metadata_cache_count",		KSTAT_DATA_UINT64 },
 	{ "metadata_cache_size_bytes",		KSTAT_DATA_UINT64 },
 	{ "metadata_cache_size_bytes_max",	KSTAT_DATA_UINT64 },
-	{ "metadata_cache_overflow",		KSTAT_DATA_UINT64 }
+	{ "metadata_cache_overflow",		KSTAT_DATA_UINT64 },
+	{ "metadata_cache_os_overflow",		KSTAT_DATA_UINT64 }
 };
 
 struct {
 	wmsum_t cache_count;
 	wmsum_t cache_total_evicts;
+	wmsum_t cache_inline_evicts;
+	wmsum_t cache_async_evicts;
 	wmsum_t cache_levels[DN_MAX_LEVELS];
 	wmsum_t cache_levels_bytes[DN_MAX_LEVELS];
 	wmsum_t hash_hits;
@@ -158,6 +181,7 @@ struct {
 	wmsum_t hash_insert_race;
 	wmsum_t metadata_cache_count;
 	wmsum_t metadata_cache_overflow;
+	wmsum_t metadata_cache_os_overflow;
 } dbuf_sums;
 
 #define	DBUF_STAT_INCR(stat, val)	\
@@ -185,10 +209,29 @@ static kmem_cache_t *dbuf_kmem_cache;
 kmem_cache_t *dbuf_dirty_kmem_cache;
 static taskq_t *dbu_evict_taskq;
 
-static kthread_t *dbuf_cache_evict_thread;
 static kmutex_t dbuf_evict_lock;
 static kcondvar_t dbuf_evict_cv;
 static boolean_t dbuf_evict_thread_exit;
+static uint_t dbuf_evict_threads_active;
+
+/*
+ * Number of dbuf cache eviction threads; the cache sublists are
+ * partitioned round-robin between them.  0 (the default) computes it
+ * from the CPU count at module load, the same way the ARC does for
+ * zfs_arc_evict_threads.
+ */
+static uint_t dbuf_evict_threads = 0;
+
+/*
+ * Hash chain length on insert beyond which the dbuf hash table is grown
+ * (doubled) asynchronously.  Zero disables online growth, leaving the
+ * table at the size chosen by dbuf_init().
+ */
+static uint_t dbuf_hash_chain_limit = 16;
+
+static kmutex_t dbuf_hash_grow_lock;
+static kcondvar_t dbuf_hash_grow_cv;
+static boolean_t dbuf_hash_grow_active;
 
 /*
  * There are two dbuf caches; each dbuf can only be in one of them at a time.
@@ -235,6 +278,14 @@ static uint64_t dbuf_metadata_cache_max_bytes = UINT64_MAX;
 static uint_t dbuf_cache_shift = 5;
 static uint_t dbuf_metadata_cache_shift = 6;
 
+/*
+ * Cap any single objset's share of the metadata dbuf cache at this
+ * percentage of the cache target, so one dataset's dense metadata scan
+ * cannot monopolize admission and starve its neighbors.  100 (the
+ * default) preserves the historical single-pool behavior.
+ */
+static uint_t dbuf_metadata_cache_os_pct = 100;
+
 /* Set the dbuf hash mutex count as log2 shift (dynamic by default) */
 static uint_t dbuf_mutex_cache_shift = 0;
 
@@ -339,6 +390,158 @@ dbuf_hash(void *os, uint64_t obj, uint8_t lvl, uint64_t blkid)
 	(dbuf)->db_level == (level) &&			\
 	(dbuf)->db_blkid == (blkid))
 
+/*
+ * Return the hash bucket the given hash value currently maps to.  The
+ * caller must hold the bucket's hash mutex, which also serializes
+ * against the bucket being split by an in-progress table resize.
+ */
+static dmu_buf_impl_t **
+dbuf_hash_bucket(dbuf_hash_table_t *h, uint64_t hv)
+{
+	if (h->hash_resizing) {
+		uint64_t oidx = hv & h->hash_old_mask;
+
+		if (oidx >= h->hash_migrated)
+			return (&h->hash_old_table[oidx]);
+		return (&h->hash_new_table[hv & h->hash_new_mask]);
+	}
+
+	return (&h->hash_table[hv & h->hash_table_mask]);
+}
+
+/*
+ * Double the bucket array and incrementally rehash into it, following
+ * the same scheme as the ARC buf hash table: entry to and exit from
+ * the resizing state happen with every hash mutex held, so
+ * dbuf_hash_bucket() callers (who hold one of them) always see a
+ * consistent view, and each old bucket is then migrated under just its
+ * own mutex.  Growth is only started while the table has at least as
+ * many buckets as there are mutexes, so an old bucket and both new
+ * buckets it splits into always share one mutex.
+ */
+static __attribute__((noreturn)) void
+dbuf_hash_grow_thread(void *unused)
+{
+	(void) unused;
+	dbuf_hash_table_t *h = &dbuf_hash_table;
+	uint64_t osize = h->hash_table_mask + 1;
+	uint64_t nsize = osize << 1;
+	uint64_t nmutex = h->hash_mutex_mask + 1;
+	dmu_buf_impl_t **ntable;
+
+	ntable = vmem_zalloc(nsize * sizeof (void *), KM_SLEEP);
+
+	for (uint64_t i = 0; i < nmutex; i++)
+		mutex_enter(&h->hash_mutexes[i]);
+	h->hash_old_mask = h->hash_table_mask;
+	h->hash_old_table = h->hash_table;
+	h->hash_new_mask = nsize - 1;
+	h->hash_new_table = ntable;
+	h->hash_migrated = 0;
+	h->hash_resizing = 1;
+	for (uint64_t i = nmutex; i > 0; i--)
+		mutex_exit(&h->hash_mutexes[i - 1]);
+
+	for (uint64_t b = 0; b < osize; b++) {
+		kmutex_t *lock = DBUF_HASH_MUTEX(h, b);
+		dmu_buf_impl_t *db;
+
+		mutex_enter(lock);
+		if (h->hash_old_table[b] != NULL &&
+		    h->hash_old_table[b]->db_hash_next != NULL)
+			DBUF_STAT_BUMPDOWN(hash_chains);
+		while ((db = h->hash_old_table[b]) != NULL) {
+			uint64_t nidx = db->db_hash & h->hash_new_mask;
+
+			ASSERT3U(db->db_hash & h->hash_old_mask, ==, b);
+			h->hash_old_table[b] = db->db_hash_next;
+			if (h->hash_new_table[nidx] != NULL &&
+			    h->hash_new_table[nidx]->db_hash_next == NULL)
+				DBUF_STAT_BUMP(hash_chains);
+			db->db_hash_next = h->hash_new_table[nidx];
+			h->hash_new_table[nidx] = db;
+		}
+		h->hash_migrated = b + 1;
+		mutex_exit(lock);
+	}
+
+	for (uint64_t i = 0; i < nmutex; i++)
+		mutex_enter(&h->hash_mutexes[i]);
+	h->hash_table_mask = h->hash_new_mask;
+	h->hash_table = h->hash_new_table;
+	h->hash_resizing = 0;
+	for (uint64_t i = nmutex; i > 0; i--)
+		mutex_exit(&h->hash_mutexes[i - 1]);
+
+	vmem_free(h->hash_old_table, osize * sizeof (void *));
+	h->hash_old_table = NULL;
+
+	mutex_enter(&dbuf_hash_grow_lock);
+	dbuf_hash_grow_active = B_FALSE;
+	cv_broadcast(&dbuf_hash_grow_cv);
+	mutex_exit(&dbuf_hash_grow_lock);
+
+	thread_exit();
+}
+
+/*
+ * Kick off an asynchronous doubling of the dbuf hash table, unless one
+ * is already running.
+ */
+static void
+dbuf_hash_grow(void)
+{
+	mutex_enter(&dbuf_hash_grow_lock);
+	if (!dbuf_hash_grow_active) {
+		dbuf_hash_grow_active = B_TRUE;
+		(void) thread_create(NULL, 0, dbuf_hash_grow_thread, NULL,
+		    0, &p0, TS_RUN, minclsyspri);
+	}
+	mutex_exit(&dbuf_hash_grow_lock);
+}
+
+/*
+ * Collect the identities of the given pool's cached level-0 dbufs into
+ * recs[], up to maxrecs entries, for an ARC warmup snapshot (see
+ * arc_warmup.c).  Only (objset, object, offset, size) is recorded, so
+ * the result can be replayed with dmu_prefetch() after the pool is
+ * imported again.  The walk takes each hash mutex once and records
+ * dbufs in whatever state they are cached, skipping the MOS and bonus
+ * buffers; the snapshot is advisory, so no stronger consistency is
+ * needed.
+ */
+uint64_t
+dbuf_warmup_collect(spa_t *spa, arc_warmup_rec_t *recs, uint64_t maxrecs)
+{
+	dbuf_hash_table_t *h = &dbuf_hash_table;
+	uint64_t n = 0;
+
+	for (uint64_t idx = 0; idx <= h->hash_table_mask && n < maxrecs;
+	    idx++) {
+		mutex_enter(DBUF_HASH_MUTEX(h, idx));
+		for (dmu_buf_impl_t *db = h->hash_table[idx];
+		    db != NULL && n < maxrecs; db = db->db_hash_next) {
+			objset_t *os = db->db_objset;
+
+			if (os->os_spa != spa ||
+			    os->os_dsl_dataset == NULL ||
+			    db->db_level != 0 ||
+			    db->db_blkid == DMU_BONUS_BLKID ||
+			    db->db_state != DB_CACHED)
+				continue;
+
+			recs[n].awr_objset = os->os_dsl_dataset->ds_object;
+			recs[n].awr_object = db->db.db_object;
+			recs[n].awr_offset = db->db.db_offset;
+			recs[n].awr_size = db->db.db_size;
+			n++;
+		}
+		mutex_exit(DBUF_HASH_MUTEX(h, idx));
+	}
+
+	return (n);
+}
+
 dmu_buf_impl_t *
 dbuf_find(objset_t *os, uint64_t obj, uint8_t level, uint64_t blkid,
     uint64_t *hash_out)
@@ -352,7 +555,8 @@ dbuf_find(objset_t *os, uint64_t obj, uint8_t level, uint64_t blkid,
 	idx = hv & h->hash_table_mask;
 
 	mutex_enter(DBUF_HASH_MUTEX(h, idx));
-	for (db = h->hash_table[idx]; db != NULL; db = db->db_hash_next) {
+	for (db = *dbuf_hash_bucket(h, hv); db != NULL;
+	    db = db->db_hash_next) {
 		if (DBUF_EQUAL(db, os, obj, level, blkid)) {
 			mutex_enter(&db->db_mtx);
 			if (db->db_state != DB_EVICTING) {
@@ -408,7 +612,8 @@ dbuf_hash_insert(dmu_buf_impl_t *db)
 	idx = db->db_hash & h->hash_table_mask;
 
 	mutex_enter(DBUF_HASH_MUTEX(h, idx));
-	for (dbf = h->hash_table[idx], i = 0; dbf != NULL;
+	dmu_buf_impl_t **bucket = dbuf_hash_bucket(h, db->db_hash);
+	for (dbf = *bucket, i = 0; dbf != NULL;
 	    dbf = dbf->db_hash_next, i++) {
 		if (DBUF_EQUAL(dbf, os, obj, level, blkid)) {
 			mutex_enter(&dbf->db_mtx);
@@ -429,11 +634,21 @@ dbuf_hash_insert(dmu_buf_impl_t *db)
 	}
 
 	mutex_enter(&db->db_mtx);
-	db->db_hash_next = h->hash_table[idx];
-	h->hash_table[idx] = db;
+	db->db_hash_next = *bucket;
+	*bucket = db;
 	mutex_exit(DBUF_HASH_MUTEX(h, idx));
 	DBUF_STAT_BUMP(hash_elements);
 
+	/*
+	 * Long chains mean the table has been outgrown; kick off an
+	 * asynchronous doubling of the bucket array.  Growth requires
+	 * that an old bucket and the new buckets it splits into share
+	 * one mutex, hence the mask comparison.
+	 */
+	if (dbuf_hash_chain_limit != 0 && i >= dbuf_hash_chain_limit &&
+	    !h->hash_resizing && h->hash_table_mask >= h->hash_mutex_mask)
+		dbuf_hash_grow();
+
 	return (NULL);
 }
 
@@ -457,17 +672,29 @@ dbuf_include_in_metadata_cache(dmu_buf_impl_t *db)
 		/* If we hit this, then we set something up wrong in dmu_ot */
 		ASSERT(DMU_OT_IS_METADATA(type));
 
+		uint64_t target = dbuf_metadata_cache_target_bytes();
+
 		/*
 		 * Sanity check for small-memory systems: don't allocate too
 		 * much memory for this purpose.
 		 */
 		if (zfs_refcount_count(
-		    &dbuf_caches[DB_DBUF_METADATA_CACHE].size) >
-		    dbuf_metadata_cache_target_bytes()) {
+		    &dbuf_caches[DB_DBUF_METADATA_CACHE].size) > target) {
 			DBUF_STAT_BUMP(metadata_cache_overflow);
 			return (B_FALSE);
 		}
 
+		/*
+		 * Per-objset fairness: don't let one dataset's metadata
+		 * crowd out every other dataset's.
+		 */
+		if (dbuf_metadata_cache_os_pct < 100 &&
+		    db->db_objset->os_dbuf_md_cache_size >
+		    target * dbuf_metadata_cache_os_pct / 100) {
+			DBUF_STAT_BUMP(metadata_cache_os_overflow);
+			return (B_FALSE);
+		}
+
 		return (B_TRUE);
 	}
 
@@ -497,15 +724,15 @@ dbuf_hash_remove(dmu_buf_impl_t *db)
 	ASSERT(!MUTEX_HELD(&db->db_mtx));
 
 	mutex_enter(DBUF_HASH_MUTEX(h, idx));
-	dbp = &h->hash_table[idx];
+	dmu_buf_impl_t **bucket = dbuf_hash_bucket(h, db->db_hash);
+	dbp = bucket;
 	while ((dbf = *dbp) != db) {
 		dbp = &dbf->db_hash_next;
 		ASSERT(dbf != NULL);
 	}
 	*dbp = db->db_hash_next;
 	db->db_hash_next = NULL;
-	if (h->hash_table[idx] &&
-	    h->hash_table[idx]->db_hash_next == NULL)
+	if (*bucket && (*bucket)->db_hash_next == NULL)
 		DBUF_STAT_BUMPDOWN(hash_chains);
 	mutex_exit(DBUF_HASH_MUTEX(h, idx));
 	DBUF_STAT_BUMPDOWN(hash_elements);
@@ -584,6 +811,9 @@ dbuf_evict_user(dmu_buf_impl_t *db)
 		    &dbuf_caches[db->db_caching_status].size, size, dbu);
 		if (db->db_caching_status == DB_DBUF_CACHE)
 			DBUF_STAT_DECR(cache_levels_bytes[db->db_level], size);
+		else if (db->db_caching_status == DB_DBUF_METADATA_CACHE)
+			atomic_add_64(&db->db_objset->os_dbuf_md_cache_size,
+			    -(int64_t)size);
 	}
 
 	/*
@@ -771,12 +1001,12 @@ dbuf_cache_above_lowater(void)
 }
 
 /*
- * Evict the oldest eligible dbuf from the dbuf cache.
+ * Evict the oldest eligible dbuf from the given sublist of the dbuf
+ * cache.  Returns whether a dbuf was evicted.
  */
-static void
-dbuf_evict_one(void)
+static boolean_t
+dbuf_evict_one(unsigned int idx)
 {
-	int idx = multilist_get_random_index(&dbuf_caches[DB_DBUF_CACHE].cache);
 	multilist_sublist_t *mls = multilist_sublist_lock_idx(
 	    &dbuf_caches[DB_DBUF_CACHE].cache, idx);
 
@@ -806,9 +1036,11 @@ dbuf_evict_one(void)
 		db->db_caching_status = DB_NO_CACHE;
 		dbuf_destroy(db);
 		DBUF_STAT_BUMP(cache_total_evicts);
+		return (B_TRUE);
 	} else {
 		multilist_sublist_unlock(mls);
 	}
+	return (B_FALSE);
 }
 
 /*
@@ -819,9 +1051,13 @@ dbuf_evict_one(void)
  * out of the cache it is destroyed and becomes eligible for arc eviction.
  */
 static __attribute__((noreturn)) void
-dbuf_evict_thread(void *unused)
+dbuf_evict_thread(void *arg)
 {
-	(void) unused;
+	unsigned int worker = (unsigned int)(uintptr_t)arg;
+	unsigned int nsub = multilist_get_num_sublists(
+	    &dbuf_caches[DB_DBUF_CACHE].cache);
+	unsigned int nmine = (nsub - worker + dbuf_evict_threads - 1) /
+	    dbuf_evict_threads;
 	callb_cpr_t cpr;
 
 	CALLB_CPR_INIT(&cpr, &dbuf_evict_lock, callb_generic_cpr, FTAG);
@@ -839,16 +1075,30 @@ dbuf_evict_thread(void *unused)
 		/*
 		 * Keep evicting as long as we're above the low water mark
 		 * for the cache. We do this without holding the locks to
-		 * minimize lock contention.
+		 * minimize lock contention.  The sublists are partitioned
+		 * round-robin between the eviction threads, so each thread
+		 * only picks from its own share and the threads never
+		 * contend on a sublist lock.
 		 */
 		while (dbuf_cache_above_lowater() && !dbuf_evict_thread_exit) {
-			dbuf_evict_one();
+			if (dbuf_evict_one(worker + dbuf_evict_threads *
+			    random_in_range(nmine))) {
+				DBUF_STAT_BUMP(cache_async_evicts);
+			} else {
+				/*
+				 * Our share of the sublists has drained
+				 * (or the tail dbufs are locked); go back
+				 * to sleep rather than spinning while the
+				 * other threads work on theirs.
+				 */
+				break;
+			}
 		}
 
 		mutex_enter(&dbuf_evict_lock);
 	}
 
-	dbuf_evict_thread_exit = B_FALSE;
+	dbuf_evict_threads_active--;
 	cv_broadcast(&dbuf_evict_cv);
 	CALLB_CPR_EXIT(&cpr);	/* drops dbuf_evict_lock */
 	thread_exit();
@@ -876,7 +1126,9 @@ dbuf_evict_notify(uint64_t size)
 		 */
 		if (size > dbuf_cache_hiwater_bytes() &&
 		    !current_is_reclaim_thread()) {
-			dbuf_evict_one();
+			if (dbuf_evict_one(multilist_get_random_index(
+			    &dbuf_caches[DB_DBUF_CACHE].cache)))
+				DBUF_STAT_BUMP(cache_inline_evicts);
 		}
 		cv_signal(&dbuf_evict_cv);
 	}
@@ -913,12 +1165,40 @@ dbuf_kstat_update(kstat_t *ksp, int rw)
 	ds->cache_lowater_bytes.value.ui64 = dbuf_cache_lowater_bytes();
 	ds->cache_total_evicts.value.ui64 =
 	    wmsum_value(&dbuf_sums.cache_total_evicts);
+	ds->cache_inline_evicts.value.ui64 =
+	    wmsum_value(&dbuf_sums.cache_inline_evicts);
+	ds->cache_async_evicts.value.ui64 =
+	    wmsum_value(&dbuf_sums.cache_async_evicts);
 	for (int i = 0; i < DN_MAX_LEVELS; i++) {
 		ds->cache_levels[i].value.ui64 =
 		    wmsum_value(&dbuf_sums.cache_levels[i]);
 		ds->cache_levels_bytes[i].value.ui64 =
 		    wmsum_value(&dbuf_sums.cache_levels_bytes[i]);
 	}
+	/*
+	 * Refresh the sampled chain-length distribution.  The sample is
+	 * bounded, and each bucket is examined under its mutex, so this
+	 * stays cheap even for very large tables; buckets visited while
+	 * a resize is migrating them are simply counted as they appear.
+	 */
+	uint64_t histo[DBUF_HASH_HISTO_BUCKETS] = { 0 };
+	uint64_t hcount = MIN(h->hash_table_mask + 1, 1ULL << 16);
+	uint64_t stride = (h->hash_table_mask + 1) / hcount;
+
+	for (uint64_t i = 0; i < hcount; i++) {
+		uint64_t idx = i * stride;
+		uint64_t len = 0;
+
+		mutex_enter(DBUF_HASH_MUTEX(h, idx));
+		for (dmu_buf_impl_t *db = h->hash_table[idx &
+		    h->hash_table_mask]; db != NULL; db = db->db_hash_next)
+			len++;
+		mutex_exit(DBUF_HASH_MUTEX(h, idx));
+		histo[MIN(len, DBUF_HASH_HISTO_BUCKETS - 1)]++;
+	}
+	for (int i = 0; i < DBUF_HASH_HISTO_BUCKETS; i++)
+		ds->hash_chain_histo[i].value.ui64 = histo[i];
+
 	ds->hash_hits.value.ui64 =
 	    wmsum_value(&dbuf_sums.hash_hits);
 	ds->hash_misses.value.ui64 =
@@ -939,6 +1219,8 @@ dbuf_kstat_update(kstat_t *ksp, int rw)
 	    &dbuf_caches[DB_DBUF_METADATA_CACHE].size);
 	ds->metadata_cache_overflow.value.ui64 =
 	    wmsum_value(&dbuf_sums.metadata_cache_overflow);
+	ds->metadata_cache_os_overflow.value.ui64 =
+	    wmsum_value(&dbuf_sums.metadata_cache_os_overflow);
 	return (0);
 }
 
@@ -1016,11 +1298,34 @@ dbuf_init(void)
 	dbuf_evict_thread_exit = B_FALSE;
 	mutex_init(&dbuf_evict_lock, NULL, MUTEX_DEFAULT, NULL);
 	cv_init(&dbuf_evict_cv, NULL, CV_DEFAULT, NULL);
-	dbuf_cache_evict_thread = thread_create(NULL, 0, dbuf_evict_thread,
-	    NULL, 0, &p0, TS_RUN, minclsyspri);
+	mutex_init(&dbuf_hash_grow_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&dbuf_hash_grow_cv, NULL, CV_DEFAULT, NULL);
+
+	/*
+	 * Size the eviction thread pool the same way the ARC does for
+	 * zfs_arc_evict_threads, bounded by the number of sublists so
+	 * every thread owns at least one.
+	 */
+	if (dbuf_evict_threads == 0) {
+		if (max_ncpus < 6)
+			dbuf_evict_threads = 1;
+		else
+			dbuf_evict_threads =
+			    (highbit64(max_ncpus) - 1) + max_ncpus / 32;
+	}
+	dbuf_evict_threads = MIN(dbuf_evict_threads,
+	    multilist_get_num_sublists(&dbuf_caches[DB_DBUF_CACHE].cache));
+
+	dbuf_evict_threads_active = dbuf_evict_threads;
+	for (uint_t i = 0; i < dbuf_evict_threads; i++) {
+		(void) thread_create(NULL, 0, dbuf_evict_thread,
+		    (void *)(uintptr_t)i, 0, &p0, TS_RUN, minclsyspri);
+	}
 
 	wmsum_init(&dbuf_sums.cache_count, 0);
 	wmsum_init(&dbuf_sums.cache_total_evicts, 0);
+	wmsum_init(&dbuf_sums.cache_inline_evicts, 0);
+	wmsum_init(&dbuf_sums.cache_async_evicts, 0);
 	for (int i = 0; i < DN_MAX_LEVELS; i++) {
 		wmsum_init(&dbuf_sums.cache_levels[i], 0);
 		wmsum_init(&dbuf_sums.cache_levels_bytes[i], 0);
@@ -1033,6 +1338,7 @@ dbuf_init(void)
 	wmsum_init(&dbuf_sums.hash_insert_race, 0);
 	wmsum_init(&dbuf_sums.metadata_cache_count, 0);
 	wmsum_init(&dbuf_sums.metadata_cache_overflow, 0);
+	wmsum_init(&dbuf_sums.metadata_cache_os_overflow, 0);
 
 	dbuf_ksp = kstat_create("zfs", 0, "dbufstats", "misc",
 	    KSTAT_TYPE_NAMED, sizeof (dbuf_stats) / sizeof (kstat_named_t),
@@ -1048,6 +1354,14 @@ dbuf_init(void)
 			dbuf_stats.cache_levels_bytes[i].data_type =
 			    KSTAT_DATA_UINT64;
 		}
+		for (int i = 0; i < DBUF_HASH_HISTO_BUCKETS; i++) {
+			snprintf(dbuf_stats.hash_chain_histo[i].name,
+			    KSTAT_STRLEN, i < DBUF_HASH_HISTO_BUCKETS - 1 ?
+			    "hash_chain_histo_%d" : "hash_chain_histo_ge_%d",
+			    i);
+			dbuf_stats.hash_chain_histo[i].data_type =
+			    KSTAT_DATA_UINT64;
+		}
 		dbuf_ksp->ks_data = &dbuf_stats;
 		dbuf_ksp->ks_update = dbuf_kstat_update;
 		kstat_install(dbuf_ksp);
@@ -1061,6 +1375,15 @@ dbuf_fini(void)
 
 	dbuf_stats_destroy();
 
+	/*
+	 * Wait out any hash table grow still in flight before the
+	 * mutexes and bucket arrays are torn down.
+	 */
+	mutex_enter(&dbuf_hash_grow_lock);
+	while (dbuf_hash_grow_active)
+		cv_wait(&dbuf_hash_grow_cv, &dbuf_hash_grow_lock);
+	mutex_exit(&dbuf_hash_grow_lock);
+
 	for (int i = 0; i < (h->hash_mutex_mask + 1); i++)
 		mutex_destroy(&h->hash_mutexes[i]);
 
@@ -1074,14 +1397,17 @@ dbuf_fini(void)
 
 	mutex_enter(&dbuf_evict_lock);
 	dbuf_evict_thread_exit = B_TRUE;
-	while (dbuf_evict_thread_exit) {
-		cv_signal(&dbuf_evict_cv);
+	while (dbuf_evict_threads_active > 0) {
+		cv_broadcast(&dbuf_evict_cv);
 		cv_wait(&dbuf_evict_cv, &dbuf_evict_lock);
 	}
+	dbuf_evict_thread_exit = B_FALSE;
 	mutex_exit(&dbuf_evict_lock);
 
 	mutex_destroy(&dbuf_evict_lock);
 	cv_destroy(&dbuf_evict_cv);
+	mutex_destroy(&dbuf_hash_grow_lock);
+	cv_destroy(&dbuf_hash_grow_cv);
 
 	for (dbuf_cached_state_t dcs = 0; dcs < DB_CACHE_MAX; dcs++) {
 		zfs_refcount_destroy(&dbuf_caches[dcs].size);
@@ -1095,6 +1421,8 @@ dbuf_fini(void)
 
 	wmsum_fini(&dbuf_sums.cache_count);
 	wmsum_fini(&dbuf_sums.cache_total_evicts);
+	wmsum_fini(&dbuf_sums.cache_inline_evicts);
+	wmsum_fini(&dbuf_sums.cache_async_evicts);
 	for (int i = 0; i < DN_MAX_LEVELS; i++) {
 		wmsum_fini(&dbuf_sums.cache_levels[i]);
 		wmsum_fini(&dbuf_sums.cache_levels_bytes[i]);
@@ -1107,6 +1435,7 @@ dbuf_fini(void)
 	wmsum_fini(&dbuf_sums.hash_insert_race);
 	wmsum_fini(&dbuf_sums.metadata_cache_count);
 	wmsum_fini(&dbuf_sums.metadata_cache_overflow);
+	wmsum_fini(&dbuf_sums.metadata_cache_os_overflow);
 }
 
 /*
@@ -1661,7 +1990,8 @@ dbuf_read_impl(dmu_buf_impl_t *db, dnode_t *dn, zio_t *zio, dmu_flags_t flags,
 	blkptr_t copy = *bp;
 	dmu_buf_unlock_parent(db, dblt, tag);
 	return (arc_read(zio, db->db_objset->os_spa, &copy,
-	    dbuf_read_done, db, ZIO_PRIORITY_SYNC_READ, zio_flags,
+	    dbuf_read_done, db, (flags & DMU_LOWPRI) ?
+	    ZIO_PRIORITY_ASYNC_READ : ZIO_PRIORITY_SYNC_READ, zio_flags,
 	    &aflags, &zb));
 
 early_unlock:
@@ -3319,6 +3649,8 @@ dbuf_destroy(dmu_buf_impl_t *db)
 		    db->db.db_size, db);
 
 		if (db->db_caching_status == DB_DBUF_METADATA_CACHE) {
+			atomic_add_64(&db->db_objset->os_dbuf_md_cache_size,
+			    -(int64_t)db->db.db_size);
 			DBUF_STAT_BUMPDOWN(metadata_cache_count);
 		} else {
 			DBUF_STAT_BUMPDOWN(cache_levels[db->db_level]);
@@ -4070,6 +4402,8 @@ dbuf_hold_impl(dnode_t *dn, uint8_t level, uint64_t blkid,
 		    db->db_user);
 
 		if (db->db_caching_status == DB_DBUF_METADATA_CACHE) {
+			atomic_add_64(&db->db_objset->os_dbuf_md_cache_size,
+			    -(int64_t)(size + usize));
 			DBUF_STAT_BUMPDOWN(metadata_cache_count);
 		} else {
 			DBUF_STAT_BUMPDOWN(cache_levels[db->db_level]);
@@ -4308,6 +4642,9 @@ dbuf_rele_and_unlock(dmu_buf_impl_t *db, const void *tag, boolean_t evicting)
 			mutex_exit(&db->db_mtx);
 
 			if (dcs == DB_DBUF_METADATA_CACHE) {
+				atomic_add_64(
+				    &db->db_objset->os_dbuf_md_cache_size,
+				    db_size + dbu_size);
 				DBUF_STAT_BUMP(metadata_cache_count);
 				DBUF_STAT_MAX(metadata_cache_size_bytes_max,
 				    size);
@@ -5555,8 +5892,17 @@ ZFS_MODULE_PARAM(zfs_dbuf, dbuf_, metadata_cache_max_bytes, U64, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_dbuf, dbuf_, cache_shift, UINT, ZMOD_RW,
 	"Set size of dbuf cache to log2 fraction of arc size.");
 
+ZFS_MODULE_PARAM(zfs_dbuf, dbuf_, metadata_cache_os_pct, UINT, ZMOD_RW,
+	"Max percentage of the metadata dbuf cache one objset may hold");
+
 ZFS_MODULE_PARAM(zfs_dbuf, dbuf_, metadata_cache_shift, UINT, ZMOD_RW,
 	"Set size of dbuf metadata cache to log2 fraction of arc size.");
 
+ZFS_MODULE_PARAM(zfs_dbuf, dbuf_, evict_threads, UINT, ZMOD_RD,
+	"Number of dbuf cache eviction threads (0 == auto)");
+
+ZFS_MODULE_PARAM(zfs_dbuf, dbuf_, hash_chain_limit, UINT, ZMOD_RW,
+	"Hash chain length that triggers growing the dbuf hash table");
+
 ZFS_MODULE_PARAM(zfs_dbuf, dbuf_, mutex_cache_shift, UINT, ZMOD_RD,
 	"Set size of dbuf cache mutex array as log2 shift.");
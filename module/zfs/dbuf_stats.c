@@ -216,15 +216,174 @@ dbuf_stats_hash_table_destroy(void)
 	mutex_destroy(&dsh->lock);
 }
 
+/*
+ * ==========================================================================
+ * Aggregated dbuf statistics; kstat zfs/dbufs_agg
+ * ==========================================================================
+ * The per-dbuf dump above emits one line per cached dbuf, which on a
+ * large cache means gigabytes of text and a long walk holding each
+ * bucket lock while formatting.  This kstat walks the same hash table
+ * once per read, classifying dbufs by (dnode type, level) and summing
+ * counts, bytes, and held buffers into a fixed table, then emits one
+ * row per non-empty class - production-safe cache analysis in a few
+ * kilobytes.
+ */
+typedef struct dbuf_agg_row {
+	uint64_t	dar_count;
+	uint64_t	dar_bytes;
+	uint64_t	dar_holds;
+} dbuf_agg_row_t;
+
+#define	DBUF_AGG_LEVELS	8
+
+typedef struct dbuf_agg {
+	kmutex_t	daa_lock;
+	kstat_t		*daa_kstat;
+	dbuf_hash_table_t *daa_hash;
+	dbuf_agg_row_t	daa_rows[DMU_OT_NUMTYPES][DBUF_AGG_LEVELS];
+	uint_t		daa_types[DMU_OT_NUMTYPES * DBUF_AGG_LEVELS];
+	uint_t		daa_levels[DMU_OT_NUMTYPES * DBUF_AGG_LEVELS];
+	uint_t		daa_nrows;
+} dbuf_agg_t;
+
+static dbuf_agg_t dbuf_agg;
+
+static void
+dbuf_agg_collect(dbuf_agg_t *daa)
+{
+	dbuf_hash_table_t *h = daa->daa_hash;
+
+	memset(daa->daa_rows, 0, sizeof (daa->daa_rows));
+
+	for (uint64_t i = 0; i <= h->hash_table_mask; i++) {
+		mutex_enter(DBUF_HASH_MUTEX(h, i));
+		for (dmu_buf_impl_t *db = h->hash_table[i]; db != NULL;
+		    db = db->db_hash_next) {
+			mutex_enter(&db->db_mtx);
+			if (db->db_state != DB_EVICTING) {
+				dmu_object_type_t t = DMU_OT_NONE;
+				uint_t l = MIN(db->db_level,
+				    DBUF_AGG_LEVELS - 1);
+
+				DB_DNODE_ENTER(db);
+				if (DB_DNODE(db) != NULL)
+					t = DB_DNODE(db)->dn_type;
+				DB_DNODE_EXIT(db);
+
+				/*
+				 * Fold out-of-range types (including the
+				 * DMU_OT_NEWTYPE encodings) into one class.
+				 */
+				if (t >= DMU_OT_NUMTYPES)
+					t = DMU_OT_NONE;
+				dbuf_agg_row_t *r = &daa->daa_rows[t][l];
+				r->dar_count++;
+				r->dar_bytes += db->db.db_size;
+				if (zfs_refcount_count(&db->db_holds) > 0)
+					r->dar_holds++;
+			}
+			mutex_exit(&db->db_mtx);
+		}
+		mutex_exit(DBUF_HASH_MUTEX(h, i));
+	}
+
+	/* Index the non-empty rows for the emitter */
+	daa->daa_nrows = 0;
+	for (uint_t t = 0; t < DMU_OT_NUMTYPES; t++) {
+		for (uint_t l = 0; l < DBUF_AGG_LEVELS; l++) {
+			if (daa->daa_rows[t][l].dar_count == 0)
+				continue;
+			daa->daa_types[daa->daa_nrows] = t;
+			daa->daa_levels[daa->daa_nrows] = l;
+			daa->daa_nrows++;
+		}
+	}
+}
+
+static int
+dbuf_agg_headers(char *buf, size_t size)
+{
+	(void) snprintf(buf, size, "%-24s %-6s %-12s %-14s %-12s\n",
+	    "type", "level", "count", "bytes", "holds");
+	return (0);
+}
+
+static int
+dbuf_agg_data(char *buf, size_t size, void *data)
+{
+	dbuf_agg_t *daa = &dbuf_agg;
+	uint_t n = (uint_t)((uint_t *)data - daa->daa_types);
+	uint_t t = daa->daa_types[n];
+	uint_t l = daa->daa_levels[n];
+	dbuf_agg_row_t *r = &daa->daa_rows[t][l];
+
+	(void) snprintf(buf, size, "%-24s %-6u %-12llu %-14llu %-12llu\n",
+	    dmu_ot[t].ot_name, l,
+	    (u_longlong_t)r->dar_count,
+	    (u_longlong_t)r->dar_bytes,
+	    (u_longlong_t)r->dar_holds);
+	return (0);
+}
+
+static void *
+dbuf_agg_addr(kstat_t *ksp, loff_t n)
+{
+	dbuf_agg_t *daa = ksp->ks_private;
+
+	ASSERT(MUTEX_HELD(&daa->daa_lock));
+
+	if (n == 0)
+		dbuf_agg_collect(daa);
+	if (n < daa->daa_nrows)
+		return (&daa->daa_types[n]);
+
+	return (NULL);
+}
+
+static void
+dbuf_agg_init(dbuf_hash_table_t *hash)
+{
+	dbuf_agg_t *daa = &dbuf_agg;
+	kstat_t *ksp;
+
+	mutex_init(&daa->daa_lock, NULL, MUTEX_DEFAULT, NULL);
+	daa->daa_hash = hash;
+
+	ksp = kstat_create("zfs", 0, "dbufs_agg", "misc",
+	    KSTAT_TYPE_RAW, 0, KSTAT_FLAG_VIRTUAL);
+	daa->daa_kstat = ksp;
+
+	if (ksp) {
+		ksp->ks_lock = &daa->daa_lock;
+		ksp->ks_ndata = UINT32_MAX;
+		ksp->ks_private = daa;
+		kstat_set_raw_ops(ksp, dbuf_agg_headers,
+		    dbuf_agg_data, dbuf_agg_addr);
+		kstat_install(ksp);
+	}
+}
+
+static void
+dbuf_agg_destroy(void)
+{
+	dbuf_agg_t *daa = &dbuf_agg;
+
+	if (daa->daa_kstat)
+		kstat_delete(daa->daa_kstat);
+	mutex_destroy(&daa->daa_lock);
+}
+
 void
 dbuf_stats_init(dbuf_hash_table_t *hash)
 {
 	dbuf_stats_hash_table_init(hash);
+	dbuf_agg_init(hash);
 }
 
 void
 dbuf_stats_destroy(void)
 {
+	dbuf_agg_destroy();
 	dbuf_stats_hash_table_destroy();
 }
 
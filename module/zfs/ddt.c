@@ -230,6 +230,63 @@ static kmem_cache_t *ddt_entry_trad_cache;
  */
 int zfs_dedup_prefetch = 0;
 
+/*
+ * Number of slots in the per-checksum negative lookup cache, rounded up
+ * to a power of two.  The cache remembers keys recently confirmed absent
+ * from every entry store object, so streams of unique writes don't probe
+ * each type/class ZAP on every lookup.  Each slot holds one key (40
+ * bytes); the cache is allocated on first use of a DDT.  Zero disables
+ * it.
+ */
+static uint_t zfs_dedup_negative_cache_entries = 128 * 1024;
+
+/*
+ * Automatic background pruning of single-reference DDT entries.  When
+ * enabled, a per-pool thread watches the table size and, once it crosses
+ * zfs_dedup_prune_quota_pct percent of an explicit dedup_table_quota (or
+ * the automatic quota reports the dedup/special class full), prunes
+ * zfs_dedup_prune_percent percent of the unique-class entries - oldest
+ * first, selected by the same age histogram the manual "zpool ddtprune"
+ * uses - and repeats each interval until the table is back under the
+ * threshold.  Requires the fast_dedup (flat) format, like manual prune.
+ */
+int zfs_dedup_prune_enabled = 0;
+static uint_t zfs_dedup_prune_quota_pct = 80;
+static uint_t zfs_dedup_prune_percent = 10;
+
+typedef struct ddt_prune_stats {
+	kstat_named_t dps_auto_runs;
+	kstat_named_t dps_auto_errors;
+} ddt_prune_stats_t;
+
+static ddt_prune_stats_t ddt_prune_stats = {
+	{ "auto_runs",		KSTAT_DATA_UINT64 },
+	{ "auto_errors",	KSTAT_DATA_UINT64 },
+};
+
+struct {
+	wmsum_t dps_auto_runs;
+	wmsum_t dps_auto_errors;
+} ddt_prune_sums;
+
+static kstat_t *ddt_prune_ksp;
+
+static int
+ddt_prune_kstats_update(kstat_t *ksp, int rw)
+{
+	ddt_prune_stats_t *dps = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (EACCES);
+
+	dps->dps_auto_runs.value.ui64 =
+	    wmsum_value(&ddt_prune_sums.dps_auto_runs);
+	dps->dps_auto_errors.value.ui64 =
+	    wmsum_value(&ddt_prune_sums.dps_auto_errors);
+
+	return (0);
+}
+
 /*
  * If the dedup class cannot satisfy a DDT allocation, treat as over quota
  * for this many TXGs.
@@ -331,6 +388,9 @@ typedef struct {
 	kstat_named_t dds_lookup_stored_hit;
 	kstat_named_t dds_lookup_stored_miss;
 
+	/* store probes skipped by the negative lookup cache */
+	kstat_named_t dds_lookup_absent_hit;
+
 	/* number of entries on log trees */
 	kstat_named_t dds_log_active_entries;
 	kstat_named_t dds_log_flushing_entries;
@@ -354,6 +414,7 @@ static const ddt_kstats_t ddt_kstats_template = {
 	{ "lookup_log_miss",		KSTAT_DATA_UINT64 },
 	{ "lookup_stored_hit",		KSTAT_DATA_UINT64 },
 	{ "lookup_stored_miss",		KSTAT_DATA_UINT64 },
+	{ "lookup_absent_hit",		KSTAT_DATA_UINT64 },
 	{ "log_active_entries",		KSTAT_DATA_UINT64 },
 	{ "log_flushing_entries",	KSTAT_DATA_UINT64 },
 	{ "log_ingest_rate",		KSTAT_DATA_UINT32 },
@@ -388,6 +449,95 @@ static const ddt_kstats_t ddt_kstats_template = {
 #endif /* _KERNEL */
 
 
+/*
+ * Negative lookup cache.  A direct-mapped table of keys known to be
+ * absent from every store object, indexed by the low bits of the block
+ * checksum (which is uniformly distributed) and guarded by striped
+ * locks.  An empty slot is all zeroes, which can never equal a real key:
+ * the compression field of ddk_prop is copied from an on-disk bp, which
+ * never stores a value below ZIO_COMPRESS_OFF.  Collisions simply
+ * overwrite; the cache is advisory, and a lost entry only costs the
+ * store probes it would have skipped.
+ *
+ * This fills the role a persistent bloom/cuckoo filter over the stored
+ * keys would: on mostly-unique data nearly every lookup is a miss that
+ * resolves in a couple of memory reads.  An exact cache was chosen
+ * instead of a probabilistic filter because entries are also removed
+ * from the stores (frees, pruning, quota), which a plain bloom filter
+ * cannot express without counting slots or periodic rebuilds from the
+ * ZAPs; because a false positive still pays the full probe sweep; and
+ * because exactness means nothing needs to be persisted or rebuilt at
+ * import.  Note that a "definite miss" cannot skip ddt_lookup() itself
+ * in any case - the write still needs a live entry created here so the
+ * new block is recorded and synced into the stores.
+ */
+static void
+ddt_neg_cache_alloc(ddt_t *ddt)
+{
+	ASSERT(MUTEX_HELD(&ddt->ddt_lock));
+
+	uint64_t entries = MIN(zfs_dedup_negative_cache_entries, 1 << 22);
+	if (entries == 0 || ddt->ddt_neg_cache != NULL)
+		return;
+	if (!ISP2(entries))
+		entries = 1ULL << highbit64(entries);
+	ddt_key_t *cache = vmem_zalloc(entries * sizeof (ddt_key_t),
+	    KM_SLEEP);
+	ddt->ddt_neg_cache_mask = entries - 1;
+	membar_producer();
+	ddt->ddt_neg_cache = cache;
+}
+
+static boolean_t
+ddt_neg_cache_contains(ddt_t *ddt, const ddt_key_t *ddk)
+{
+	ddt_key_t *cache = ddt->ddt_neg_cache;
+
+	if (cache == NULL)
+		return (B_FALSE);
+	membar_consumer();
+	uint32_t slot = ddk->ddk_cksum.zc_word[0] & ddt->ddt_neg_cache_mask;
+	kmutex_t *lock =
+	    &ddt->ddt_neg_cache_locks[slot & (DDT_NEG_CACHE_LOCKS - 1)];
+	mutex_enter(lock);
+	boolean_t found = (memcmp(&cache[slot], ddk, sizeof (*ddk)) == 0);
+	mutex_exit(lock);
+	return (found);
+}
+
+static void
+ddt_neg_cache_insert(ddt_t *ddt, const ddt_key_t *ddk)
+{
+	ddt_key_t *cache = ddt->ddt_neg_cache;
+
+	if (cache == NULL)
+		return;
+	membar_consumer();
+	uint32_t slot = ddk->ddk_cksum.zc_word[0] & ddt->ddt_neg_cache_mask;
+	kmutex_t *lock =
+	    &ddt->ddt_neg_cache_locks[slot & (DDT_NEG_CACHE_LOCKS - 1)];
+	mutex_enter(lock);
+	cache[slot] = *ddk;
+	mutex_exit(lock);
+}
+
+static void
+ddt_neg_cache_remove(ddt_t *ddt, const ddt_key_t *ddk)
+{
+	ddt_key_t *cache = ddt->ddt_neg_cache;
+
+	if (cache == NULL)
+		return;
+	membar_consumer();
+	uint32_t slot = ddk->ddk_cksum.zc_word[0] & ddt->ddt_neg_cache_mask;
+	kmutex_t *lock =
+	    &ddt->ddt_neg_cache_locks[slot & (DDT_NEG_CACHE_LOCKS - 1)];
+	mutex_enter(lock);
+	if (memcmp(&cache[slot], ddk, sizeof (*ddk)) == 0)
+		memset(&cache[slot], 0, sizeof (*ddk));
+	mutex_exit(lock);
+}
+
 static void
 ddt_object_create(ddt_t *ddt, ddt_type_t type, ddt_class_t class,
     dmu_tx_t *tx)
@@ -621,6 +771,12 @@ ddt_object_update(ddt_t *ddt, ddt_type_t type, ddt_class_t class,
 	dnode_t *dn = ddt->ddt_object_dnode[type][class];
 	ASSERT(dn != NULL);
 
+	/*
+	 * This key is now present in a store object, so it must not
+	 * linger in the negative lookup cache.
+	 */
+	ddt_neg_cache_remove(ddt, &ddlwe->ddlwe_key);
+
 	return (ddt_ops[type]->ddt_op_update(dn, &ddlwe->ddlwe_key,
 	    &ddlwe->ddlwe_phys, DDT_PHYS_SIZE(ddt), tx));
 }
@@ -1039,11 +1195,30 @@ ddt_init(void)
 	    DDT_ENTRY_TRAD_SIZE, 0, NULL, NULL, NULL, NULL, NULL, 0);
 
 	ddt_log_init();
+
+	wmsum_init(&ddt_prune_sums.dps_auto_runs, 0);
+	wmsum_init(&ddt_prune_sums.dps_auto_errors, 0);
+	ddt_prune_ksp = kstat_create("zfs", 0, "ddt_prune", "misc",
+	    KSTAT_TYPE_NAMED,
+	    sizeof (ddt_prune_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (ddt_prune_ksp != NULL) {
+		ddt_prune_ksp->ks_data = &ddt_prune_stats;
+		ddt_prune_ksp->ks_update = ddt_prune_kstats_update;
+		kstat_install(ddt_prune_ksp);
+	}
 }
 
 void
 ddt_fini(void)
 {
+	if (ddt_prune_ksp != NULL) {
+		kstat_delete(ddt_prune_ksp);
+		ddt_prune_ksp = NULL;
+	}
+	wmsum_fini(&ddt_prune_sums.dps_auto_runs);
+	wmsum_fini(&ddt_prune_sums.dps_auto_errors);
+
 	ddt_log_fini();
 
 	kmem_cache_destroy(ddt_entry_trad_cache);
@@ -1249,6 +1424,9 @@ ddt_lookup(ddt_t *ddt, const blkptr_t *bp, boolean_t verify)
 		ASSERT3U(ddt->ddt_version, !=, DDT_VERSION_UNCONFIGURED);
 	}
 
+	if (unlikely(ddt->ddt_neg_cache == NULL))
+		ddt_neg_cache_alloc(ddt);
+
 	DDT_KSTAT_BUMP(ddt, dds_lookup);
 
 	ddt_key_fill(&search, bp);
@@ -1350,18 +1528,36 @@ ddt_lookup(ddt_t *ddt, const blkptr_t *bp, boolean_t verify)
 		DDT_KSTAT_BUMP(ddt, dds_lookup_log_miss);
 	}
 
-	/* Search all store objects for the entry. */
+	/*
+	 * If this key was recently confirmed absent from every store
+	 * object (and it isn't on the live tree or the logs, or we would
+	 * have found it above), we can skip the store probes entirely.
+	 */
 	error = ENOENT;
-	for (type = 0; type < DDT_TYPES; type++) {
-		for (class = 0; class < DDT_CLASSES; class++) {
-			error = ddt_object_lookup(ddt, type, class, dde);
-			if (error != ENOENT) {
-				ASSERT0(error);
-				break;
+	type = DDT_TYPES;
+	class = DDT_CLASSES;
+	if (ddt_neg_cache_contains(ddt, &search)) {
+		DDT_KSTAT_BUMP(ddt, dds_lookup_absent_hit);
+	} else {
+		/* Search all store objects for the entry. */
+		for (type = 0; type < DDT_TYPES; type++) {
+			for (class = 0; class < DDT_CLASSES; class++) {
+				error = ddt_object_lookup(ddt, type, class,
+				    dde);
+				if (error != ENOENT) {
+					ASSERT0(error);
+					break;
+				}
 			}
+			if (error != ENOENT)
+				break;
+		}
+		if (error == ENOENT) {
+			ddt_neg_cache_insert(ddt, &search);
+		} else {
+			/* Defensively drop any stale entry for this key */
+			ddt_neg_cache_remove(ddt, &search);
 		}
-		if (error != ENOENT)
-			break;
 	}
 
 	ddt_enter(ddt);
@@ -1695,6 +1891,8 @@ ddt_kstat_update(kstat_t *ksp, int rw)
 	    wmsum_value(&ddt->ddt_kstat_dds_lookup_stored_hit);
 	dds->dds_lookup_stored_miss.value.ui64 =
 	    wmsum_value(&ddt->ddt_kstat_dds_lookup_stored_miss);
+	dds->dds_lookup_absent_hit.value.ui64 =
+	    wmsum_value(&ddt->ddt_kstat_dds_lookup_absent_hit);
 
 	/* Sync-only counters are already set directly in kstats */
 
@@ -1721,6 +1919,7 @@ ddt_table_alloc_kstats(ddt_t *ddt)
 	wmsum_init(&ddt->ddt_kstat_dds_lookup_log_miss, 0);
 	wmsum_init(&ddt->ddt_kstat_dds_lookup_stored_hit, 0);
 	wmsum_init(&ddt->ddt_kstat_dds_lookup_stored_miss, 0);
+	wmsum_init(&ddt->ddt_kstat_dds_lookup_absent_hit, 0);
 
 	ddt->ddt_ksp = kstat_create(mod, 0, name, "misc", KSTAT_TYPE_NAMED,
 	    sizeof (ddt_kstats_t) / sizeof (kstat_named_t), KSTAT_FLAG_VIRTUAL);
@@ -1745,6 +1944,10 @@ ddt_table_alloc(spa_t *spa, enum zio_checksum c)
 	ddt = kmem_cache_alloc(ddt_cache, KM_SLEEP);
 	memset(ddt, 0, sizeof (ddt_t));
 	mutex_init(&ddt->ddt_lock, NULL, MUTEX_DEFAULT, NULL);
+	for (int i = 0; i < DDT_NEG_CACHE_LOCKS; i++) {
+		mutex_init(&ddt->ddt_neg_cache_locks[i], NULL,
+		    MUTEX_DEFAULT, NULL);
+	}
 	avl_create(&ddt->ddt_tree, ddt_key_compare,
 	    sizeof (ddt_entry_t), offsetof(ddt_entry_t, dde_node));
 	avl_create(&ddt->ddt_repair_tree, ddt_key_compare,
@@ -1785,6 +1988,7 @@ ddt_table_free(ddt_t *ddt)
 	wmsum_fini(&ddt->ddt_kstat_dds_lookup_log_miss);
 	wmsum_fini(&ddt->ddt_kstat_dds_lookup_stored_hit);
 	wmsum_fini(&ddt->ddt_kstat_dds_lookup_stored_miss);
+	wmsum_fini(&ddt->ddt_kstat_dds_lookup_absent_hit);
 
 	ddt_log_free(ddt);
 	for (ddt_type_t type = 0; type < DDT_TYPES; type++) {
@@ -1796,6 +2000,13 @@ ddt_table_free(ddt_t *ddt)
 			}
 		}
 	}
+	if (ddt->ddt_neg_cache != NULL) {
+		vmem_free(ddt->ddt_neg_cache,
+		    (ddt->ddt_neg_cache_mask + 1ULL) * sizeof (ddt_key_t));
+		ddt->ddt_neg_cache = NULL;
+	}
+	for (int i = 0; i < DDT_NEG_CACHE_LOCKS; i++)
+		mutex_destroy(&ddt->ddt_neg_cache_locks[i]);
 	rw_destroy(&ddt->ddt_objects_lock);
 	ASSERT0(avl_numnodes(&ddt->ddt_tree));
 	ASSERT0(avl_numnodes(&ddt->ddt_repair_tree));
@@ -2229,6 +2440,19 @@ ddt_flush_force_update_txg(ddt_t *ddt, uint64_t txg)
 	ddt->ddt_flush_force_txg = 0;
 }
 
+/*
+ * Apply a paced portion of the flushing log to the store objects.  The
+ * controller below already spreads the backlog across txgs (matching the
+ * ingest rate, with cap pressure and time limits), so sync time stays
+ * roughly flat as the log grows.  The application itself is one ordered
+ * stream: entries must be flushed in key order so that the checkpoint
+ * always names a contiguous flushed prefix of the key space, and the
+ * stores themselves are single ZAPs per type/class - partitioning the
+ * flush by key prefix would need independent shard objects, which is an
+ * on-disk format change.  The prefetch pass below gets most of the
+ * benefit by overlapping the leaf reads that the ordered stream would
+ * otherwise take one at a time.
+ */
 static void
 ddt_sync_flush_log(ddt_t *ddt, dmu_tx_t *tx)
 {
@@ -2323,6 +2547,30 @@ ddt_sync_flush_log(ddt_t *ddt, dmu_tx_t *tx)
 		target_time = SEC2NSEC(zfs_txg_timeout) / 2;
 	}
 
+	/*
+	 * Prefetch the store blocks this batch will touch, so the flush
+	 * loop below doesn't stall on a synchronous ZAP leaf read per
+	 * entry.  Entries that were stored before go back to their old
+	 * object first (for the remove); fresh entries land in the default
+	 * type, almost always in the unique class on their first flush.
+	 */
+	uint32_t plimit = MIN(flush_max, 4 * 1024);
+	uint32_t pcount = 0;
+	for (ddt_log_entry_t *ddle =
+	    avl_first(&ddt->ddt_log_flushing->ddl_tree);
+	    ddle != NULL && pcount < plimit;
+	    ddle = AVL_NEXT(&ddt->ddt_log_flushing->ddl_tree, ddle),
+	    pcount++) {
+		if (ddle->ddle_type < DDT_TYPES &&
+		    ddle->ddle_class < DDT_CLASSES) {
+			ddt_object_prefetch(ddt, ddle->ddle_type,
+			    ddle->ddle_class, &ddle->ddle_key);
+		} else {
+			ddt_object_prefetch(ddt, DDT_TYPE_DEFAULT,
+			    DDT_CLASS_UNIQUE, &ddle->ddle_key);
+		}
+	}
+
 	ddt_lightweight_entry_t ddlwe;
 	while (ddt_log_take_first(ddt, ddt->ddt_log_flushing, &ddlwe)) {
 		ddt_sync_flush_entry(ddt, &ddlwe,
@@ -2970,6 +3218,67 @@ ddt_prune_unique_entries(spa_t *spa, zpool_ddt_prune_unit_t unit,
 	return (0);
 }
 
+/*
+ * zthr callbacks for the automatic pruner (see zfs_dedup_prune_enabled
+ * above).  The check is cheap - object stats, no table walk - and runs
+ * on a timer; the prune itself paces its work through batched synctasks
+ * and bails out if the pool starts shutting down.
+ */
+boolean_t
+ddt_prune_thread_check(void *arg, zthr_t *zthr)
+{
+	(void) zthr;
+	spa_t *spa = arg;
+
+	if (!zfs_dedup_prune_enabled)
+		return (B_FALSE);
+	if (!spa_writeable(spa) || spa_suspended(spa) ||
+	    spa->spa_active_ddt_prune)
+		return (B_FALSE);
+	if (!spa_feature_is_enabled(spa, SPA_FEATURE_FAST_DEDUP))
+		return (B_FALSE);
+
+	uint64_t quota = spa->spa_dedup_table_quota;
+	if (quota == 0)
+		return (B_FALSE);
+	if (quota != UINT64_MAX) {
+		uint64_t pct = MIN(zfs_dedup_prune_quota_pct, 100);
+		return (ddt_get_ddt_dsize(spa) >= quota / 100 * pct);
+	}
+
+	/* Automatic quota: prune once the backing class reports full. */
+	return (ddt_over_quota(spa));
+}
+
+void
+ddt_prune_thread(void *arg, zthr_t *zthr)
+{
+	(void) zthr;
+	spa_t *spa = arg;
+
+	uint64_t percent = MIN(MAX(zfs_dedup_prune_percent, 1), 100);
+	wmsum_add(&ddt_prune_sums.dps_auto_runs, 1);
+	int err = ddt_prune_unique_entries(spa,
+	    ZPOOL_DDT_PRUNE_PERCENTAGE, percent);
+	if (err != 0 && err != EALREADY) {
+		wmsum_add(&ddt_prune_sums.dps_auto_errors, 1);
+		zfs_dbgmsg("auto ddt prune of %llu%% failed on %s: error %d",
+		    (u_longlong_t)percent, spa_name(spa), err);
+	}
+}
+
+ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, negative_cache_entries, UINT,
+	ZMOD_RW, "Slots in the DDT negative lookup cache (0 disables)");
+
+ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, prune_enabled, INT, ZMOD_RW,
+	"Automatically prune old unique DDT entries near the table quota");
+
+ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, prune_quota_pct, UINT, ZMOD_RW,
+	"Percent of dedup_table_quota that triggers automatic pruning");
+
+ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, prune_percent, UINT, ZMOD_RW,
+	"Percent of unique DDT entries pruned per automatic prune run");
+
 ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, prefetch, INT, ZMOD_RW,
 	"Enable prefetching dedup-ed blks");
 
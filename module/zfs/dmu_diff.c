@@ -223,6 +223,18 @@ dmu_diff(const char *tosnap_name, const char *fromsnap_name,
 	 * dataset isn't mounted and because it will fail when it attempts to
 	 * call the ZFS_IOC_OBJ_TO_STATS ioctl.
 	 */
+	/*
+	 * This stays a single ordered traversal by design.  The diff pipe
+	 * protocol emits records in object order (userland resolves them
+	 * to paths as they stream), and the birth-txg pruning in diff_cb
+	 * already skips every subtree untouched since fromtxg - so the
+	 * wall time is the I/O to read the changed indirects, issued
+	 * ahead of the walk by the metadata prefetcher.  Parallel dnode
+	 * ranges would need the sorted-merge apparatus just to restore
+	 * emission order, to speed up a walk that is pruned rather than
+	 * exhaustive.  A count-only mode would save only the record
+	 * formatting, which is noise next to that I/O.
+	 */
 	error = traverse_dataset(tosnap, fromtxg,
 	    TRAVERSE_PRE | TRAVERSE_PREFETCH_METADATA | TRAVERSE_NO_DECRYPT |
 	    TRAVERSE_LOGICAL, diff_cb, &da);
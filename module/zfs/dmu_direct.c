@@ -30,6 +30,17 @@
 #include <sys/dsl_dataset.h>
 #include <sys/dmu_objset.h>
 
+/*
+ * Build the ABD a direct read/write will target for one dbuf.  The user's
+ * pages (already mapped into "data") cover whatever part of the block the
+ * request spans; if the request enters or leaves the block mid-way, small
+ * bounce buffers are allocated for the uncovered edges and the pieces are
+ * stitched together as a gang ABD.  This is what lets sub-recordsize,
+ * page-aligned O_DIRECT requests stay on the zero-copy path: only
+ * page-alignment is required by zfs_setup_direct(), not recordsize
+ * alignment, and the cost of a partial block is just the edge bounce
+ * buffers, not a fallback to the buffered path.
+ */
 static abd_t *
 make_abd_for_dbuf(dmu_buf_impl_t *db, abd_t *data, uint64_t offset,
     uint64_t size)
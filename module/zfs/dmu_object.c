@@ -104,67 +104,98 @@ dmu_object_alloc_impl(objset_t *os, dmu_object_type_t ot, int blocksize,
 		    (P2PHASE(object + dn_slots - 1, dnodes_per_chunk) <
 		    dn_slots)) {
 			DNODE_STAT_BUMP(dnode_alloc_next_chunk);
-			mutex_enter(&os->os_obj_lock);
-			ASSERT0(P2PHASE(os->os_obj_next_chunk,
-			    dnodes_per_chunk));
-			object = os->os_obj_next_chunk;
 
 			/*
-			 * Each time we polish off a L1 bp worth of dnodes
-			 * (2^12 objects), move to another L1 bp that's
-			 * still reasonably sparse (at most 1/4 full). Look
-			 * from the beginning at most once per txg. If we
-			 * still can't allocate from that L1 block, search
-			 * for an empty L0 block, which will quickly skip
-			 * to the end of the metadnode if no nearby L0
-			 * blocks are empty. This fallback avoids a
-			 * pathology where full dnode blocks containing
-			 * large dnodes appear sparse because they have a
-			 * low blk_fill, leading to many failed allocation
-			 * attempts. In the long term a better mechanism to
-			 * search for sparse metadnode regions, such as
-			 * spacemaps, could be implemented.
-			 *
-			 * os_scan_dnodes is set during txg sync if enough
-			 * objects have been freed since the previous
-			 * rescan to justify backfilling again.
-			 *
-			 * Note that dmu_traverse depends on the behavior
-			 * that we use multiple blocks of the dnode object
-			 * before going back to reuse objects.  Any change
-			 * to this algorithm should preserve that property
-			 * or find another solution to the issues described
-			 * in traverse_visitbp.
+			 * Chunk refills that stay within the current L1
+			 * block's worth of dnodes claim the next chunk
+			 * with a single compare-and-swap, so concurrent
+			 * allocators only rendezvous on os_obj_lock at L1
+			 * boundaries, where the sparse-region scan below
+			 * may be needed.  A refill racing with the locked
+			 * path can at worst hand two CPUs overlapping
+			 * chunks; the DNODE_MUST_BE_FREE check further
+			 * down already resolves that by skipping objects
+			 * that lost the race.
 			 */
-			if (P2PHASE(object, L1_dnode_count) == 0) {
-				uint64_t offset;
-				uint64_t blkfill;
-				int minlvl;
-				if (os->os_rescan_dnodes) {
-					offset = 0;
-					os->os_rescan_dnodes = B_FALSE;
-				} else {
-					offset = object << DNODE_SHIFT;
-				}
-				blkfill = restarted ? 1 : DNODES_PER_BLOCK >> 2;
-				minlvl = restarted ? 1 : 2;
-				restarted = B_TRUE;
-				error = dnode_next_offset(DMU_META_DNODE(os),
-				    DNODE_FIND_HOLE, &offset, minlvl,
-				    blkfill, 0);
-				if (error == 0) {
-					object = offset >> DNODE_SHIFT;
+			object = os->os_obj_next_chunk;
+			if (P2PHASE(object, L1_dnode_count) != 0 &&
+			    atomic_cas_64(&os->os_obj_next_chunk, object,
+			    P2ALIGN_TYPED(object, dnodes_per_chunk,
+			    uint64_t) + dnodes_per_chunk) == object) {
+				(void) atomic_swap_64(cpuobj, object);
+			} else {
+				DNODE_STAT_BUMP(dnode_alloc_next_chunk_lock);
+				mutex_enter(&os->os_obj_lock);
+				ASSERT0(P2PHASE(os->os_obj_next_chunk,
+				    dnodes_per_chunk));
+				object = os->os_obj_next_chunk;
+
+				/*
+				 * Each time we polish off a L1 bp worth
+				 * of dnodes (2^12 objects), move to
+				 * another L1 bp that's still reasonably
+				 * sparse (at most 1/4 full). Look from
+				 * the beginning at most once per txg.
+				 * If we still can't allocate from that
+				 * L1 block, search for an empty L0
+				 * block, which will quickly skip to the
+				 * end of the metadnode if no nearby L0
+				 * blocks are empty. This fallback
+				 * avoids a pathology where full dnode
+				 * blocks containing large dnodes appear
+				 * sparse because they have a low
+				 * blk_fill, leading to many failed
+				 * allocation attempts. In the long term
+				 * a better mechanism to search for
+				 * sparse metadnode regions, such as
+				 * spacemaps, could be implemented.
+				 *
+				 * os_scan_dnodes is set during txg sync
+				 * if enough objects have been freed
+				 * since the previous rescan to justify
+				 * backfilling again.
+				 *
+				 * Note that dmu_traverse depends on the
+				 * behavior that we use multiple blocks
+				 * of the dnode object before going back
+				 * to reuse objects.  Any change to this
+				 * algorithm should preserve that
+				 * property or find another solution to
+				 * the issues described in
+				 * traverse_visitbp.
+				 */
+				if (P2PHASE(object, L1_dnode_count) == 0) {
+					uint64_t offset;
+					uint64_t blkfill;
+					int minlvl;
+					if (os->os_rescan_dnodes) {
+						offset = 0;
+						os->os_rescan_dnodes = B_FALSE;
+					} else {
+						offset = object << DNODE_SHIFT;
+					}
+					blkfill = restarted ?
+					    1 : DNODES_PER_BLOCK >> 2;
+					minlvl = restarted ? 1 : 2;
+					restarted = B_TRUE;
+					error = dnode_next_offset(
+					    DMU_META_DNODE(os),
+					    DNODE_FIND_HOLE, &offset, minlvl,
+					    blkfill, 0);
+					if (error == 0) {
+						object = offset >> DNODE_SHIFT;
+					}
 				}
+				/*
+				 * Note: if "restarted", we may find a L0 that
+				 * is not suitably aligned.
+				 */
+				os->os_obj_next_chunk =
+				    P2ALIGN_TYPED(object, dnodes_per_chunk,
+				    uint64_t) + dnodes_per_chunk;
+				(void) atomic_swap_64(cpuobj, object);
+				mutex_exit(&os->os_obj_lock);
 			}
-			/*
-			 * Note: if "restarted", we may find a L0 that
-			 * is not suitably aligned.
-			 */
-			os->os_obj_next_chunk =
-			    P2ALIGN_TYPED(object, dnodes_per_chunk, uint64_t) +
-			    dnodes_per_chunk;
-			(void) atomic_swap_64(cpuobj, object);
-			mutex_exit(&os->os_obj_lock);
 		}
 
 		/*
@@ -280,6 +280,29 @@ prefetch_changed_cb(void *arg, uint64_t newval)
 	os->os_prefetch = newval;
 }
 
+static void
+alloclocality_changed_cb(void *arg, uint64_t newval)
+{
+	objset_t *os = arg;
+
+	os->os_alloc_locality = (newval != 0);
+}
+
+static void
+writelimit_changed_cb(void *arg, uint64_t newval)
+{
+	objset_t *os = arg;
+
+	/*
+	 * This may run before os_wr_bucket_lock exists (property
+	 * callbacks fire during registration), so only store the limit;
+	 * the bucket in dmu_tx_wrlimit_delay() caps its credit at one
+	 * second of the current limit, so changes take hold within a
+	 * second on their own.
+	 */
+	os->os_write_limit = newval;
+}
+
 static void
 sync_changed_cb(void *arg, uint64_t newval)
 {
@@ -636,6 +659,17 @@ dmu_objset_open_impl(spa_t *spa, dsl_dataset_t *ds, blkptr_t *bp,
 				    zfs_prop_to_name(ZFS_PROP_DIRECT),
 				    direct_changed_cb, os);
 			}
+			if (err == 0) {
+				err = dsl_prop_register(ds,
+				    zfs_prop_to_name(ZFS_PROP_WRITELIMIT),
+				    writelimit_changed_cb, os);
+			}
+			if (err == 0) {
+				err = dsl_prop_register(ds,
+				    zfs_prop_to_name(
+				    ZFS_PROP_ALLOCLOCALITY),
+				    alloclocality_changed_cb, os);
+			}
 		}
 		if (err != 0) {
 			arc_buf_destroy(os->os_phys_buf, &os->os_phys_buf);
@@ -668,15 +702,23 @@ dmu_objset_open_impl(spa_t *spa, dsl_dataset_t *ds, blkptr_t *bp,
 		    offsetof(dnode_t, dn_dirty_link[i]),
 		    dnode_multilist_index_func);
 	}
-	list_create(&os->os_dnodes, sizeof (dnode_t),
-	    offsetof(dnode_t, dn_link));
+	for (i = 0; i < OS_DNODE_SHARDS; i++) {
+		mutex_init(&os->os_dnodes[i].ods_lock, NULL, MUTEX_DEFAULT,
+		    NULL);
+		list_create(&os->os_dnodes[i].ods_list, sizeof (dnode_t),
+		    offsetof(dnode_t, dn_link));
+	}
+	os->os_dnode_count = 1;
 	list_create(&os->os_downgraded_dbufs, sizeof (dmu_buf_impl_t),
 	    offsetof(dmu_buf_impl_t, db_link));
 
 	list_link_init(&os->os_evicting_node);
 
 	mutex_init(&os->os_lock, NULL, MUTEX_DEFAULT, NULL);
+	mutex_init(&os->os_wr_bucket_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&os->os_userused_lock, NULL, MUTEX_DEFAULT, NULL);
+	mutex_init(&os->os_groupused_lock, NULL, MUTEX_DEFAULT, NULL);
+	mutex_init(&os->os_projectused_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&os->os_obj_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&os->os_user_ptr_lock, NULL, MUTEX_DEFAULT, NULL);
 	os->os_obj_next_percpu_len = boot_ncpus;
@@ -949,29 +991,35 @@ dmu_objset_evict_dbufs(objset_t *os)
 
 	dn_marker = kmem_alloc(sizeof (dnode_t), KM_SLEEP);
 
-	mutex_enter(&os->os_lock);
-	dn = list_head(&os->os_dnodes);
-	while (dn != NULL) {
-		/*
-		 * Skip dnodes without holds.  We have to do this dance
-		 * because dnode_add_ref() only works if there is already a
-		 * hold.  If the dnode has no holds, then it has no dbufs.
-		 */
-		if (dnode_add_ref(dn, FTAG)) {
-			list_insert_after(&os->os_dnodes, dn, dn_marker);
-			mutex_exit(&os->os_lock);
-
-			dnode_evict_dbufs(dn);
-			dnode_rele(dn, FTAG);
+	for (int i = 0; i < OS_DNODE_SHARDS; i++) {
+		objset_dnode_shard_t *s = &os->os_dnodes[i];
 
-			mutex_enter(&os->os_lock);
-			dn = list_next(&os->os_dnodes, dn_marker);
-			list_remove(&os->os_dnodes, dn_marker);
-		} else {
-			dn = list_next(&os->os_dnodes, dn);
+		mutex_enter(&s->ods_lock);
+		dn = list_head(&s->ods_list);
+		while (dn != NULL) {
+			/*
+			 * Skip dnodes without holds.  We have to do this
+			 * dance because dnode_add_ref() only works if
+			 * there is already a hold.  If the dnode has no
+			 * holds, then it has no dbufs.
+			 */
+			if (dnode_add_ref(dn, FTAG)) {
+				list_insert_after(&s->ods_list, dn,
+				    dn_marker);
+				mutex_exit(&s->ods_lock);
+
+				dnode_evict_dbufs(dn);
+				dnode_rele(dn, FTAG);
+
+				mutex_enter(&s->ods_lock);
+				dn = list_next(&s->ods_list, dn_marker);
+				list_remove(&s->ods_list, dn_marker);
+			} else {
+				dn = list_next(&s->ods_list, dn);
+			}
 		}
+		mutex_exit(&s->ods_lock);
 	}
-	mutex_exit(&os->os_lock);
 
 	kmem_free(dn_marker, sizeof (dnode_t));
 
@@ -1015,20 +1063,21 @@ dmu_objset_evict(objset_t *os)
 
 	mutex_enter(&os->os_lock);
 	spa_evicting_os_register(os->os_spa, os);
-	if (list_is_empty(&os->os_dnodes)) {
-		mutex_exit(&os->os_lock);
-		dmu_objset_evict_done(os);
-	} else {
-		mutex_exit(&os->os_lock);
-	}
-
+	mutex_exit(&os->os_lock);
 
+	/*
+	 * Drop the reference os_dnode_count was created with.  If no
+	 * dnodes remain, complete the eviction here; otherwise the
+	 * dnode_destroy() of the last one will.
+	 */
+	if (atomic_dec_64_nv(&os->os_dnode_count) == 0)
+		dmu_objset_evict_done(os);
 }
 
 void
 dmu_objset_evict_done(objset_t *os)
 {
-	ASSERT3P(list_head(&os->os_dnodes), ==, NULL);
+	ASSERT0(os->os_dnode_count);
 
 	dnode_special_close(&os->os_meta_dnode);
 	if (DMU_USERUSED_DNODE(os)) {
@@ -1053,8 +1102,16 @@ dmu_objset_evict_done(objset_t *os)
 	kmem_free(os->os_obj_next_percpu,
 	    os->os_obj_next_percpu_len * sizeof (os->os_obj_next_percpu[0]));
 
+	for (int i = 0; i < OS_DNODE_SHARDS; i++) {
+		ASSERT(list_is_empty(&os->os_dnodes[i].ods_list));
+		list_destroy(&os->os_dnodes[i].ods_list);
+		mutex_destroy(&os->os_dnodes[i].ods_lock);
+	}
 	mutex_destroy(&os->os_lock);
+	mutex_destroy(&os->os_wr_bucket_lock);
 	mutex_destroy(&os->os_userused_lock);
+	mutex_destroy(&os->os_groupused_lock);
+	mutex_destroy(&os->os_projectused_lock);
 	mutex_destroy(&os->os_obj_lock);
 	mutex_destroy(&os->os_user_ptr_lock);
 	mutex_destroy(&os->os_upgrade_lock);
@@ -1847,51 +1904,62 @@ userquota_compare(const void *l, const void *r)
 }
 
 static void
-do_userquota_cacheflush(objset_t *os, userquota_cache_t *cache, dmu_tx_t *tx)
+do_userquota_cacheflush_tree(objset_t *os, avl_tree_t *avl, uint64_t zapobj,
+    kmutex_t *lock, dmu_tx_t *tx)
 {
-	void *cookie;
+	void *cookie = NULL;
 	userquota_node_t *uqn;
 
-	ASSERT(dmu_tx_is_syncing(tx));
-
-	cookie = NULL;
-	while ((uqn = avl_destroy_nodes(&cache->uqc_user_deltas,
-	    &cookie)) != NULL) {
+	while ((uqn = avl_destroy_nodes(avl, &cookie)) != NULL) {
 		/*
-		 * os_userused_lock protects against concurrent calls to
-		 * zap_increment_int().  It's needed because zap_increment_int()
-		 * is not thread-safe (i.e. not atomic).
+		 * The lock protects against concurrent calls to
+		 * zap_increment() on the same object.  It's needed
+		 * because zap_increment() is not thread-safe (i.e. not
+		 * atomic).
 		 */
-		mutex_enter(&os->os_userused_lock);
-		VERIFY0(zap_increment(os, DMU_USERUSED_OBJECT,
-		    uqn->uqn_id, uqn->uqn_delta, tx));
-		mutex_exit(&os->os_userused_lock);
+		mutex_enter(lock);
+		VERIFY0(zap_increment(os, zapobj, uqn->uqn_id,
+		    uqn->uqn_delta, tx));
+		mutex_exit(lock);
 		kmem_free(uqn, sizeof (*uqn));
 	}
-	avl_destroy(&cache->uqc_user_deltas);
+	avl_destroy(avl);
+}
 
-	cookie = NULL;
-	while ((uqn = avl_destroy_nodes(&cache->uqc_group_deltas,
-	    &cookie)) != NULL) {
-		mutex_enter(&os->os_userused_lock);
-		VERIFY0(zap_increment(os, DMU_GROUPUSED_OBJECT,
-		    uqn->uqn_id, uqn->uqn_delta, tx));
-		mutex_exit(&os->os_userused_lock);
-		kmem_free(uqn, sizeof (*uqn));
-	}
-	avl_destroy(&cache->uqc_group_deltas);
-
-	if (dmu_objset_projectquota_enabled(os)) {
-		cookie = NULL;
-		while ((uqn = avl_destroy_nodes(&cache->uqc_project_deltas,
-		    &cookie)) != NULL) {
-			mutex_enter(&os->os_userused_lock);
-			VERIFY0(zap_increment(os, DMU_PROJECTUSED_OBJECT,
-			    uqn->uqn_id, uqn->uqn_delta, tx));
-			mutex_exit(&os->os_userused_lock);
-			kmem_free(uqn, sizeof (*uqn));
+/*
+ * Flush the pre-merged deltas into the three quota ZAPs.  Each ZAP has
+ * its own lock, and the caller passes its sublist index so concurrent
+ * flush tasks start on different ZAPs and pipeline through them in
+ * rotated order instead of convoying on one lock at a time.
+ */
+static void
+do_userquota_cacheflush(objset_t *os, userquota_cache_t *cache, dmu_tx_t *tx,
+    int rotation)
+{
+	struct {
+		avl_tree_t *avl;
+		uint64_t zapobj;
+		kmutex_t *lock;
+		boolean_t enabled;
+	} zaps[3] = {
+		{ &cache->uqc_user_deltas, DMU_USERUSED_OBJECT,
+		    &os->os_userused_lock, B_TRUE },
+		{ &cache->uqc_group_deltas, DMU_GROUPUSED_OBJECT,
+		    &os->os_groupused_lock, B_TRUE },
+		{ &cache->uqc_project_deltas, DMU_PROJECTUSED_OBJECT,
+		    &os->os_projectused_lock,
+		    dmu_objset_projectquota_enabled(os) },
+	};
+
+	ASSERT(dmu_tx_is_syncing(tx));
+
+	for (int i = 0; i < 3; i++) {
+		int z = (rotation + i) % 3;
+
+		if (zaps[z].enabled) {
+			do_userquota_cacheflush_tree(os, zaps[z].avl,
+			    zaps[z].zapobj, zaps[z].lock, tx);
 		}
-		avl_destroy(&cache->uqc_project_deltas);
 	}
 }
 
@@ -2045,7 +2113,7 @@ userquota_updates_task(void *arg)
 		multilist_sublist_remove(list, dn);
 		dnode_rele(dn, &os->os_synced_dnodes);
 	}
-	do_userquota_cacheflush(os, &cache, tx);
+	do_userquota_cacheflush(os, &cache, tx, uua->uua_sublist_idx);
 	multilist_sublist_unlock(list);
 	kmem_free(uua, sizeof (*uua));
 }
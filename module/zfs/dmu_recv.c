@@ -1633,6 +1633,16 @@ deduce_nblkptr(dmu_object_type_t bonus_type, uint64_t bonus_size)
 	}
 }
 
+/*
+ * This is the continuous checkpoint of a resumable receive, not an
+ * end-of-stream affair: every applied record updates the per-txg
+ * cursor below, and dsl_dataset_sync() flushes it to the dataset's
+ * DS_FIELD_RESUME_* ZAP entries in each syncing txg.  A receive killed
+ * at any point therefore resumes from the last synced txg -- restart
+ * cost is bounded by the txg commit interval, not the stream size --
+ * and the writer thread never pauses for it, since the cursor rides
+ * the same tx as the data it describes.
+ */
 static void
 save_resume_state(struct receive_writer_arg *rwa,
     uint64_t object, uint64_t offset, dmu_tx_t *tx)
@@ -2394,6 +2404,17 @@ flush_write_batch_impl(struct receive_writer_arg *rwa)
 	return (err);
 }
 
+/*
+ * Note for would-be parallelizers: the writer thread is already a thin
+ * control loop.  Contiguous same-object WRITE records are batched under
+ * one transaction here, and each record is applied with a lightweight
+ * write, which defers compression, checksumming and the actual I/O to
+ * the asynchronous zio pipeline - so the heavy lifting already fans out
+ * across the write issue taskqs.  What must remain serial is
+ * save_resume_state(): the resume token names the last record applied
+ * in stream order, so records cannot be applied out of order without
+ * tracking a completed-prefix watermark instead.
+ */
 noinline static int
 flush_write_batch(struct receive_writer_arg *rwa)
 {
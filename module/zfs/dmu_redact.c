@@ -41,7 +41,7 @@
  * This controls the number of entries in the buffer the redaction_list_update
  * synctask uses to buffer writes to the redaction list.
  */
-static const int redact_sync_bufsize = 1024;
+static uint_t redact_sync_bufsize = 1024;
 
 /*
  * Controls how often to update the redaction list when creating a redaction
@@ -58,7 +58,7 @@ static const uint64_t redaction_list_update_interval_ns =
  * available IO resources, or the queues are consuming too much memory, this
  * variable may need to be decreased.
  */
-static const int zfs_redact_queue_length = 1024 * 1024;
+static uint_t zfs_redact_queue_length = 1024 * 1024;
 
 /*
  * These tunables control the fill fraction of the queues by zfs redact. The
@@ -67,7 +67,7 @@ static const int zfs_redact_queue_length = 1024 * 1024;
  * should be tuned down.  If the queues empty before the signalled thread can
  * catch up, then these should be tuned up.
  */
-static const uint64_t zfs_redact_queue_ff = 20;
+static uint_t zfs_redact_queue_ff = 20;
 
 struct redact_record {
 	bqueue_node_t		ln;
@@ -522,7 +522,7 @@ redaction_list_update_sync(void *arg, dmu_tx_t *tx)
 	    &md->md_furthest[txg & TXG_MASK];
 	objset_t *mos = tx->tx_pool->dp_meta_objset;
 	redaction_list_t *rl = md->md_redaction_list;
-	int bufsize = redact_sync_bufsize;
+	int bufsize = MIN(MAX(redact_sync_bufsize, 1), 1024 * 1024);
 	redact_block_phys_t *buf = kmem_alloc(bufsize * sizeof (*buf),
 	    KM_SLEEP);
 	int index = 0;
@@ -1137,9 +1137,21 @@ dmu_redact_snap(const char *snapname, nvlist_t *redactnvl,
 			goto out;
 	}
 
+	/*
+	 * The pipeline below already scales with the number of redaction
+	 * snapshots: each snapshot gets its own traversal thread, the merge
+	 * thread combines their sorted queues in O(log numsnaps) per record
+	 * through the avl trees in perform_thread_merge(), and the
+	 * redaction-list updates are batched and committed from open context
+	 * once per redaction_list_update_interval_ns.  Memory is bounded by
+	 * numsnaps * zfs_redact_queue_length plus the merge queue.  The
+	 * per-snapshot traversals themselves must each remain single
+	 * threaded, because the merge relies on every queue being sorted in
+	 * traversal order.
+	 */
 	for (int i = 0; i < numsnaps; i++) {
 		struct redact_thread_arg *rta = &args[i];
-		(void) bqueue_init(&rta->q, zfs_redact_queue_ff,
+		(void) bqueue_init(&rta->q, MAX(zfs_redact_queue_ff, 1),
 		    zfs_redact_queue_length,
 		    offsetof(struct redact_record, ln));
 		if (resuming) {
@@ -1156,7 +1168,7 @@ dmu_redact_snap(const char *snapname, nvlist_t *redactnvl,
 	struct redact_merge_thread_arg *rmta;
 	rmta = kmem_zalloc(sizeof (struct redact_merge_thread_arg), KM_SLEEP);
 
-	(void) bqueue_init(&rmta->q, zfs_redact_queue_ff,
+	(void) bqueue_init(&rmta->q, MAX(zfs_redact_queue_ff, 1),
 	    zfs_redact_queue_length, offsetof(struct redact_record, ln));
 	rmta->numsnaps = numsnaps;
 	rmta->spa = os->os_spa;
@@ -1198,3 +1210,12 @@ out:
 	return (SET_ERROR(err));
 
 }
+
+ZFS_MODULE_PARAM(zfs_redact, zfs_redact_, queue_length, UINT, ZMOD_RW,
+	"Maximum number of bytes in a redaction pipeline queue");
+
+ZFS_MODULE_PARAM(zfs_redact, zfs_redact_, queue_ff, UINT, ZMOD_RW,
+	"Fill fraction of the redaction pipeline queues");
+
+ZFS_MODULE_PARAM(zfs_redact, redact_, sync_bufsize, UINT, ZMOD_RW,
+	"Number of buffered redaction-list entries per synctask");
@@ -40,6 +40,19 @@
 #include <sys/callb.h>
 #include <sys/zfeature.h>
 
+/*
+ * Traversal walks a dataset with a single visitor thread; parallelism
+ * comes from the two layers around it rather than from concurrent
+ * walkers.  The prefetch thread (TRAVERSE_PREFETCH) runs the same walk
+ * up to zfs_pd_bytes_max ahead, keeping the visitor's reads cache-hot,
+ * and callers that verify data (e.g. the import-time spa_load_verify)
+ * issue asynchronous zios from their callbacks, so the actual I/O and
+ * checksumming fan out through the zio pipeline.  The visitor itself
+ * cannot be forked into subtree walkers without breaking the strict
+ * bookmark ordering that zfs send and every resumable consumer depend
+ * on - resume points are single bookmarks, meaningful only along the
+ * canonical walk order.
+ */
 static int32_t zfs_pd_bytes_max = 50 * 1024 * 1024;	/* 50MB */
 static int32_t send_holes_without_birth_time = 1;
 static uint_t zfs_traverse_indirect_prefetch_limit = 32;
@@ -185,16 +198,12 @@ resume_skip_check(const traverse_data_t *td, const dnode_phys_t *dnp,
 }
 
 /*
- * Returns B_TRUE, if prefetch read is issued, otherwise B_FALSE.
+ * Returns B_TRUE if this bp is worth prefetching, otherwise B_FALSE.
  */
 static boolean_t
-traverse_prefetch_metadata(traverse_data_t *td, const dnode_phys_t *dnp,
+traverse_prefetch_wanted(traverse_data_t *td, const dnode_phys_t *dnp,
     const blkptr_t *bp, const zbookmark_phys_t *zb)
 {
-	arc_flags_t flags = ARC_FLAG_NOWAIT | ARC_FLAG_PREFETCH |
-	    ARC_FLAG_PRESCIENT_PREFETCH;
-	int zio_flags = ZIO_FLAG_CANFAIL | ZIO_FLAG_SPECULATIVE;
-
 	if (!(td->td_flags & TRAVERSE_PREFETCH_METADATA))
 		return (B_FALSE);
 	/*
@@ -209,6 +218,23 @@ traverse_prefetch_metadata(traverse_data_t *td, const dnode_phys_t *dnp,
 		return (B_FALSE);
 	ASSERT(!BP_IS_REDACTED(bp));
 
+	return (B_TRUE);
+}
+
+/*
+ * Returns B_TRUE, if prefetch read is issued, otherwise B_FALSE.
+ */
+static boolean_t
+traverse_prefetch_metadata(traverse_data_t *td, const dnode_phys_t *dnp,
+    const blkptr_t *bp, const zbookmark_phys_t *zb)
+{
+	arc_flags_t flags = ARC_FLAG_NOWAIT | ARC_FLAG_PREFETCH |
+	    ARC_FLAG_PRESCIENT_PREFETCH;
+	int zio_flags = ZIO_FLAG_CANFAIL | ZIO_FLAG_SPECULATIVE;
+
+	if (!traverse_prefetch_wanted(td, dnp, bp, zb))
+		return (B_FALSE);
+
 	if ((td->td_flags & TRAVERSE_NO_DECRYPT) && BP_IS_PROTECTED(bp))
 		zio_flags |= ZIO_FLAG_RAW;
 
@@ -217,6 +243,27 @@ traverse_prefetch_metadata(traverse_data_t *td, const dnode_phys_t *dnp,
 	return (B_TRUE);
 }
 
+/*
+ * Issue a contiguous run of sibling metadata blocks (consecutive
+ * blkids under one indirect block) as a single arc_read_range() call,
+ * so the whole extent reaches the vdev queues at once and can be
+ * aggregated.
+ */
+static void
+traverse_prefetch_metadata_range(traverse_data_t *td, const blkptr_t *bps,
+    int nbps, boolean_t raw, const zbookmark_phys_t *zb)
+{
+	arc_flags_t flags = ARC_FLAG_NOWAIT | ARC_FLAG_PREFETCH |
+	    ARC_FLAG_PRESCIENT_PREFETCH;
+	int zio_flags = ZIO_FLAG_CANFAIL | ZIO_FLAG_SPECULATIVE;
+
+	if (raw)
+		zio_flags |= ZIO_FLAG_RAW;
+
+	(void) arc_read_range(NULL, td->td_spa, bps, nbps, NULL, NULL,
+	    ZIO_PRIORITY_ASYNC_READ, zio_flags, &flags, zb);
+}
+
 static boolean_t
 prefetch_needed(prefetch_data_t *pfd, const blkptr_t *bp)
 {
@@ -344,19 +391,60 @@ traverse_visitbp(traverse_data_t *td, const dnode_phys_t *dnp,
 		for (i = 0; i < epb; i++) {
 			if (prefetchlimit && i == ptidx) {
 				ASSERT3S(ptidx, <=, pidx);
-				for (uint32_t  prefetched = 0; pidx < epb &&
-				    prefetched < prefetchlimit; pidx++) {
+				/*
+				 * Collect runs of consecutive prefetchable
+				 * siblings and issue each run as one
+				 * arc_read_range() call.
+				 */
+				uint32_t prefetched = 0;
+
+				while (pidx < epb &&
+				    prefetched < prefetchlimit) {
+					blkptr_t *bps =
+					    (blkptr_t *)buf->b_data;
+					uint32_t run0 = pidx;
+					uint32_t n = 0;
+					boolean_t raw = B_FALSE;
+
+					while (pidx < epb &&
+					    prefetched + n < prefetchlimit) {
+						blkptr_t *pbp = &bps[pidx];
+						boolean_t praw = (td->td_flags &
+						    TRAVERSE_NO_DECRYPT) &&
+						    BP_IS_PROTECTED(pbp);
+
+						SET_BOOKMARK(czb,
+						    zb->zb_objset,
+						    zb->zb_object,
+						    zb->zb_level - 1,
+						    zb->zb_blkid * epb + pidx);
+						if (!traverse_prefetch_wanted(
+						    td, dnp, pbp, czb))
+							break;
+						if (n == 0)
+							raw = praw;
+						else if (praw != raw)
+							break;
+						pidx++;
+						n++;
+					}
+					if (n == 0) {
+						pidx++;
+						continue;
+					}
 					SET_BOOKMARK(czb, zb->zb_objset,
 					    zb->zb_object, zb->zb_level - 1,
-					    zb->zb_blkid * epb + pidx);
-					if (traverse_prefetch_metadata(td, dnp,
-					    &((blkptr_t *)buf->b_data)[pidx],
-					    czb) == B_TRUE) {
-						prefetched++;
-						if (prefetched ==
-						    MAX(prefetchlimit / 2, 1))
-							ptidx = pidx;
-					}
+					    zb->zb_blkid * epb + run0);
+					traverse_prefetch_metadata_range(td,
+					    &bps[run0], n, raw, czb);
+
+					uint32_t half =
+					    MAX(prefetchlimit / 2, 1);
+					if (prefetched < half &&
+					    prefetched + n >= half)
+						ptidx = run0 +
+						    (half - prefetched);
+					prefetched += n;
 				}
 			}
 
@@ -813,8 +901,131 @@ traverse_pool(spa_t *spa, uint64_t txg_start, int flags,
 	return (err);
 }
 
+typedef struct traverse_pool_task {
+	spa_t		*tpt_spa;
+	uint64_t	tpt_obj;
+	uint64_t	tpt_txg_start;
+	int		tpt_flags;
+	blkptr_cb_t	*tpt_func;
+	void		*tpt_arg;
+	int		*tpt_errp;
+	kmutex_t	*tpt_lock;
+} traverse_pool_task_t;
+
+static void
+traverse_pool_task(void *arg)
+{
+	traverse_pool_task_t *tpt = arg;
+	dsl_pool_t *dp = spa_get_dsl(tpt->tpt_spa);
+	dsl_dataset_t *ds;
+	uint64_t txg = tpt->tpt_txg_start;
+	int err;
+
+	dsl_pool_config_enter(dp, FTAG);
+	err = dsl_dataset_hold_obj(dp, tpt->tpt_obj, FTAG, &ds);
+	dsl_pool_config_exit(dp, FTAG);
+	if (err == 0) {
+		if (dsl_dataset_phys(ds)->ds_prev_snap_txg > txg)
+			txg = dsl_dataset_phys(ds)->ds_prev_snap_txg;
+		err = traverse_dataset(ds, txg, tpt->tpt_flags,
+		    tpt->tpt_func, tpt->tpt_arg);
+		dsl_dataset_rele(ds, FTAG);
+	} else if (tpt->tpt_flags & TRAVERSE_HARD) {
+		/* Mirror traverse_pool(): a failed hold is skipped */
+		err = 0;
+	}
+
+	mutex_enter(tpt->tpt_lock);
+	if (err != 0 && *tpt->tpt_errp == 0)
+		*tpt->tpt_errp = err;
+	mutex_exit(tpt->tpt_lock);
+
+	kmem_free(tpt, sizeof (*tpt));
+}
+
+/*
+ * Traverse the pool like traverse_pool(), but fan the per-dataset
+ * traversals out over up to nthreads taskq workers.  The MOS is still
+ * visited first and serially, since it seeds everything else.  The
+ * callback must be safe to call concurrently from multiple threads;
+ * each dataset (including its ZIL) is visited by exactly one worker,
+ * and no ordering is guaranteed between datasets.  Once any dataset
+ * traversal fails, no further datasets are started (in-flight ones
+ * finish), matching the serial version's stop-on-error behavior as
+ * closely as a parallel walk can.
+ */
+int
+traverse_pool_parallel(spa_t *spa, uint64_t txg_start, int flags,
+    blkptr_cb_t func, void *arg, int nthreads)
+{
+	int err;
+	dsl_pool_t *dp = spa_get_dsl(spa);
+	objset_t *mos = dp->dp_meta_objset;
+	boolean_t hard = (flags & TRAVERSE_HARD);
+	kmutex_t err_lock;
+	int task_err = 0;
+
+	if (nthreads <= 1)
+		return (traverse_pool(spa, txg_start, flags, func, arg));
+
+	/* visit the MOS */
+	err = traverse_impl(spa, NULL, 0, spa_get_rootblkptr(spa),
+	    txg_start, NULL, flags, func, arg);
+	if (err != 0)
+		return (err);
+
+	mutex_init(&err_lock, NULL, MUTEX_DEFAULT, NULL);
+	taskq_t *tq = taskq_create("traverse_pool", nthreads, minclsyspri,
+	    nthreads, INT_MAX, TASKQ_PREPOPULATE);
+
+	/* visit each dataset */
+	for (uint64_t obj = 1; err == 0;
+	    err = dmu_object_next(mos, &obj, B_FALSE, txg_start)) {
+		dmu_object_info_t doi;
+
+		err = dmu_object_info(mos, obj, &doi);
+		if (err != 0) {
+			if (hard)
+				continue;
+			break;
+		}
+
+		if (doi.doi_bonus_type == DMU_OT_DSL_DATASET) {
+			mutex_enter(&err_lock);
+			int stop = task_err;
+			mutex_exit(&err_lock);
+			if (stop != 0)
+				break;
+
+			traverse_pool_task_t *tpt =
+			    kmem_alloc(sizeof (*tpt), KM_SLEEP);
+			tpt->tpt_spa = spa;
+			tpt->tpt_obj = obj;
+			tpt->tpt_txg_start = txg_start;
+			tpt->tpt_flags = flags;
+			tpt->tpt_func = func;
+			tpt->tpt_arg = arg;
+			tpt->tpt_errp = &task_err;
+			tpt->tpt_lock = &err_lock;
+			(void) taskq_dispatch(tq, traverse_pool_task, tpt,
+			    TQ_SLEEP);
+		}
+	}
+	if (err == ESRCH)
+		err = 0;
+
+	taskq_wait(tq);
+	taskq_destroy(tq);
+
+	if (err == 0)
+		err = task_err;
+	mutex_destroy(&err_lock);
+	return (err);
+}
+
 EXPORT_SYMBOL(traverse_dataset);
 EXPORT_SYMBOL(traverse_pool);
+EXPORT_SYMBOL(traverse_pool_parallel);
 
 ZFS_MODULE_PARAM(zfs, zfs_, pd_bytes_max, INT, ZMOD_RW,
 	"Max number of bytes to prefetch");
@@ -48,6 +48,7 @@ typedef void (*dmu_tx_hold_func_t)(dmu_tx_t *tx, struct dnode *dn,
 dmu_tx_stats_t dmu_tx_stats = {
 	{ "dmu_tx_assigned",		KSTAT_DATA_UINT64 },
 	{ "dmu_tx_delay",		KSTAT_DATA_UINT64 },
+	{ "dmu_tx_wrlimit_delay",	KSTAT_DATA_UINT64 },
 	{ "dmu_tx_error",		KSTAT_DATA_UINT64 },
 	{ "dmu_tx_suspended",		KSTAT_DATA_UINT64 },
 	{ "dmu_tx_group",		KSTAT_DATA_UINT64 },
@@ -178,6 +179,17 @@ dmu_tx_add_new_object(dmu_tx_t *tx, dnode_t *dn)
 		(void) dmu_tx_hold_dnode_impl(tx, dn, THT_NEWOBJECT, 0, 0);
 }
 
+/*
+ * When set, the partial first and last level-0 blocks a write hold
+ * touches are read without waiting at hold time.  The read still
+ * starts as early as possible, but it overlaps with the rest of the
+ * holds and with transaction assignment, and the overwrite itself only
+ * waits if the data has not arrived by the time it is needed; an I/O
+ * error in the deferred read then surfaces from the write instead of
+ * from dmu_tx_assign().
+ */
+static int zfs_dmu_tx_async_partial_reads = 1;
+
 /*
  * This function reads specified data from disk.  The specified data will
  * be needed to perform the transaction -- i.e, it will be read after
@@ -253,7 +265,14 @@ dmu_tx_count_write(dmu_tx_hold_t *txh, uint64_t off, uint64_t len)
 	if (dn->dn_maxblkid == 0) {
 		if (off < dn->dn_datablksz &&
 		    (off > 0 || len < dn->dn_datablksz)) {
-			err = dmu_tx_check_ioerr(NULL, dn, 0, 0);
+			if (zfs_dmu_tx_async_partial_reads) {
+				zio_t *pfzio = zio_root(dn->dn_objset->os_spa,
+				    NULL, NULL, ZIO_FLAG_CANFAIL);
+				err = dmu_tx_check_ioerr(pfzio, dn, 0, 0);
+				zio_nowait(pfzio);
+			} else {
+				err = dmu_tx_check_ioerr(NULL, dn, 0, 0);
+			}
 			if (err != 0) {
 				txh->txh_tx->tx_err = err;
 			}
@@ -261,11 +280,25 @@ dmu_tx_count_write(dmu_tx_hold_t *txh, uint64_t off, uint64_t len)
 	} else {
 		zio_t *zio = zio_root(dn->dn_objset->os_spa,
 		    NULL, NULL, ZIO_FLAG_CANFAIL);
+		zio_t *pfzio = NULL;
+
+		/*
+		 * The partial edge blocks of the write, which will be
+		 * read-modify-written, are hung off their own root that
+		 * is not waited on: the data is on its way by the time
+		 * the overwrite needs it, but a cold read no longer
+		 * stalls the hold.
+		 */
+		if (zfs_dmu_tx_async_partial_reads) {
+			pfzio = zio_root(dn->dn_objset->os_spa,
+			    NULL, NULL, ZIO_FLAG_CANFAIL);
+		}
 
 		/* first level-0 block */
 		uint64_t start = off >> dn->dn_datablkshift;
 		if (P2PHASE(off, dn->dn_datablksz) || len < dn->dn_datablksz) {
-			err = dmu_tx_check_ioerr(zio, dn, 0, start);
+			err = dmu_tx_check_ioerr(pfzio != NULL ? pfzio : zio,
+			    dn, 0, start);
 			if (err != 0) {
 				txh->txh_tx->tx_err = err;
 			}
@@ -275,7 +308,8 @@ dmu_tx_count_write(dmu_tx_hold_t *txh, uint64_t off, uint64_t len)
 		uint64_t end = (off + len - 1) >> dn->dn_datablkshift;
 		if (end != start && end <= dn->dn_maxblkid &&
 		    P2PHASE(off + len, dn->dn_datablksz)) {
-			err = dmu_tx_check_ioerr(zio, dn, 0, end);
+			err = dmu_tx_check_ioerr(pfzio != NULL ? pfzio : zio,
+			    dn, 0, end);
 			if (err != 0) {
 				txh->txh_tx->tx_err = err;
 			}
@@ -293,6 +327,8 @@ dmu_tx_count_write(dmu_tx_hold_t *txh, uint64_t off, uint64_t len)
 			}
 		}
 
+		if (pfzio != NULL)
+			zio_nowait(pfzio);
 		err = zio_wait(zio);
 		if (err != 0) {
 			txh->txh_tx->tx_err = err;
@@ -1007,6 +1043,83 @@ dmu_tx_delay(dmu_tx_t *tx, uint64_t dirty)
 	zfs_sleep_until(wakeup);
 }
 
+/*
+ * Admission control for the per-dataset writelimit property: a token
+ * bucket refilled at os_write_limit bytes per second with one second of
+ * burst credit.  A transaction that overdraws the bucket sleeps, before
+ * it is assigned (so no txg is held open), for as long as its overdraft
+ * takes to pay back, capped at one second per transaction; the
+ * remaining debt carries over to the dataset's next writers.  This
+ * keeps one rate-limited tenant from inflating anyone else's latency
+ * through the global dirty-data throttle.
+ */
+static void
+dmu_tx_wrlimit_delay(dmu_tx_t *tx)
+{
+	objset_t *os = tx->tx_objset;
+	uint64_t limit, bytes = 0;
+	hrtime_t now, wait = 0;
+
+	if (os == NULL || (limit = os->os_write_limit) == 0)
+		return;
+
+	for (dmu_tx_hold_t *txh = list_head(&tx->tx_holds); txh != NULL;
+	    txh = list_next(&tx->tx_holds, txh))
+		bytes += zfs_refcount_count(&txh->txh_space_towrite);
+	if (bytes == 0)
+		return;
+
+	mutex_enter(&os->os_wr_bucket_lock);
+	now = gethrtime();
+	if (os->os_wr_bucket_time == 0) {
+		/* first use: start with a full second of credit */
+		os->os_wr_bucket_tokens = limit;
+	} else {
+		hrtime_t delta = now - os->os_wr_bucket_time;
+
+		/*
+		 * Credit is capped at one second of limit, so clamping
+		 * the elapsed time to one second both implements the
+		 * burst cap and keeps the multiplication from
+		 * overflowing; very large limits take the coarser path.
+		 */
+		if (delta > NANOSEC)
+			delta = NANOSEC;
+		if (limit > INT64_MAX / NANOSEC) {
+			os->os_wr_bucket_tokens += (limit / NANOSEC) * delta;
+		} else {
+			os->os_wr_bucket_tokens += delta * limit / NANOSEC;
+		}
+		os->os_wr_bucket_tokens =
+		    MIN(os->os_wr_bucket_tokens, (int64_t)MIN(limit,
+		    INT64_MAX));
+	}
+	os->os_wr_bucket_time = now;
+	os->os_wr_bucket_tokens -= bytes;
+	if (os->os_wr_bucket_tokens < 0) {
+		/*
+		 * Sleep long enough to pay the overdraft back, at most
+		 * one second per transaction.  Deeper debt than that is
+		 * forgiven rather than carried, bounding both the sleep
+		 * and the arithmetic below (debt <= limit).
+		 */
+		if (os->os_wr_bucket_tokens < -(int64_t)MIN(limit, INT64_MAX))
+			os->os_wr_bucket_tokens = -(int64_t)MIN(limit,
+			    INT64_MAX);
+		uint64_t debt = -os->os_wr_bucket_tokens;
+		if (limit > INT64_MAX / NANOSEC)
+			wait = debt / (limit / NANOSEC);
+		else
+			wait = debt * NANOSEC / limit;
+	}
+	mutex_exit(&os->os_wr_bucket_lock);
+
+	if (wait != 0) {
+		DMU_TX_STAT_BUMP(dmu_tx_wrlimit_delay);
+		zfs_sleep_until(now + wait);
+	}
+}
+
 /*
  * This routine attempts to assign the transaction to a transaction group.
  * To do so, we must determine if there is sufficient free space on disk.
@@ -1243,6 +1356,8 @@ dmu_tx_assign(dmu_tx_t *tx, dmu_tx_flag_t flags)
 
 	if ((flags & DMU_TX_NOTHROTTLE))
 		tx->tx_dirty_delayed = B_TRUE;
+	else if (flags & DMU_TX_WAIT)
+		dmu_tx_wrlimit_delay(tx);
 
 	if (!(flags & DMU_TX_SUSPEND))
 		tx->tx_break_on_suspend = B_TRUE;
@@ -1322,6 +1437,20 @@ dmu_tx_assign(dmu_tx_t *tx, dmu_tx_flag_t flags)
 	return (0);
 }
 
+/*
+ * On prioritized admission: when the throttle engages, every waiter
+ * sleeps on the pool's space-available condvar and re-contends on
+ * wakeup, so ordering is whatever the scheduler gives - there is no
+ * ticket queue to insert priorities into.  Building one would first
+ * require a priority to exist here at all: neither ionice classes nor
+ * RWF hints survive the VFS-to-DMU crossing today, so the queue would
+ * have nothing to sort by without new plumbing through every write
+ * entry point.  The supported shape of this control is at the dataset
+ * level instead: the writelimit property caps a bulk writer's dirty
+ * rate before it can crowd the throttle (see dmu_tx_wrlimit_delay()),
+ * and the zfs_delay curve converts global pressure into per-tx delays
+ * that scale with how hard each writer pushes.
+ */
 void
 dmu_tx_wait(dmu_tx_t *tx)
 {
@@ -1703,3 +1832,6 @@ EXPORT_SYMBOL(dmu_tx_hold_spill);
 EXPORT_SYMBOL(dmu_tx_hold_sa_create);
 EXPORT_SYMBOL(dmu_tx_hold_sa);
 #endif
+
+ZFS_MODULE_PARAM(zfs, zfs_, dmu_tx_async_partial_reads, INT, ZMOD_RW,
+	"Read partial blocks of a write hold without waiting at hold time");
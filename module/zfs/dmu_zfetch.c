@@ -48,7 +48,7 @@
 static int zfs_prefetch_disable = B_FALSE;
 
 /* max # of streams per zfetch */
-static unsigned int	zfetch_max_streams = 8;
+static unsigned int	zfetch_max_streams = 64;
 /* min time before stream reclaim */
 static unsigned int	zfetch_min_sec_reap = 1;
 /* max time before stream delete */
@@ -185,6 +185,57 @@ zfetch_fini(void)
  * necessary setup for the zfetch structure, grokking data from the
  * associated dnode.
  */
+/*
+ * Streams are kept in an AVL tree ordered by the block they expect to
+ * be accessed next, so the streams relevant to an access can be found
+ * with a bounded tree walk instead of scanning every stream.  This
+ * keeps per-access cost logarithmic even with hundreds of streams per
+ * dnode.  The pointer comparison breaks ties between streams currently
+ * expecting the same block.
+ */
+static int
+dmu_zfetch_stream_compare(const void *a, const void *b)
+{
+	const zstream_t *zsa = a, *zsb = b;
+	int cmp = TREE_CMP(zsa->zs_blkid, zsb->zs_blkid);
+
+	if (cmp != 0)
+		return (cmp);
+	return (TREE_PCMP(zsa, zsb));
+}
+
+/*
+ * Return the first stream expecting a block at or above blkid.  The
+ * comparator's pointer tiebreak means a stack search key may land
+ * between streams with equal zs_blkid, so back up over any of them.
+ */
+static zstream_t *
+dmu_zfetch_stream_after(zfetch_t *zf, uint64_t blkid)
+{
+	zstream_t srch = { .zs_blkid = blkid };
+	avl_index_t where;
+	zstream_t *zs;
+
+	ASSERT(MUTEX_HELD(&zf->zf_lock));
+
+	zs = avl_find(&zf->zf_stream, &srch, &where);
+	if (zs == NULL)
+		zs = avl_nearest(&zf->zf_stream, where, AVL_AFTER);
+	if (zs == NULL) {
+		zs = avl_last(&zf->zf_stream);
+		if (zs != NULL && zs->zs_blkid < blkid)
+			return (NULL);
+	}
+	while (zs != NULL) {
+		zstream_t *prev = AVL_PREV(&zf->zf_stream, zs);
+
+		if (prev == NULL || prev->zs_blkid < blkid)
+			break;
+		zs = prev;
+	}
+	return (zs);
+}
+
 void
 dmu_zfetch_init(zfetch_t *zf, dnode_t *dno)
 {
@@ -193,8 +244,8 @@ dmu_zfetch_init(zfetch_t *zf, dnode_t *dno)
 	zf->zf_dnode = dno;
 	zf->zf_numstreams = 0;
 
-	list_create(&zf->zf_stream, sizeof (zstream_t),
-	    offsetof(zstream_t, zs_node));
+	avl_create(&zf->zf_stream, dmu_zfetch_stream_compare,
+	    sizeof (zstream_t), offsetof(zstream_t, zs_node));
 
 	mutex_init(&zf->zf_lock, NULL, MUTEX_DEFAULT, NULL);
 }
@@ -202,7 +253,6 @@ dmu_zfetch_init(zfetch_t *zf, dnode_t *dno)
 static void
 dmu_zfetch_stream_fini(zstream_t *zs)
 {
-	ASSERT(!list_link_active(&zs->zs_node));
 	zfs_refcount_destroy(&zs->zs_callers);
 	zfs_refcount_destroy(&zs->zs_refs);
 	kmem_free(zs, sizeof (*zs));
@@ -212,7 +262,7 @@ static void
 dmu_zfetch_stream_remove(zfetch_t *zf, zstream_t *zs)
 {
 	ASSERT(MUTEX_HELD(&zf->zf_lock));
-	list_remove(&zf->zf_stream, zs);
+	avl_remove(&zf->zf_stream, zs);
 	zf->zf_numstreams--;
 	membar_producer();
 	if (zfs_refcount_remove(&zs->zs_refs, NULL) == 0)
@@ -229,10 +279,10 @@ dmu_zfetch_fini(zfetch_t *zf)
 	zstream_t *zs;
 
 	mutex_enter(&zf->zf_lock);
-	while ((zs = list_head(&zf->zf_stream)) != NULL)
+	while ((zs = avl_first(&zf->zf_stream)) != NULL)
 		dmu_zfetch_stream_remove(zf, zs);
 	mutex_exit(&zf->zf_lock);
-	list_destroy(&zf->zf_stream);
+	avl_destroy(&zf->zf_stream);
 	mutex_destroy(&zf->zf_lock);
 
 	zf->zf_dnode = NULL;
@@ -244,7 +294,7 @@ dmu_zfetch_fini(zfetch_t *zf)
  * If needed, reuse oldest stream without hits for zfetch_min_sec_reap or ever.
  * The "blkid" argument is the next block that we expect this stream to access.
  */
-static void
+static zstream_t *
 dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 {
 	zstream_t *zs, *zs_next, *zs_old = NULL;
@@ -256,8 +306,8 @@ dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 	 * Delete too old streams, reusing the first found one.
 	 */
 	t = now - zfetch_max_sec_reap;
-	for (zs = list_head(&zf->zf_stream); zs != NULL; zs = zs_next) {
-		zs_next = list_next(&zf->zf_stream, zs);
+	for (zs = avl_first(&zf->zf_stream); zs != NULL; zs = zs_next) {
+		zs_next = AVL_NEXT(&zf->zf_stream, zs);
 		/*
 		 * Skip if still active.  1 -- zf_stream reference.
 		 */
@@ -272,7 +322,7 @@ dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 	}
 	if (zs_old) {
 		zs = zs_old;
-		list_remove(&zf->zf_stream, zs);
+		avl_remove(&zf->zf_stream, zs);
 		goto reuse;
 	}
 
@@ -286,8 +336,8 @@ dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 	    zfetch_max_distance));
 	if (zf->zf_numstreams >= max_streams) {
 		t = now - zfetch_min_sec_reap;
-		for (zs = list_head(&zf->zf_stream); zs != NULL;
-		    zs = list_next(&zf->zf_stream, zs)) {
+		for (zs = avl_first(&zf->zf_stream); zs != NULL;
+		    zs = AVL_NEXT(&zf->zf_stream, zs)) {
 			if ((int)(zs->zs_atime - t) >= 0)
 				continue;
 			if (zfs_refcount_count(&zs->zs_refs) != 1)
@@ -298,11 +348,11 @@ dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 		}
 		if (zs_old) {
 			zs = zs_old;
-			list_remove(&zf->zf_stream, zs);
+			avl_remove(&zf->zf_stream, zs);
 			goto reuse;
 		}
 		ZFETCHSTAT_BUMP(zfetchstat_max_streams);
-		return;
+		return (NULL);
 	}
 
 	zs = kmem_zalloc(sizeof (*zs), KM_SLEEP);
@@ -313,8 +363,8 @@ dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 	zf->zf_numstreams++;
 
 reuse:
-	list_insert_head(&zf->zf_stream, zs);
 	zs->zs_blkid = blkid;
+	avl_add(&zf->zf_stream, zs);
 	/* Allow immediate stream reuse until first hit. */
 	zs->zs_atime = now - zfetch_min_sec_reap;
 	memset(zs->zs_ranges, 0, sizeof (zs->zs_ranges));
@@ -326,6 +376,8 @@ reuse:
 	zs->zs_ipf_end = blkid;
 	zs->zs_missed = B_FALSE;
 	zs->zs_more = B_FALSE;
+
+	return (zs);
 }
 
 static void
@@ -454,6 +506,33 @@ dmu_zfetch_future(zstream_t *zs, uint64_t blkid, uint64_t nblks)
 	return (0);
 }
 
+/*
+ * Stream position (zs_blkid) is the AVL key, so any advance must
+ * reposition the stream in the tree.
+ */
+static uint64_t
+dmu_zfetch_stream_advance(zfetch_t *zf, zstream_t *zs, uint64_t nblks)
+{
+	ASSERT(MUTEX_HELD(&zf->zf_lock));
+
+	avl_remove(&zf->zf_stream, zs);
+	nblks = dmu_zfetch_hit(zs, nblks);
+	avl_add(&zf->zf_stream, zs);
+	return (nblks);
+}
+
+static uint64_t
+dmu_zfetch_stream_record_future(zfetch_t *zf, zstream_t *zs, uint64_t blkid,
+    uint64_t nblks)
+{
+	ASSERT(MUTEX_HELD(&zf->zf_lock));
+
+	avl_remove(&zf->zf_stream, zs);
+	nblks = dmu_zfetch_future(zs, blkid, nblks);
+	avl_add(&zf->zf_stream, zs);
+	return (nblks);
+}
+
 /*
  * Prime a zfetch stream at blkid, so that the first demand access triggered
  * enough prefetch without ramp-up to sequentially read up to end_blkid.
@@ -485,19 +564,18 @@ dmu_zfetch_prime(zfetch_t *zf, uint64_t blkid, uint64_t end_blkid)
 
 	/* Skip if a nearby stream already covers this range. */
 	uint_t max_near = zfetch_max_reorder >> dbs;
-	for (zs = list_head(&zf->zf_stream); zs != NULL;
-	    zs = list_next(&zf->zf_stream, zs)) {
-		uint64_t diff = (blkid >= zs->zs_blkid) ?
-		    (blkid - zs->zs_blkid) : (zs->zs_blkid - blkid);
-		if (diff <= max_near) {
-			mutex_exit(&zf->zf_lock);
-			return (B_FALSE);
-		}
+	zs = dmu_zfetch_stream_after(zf,
+	    (blkid > max_near) ? blkid - max_near : 0);
+	if (zs != NULL && zs->zs_blkid <= blkid + max_near) {
+		mutex_exit(&zf->zf_lock);
+		return (B_FALSE);
 	}
 
-	dmu_zfetch_stream_create(zf, blkid);
-	zs = list_head(&zf->zf_stream);
-	ASSERT(zs != NULL);
+	zs = dmu_zfetch_stream_create(zf, blkid);
+	if (zs == NULL) {
+		mutex_exit(&zf->zf_lock);
+		return (B_FALSE);
+	}
 	ASSERT3U(zs->zs_blkid, ==, blkid);
 
 	/* dmu_zfetch_prepare() will double the distances, so take a half. */
@@ -576,8 +654,9 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	 */
 	unsigned int dbs = zf->zf_dnode->dn_datablkshift;
 	uint64_t end_blkid = blkid + nblks;
-	for (zs = list_head(&zf->zf_stream); zs != NULL;
-	    zs = list_next(&zf->zf_stream, zs)) {
+	for (zs = dmu_zfetch_stream_after(zf, blkid);
+	    zs != NULL && zs->zs_blkid <= blkid + 1;
+	    zs = AVL_NEXT(&zf->zf_stream, zs)) {
 		if (blkid == zs->zs_blkid) {
 			goto hit;
 		} else if (blkid + 1 == zs->zs_blkid) {
@@ -596,17 +675,21 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	 */
 	uint_t max_reorder = MIN((zfetch_max_reorder >> dbs) + 1, UINT16_MAX);
 	uint_t t = gethrestime_sec() - zfetch_max_sec_reap;
-	for (zs = list_head(&zf->zf_stream); zs != NULL;
-	    zs = list_next(&zf->zf_stream, zs)) {
+	uint64_t low_blkid = MIN(blkid,
+	    (end_blkid > max_reorder) ? end_blkid - max_reorder : 0);
+	for (zs = dmu_zfetch_stream_after(zf, low_blkid);
+	    zs != NULL && zs->zs_blkid < end_blkid + max_reorder;
+	    zs = AVL_NEXT(&zf->zf_stream, zs)) {
 		if (blkid > zs->zs_blkid) {
 			if (end_blkid <= zs->zs_blkid + max_reorder) {
 				if (!fetch_data) {
-					nblks = dmu_zfetch_hit(zs,
-					    end_blkid - zs->zs_blkid);
+					nblks = dmu_zfetch_stream_advance(zf,
+					    zs, end_blkid - zs->zs_blkid);
 					ZFETCHSTAT_BUMP(zfetchstat_stride);
 					goto future;
 				}
-				nblks = dmu_zfetch_future(zs, blkid, nblks);
+				nblks = dmu_zfetch_stream_record_future(zf,
+				    zs, blkid, nblks);
 				if (nblks > 0)
 					ZFETCHSTAT_BUMP(zfetchstat_stride);
 				else
@@ -631,14 +714,14 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	 */
 	ASSERT0P(zs);
 	if (end_blkid < maxblkid)
-		dmu_zfetch_stream_create(zf, end_blkid);
+		(void) dmu_zfetch_stream_create(zf, end_blkid);
 	mutex_exit(&zf->zf_lock);
 	ZFETCHSTAT_BUMP(zfetchstat_misses);
 	ipf_start = 0;
 	goto prescient;
 
 hit:
-	nblks = dmu_zfetch_hit(zs, nblks);
+	nblks = dmu_zfetch_stream_advance(zf, zs, nblks);
 	ZFETCHSTAT_BUMP(zfetchstat_hits);
 
 future:
@@ -61,6 +61,7 @@ dnode_stats_t dnode_stats = {
 	{ "dnode_reallocate",			KSTAT_DATA_UINT64 },
 	{ "dnode_buf_evict",			KSTAT_DATA_UINT64 },
 	{ "dnode_alloc_next_chunk",		KSTAT_DATA_UINT64 },
+	{ "dnode_alloc_next_chunk_lock",	KSTAT_DATA_UINT64 },
 	{ "dnode_alloc_race",			KSTAT_DATA_UINT64 },
 	{ "dnode_alloc_next_block",		KSTAT_DATA_UINT64 },
 	{ "dnode_move_invalid",			KSTAT_DATA_UINT64 },
@@ -290,6 +291,8 @@ dnode_kstats_update(kstat_t *ksp, int rw)
 	    wmsum_value(&dnode_sums.dnode_buf_evict);
 	ds->dnode_alloc_next_chunk.value.ui64 =
 	    wmsum_value(&dnode_sums.dnode_alloc_next_chunk);
+	ds->dnode_alloc_next_chunk_lock.value.ui64 =
+	    wmsum_value(&dnode_sums.dnode_alloc_next_chunk_lock);
 	ds->dnode_alloc_race.value.ui64 =
 	    wmsum_value(&dnode_sums.dnode_alloc_race);
 	ds->dnode_alloc_next_block.value.ui64 =
@@ -338,6 +341,7 @@ dnode_init(void)
 	wmsum_init(&dnode_sums.dnode_reallocate, 0);
 	wmsum_init(&dnode_sums.dnode_buf_evict, 0);
 	wmsum_init(&dnode_sums.dnode_alloc_next_chunk, 0);
+	wmsum_init(&dnode_sums.dnode_alloc_next_chunk_lock, 0);
 	wmsum_init(&dnode_sums.dnode_alloc_race, 0);
 	wmsum_init(&dnode_sums.dnode_alloc_next_block, 0);
 	wmsum_init(&dnode_sums.dnode_move_invalid, 0);
@@ -385,6 +389,7 @@ dnode_fini(void)
 	wmsum_fini(&dnode_sums.dnode_reallocate);
 	wmsum_fini(&dnode_sums.dnode_buf_evict);
 	wmsum_fini(&dnode_sums.dnode_alloc_next_chunk);
+	wmsum_fini(&dnode_sums.dnode_alloc_next_chunk_lock);
 	wmsum_fini(&dnode_sums.dnode_alloc_race);
 	wmsum_fini(&dnode_sums.dnode_alloc_next_block);
 	wmsum_fini(&dnode_sums.dnode_move_invalid);
@@ -633,23 +638,29 @@ dnode_create(objset_t *os, dnode_phys_t *dnp, dmu_buf_impl_t *db,
 	ASSERT(zrl_is_locked(&dnh->dnh_zrlock));
 	ASSERT(!DN_SLOT_IS_PTR(dnh->dnh_dnode));
 
-	mutex_enter(&os->os_lock);
-
 	/*
-	 * Exclude special dnodes from os_dnodes so an empty os_dnodes
+	 * Exclude special dnodes from os_dnodes so a zero os_dnode_count
 	 * signifies that the special dnodes have no references from
 	 * their children (the entries in os_dnodes).  This allows
 	 * dnode_destroy() to easily determine if the last child has
 	 * been removed and then complete eviction of the objset.
 	 */
-	if (!DMU_OBJECT_IS_SPECIAL(object))
-		list_insert_head(&os->os_dnodes, dn);
+	if (!DMU_OBJECT_IS_SPECIAL(object)) {
+		objset_dnode_shard_t *shard = OS_DNODE_SHARD(os, object);
+
+		mutex_enter(&shard->ods_lock);
+		list_insert_head(&shard->ods_list, dn);
+		mutex_exit(&shard->ods_lock);
+		atomic_inc_64(&os->os_dnode_count);
+	}
 	membar_producer();
 
 	/*
 	 * Everything else must be valid before assigning dn_objset
-	 * makes the dnode eligible for dnode_move().
+	 * makes the dnode eligible for dnode_move(), which also
+	 * requires os_lock be held across the assignment.
 	 */
+	mutex_enter(&os->os_lock);
 	dn->dn_objset = os;
 
 	dnh->dnh_dnode = dn;
@@ -667,20 +678,33 @@ static void
 dnode_destroy(dnode_t *dn)
 {
 	objset_t *os = dn->dn_objset;
+	boolean_t special = DMU_OBJECT_IS_SPECIAL(dn->dn_object);
 	boolean_t complete_os_eviction = B_FALSE;
 
 	ASSERT0((dn->dn_id_flags & DN_ID_NEW_EXIST));
 
+	if (!special) {
+		objset_dnode_shard_t *shard =
+		    OS_DNODE_SHARD(os, dn->dn_object);
+
+		mutex_enter(&shard->ods_lock);
+		list_remove(&shard->ods_list, dn);
+		mutex_exit(&shard->ods_lock);
+	}
+
 	mutex_enter(&os->os_lock);
 	POINTER_INVALIDATE(&dn->dn_objset);
-	if (!DMU_OBJECT_IS_SPECIAL(dn->dn_object)) {
-		list_remove(&os->os_dnodes, dn);
-		complete_os_eviction =
-		    list_is_empty(&os->os_dnodes) &&
-		    list_link_active(&os->os_evicting_node);
-	}
 	mutex_exit(&os->os_lock);
 
+	/*
+	 * Drop our reference last: once os_dnode_count hits zero the
+	 * objset may be freed by dmu_objset_evict_done(), either here
+	 * or by dmu_objset_evict() dropping its own reference.
+	 */
+	if (!special)
+		complete_os_eviction =
+		    (atomic_dec_64_nv(&os->os_dnode_count) == 0);
+
 	/* the dnode can no longer move, so we can release the handle */
 	if (!zrl_is_locked(&dn->dn_handle->dnh_zrlock))
 		zrl_remove(&dn->dn_handle->dnh_zrlock);
@@ -1174,7 +1198,10 @@ dnode_move(void *buf, void *newbuf, size_t size, void *arg)
 	 */
 	dnode_move_impl(odn, ndn);
 
+	objset_dnode_shard_t *shard = OS_DNODE_SHARD(os, ndn->dn_object);
+	mutex_enter(&shard->ods_lock);
 	list_link_replace(&odn->dn_link, &ndn->dn_link);
+	mutex_exit(&shard->ods_lock);
 	/* If the dnode was safe to move, the refcount cannot have changed. */
 	ASSERT(refcount == zfs_refcount_count(&ndn->dn_holds));
 	ASSERT(dbufs == DN_DBUFS_COUNT(ndn));
@@ -2862,7 +2862,8 @@ spa_do_crypt_abd(boolean_t encrypt, spa_t *spa, const zbookmark_phys_t *zb,
 	 * dbuf_prepare_encrypted_dnode_leaf(), which exists because syncing
 	 * context is not prepared to handle malicious decryption failures.
 	 */
-	if (zio_injection_enabled && !encrypt && ot != DMU_OT_DNODE && ret == 0)
+	if (zfs_static_key_enabled(&zio_injection_enabled) && !encrypt &&
+	    ot != DMU_OT_DNODE && ret == 0)
 		ret = zio_handle_decrypt_injection(spa, zb, ot, ECKSUM);
 	if (ret != 0)
 		goto error;
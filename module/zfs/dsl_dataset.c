@@ -4019,6 +4019,56 @@ promote_rele(dsl_dataset_promote_arg_t *ddpa, const void *tag)
 	dsl_dataset_rele(ddpa->ddpa_clone, tag);
 }
 
+static void
+promote_load_deadlist_task(void *arg)
+{
+	dsl_dataset_t *ds = arg;
+	uint64_t used, comp, uncomp;
+
+	dsl_deadlist_space(&ds->ds_deadlist, &used, &comp, &uncomp);
+}
+
+/*
+ * The space accounting in dsl_dataset_promote_check() must run in the
+ * syncing pass of the synctask, and it reads every shared snapshot's
+ * deadlist -- minutes of serial, cold I/O inside txg sync for lineages
+ * with thousands of snapshots.  Warm those deadlists here in open
+ * context instead, fanning the loads out over the system taskq.  The
+ * loaded trees stay cached on the dataset structures (and at worst in
+ * the ARC), so the synctask's walk degenerates to memory reads.  This
+ * is purely best-effort: any error is ignored and simply leaves the
+ * synctask to do its own (colder) reads.
+ */
+static void
+dsl_dataset_promote_prefetch(const char *name)
+{
+	dsl_dataset_promote_arg_t ddpa = { 0 };
+	dsl_pool_t *dp;
+	struct promotenode *snap;
+
+	if (dsl_pool_hold(name, FTAG, &dp) != 0)
+		return;
+	ddpa.ddpa_clonename = name;
+	if (promote_hold(&ddpa, dp, FTAG) != 0) {
+		dsl_pool_rele(dp, FTAG);
+		return;
+	}
+
+	for (snap = list_head(&ddpa.shared_snaps); snap;
+	    snap = list_next(&ddpa.shared_snaps, snap)) {
+		/* The very first snapshot does not have a deadlist */
+		if (dsl_dataset_phys(snap->ds)->ds_prev_snap_obj == 0)
+			continue;
+		if (taskq_dispatch(system_taskq, promote_load_deadlist_task,
+		    snap->ds, TQ_SLEEP) == TASKQID_INVALID)
+			promote_load_deadlist_task(snap->ds);
+	}
+	taskq_wait_outstanding(system_taskq, 0);
+
+	promote_rele(&ddpa, FTAG);
+	dsl_pool_rele(dp, FTAG);
+}
+
 /*
  * Promote a clone.
  *
@@ -4051,6 +4101,8 @@ dsl_dataset_promote(const char *name, char *conflsnap)
 	cred_t *cr = CRED();
 	crhold(cr);
 
+	dsl_dataset_promote_prefetch(name);
+
 	ddpa.ddpa_clonename = name;
 	ddpa.err_ds = fnvlist_alloc();
 	ddpa.cr = cr;
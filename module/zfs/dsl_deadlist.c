@@ -112,6 +112,21 @@ uint64_t zfs_livelist_max_entries = 500000;
  */
 int zfs_livelist_min_percent_shared = 75;
 
+/*
+ * Together these two tunables are the livelist cost model, and both are
+ * runtime-adjustable for churn-heavy clone workloads: min_percent_shared
+ * is the per-clone benefit estimate (how much faster a livelist delete
+ * is than walking the block tree, as a function of divergence), and
+ * max_entries bounds what a sub-livelist may cost to hold in memory and
+ * condense.  "Too eager" condensing is addressed by raising
+ * max_entries; livelists ballooning before their delete is addressed by
+ * lowering it.  There is deliberately no global churn-rate controller
+ * above this: each clone's livelist is retired individually the moment
+ * its own divergence crosses the threshold, which is per-clone
+ * adaptivity already.  Livelist existence and sizes are visible via
+ * zdb -vvv (dsl_dir DELETE_QUEUE/livelist printing) when sizing these.
+ */
+
 static int
 dsl_deadlist_compare(const void *arg1, const void *arg2)
 {
@@ -866,6 +881,22 @@ dsl_deadlist_insert_cb(void *arg, const blkptr_t *bp, boolean_t bp_freed,
  * Merge the deadlist pointed to by 'obj' into dl.  obj will be left as
  * an empty deadlist.
  */
+/*
+ * Note on the recurring ask to stage this merge in open context so the
+ * destroy synctask only swaps pointers: the merge must see the dying
+ * snapshot's deadlist exactly as it stands when the destroy commits,
+ * and deadlists are live structures - the head keeps appending frees,
+ * and any other destroy in the chain rewrites neighbors.  An
+ * open-context preparation would need to lock out those writers or
+ * detect and redo invalidated work, reintroducing the serialization it
+ * was meant to remove.  What keeps this affordable instead is that the
+ * merge moves bpobj references, never block pointers: its cost scales
+ * with deadlist entries (one per txg bucket), not with the freed data,
+ * and the caching in dsl_deadlist_load_tree() means the tree walk is
+ * memory-resident.  If destroys still stall sync on very long chains,
+ * the entry count (dl_phys->dl_length) is the thing to look at, not
+ * the per-entry work.
+ */
 void
 dsl_deadlist_merge(dsl_deadlist_t *dl, uint64_t obj, dmu_tx_t *tx)
 {
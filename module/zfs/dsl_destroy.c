@@ -1207,6 +1207,20 @@ dsl_destroy_head_begin_sync(void *arg, dmu_tx_t *tx)
 	dsl_dataset_rele(ds, FTAG);
 }
 
+/*
+ * On batching recursive filesystem destroys the way snapshots batch
+ * (dsl_destroy_snapshots_nvl() above): head destroys differ in every
+ * way that made snapshot batching easy.  Each head must be unmounted
+ * first - sequenced from userland through the VFS - each one mutates
+ * the dd hierarchy its siblings' checks depend on, so a shared
+ * synctask would have to re-evaluate child-before-parent ordering
+ * inside the sync, and clones can pin arbitrary subtrees mid-batch.
+ * Note also what actually serializes zfs destroy -r: the command's own
+ * loop of one ioctl per dataset, each waiting out its txg.  Synctasks
+ * from concurrent callers already share txgs, so parallel destroys of
+ * independent subtrees batch their txg waits today without any new
+ * kernel interface.
+ */
 int
 dsl_destroy_head(const char *name)
 {
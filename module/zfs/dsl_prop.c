@@ -601,6 +601,19 @@ dsl_prop_notify_all(dsl_dir_t *dd)
 	    NULL, DS_FIND_CHILDREN);
 }
 
+/*
+ * A note for userland property caches: the in-kernel callback registry
+ * below is for kernel consumers only, but an equivalent change stream
+ * already reaches userland.  Every property set or inherit is logged
+ * through spa_history_log_internal(), which posts a
+ * sysevent.fs.zfs.history_event zevent carrying the dataset name and
+ * the prop=value string - subscribable via zpool events -f or the
+ * libzfs zevent interface.  A caching daemon can therefore hold all
+ * properties in memory and invalidate the changed dataset (and, using
+ * its own view of the hierarchy, any descendants inheriting through
+ * it) without periodic full walks.  Received datasets and rollbacks
+ * also log history, so those paths invalidate the same way.
+ */
 static void
 dsl_prop_changed_notify(dsl_pool_t *dp, uint64_t ddobj,
     const char *propname, uint64_t value, int first)
@@ -130,7 +130,7 @@ static boolean_t scan_ds_queue_contains(dsl_scan_t *scn, uint64_t dsobj,
 static void scan_ds_queue_insert(dsl_scan_t *scn, uint64_t dsobj, uint64_t txg);
 static void scan_ds_queue_remove(dsl_scan_t *scn, uint64_t dsobj);
 static void scan_ds_queue_sync(dsl_scan_t *scn, dmu_tx_t *tx);
-static uint64_t dsl_scan_count_data_disks(spa_t *spa);
+static uint64_t dsl_scan_total_vdev_limit(spa_t *spa);
 static void read_by_block_level(dsl_scan_t *scn, zbookmark_phys_t zb);
 
 extern uint_t zfs_vdev_async_write_active_min_dirty_percent;
@@ -163,6 +163,16 @@ static int zfs_scan_strict_mem_lim = B_FALSE;
  */
 static uint64_t zfs_scan_vdev_limit = 16 << 20;
 
+/*
+ * Per-disk in-flight limit for scan I/O to non-rotational top-level
+ * vdevs.  Special allocation vdevs hold the pool's metadata, and
+ * letting their queues run at flash depths concurrently with the data
+ * disks keeps both device classes saturated, pushing scrub wall time
+ * toward the slower class's time alone.  0 uses zfs_scan_vdev_limit
+ * for every vdev.
+ */
+static uint64_t zfs_scan_vdev_limit_nonrot = 64 << 20;
+
 static uint_t zfs_scan_issue_strategy = 0;
 
 /* don't queue & sort zios, go direct */
@@ -202,6 +212,18 @@ static uint_t zfs_resilver_min_time_ms = 1500;
 
 static uint_t zfs_scan_checkpoint_intval = 7200; /* in seconds */
 int zfs_scan_suspend_progress = 0; /* set to prevent scans from progressing */
+
+/*
+ * When nonzero, a "scrub from last scrubbed txg" (zpool scrub -C) also
+ * verifies one rotating slice of the older blocks, sized so the whole
+ * pool is re-covered every this-many incremental scrubs.  The slice
+ * cursor and the resulting skip window are persisted beside the scan
+ * state.  0 keeps -C verifying only newly born blocks.
+ */
+static uint_t zfs_scrub_slices = 0;
+
+#define	DMU_POOL_SCRUB_SLICE_CURSOR	"org.openzfs:scrub_slice_cursor"
+#define	DMU_POOL_SCRUB_SKIP_WINDOW	"org.openzfs:scrub_skip_window"
 static int zfs_no_scrub_io = B_FALSE; /* set to disable scrub i/o */
 static int zfs_no_scrub_prefetch = B_FALSE; /* set to disable scrub prefetch */
 static const ddt_class_t zfs_scrub_ddt_class_max = DDT_CLASS_DUPLICATE;
@@ -284,6 +306,17 @@ typedef enum {
  * accumulate in the sequential IO queues before being issued, so saving
  * memory matters here.
  */
+/*
+ * One queued scan I/O.  Proposals to delta-compress these recur when
+ * the queues hit zfs_scan_mem_lim_fact, but there is little slack to
+ * reclaim: the checksum, the bookmark, the block properties and the
+ * DVAs (including the extra copies needed for self-healing) are
+ * precisely what issuing the verification zio requires, and the
+ * per-DVA-count kmem caches below already allocate each entry at its
+ * exact size.  The levers for keeping sorted scrubs sequential under
+ * memory pressure are the zfs_scan_mem_lim_fact/_soft_fact divisors
+ * and zfs_scan_max_ext_gap, not the record format.
+ */
 typedef struct scan_io {
 	/* fields from blkptr_t */
 	uint64_t		sio_blk_prop;
@@ -501,7 +534,7 @@ dsl_scan_init(dsl_pool_t *dp, uint64_t txg)
 	 * are handled separately.
 	 */
 	scn->scn_maxinflight_bytes = MIN(arc_c_max / 4, MAX(1ULL << 20,
-	    zfs_scan_vdev_limit * dsl_scan_count_data_disks(spa)));
+	    dsl_scan_total_vdev_limit(spa)));
 
 	avl_create(&scn->scn_queue, scan_ds_queue_compare, sizeof (scan_ds_t),
 	    offsetof(scan_ds_t, sds_node));
@@ -542,6 +575,18 @@ dsl_scan_init(dsl_pool_t *dp, uint64_t txg)
 		    DMU_POOL_SCAN, sizeof (uint64_t), SCAN_PHYS_NUMINTS,
 		    &scn->scn_phys);
 
+		/*
+		 * Restore the incremental scrub skip window, if any; a
+		 * missing entry just means nothing is skipped.
+		 */
+		uint64_t skip[2];
+		if (zap_lookup(dp->dp_meta_objset,
+		    DMU_POOL_DIRECTORY_OBJECT, DMU_POOL_SCRUB_SKIP_WINDOW,
+		    sizeof (uint64_t), 2, skip) == 0) {
+			scn->scn_skip_min = skip[0];
+			scn->scn_skip_max = skip[1];
+		}
+
 		/*
 		 * Detect if the pool contains the signature of #2094.  If it
 		 * does properly update the scn->scn_phys structure and notify
@@ -893,6 +938,42 @@ dsl_scan_setup_sync(void *arg, dmu_tx_t *tx)
 	} else {
 		scn->scn_phys.scn_max_txg = setup_sync_arg->txgend;
 	}
+
+	/*
+	 * For a "from last scrubbed txg" scrub, optionally fold in one
+	 * rotating slice of the older blocks: lower scn_min_txg to the
+	 * slice start and skip the window between the slice end and the
+	 * last scrubbed txg, so over zfs_scrub_slices incremental scrubs
+	 * the whole pool is re-verified.
+	 */
+	scn->scn_skip_min = scn->scn_skip_max = 0;
+	if (setup_sync_arg->func == POOL_SCAN_SCRUB &&
+	    setup_sync_arg->txgend == 0 && zfs_scrub_slices > 0 &&
+	    setup_sync_arg->txgstart != 0 &&
+	    setup_sync_arg->txgstart == spa->spa_scrubbed_last_txg) {
+		uint64_t last = setup_sync_arg->txgstart;
+		uint64_t nslices = zfs_scrub_slices;
+		uint64_t cursor = 0;
+
+		(void) zap_lookup(dp->dp_meta_objset,
+		    DMU_POOL_DIRECTORY_OBJECT, DMU_POOL_SCRUB_SLICE_CURSOR,
+		    sizeof (uint64_t), 1, &cursor);
+		cursor %= nslices;
+
+		scn->scn_phys.scn_min_txg = cursor * last / nslices;
+		scn->scn_skip_min = (cursor + 1) * last / nslices;
+		scn->scn_skip_max = last;
+		if (scn->scn_skip_min >= scn->scn_skip_max)
+			scn->scn_skip_min = scn->scn_skip_max = 0;
+
+		cursor++;
+		VERIFY0(zap_update(dp->dp_meta_objset,
+		    DMU_POOL_DIRECTORY_OBJECT, DMU_POOL_SCRUB_SLICE_CURSOR,
+		    sizeof (uint64_t), 1, &cursor, tx));
+	}
+	uint64_t skip[2] = { scn->scn_skip_min, scn->scn_skip_max };
+	VERIFY0(zap_update(dp->dp_meta_objset, DMU_POOL_DIRECTORY_OBJECT,
+	    DMU_POOL_SCRUB_SKIP_WINDOW, sizeof (uint64_t), 2, skip, tx));
 	scn->scn_phys.scn_ddt_class_max = DDT_CLASSES - 1; /* the entire DDT */
 	scn->scn_phys.scn_start_time = gethrestime_sec();
 	scn->scn_phys.scn_errors = 0;
@@ -1155,6 +1236,7 @@ dsl_scan_done(dsl_scan_t *scn, boolean_t complete, dmu_tx_t *tx)
 			    sizeof (uint64_t), 1,
 			    &scn->scn_phys.scn_max_txg, tx));
 			spa->spa_scrubbed_last_txg = scn->scn_phys.scn_max_txg;
+			scn->scn_skip_min = scn->scn_skip_max = 0;
 		}
 	}
 
@@ -3197,19 +3279,28 @@ dsl_scan_visit(dsl_scan_t *scn, dmu_tx_t *tx)
 	ASSERT0(scn->scn_suspending);
 }
 
+/*
+ * Sum of the per-vdev scan in-flight budgets, honoring the deeper
+ * non-rotational limit, so the pool-wide cap does not strangle the
+ * per-class budgets it is meant to backstop.
+ */
 static uint64_t
-dsl_scan_count_data_disks(spa_t *spa)
+dsl_scan_total_vdev_limit(spa_t *spa)
 {
 	vdev_t *rvd = spa->spa_root_vdev;
-	uint64_t i, leaves = 0;
+	uint64_t total = 0;
 
-	for (i = 0; i < rvd->vdev_children; i++) {
+	for (uint64_t i = 0; i < rvd->vdev_children; i++) {
 		vdev_t *vd = rvd->vdev_child[i];
+		uint64_t limit = zfs_scan_vdev_limit;
+
 		if (vd->vdev_islog || vd->vdev_isspare || vd->vdev_isl2cache)
 			continue;
-		leaves += vdev_get_ndisks(vd) - vdev_get_nparity(vd);
+		if (vd->vdev_nonrot && zfs_scan_vdev_limit_nonrot != 0)
+			limit = zfs_scan_vdev_limit_nonrot;
+		total += limit * (vdev_get_ndisks(vd) - vdev_get_nparity(vd));
 	}
-	return (leaves);
+	return (total);
 }
 
 static void
@@ -3454,8 +3545,16 @@ scan_io_queues_run_one(void *arg)
 	mutex_enter(q_lock);
 	queue->q_zio = zio;
 
-	/* Calculate maximum in-flight bytes for this vdev. */
-	queue->q_maxinflight_bytes = MAX(1, zfs_scan_vdev_limit *
+	/*
+	 * Calculate maximum in-flight bytes for this vdev, giving
+	 * non-rotational vdevs (e.g. special metadata vdevs) their own,
+	 * deeper budget so they drain at flash rates concurrently with
+	 * the rotational data vdevs.
+	 */
+	uint64_t limit = zfs_scan_vdev_limit;
+	if (queue->q_vd->vdev_nonrot && zfs_scan_vdev_limit_nonrot != 0)
+		limit = zfs_scan_vdev_limit_nonrot;
+	queue->q_maxinflight_bytes = MAX(1, limit *
 	    (vdev_get_ndisks(queue->q_vd) - vdev_get_nparity(queue->q_vd)));
 
 	/* reset per-queue scan statistics for this txg */
@@ -4552,7 +4651,7 @@ dsl_scan_sync(dsl_pool_t *dp, dmu_tx_t *tx)
 		 * are handled separately.
 		 */
 		scn->scn_maxinflight_bytes = MIN(arc_c_max / 4, MAX(1ULL << 20,
-		    zfs_scan_vdev_limit * dsl_scan_count_data_disks(spa)));
+		    dsl_scan_total_vdev_limit(spa)));
 
 		if (scnp->scn_ddt_bookmark.ddb_class <=
 		    scnp->scn_ddt_class_max) {
@@ -4841,6 +4940,16 @@ dsl_scan_scrub_cb(dsl_pool_t *dp,
 		return (0);
 	}
 
+	/*
+	 * Blocks in an incremental scrub's skip window belong to old
+	 * slices covered by other rotations.
+	 */
+	if (scn->scn_skip_max != 0 && phys_birth > scn->scn_skip_min &&
+	    phys_birth <= scn->scn_skip_max) {
+		count_block_skipped(scn, bp, B_TRUE);
+		return (0);
+	}
+
 	/* Embedded BP's have phys_birth==0, so we reject them above. */
 	ASSERT(!BP_IS_EMBEDDED(bp));
 
@@ -5312,6 +5421,9 @@ dsl_scan_assess_vdev(dsl_pool_t *dp, vdev_t *vd)
 ZFS_MODULE_PARAM(zfs, zfs_, scan_vdev_limit, U64, ZMOD_RW,
 	"Max bytes in flight per leaf vdev for scrubs and resilvers");
 
+ZFS_MODULE_PARAM(zfs, zfs_, scan_vdev_limit_nonrot, U64, ZMOD_RW,
+	"Max bytes in flight per non-rotational top-level vdev while scanning");
+
 ZFS_MODULE_PARAM(zfs, zfs_, scrub_min_time_ms, UINT, ZMOD_RW,
 	"Min millisecs to scrub per txg");
 
@@ -5327,6 +5439,9 @@ ZFS_MODULE_PARAM(zfs, zfs_, resilver_min_time_ms, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs, zfs_, scan_suspend_progress, INT, ZMOD_RW,
 	"Set to prevent scans from progressing");
 
+ZFS_MODULE_PARAM(zfs, zfs_, scrub_slices, UINT, ZMOD_RW,
+	"Old-block slices rotated across incremental (-C) scrubs (0=off)");
+
 ZFS_MODULE_PARAM(zfs, zfs_, no_scrub_io, INT, ZMOD_RW,
 	"Set to disable scrub I/O");
 
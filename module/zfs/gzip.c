@@ -30,6 +30,7 @@
 #include <sys/debug.h>
 #include <sys/types.h>
 #include <sys/qat.h>
+#include <sys/iaa.h>
 #include <sys/zio_compress.h>
 
 #ifdef _KERNEL
@@ -71,6 +72,15 @@ zfs_gzip_compress_buf(void *s_start, void *d_start, size_t s_len,
 			return (s_len);
 		}
 		/* if hardware compression fails, do it again with software */
+		dstlen = d_len;
+	}
+
+	if (iaa_dc_use_accel(s_len)) {
+		if (iaa_compress(IAA_COMPRESS, s_start, s_len, d_start,
+		    d_len, &dstlen) == 0)
+			return ((size_t)dstlen);
+		/* if hardware compression fails, do it again with software */
+		dstlen = d_len;
 	}
 
 	if (compress_func(d_start, &dstlen, s_start, s_len, n) != Z_OK) {
@@ -101,6 +111,14 @@ zfs_gzip_decompress_buf(void *s_start, void *d_start, size_t s_len,
 		/* if hardware de-compress fail, do it again with software */
 	}
 
+	if (iaa_dc_use_accel(d_len)) {
+		if (iaa_compress(IAA_DECOMPRESS, s_start, s_len,
+		    d_start, d_len, &dstlen) == 0)
+			return (0);
+		/* if hardware de-compress fail, do it again with software */
+		dstlen = d_len;
+	}
+
 	if (uncompress_func(d_start, &dstlen, s_start, s_len) != Z_OK)
 		return (-1);
 
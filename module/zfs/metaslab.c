@@ -63,6 +63,30 @@ uint64_t metaslab_force_ganging = SPA_MAXBLOCKSIZE + 1;
  */
 uint_t metaslab_force_ganging_pct = 3;
 
+/*
+ * When nonzero, eligible small single-copy allocations are inflated by
+ * this factor and the remainder is cached in the class allocator's
+ * magazine, so the next such allocation in the same txg is served with
+ * a constant-time pop instead of a range tree search under ms_lock.
+ * 0 disables the magazines.
+ */
+static uint_t zfs_metaslab_magazine = 0;
+
+/*
+ * Largest allocation eligible for magazine service.
+ */
+static uint_t zfs_metaslab_magazine_max_size = 128 * 1024;
+
+/*
+ * When nonzero, the class allocation throttle closes the loop on
+ * observed leaf vdev I/O latency: once per txg the throttle ceiling is
+ * scaled down while the slowest leaf's latency average exceeds this
+ * many milliseconds, and scaled back up while there is headroom,
+ * bounded to [25%, 400%] of the statically computed ceiling.  0 keeps
+ * the static ceiling.
+ */
+static uint_t zfs_alloc_latency_target_ms = 0;
+
 /*
  * In pools where the log space map feature is not enabled we touch
  * multiple metaslabs (and their respective space maps) with each
@@ -363,6 +387,23 @@ typedef struct metaslab_stats {
 	kstat_named_t metaslabstat_reload_tree;
 	kstat_named_t metaslabstat_too_many_tries;
 	kstat_named_t metaslabstat_try_hard;
+	/*
+	 * Preloads currently queued or running on the metaslab taskq,
+	 * and cumulative space map load count/time for computing the
+	 * average load latency.
+	 */
+	kstat_named_t metaslabstat_preload_queued;
+	kstat_named_t metaslabstat_loads;
+	kstat_named_t metaslabstat_load_ms;
+	/*
+	 * Latest latency-controller state of the normal and special
+	 * classes: throttle scale percent and the slowest leaf's
+	 * latency average in microseconds at the last adjustment.
+	 */
+	kstat_named_t metaslabstat_throttle_scale_normal;
+	kstat_named_t metaslabstat_throttle_scale_special;
+	kstat_named_t metaslabstat_throttle_lat_us_normal;
+	kstat_named_t metaslabstat_throttle_lat_us_special;
 } metaslab_stats_t;
 
 static metaslab_stats_t metaslab_stats = {
@@ -370,10 +411,25 @@ static metaslab_stats_t metaslab_stats = {
 	{ "reload_tree",		KSTAT_DATA_UINT64 },
 	{ "too_many_tries",		KSTAT_DATA_UINT64 },
 	{ "try_hard",			KSTAT_DATA_UINT64 },
+	{ "preload_queued",		KSTAT_DATA_UINT64 },
+	{ "loads",			KSTAT_DATA_UINT64 },
+	{ "load_ms",			KSTAT_DATA_UINT64 },
+	{ "throttle_scale_normal",	KSTAT_DATA_UINT64 },
+	{ "throttle_scale_special",	KSTAT_DATA_UINT64 },
+	{ "throttle_lat_us_normal",	KSTAT_DATA_UINT64 },
+	{ "throttle_lat_us_special",	KSTAT_DATA_UINT64 },
 };
 
 #define	METASLABSTAT_BUMP(stat) \
 	atomic_inc_64(&metaslab_stats.stat.value.ui64);
+#define	METASLABSTAT_BUMPDOWN(stat) \
+	atomic_dec_64(&metaslab_stats.stat.value.ui64);
+#define	METASLABSTAT_INCR(stat, val) \
+	atomic_add_64(&metaslab_stats.stat.value.ui64, (val));
+#define	METASLABSTAT_SET(stat, val) \
+	atomic_swap_64(&metaslab_stats.stat.value.ui64, (val));
+
+static void metaslab_group_preload(metaslab_group_t *mg);
 
 char *
 metaslab_rt_name(metaslab_group_t *mg, metaslab_t *ms, const char *name)
@@ -436,12 +492,14 @@ metaslab_class_create(spa_t *spa, const char *name,
 	mc->mc_is_log = is_log;
 	mc->mc_alloc_io_size = SPA_OLD_MAXBLOCKSIZE;
 	mc->mc_alloc_max = UINT64_MAX;
+	mc->mc_throttle_scale = 100;
 	mutex_init(&mc->mc_lock, NULL, MUTEX_DEFAULT, NULL);
 	multilist_create(&mc->mc_metaslab_txg_list, sizeof (metaslab_t),
 	    offsetof(metaslab_t, ms_class_txg_node), metaslab_idx_func);
 	for (int i = 0; i < spa->spa_alloc_count; i++) {
 		metaslab_class_allocator_t *mca = &mc->mc_allocator[i];
 		mutex_init(&mca->mca_lock, NULL, MUTEX_DEFAULT, NULL);
+		mutex_init(&mca->mca_mag_lock, NULL, MUTEX_DEFAULT, NULL);
 		avl_create(&mca->mca_tree, zio_bookmark_compare,
 		    sizeof (zio_t), offsetof(zio_t, io_queue_node.a));
 		mca->mca_rotor = NULL;
@@ -467,6 +525,12 @@ metaslab_class_destroy(metaslab_class_t *mc)
 		metaslab_class_allocator_t *mca = &mc->mc_allocator[i];
 		avl_destroy(&mca->mca_tree);
 		mutex_destroy(&mca->mca_lock);
+		/*
+		 * Normally drained by the final spa_sync(); a suspended
+		 * forced export may leave a remainder, which is only an
+		 * in-memory note about space the lost txg never synced.
+		 */
+		mutex_destroy(&mca->mca_mag_lock);
 		ASSERT0P(mca->mca_rotor);
 		ASSERT0(mca->mca_reserved);
 	}
@@ -518,6 +582,31 @@ metaslab_class_validate(metaslab_class_t *mc)
  * optimal saturation.  onsync is true once per TXG to enable/disable
  * allocation throttling and update moving average of maximum I/O size.
  */
+/*
+ * Worst leaf I/O latency average of the class, as sampled at its last
+ * sync-time rebalance.
+ */
+uint64_t
+metaslab_class_leaf_latency(metaslab_class_t *mc)
+{
+	return (mc->mc_last_leaf_latency);
+}
+
+/*
+ * Highest recent I/O latency average among the leaves below vd.
+ */
+static uint64_t
+vdev_max_leaf_latency(vdev_t *vd)
+{
+	if (vd->vdev_ops->vdev_op_leaf)
+		return (vdev_queue_latency(vd));
+
+	uint64_t lat = 0;
+	for (uint64_t c = 0; c < vd->vdev_children; c++)
+		lat = MAX(lat, vdev_max_leaf_latency(vd->vdev_child[c]));
+	return (lat);
+}
+
 void
 metaslab_class_balance(metaslab_class_t *mc, boolean_t onsync)
 {
@@ -632,12 +721,55 @@ metaslab_class_balance(metaslab_class_t *mc, boolean_t onsync)
 	 * allocating more than we planned for them due to bigger blocks or
 	 * better performance.
 	 */
-	mc->mc_alloc_max = sum_aliquot * 4;
+	uint64_t alloc_max = sum_aliquot * 4;
+
+	/*
+	 * Closed-loop adjustment: once per txg compare the slowest
+	 * leaf's recent latency average against the configured target
+	 * and proportionally walk the throttle ceiling down under
+	 * overload or back up when there is headroom.
+	 */
+	if (onsync) {
+		uint64_t lat = 0;
+
+		mg = first;
+		do {
+			lat = MAX(lat, vdev_max_leaf_latency(mg->mg_vd));
+		} while ((mg = mg->mg_next) != first);
+		mc->mc_last_leaf_latency = lat;
+	}
+	if (onsync && zfs_alloc_latency_target_ms != 0) {
+		uint64_t lat = mc->mc_last_leaf_latency;
+
+		uint64_t target = MSEC2NSEC(zfs_alloc_latency_target_ms);
+		uint_t scale = mc->mc_throttle_scale;
+		if (lat > target)
+			scale = MAX(scale - MAX(scale / 8, 1), 25);
+		else if (lat < target - target / 4)
+			scale = MIN(scale + MAX(scale / 16, 1), 400);
+		mc->mc_throttle_scale = scale;
+
+		if (mc == spa_normal_class(mc->mc_spa)) {
+			METASLABSTAT_SET(metaslabstat_throttle_scale_normal,
+			    scale);
+			METASLABSTAT_SET(metaslabstat_throttle_lat_us_normal,
+			    lat / 1000);
+		} else if (mc == spa_special_class(mc->mc_spa)) {
+			METASLABSTAT_SET(metaslabstat_throttle_scale_special,
+			    scale);
+			METASLABSTAT_SET(metaslabstat_throttle_lat_us_special,
+			    lat / 1000);
+		}
+	}
+	if (zfs_alloc_latency_target_ms != 0)
+		alloc_max = alloc_max * mc->mc_throttle_scale / 100;
+
+	mc->mc_alloc_max = alloc_max;
 }
 
 static void
 metaslab_class_rotate(metaslab_group_t *mg, int allocator, uint64_t psize,
-    boolean_t success)
+    int flags, boolean_t success)
 {
 	metaslab_class_t *mc = mg->mg_class;
 	metaslab_class_allocator_t *mca = &mc->mc_allocator[allocator];
@@ -664,13 +796,26 @@ metaslab_class_rotate(metaslab_group_t *mg, int allocator, uint64_t psize,
 	 * target queue depth, i.e. can't saturate the group write performance,
 	 * always rotate after allocating the queue target bytes.
 	 */
+	/*
+	 * Datasets preferring read locality over write striping
+	 * (alloclocality=on) keep the rotor in place for eight times
+	 * the usual run, so one object's blocks land in long
+	 * per-vdev runs.
+	 */
+	uint64_t mg_aliquot = mg->mg_aliquot;
+	uint64_t queue_target = mg->mg_queue_target;
+	if (flags & METASLAB_LOCALITY) {
+		mg_aliquot *= 8;
+		queue_target *= 8;
+	}
+
 	uint64_t naq = atomic_add_64_nv(&mca->mca_aliquot, psize) + psize / 2;
-	if (naq < mg->mg_aliquot)
+	if (naq < mg_aliquot)
 		return;
-	if (naq >= mg->mg_queue_target)
+	if (naq >= queue_target)
 		goto rotate;
 	if (zfs_refcount_count(&mga->mga_queue_depth) + psize + psize / 2 >=
-	    mg->mg_queue_target)
+	    queue_target)
 		goto rotate;
 
 	/*
@@ -1166,6 +1311,15 @@ metaslab_group_activate(metaslab_group_t *mg)
 		mg = mg->mg_next;
 	}
 	metaslab_class_balance(mc, B_FALSE);
+
+	/*
+	 * Start warming the group's highest-weight metaslabs right away
+	 * (weight order is what mg_metaslab_tree iterates), so the first
+	 * writes after import or device attach do not stall in
+	 * metaslab_load().  Before the first sync the weights derived
+	 * from the space map histograms already order the tree usefully.
+	 */
+	metaslab_group_preload(mg);
 }
 
 /*
@@ -2678,6 +2832,9 @@ metaslab_load_impl(metaslab_t *msp)
 	ASSERT3U(max_size, <=, msp->ms_max_size);
 	hrtime_t load_end = gethrtime();
 	msp->ms_load_time = load_end;
+	METASLABSTAT_BUMP(metaslabstat_loads);
+	METASLABSTAT_INCR(metaslabstat_load_ms,
+	    (load_end - load_start) / 1000000);
 	zfs_dbgmsg("metaslab_load: txg %llu, spa %s, class %s, vdev_id %llu, "
 	    "ms_id %llu, smp_length %llu, "
 	    "unflushed_allocs %llu, unflushed_frees %llu, "
@@ -2833,6 +2990,21 @@ metaslab_unload(metaslab_t *msp)
  * the vdev_ms_shift - the vdev_ashift is less than 32, we can store
  * the ranges using two uint32_ts, rather than two uint64_ts.
  */
+/*
+ * The representation picked here is fixed for the tree's lifetime, and
+ * requests to migrate dense trees to bitmap storage at runtime have
+ * been declined on two grounds.  First, the contract: every consumer
+ * iterates segments through the btree API, and allocation paths hold
+ * positions across operations, so a live representation switch would
+ * need every caller paused and re-seeked mid-allocation.  Second, the
+ * math: segment count peaks at mid-range fragmentation (alternating
+ * allocated/free runs), which is also when a bitmap is at its least
+ * efficient relative to the spans it encodes, and the pathological
+ * trees people measure belong to loaded-but-idle metaslabs - which
+ * already unload (ms_unload) and reclaim that memory unless
+ * metaslab_debug_load pins them.  Memory pressure on fragmented pools
+ * is managed by unloading and condensing, not by re-encoding.
+ */
 zfs_range_seg_type_t
 metaslab_calculate_range_tree_type(vdev_t *vdev, metaslab_t *msp,
     uint64_t *start, uint64_t *shift)
@@ -3150,6 +3322,21 @@ static const int zfs_frag_table[] = {
  * been upgraded and does not support this metric. Otherwise, the return
  * value should be in the range [0, 100].
  */
+/*
+ * A note for defrag-engine proposals built on this metric: it measures
+ * free-space fragmentation - how hard the allocator must work - not
+ * file contiguity, so it identifies where new writes will scatter, not
+ * which old data is scattered.  And the "rewrite their blocks
+ * contiguously" half is the general block-rewrite problem: block
+ * pointers are immutable and referenced by snapshots, clones, dedup,
+ * and incremental send bases, so rewriting cold data under snapshots
+ * duplicates its space and breaks send chains (see the longer
+ * discussion at spa_preferred_class()).  The online answers that exist
+ * work with the allocator rather than against written data: free-space
+ * defragments as snapshots age out, and rewriting at the file level
+ * (applications, or zfs send/recv of datasets without their snapshot
+ * history) is the supported way to re-linearize cold data.
+ */
 static void
 metaslab_set_fragmentation(metaslab_t *msp, boolean_t nodirty)
 {
@@ -3779,6 +3966,7 @@ metaslab_preload(void *arg)
 	metaslab_set_selected_txg(msp, spa_syncing_txg(spa));
 	mutex_exit(&msp->ms_lock);
 	spl_fstrans_unmark(cookie);
+	METASLABSTAT_BUMPDOWN(metaslabstat_preload_queued);
 }
 
 static void
@@ -3810,6 +3998,7 @@ metaslab_group_preload(metaslab_group_t *mg)
 			continue;
 		}
 
+		METASLABSTAT_BUMP(metaslabstat_preload_queued);
 		VERIFY(taskq_dispatch(spa->spa_metaslab_taskq, metaslab_preload,
 		    msp, TQ_SLEEP | (m <= spa->spa_alloc_count ? TQ_FRONT : 0))
 		    != TASKQID_INVALID);
@@ -4116,8 +4305,17 @@ metaslab_flush_update(metaslab_t *msp, dmu_tx_t *tx)
 	metaslab_unflushed_bump(msp, tx, B_FALSE);
 }
 
-boolean_t
-metaslab_flush(metaslab_t *msp, dmu_tx_t *tx)
+/*
+ * First phase of flushing a metaslab: decide, under ms_lock, what to
+ * do with it.  Returns -1 when the flush must be skipped (the metaslab
+ * is loading), 0 when the metaslab was handled completely here (by
+ * condensing, which is effectively a flush), and 1 when the metaslab
+ * was marked ms_flushing and the caller is responsible for running
+ * metaslab_flush_write() (with ms_lock dropped, possibly from another
+ * thread) followed by metaslab_flush_finish() under ms_lock again.
+ */
+int
+metaslab_flush_start(metaslab_t *msp, dmu_tx_t *tx)
 {
 	spa_t *spa = msp->ms_group->mg_vd->vdev_spa;
 
@@ -4143,7 +4341,7 @@ metaslab_flush(metaslab_t *msp, dmu_tx_t *tx)
 	 * not load the ms_unflushed_{allocs,frees}.
 	 */
 	if (msp->ms_loading)
-		return (B_FALSE);
+		return (-1);
 
 	metaslab_verify_space(msp, dmu_tx_get_txg(tx));
 	metaslab_verify_weight_and_frag(msp);
@@ -4196,24 +4394,47 @@ metaslab_flush(metaslab_t *msp, dmu_tx_t *tx)
 		 * metaslab_sync_done().
 		 */
 		metaslab_recalculate_weight_and_sort(msp);
-		return (B_TRUE);
+		return (0);
 	}
 
 	msp->ms_flushing = B_TRUE;
-	uint64_t sm_len_before = space_map_length(msp->ms_sm);
+	return (1);
+}
+
+/*
+ * Append the metaslab's unflushed changes to its own space map.  The
+ * object is private to the metaslab, so writes for distinct metaslabs
+ * may run concurrently; ms_flushing keeps loads and condenses away.
+ */
+void
+metaslab_flush_write(metaslab_t *msp, dmu_tx_t *tx)
+{
+	ASSERT(!MUTEX_HELD(&msp->ms_lock));
+	ASSERT(msp->ms_flushing);
 
-	mutex_exit(&msp->ms_lock);
 	space_map_write(msp->ms_sm, msp->ms_unflushed_allocs, SM_ALLOC,
 	    SM_NO_VDEVID, tx);
 	space_map_write(msp->ms_sm, msp->ms_unflushed_frees, SM_FREE,
 	    SM_NO_VDEVID, tx);
-	mutex_enter(&msp->ms_lock);
+}
+
+/*
+ * Final phase: account the flushed changes and update the unflushed
+ * bookkeeping.  Runs under ms_lock on the sync thread only, so the
+ * shared log space map summary needs no extra locking.
+ */
+void
+metaslab_flush_finish(metaslab_t *msp, dmu_tx_t *tx)
+{
+	spa_t *spa = msp->ms_group->mg_vd->vdev_spa;
+
+	ASSERT(MUTEX_HELD(&msp->ms_lock));
+	ASSERT(msp->ms_flushing);
 
-	uint64_t sm_len_after = space_map_length(msp->ms_sm);
 	if (zfs_flags & ZFS_DEBUG_LOG_SPACEMAP) {
 		zfs_dbgmsg("flushing: txg %llu, spa %s, vdev_id %llu, "
 		    "ms_id %llu, unflushed_allocs %llu, unflushed_frees %llu, "
-		    "appended %llu bytes", (u_longlong_t)dmu_tx_get_txg(tx),
+		    "sm_len %llu", (u_longlong_t)dmu_tx_get_txg(tx),
 		    spa_name(spa),
 		    (u_longlong_t)msp->ms_group->mg_vd->vdev_id,
 		    (u_longlong_t)msp->ms_id,
@@ -4221,7 +4442,7 @@ metaslab_flush(metaslab_t *msp, dmu_tx_t *tx)
 		    msp->ms_unflushed_allocs),
 		    (u_longlong_t)zfs_range_tree_space(
 		    msp->ms_unflushed_frees),
-		    (u_longlong_t)(sm_len_after - sm_len_before));
+		    (u_longlong_t)space_map_length(msp->ms_sm));
 	}
 
 	ASSERT3U(spa->spa_unflushed_stats.sus_memused, >=,
@@ -4241,6 +4462,22 @@ metaslab_flush(metaslab_t *msp, dmu_tx_t *tx)
 
 	msp->ms_flushing = B_FALSE;
 	cv_broadcast(&msp->ms_flush_cv);
+}
+
+boolean_t
+metaslab_flush(metaslab_t *msp, dmu_tx_t *tx)
+{
+	int started = metaslab_flush_start(msp, tx);
+
+	if (started < 0)
+		return (B_FALSE);
+	if (started == 0)
+		return (B_TRUE);
+
+	mutex_exit(&msp->ms_lock);
+	metaslab_flush_write(msp, tx);
+	mutex_enter(&msp->ms_lock);
+	metaslab_flush_finish(msp, tx);
 	return (B_TRUE);
 }
 
@@ -5364,6 +5601,108 @@ metaslab_group_allocatable(spa_t *spa, metaslab_group_t *mg, uint64_t psize,
 	return (B_TRUE);
 }
 
+/*
+ * Serve an eligible allocation from the class allocator's magazine: a
+ * constant-time carve from the remainder of an earlier, intentionally
+ * inflated allocation on the same vdev in the same txg.  Returns
+ * B_TRUE and fills dva[d] on success.
+ */
+static boolean_t
+metaslab_magazine_alloc(spa_t *spa, metaslab_class_allocator_t *mca,
+    uint64_t psize, dva_t *dva, int d, uint64_t txg)
+{
+	boolean_t served = B_FALSE;
+
+	mutex_enter(&mca->mca_mag_lock);
+	if (mca->mca_mag_size != 0 && mca->mca_mag_txg == txg) {
+		vdev_t *vd = vdev_lookup_top(spa, mca->mca_mag_vdev);
+		uint64_t asize = vdev_psize_to_asize_txg(vd, psize, txg);
+
+		ASSERT0(P2PHASE(asize, 1ULL << vd->vdev_ashift));
+		if (asize <= mca->mca_mag_size) {
+			DVA_SET_VDEV(&dva[d], mca->mca_mag_vdev);
+			DVA_SET_OFFSET(&dva[d], mca->mca_mag_offset);
+			DVA_SET_GANG(&dva[d], 0);
+			DVA_SET_ASIZE(&dva[d], asize);
+			mca->mca_mag_offset += asize;
+			mca->mca_mag_size -= asize;
+			served = B_TRUE;
+		}
+	}
+	mutex_exit(&mca->mca_mag_lock);
+
+	return (served);
+}
+
+/*
+ * Stash the remainder of an inflated allocation in the magazine, or
+ * free it through the normal path if the slot is unusable (occupied,
+ * or on a dRAID vdev whose rows must not be subdivided).  Eligible
+ * allocations only happen in syncing context, so the free is safe.
+ */
+static void
+metaslab_magazine_refill(spa_t *spa, metaslab_class_allocator_t *mca,
+    vdev_t *vd, uint64_t offset, uint64_t size, uint64_t txg)
+{
+	boolean_t stash = (vd->vdev_ops != &vdev_draid_ops);
+
+	mutex_enter(&mca->mca_mag_lock);
+	mca->mca_mag_refilling = B_FALSE;
+	if (stash && mca->mca_mag_size == 0) {
+		mca->mca_mag_vdev = vd->vdev_id;
+		mca->mca_mag_offset = offset;
+		mca->mca_mag_size = size;
+		mca->mca_mag_txg = txg;
+		size = 0;
+	}
+	mutex_exit(&mca->mca_mag_lock);
+
+	if (size != 0)
+		metaslab_free_concrete(vd, offset, size, B_FALSE);
+}
+
+/*
+ * Return whatever the magazines still hold for txgs up to the given
+ * one through the normal free path.  Called from spa_sync() before the
+ * metaslabs sync, so a remainder is either unwound in the txg that
+ * allocated it or freed in the next.
+ */
+void
+metaslab_magazines_drain(spa_t *spa, uint64_t txg)
+{
+	metaslab_class_t *classes[] = {
+		spa_normal_class(spa), spa_log_class(spa),
+		spa_embedded_log_class(spa), spa_special_class(spa),
+		spa_dedup_class(spa)
+	};
+
+	for (uint_t c = 0; c < ARRAY_SIZE(classes); c++) {
+		metaslab_class_t *mc = classes[c];
+
+		if (mc == NULL)
+			continue;
+		for (int i = 0; i < spa->spa_alloc_count; i++) {
+			metaslab_class_allocator_t *mca = &mc->mc_allocator[i];
+			uint64_t vdev_id, offset, size;
+
+			mutex_enter(&mca->mca_mag_lock);
+			if (mca->mca_mag_size == 0 ||
+			    mca->mca_mag_txg > txg) {
+				mutex_exit(&mca->mca_mag_lock);
+				continue;
+			}
+			vdev_id = mca->mca_mag_vdev;
+			offset = mca->mca_mag_offset;
+			size = mca->mca_mag_size;
+			mca->mca_mag_size = 0;
+			mutex_exit(&mca->mca_mag_lock);
+
+			metaslab_free_concrete(vdev_lookup_top(spa, vdev_id),
+			    offset, size, B_FALSE);
+		}
+	}
+}
+
 static int
 metaslab_alloc_dva_range(spa_t *spa, metaslab_class_t *mc, uint64_t psize,
     uint64_t max_psize, dva_t *dva, int d, const dva_t *hintdva, uint64_t txg,
@@ -5398,6 +5737,32 @@ metaslab_alloc_dva_range(spa_t *spa, metaslab_class_t *mc, uint64_t psize,
 	}
 	ASSERT3U(psize, <=, max_psize);
 
+	/*
+	 * Try the class allocator's magazine first, and if it cannot
+	 * serve us, volunteer (one thread at a time) to refill it by
+	 * inflating this allocation.
+	 */
+	boolean_t magazine = (zfs_metaslab_magazine != 0 && d == 0 &&
+	    hintdva == NULL && psize == max_psize && txg != 0 &&
+	    psize <= zfs_metaslab_magazine_max_size &&
+	    (flags & ~(METASLAB_ASYNC_ALLOC | METASLAB_LOCALITY)) == 0);
+	if (magazine) {
+		if (metaslab_magazine_alloc(spa, mca, psize, dva, d, txg)) {
+			if (actual_psize)
+				*actual_psize = psize;
+			return (0);
+		}
+		mutex_enter(&mca->mca_mag_lock);
+		if (!mca->mca_mag_refilling && mca->mca_mag_size == 0) {
+			mca->mca_mag_refilling = B_TRUE;
+			max_psize = MIN((uint64_t)psize *
+			    zfs_metaslab_magazine, SPA_MAXBLOCKSIZE);
+		} else {
+			magazine = B_FALSE;
+		}
+		mutex_exit(&mca->mca_mag_lock);
+	}
+
 	/*
 	 * Start at the rotor and loop through all mgs until we find something.
 	 * Note that there's no locking on mca_rotor or mca_aliquot because
@@ -5453,20 +5818,48 @@ top:
 		    &asize);
 
 		if (offset != -1ULL) {
+			if (magazine) {
+				/*
+				 * Keep only what was asked for and stash
+				 * (or free) the inflation remainder.
+				 */
+				uint64_t want = vdev_psize_to_asize_txg(vd,
+				    psize, txg);
+				if (asize > want) {
+					metaslab_magazine_refill(spa, mca,
+					    vd, offset + want, asize - want,
+					    txg);
+					asize = want;
+				} else {
+					mutex_enter(&mca->mca_mag_lock);
+					mca->mca_mag_refilling = B_FALSE;
+					mutex_exit(&mca->mca_mag_lock);
+				}
+			}
 			if (actual_psize)
 				*actual_psize = vdev_asize_to_psize_txg(vd,
 				    asize, txg);
-			metaslab_class_rotate(mg, allocator, psize, B_TRUE);
+			metaslab_class_rotate(mg, allocator, psize, flags,
+			    B_TRUE);
 
 			DVA_SET_VDEV(&dva[d], vd->vdev_id);
 			DVA_SET_OFFSET(&dva[d], offset);
 			DVA_SET_GANG(&dva[d],
 			    ((flags & METASLAB_GANG_HEADER) ? 1 : 0));
 			DVA_SET_ASIZE(&dva[d], asize);
+
+			/*
+			 * A data allocation that only succeeded on the
+			 * try-hard pass is a gang write that was avoided.
+			 */
+			if (try_hard && !GANG_ALLOCATION(flags) &&
+			    !(flags & METASLAB_ZIL) &&
+			    psize > spa->spa_min_alloc)
+				spa_iostats_gang_avoided_add(spa);
 			return (0);
 		}
 next:
-		metaslab_class_rotate(mg, allocator, psize, B_FALSE);
+		metaslab_class_rotate(mg, allocator, psize, flags, B_FALSE);
 	} while ((mg = mg->mg_next) != rotor);
 
 	/*
@@ -5480,6 +5873,12 @@ next:
 		goto top;
 	}
 
+	if (magazine) {
+		mutex_enter(&mca->mca_mag_lock);
+		mca->mca_mag_refilling = B_FALSE;
+		mutex_exit(&mca->mca_mag_lock);
+	}
+
 	memset(&dva[d], 0, sizeof (dva_t));
 
 	metaslab_trace_add(zal, rotor, NULL, psize, d, TRACE_ENOSPC, allocator);
@@ -6436,6 +6835,15 @@ ZFS_MODULE_PARAM(zfs_metaslab, metaslab_, force_ganging, U64, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_metaslab, metaslab_, force_ganging_pct, UINT, ZMOD_RW,
 	"Percentage of large blocks that will be forced to be gang blocks");
 
+ZFS_MODULE_PARAM(zfs_metaslab, zfs_metaslab_, magazine, UINT, ZMOD_RW,
+	"Inflation factor feeding per-allocator magazines (0=off)");
+
+ZFS_MODULE_PARAM(zfs_metaslab, zfs_metaslab_, magazine_max_size, UINT,
+	ZMOD_RW, "Largest allocation served from the magazines");
+
+ZFS_MODULE_PARAM(zfs, zfs_, alloc_latency_target_ms, UINT, ZMOD_RW,
+	"Leaf latency target closing the loop on the allocation throttle");
+
 ZFS_MODULE_PARAM(zfs_metaslab, metaslab_, df_max_search, UINT, ZMOD_RW,
 	"Max distance (bytes) to search forward before using size tree");
 
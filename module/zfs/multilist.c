@@ -94,12 +94,18 @@ multilist_create_impl(multilist_t *ml, size_t size, size_t offset,
 }
 
 /*
- * Allocate a new multilist, using the default number of sublists (the number
- * of CPUs, or at least 4, or the tunable zfs_multilist_num_sublists). Note
- * that the multilists do not expand if more CPUs are hot-added. In that case,
- * we will have less fanout than boot_ncpus, but we don't want to always
- * reserve the RAM necessary to create the extra slots for additional CPUs up
- * front, and dynamically adding them is a complex task.
+ * Allocate a new multilist, using the default number of sublists (the
+ * number of possible CPUs, or at least 4, or the tunable
+ * zfs_multilist_num_sublists).  Sizing by max_ncpus rather than
+ * boot_ncpus means a hot-pluggable VM that boots small and grows keeps
+ * full fanout: the possible-CPU count reflects the topology ceiling,
+ * and a sublist is less than a hundred bytes, so the headroom is
+ * cheap.  The fanout still cannot change after creation -- every
+ * consumer embeds sublist indices in its iteration state, so online
+ * split/merge would mean stop-the-world migration of the very lists
+ * the fanout exists to keep unlocked -- which is why over- or
+ * under-provisioned topologies are handled by sizing generously here
+ * and by the tunable, not adaptively.
  */
 void
 multilist_create(multilist_t *ml, size_t size, size_t offset,
@@ -110,12 +116,24 @@ multilist_create(multilist_t *ml, size_t size, size_t offset,
 	if (zfs_multilist_num_sublists > 0) {
 		num_sublists = zfs_multilist_num_sublists;
 	} else {
-		num_sublists = MAX(boot_ncpus, 4);
+		num_sublists = MAX(MIN(max_ncpus, 256), 4);
 	}
 
 	multilist_create_impl(ml, size, offset, num_sublists, index_func);
 }
 
+/*
+ * Allocate a new multilist with an explicit number of sublists, for
+ * consumers (e.g. the NUMA-aware ARC lists) which need the sublist count
+ * to satisfy constraints the default heuristic knows nothing about.
+ */
+void
+multilist_create_num(multilist_t *ml, size_t size, size_t offset,
+    uint_t num_sublists, multilist_sublist_index_func_t *index_func)
+{
+	multilist_create_impl(ml, size, offset, num_sublists, index_func);
+}
+
 /*
  * Destroy the given multilist object, and free up any memory it holds.
  */
@@ -127,6 +127,19 @@
  * and the layout/attribute ZAP attributes are available.  Because of this
  * the SA attributes will be byteswapped when they are first accessed by
  * the SA code that will read the SA data.
+ *
+ * A recurring proposal is an inline-data SA attribute holding tiny file
+ * contents in the dnode itself.  The mechanism below could store the
+ * bytes, but the feature is an on-disk format change with a sharp
+ * failure mode: an implementation that doesn't know the attribute sees
+ * a zero-length or sparse file where data exists, so it needs a
+ * read-incompatible feature flag plus awareness in every data path -
+ * read, write, mmap, truncate and grow spill-out, send/recv, and
+ * scrub's expectations about where file data lives.  Note also the
+ * gains are smaller than they look: blocks up to 112 bytes already
+ * embed in the block pointer, dnode blocks amortize over 32 dnodes so
+ * the "second I/O" is usually already cached for git-style trees, and
+ * bonus space left by dnodesize=auto is claimed by xattr=sa first.
  */
 
 typedef void (sa_iterfunc_t)(void *hdr, void *addr, sa_attr_type_t,
@@ -411,7 +424,7 @@ sa_add_layout_entry(objset_t *os, const sa_attr_type_t *attrs, int attr_count,
 	int i;
 	avl_index_t loc;
 
-	ASSERT(MUTEX_HELD(&sa->sa_lock));
+	ASSERT(RW_WRITE_HELD(&sa->sa_lock));
 	tb = kmem_zalloc(sizeof (sa_lot_t), KM_SLEEP);
 	tb->lot_attr_count = attr_count;
 	tb->lot_attrs = kmem_alloc(sizeof (sa_attr_type_t) * attr_count,
@@ -468,7 +481,7 @@ sa_find_layout(objset_t *os, uint64_t hash, sa_attr_type_t *attrs,
 	sa_os_t *sa = os->os_sa;
 	boolean_t found = B_FALSE;
 
-	mutex_enter(&sa->sa_lock);
+	rw_enter(&sa->sa_lock, RW_WRITER);
 	tbsearch.lot_hash = hash;
 	tbsearch.lot_instance = 0;
 	tb = avl_find(&sa->sa_layout_hash_tree, &tbsearch, &loc);
@@ -485,7 +498,7 @@ sa_find_layout(objset_t *os, uint64_t hash, sa_attr_type_t *attrs,
 		tb = sa_add_layout_entry(os, attrs, count,
 		    avl_numnodes(&sa->sa_layout_num_tree), hash, B_TRUE, tx);
 	}
-	mutex_exit(&sa->sa_lock);
+	rw_exit(&sa->sa_lock);
 	*lot = tb;
 }
 
@@ -796,7 +809,16 @@ sa_build_layouts(sa_handle_t *hdl, sa_bulk_attr_t *attr_desc, int attr_count,
 		sa_idx_tab_rele(hdl->sa_os, hdl->sa_spill_tab);
 		if (!spilling) {
 			/*
-			 * remove spill block that is no longer needed.
+			 * Remove the spill block that is no longer needed.
+			 * This is also the spill-to-bonus compaction path:
+			 * any attribute update that shrinks the set enough
+			 * to fit the bonus buffer again (sa_modify_attrs()
+			 * funnels removals and replacements through here)
+			 * migrates everything back and frees the spill
+			 * block, so overflowed objects don't keep paying
+			 * the extra block forever.  There is deliberately
+			 * no background compaction: it would dirty
+			 * otherwise-idle objects just to move data.
 			 */
 			dmu_buf_rele(hdl->sa_spill, NULL);
 			hdl->sa_spill = NULL;
@@ -1007,20 +1029,20 @@ sa_setup(objset_t *os, uint64_t sa_obj, const sa_attr_reg_t *reg_attrs,
 
 	mutex_enter(&os->os_user_ptr_lock);
 	if (os->os_sa) {
-		mutex_enter(&os->os_sa->sa_lock);
+		rw_enter(&os->os_sa->sa_lock, RW_READER);
 		mutex_exit(&os->os_user_ptr_lock);
 		tb = os->os_sa->sa_user_table;
-		mutex_exit(&os->os_sa->sa_lock);
+		rw_exit(&os->os_sa->sa_lock);
 		*user_table = tb;
 		return (0);
 	}
 
 	sa = kmem_zalloc(sizeof (sa_os_t), KM_SLEEP);
-	mutex_init(&sa->sa_lock, NULL, MUTEX_NOLOCKDEP, NULL);
+	rw_init(&sa->sa_lock, NULL, RW_NOLOCKDEP, NULL);
 	sa->sa_master_obj = sa_obj;
 
 	os->os_sa = sa;
-	mutex_enter(&sa->sa_lock);
+	rw_enter(&sa->sa_lock, RW_WRITER);
 	mutex_exit(&os->os_user_ptr_lock);
 	avl_create(&sa->sa_layout_num_tree, layout_num_compare,
 	    sizeof (sa_lot_t), offsetof(sa_lot_t, lot_num_node));
@@ -1107,17 +1129,17 @@ sa_setup(objset_t *os, uint64_t sa_obj, const sa_attr_reg_t *reg_attrs,
 		    0, B_FALSE, NULL);
 	}
 	*user_table = os->os_sa->sa_user_table;
-	mutex_exit(&sa->sa_lock);
+	rw_exit(&sa->sa_lock);
 	return (0);
 fail:
 	os->os_sa = NULL;
 	sa_free_attr_table(sa);
 	if (sa->sa_user_table)
 		kmem_free(sa->sa_user_table, sa->sa_user_table_sz);
-	mutex_exit(&sa->sa_lock);
+	rw_exit(&sa->sa_lock);
 	avl_destroy(&sa->sa_layout_hash_tree);
 	avl_destroy(&sa->sa_layout_num_tree);
-	mutex_destroy(&sa->sa_lock);
+	rw_destroy(&sa->sa_lock);
 	kmem_free(sa, sizeof (sa_os_t));
 	return ((error == ECKSUM) ? EIO : error);
 }
@@ -1154,7 +1176,7 @@ sa_tear_down(objset_t *os)
 
 	avl_destroy(&sa->sa_layout_hash_tree);
 	avl_destroy(&sa->sa_layout_num_tree);
-	mutex_destroy(&sa->sa_lock);
+	rw_destroy(&sa->sa_lock);
 
 	kmem_free(sa, sizeof (sa_os_t));
 	os->os_sa = NULL;
@@ -1244,7 +1266,7 @@ sa_byteswap(sa_handle_t *hdl, sa_buf_type_t buftype)
 	int i;
 	sa_os_t *sa __maybe_unused = hdl->sa_os->os_sa;
 
-	ASSERT(MUTEX_HELD(&sa->sa_lock));
+	ASSERT(RW_WRITE_HELD(&sa->sa_lock));
 	if (sa_hdr_phys->sa_magic == SA_MAGIC)
 		return;
 
@@ -1294,21 +1316,30 @@ sa_build_index(sa_handle_t *hdl, sa_buf_type_t buftype)
 
 	sa_hdr_phys = SA_GET_HDR(hdl, buftype);
 
-	mutex_enter(&sa->sa_lock);
-
 	/* Do we need to byteswap? */
 
 	/* only check if not old znode */
 	if (IS_SA_BONUSTYPE(bonustype) && sa_hdr_phys->sa_magic != SA_MAGIC &&
 	    sa_hdr_phys->sa_magic != 0) {
-		if (BSWAP_32(sa_hdr_phys->sa_magic) != SA_MAGIC) {
-			mutex_exit(&sa->sa_lock);
-			zfs_dbgmsg("Buffer Header: %x != SA_MAGIC:%x "
-			    "object=%#llx\n", sa_hdr_phys->sa_magic, SA_MAGIC,
-			    (u_longlong_t)db->db.db_object);
-			return (SET_ERROR(EIO));
+		/*
+		 * Swapping is exclusive, and the write lock also keeps a
+		 * concurrent handle for the same buffer from seeing a
+		 * half-swapped header.  Re-check the magic once locked;
+		 * another thread may have swapped this buffer already.
+		 */
+		rw_enter(&sa->sa_lock, RW_WRITER);
+		if (sa_hdr_phys->sa_magic != SA_MAGIC) {
+			if (BSWAP_32(sa_hdr_phys->sa_magic) != SA_MAGIC) {
+				rw_exit(&sa->sa_lock);
+				zfs_dbgmsg("Buffer Header: %x != SA_MAGIC:%x "
+				    "object=%#llx\n", sa_hdr_phys->sa_magic,
+				    SA_MAGIC,
+				    (u_longlong_t)db->db.db_object);
+				return (SET_ERROR(EIO));
+			}
+			sa_byteswap(hdl, buftype);
 		}
-		sa_byteswap(hdl, buftype);
+		rw_exit(&sa->sa_lock);
 	}
 
 	idx_tab = sa_find_idx_tab(hdl->sa_os, bonustype, sa_hdr_phys);
@@ -1318,7 +1349,6 @@ sa_build_index(sa_handle_t *hdl, sa_buf_type_t buftype)
 	else
 		hdl->sa_spill_tab = idx_tab;
 
-	mutex_exit(&sa->sa_lock);
 	return (0);
 }
 
@@ -1338,7 +1368,7 @@ sa_idx_tab_rele(objset_t *os, void *arg)
 	if (idx_tab == NULL)
 		return;
 
-	mutex_enter(&sa->sa_lock);
+	rw_enter(&sa->sa_lock, RW_WRITER);
 	if (zfs_refcount_remove(&idx_tab->sa_refcount, NULL) == 0) {
 		list_remove(&idx_tab->sa_layout->lot_idx_tab, idx_tab);
 		if (idx_tab->sa_variable_lengths)
@@ -1350,7 +1380,7 @@ sa_idx_tab_rele(objset_t *os, void *arg)
 		    sizeof (uint32_t) * sa->sa_num_attrs);
 		kmem_free(idx_tab, sizeof (sa_idx_tab_t));
 	}
-	mutex_exit(&sa->sa_lock);
+	rw_exit(&sa->sa_lock);
 }
 
 static void
@@ -1358,7 +1388,7 @@ sa_idx_tab_hold(objset_t *os, sa_idx_tab_t *idx_tab)
 {
 	sa_os_t *sa __maybe_unused = os->os_sa;
 
-	ASSERT(MUTEX_HELD(&sa->sa_lock));
+	ASSERT(RW_LOCK_HELD(&sa->sa_lock));
 	(void) zfs_refcount_add(&idx_tab->sa_refcount, NULL);
 }
 
@@ -1760,10 +1790,44 @@ out:
 }
 #endif
 
+/*
+ * Search a layout's TOC list for an index table matching the header's
+ * variable lengths.  Returns the table with a hold, or NULL.  The caller
+ * must hold sa_lock (either mode; releases take it as writer, so a table
+ * found under the reader lock cannot be freed before the hold lands).
+ */
 static sa_idx_tab_t *
-sa_find_idx_tab(objset_t *os, dmu_object_type_t bonustype, sa_hdr_phys_t *hdr)
+sa_idx_tab_search(objset_t *os, sa_lot_t *tb, sa_hdr_phys_t *hdr)
 {
 	sa_idx_tab_t *idx_tab;
+
+	for (idx_tab = list_head(&tb->lot_idx_tab); idx_tab;
+	    idx_tab = list_next(&tb->lot_idx_tab, idx_tab)) {
+		boolean_t valid_idx = B_TRUE;
+		int i;
+
+		if (tb->lot_var_sizes != 0 &&
+		    idx_tab->sa_variable_lengths != NULL) {
+			for (i = 0; i != tb->lot_var_sizes; i++) {
+				if (hdr->sa_lengths[i] !=
+				    idx_tab->sa_variable_lengths[i]) {
+					valid_idx = B_FALSE;
+					break;
+				}
+			}
+		}
+		if (valid_idx) {
+			sa_idx_tab_hold(os, idx_tab);
+			return (idx_tab);
+		}
+	}
+	return (NULL);
+}
+
+static sa_idx_tab_t *
+sa_find_idx_tab(objset_t *os, dmu_object_type_t bonustype, sa_hdr_phys_t *hdr)
+{
+	sa_idx_tab_t *idx_tab, *found;
 	sa_os_t *sa = os->os_sa;
 	sa_lot_t *tb, search;
 	avl_index_t loc;
@@ -1777,8 +1841,14 @@ sa_find_idx_tab(objset_t *os, dmu_object_type_t bonustype, sa_hdr_phys_t *hdr)
 	 * doesn't write any attributes to the bonus buffer.
 	 */
 
+	/*
+	 * The header must not be read before taking sa_lock: sa_byteswap()
+	 * (run under the writer lock) swaps sa_magic first, so a thread
+	 * that saw SA_MAGIC early could otherwise read the rest of the
+	 * header before it has been swapped.
+	 */
+	rw_enter(&sa->sa_lock, RW_READER);
 	search.lot_num = SA_LAYOUT_NUM(hdr, bonustype);
-
 	tb = avl_find(&sa->sa_layout_num_tree, &search, &loc);
 
 	/* Verify header size is consistent with layout information */
@@ -1789,30 +1859,20 @@ sa_find_idx_tab(objset_t *os, dmu_object_type_t bonustype, sa_hdr_phys_t *hdr)
 
 	/*
 	 * See if any of the already existing TOC entries can be reused?
+	 * This is the common case for every handle after the first for a
+	 * given layout, so it runs under the reader lock.
 	 */
+	found = sa_idx_tab_search(os, tb, hdr);
+	rw_exit(&sa->sa_lock);
+	if (found != NULL)
+		return (found);
 
-	for (idx_tab = list_head(&tb->lot_idx_tab); idx_tab;
-	    idx_tab = list_next(&tb->lot_idx_tab, idx_tab)) {
-		boolean_t valid_idx = B_TRUE;
-		int i;
-
-		if (tb->lot_var_sizes != 0 &&
-		    idx_tab->sa_variable_lengths != NULL) {
-			for (i = 0; i != tb->lot_var_sizes; i++) {
-				if (hdr->sa_lengths[i] !=
-				    idx_tab->sa_variable_lengths[i]) {
-					valid_idx = B_FALSE;
-					break;
-				}
-			}
-		}
-		if (valid_idx) {
-			sa_idx_tab_hold(os, idx_tab);
-			return (idx_tab);
-		}
-	}
-
-	/* No such luck, create a new entry */
+	/*
+	 * No such luck, create a new entry.  The layout itself is stable
+	 * (layouts live until sa_tear_down()), so the table can be built
+	 * without the lock; only the list insertion needs the writer lock,
+	 * where we must re-search in case another thread beat us to it.
+	 */
 	idx_tab = kmem_zalloc(sizeof (sa_idx_tab_t), KM_SLEEP);
 	idx_tab->sa_idx_tab =
 	    kmem_zalloc(sizeof (uint32_t) * sa->sa_num_attrs, KM_SLEEP);
@@ -1824,9 +1884,24 @@ sa_find_idx_tab(objset_t *os, dmu_object_type_t bonustype, sa_hdr_phys_t *hdr)
 
 	sa_attr_iter(os, hdr, bonustype, sa_build_idx_tab,
 	    tb, idx_tab);
+
+	rw_enter(&sa->sa_lock, RW_WRITER);
+	found = sa_idx_tab_search(os, tb, hdr);
+	if (found != NULL) {
+		rw_exit(&sa->sa_lock);
+		if (idx_tab->sa_variable_lengths)
+			kmem_free(idx_tab->sa_variable_lengths,
+			    sizeof (uint16_t) * tb->lot_var_sizes);
+		zfs_refcount_destroy(&idx_tab->sa_refcount);
+		kmem_free(idx_tab->sa_idx_tab,
+		    sizeof (uint32_t) * sa->sa_num_attrs);
+		kmem_free(idx_tab, sizeof (sa_idx_tab_t));
+		return (found);
+	}
 	sa_idx_tab_hold(os, idx_tab);   /* one hold for consumer */
 	sa_idx_tab_hold(os, idx_tab);	/* one for layout */
 	list_insert_tail(&tb->lot_idx_tab, idx_tab);
+	rw_exit(&sa->sa_lock);
 	return (idx_tab);
 }
 
@@ -1848,10 +1923,10 @@ sa_attr_register_sync(sa_handle_t *hdl, dmu_tx_t *tx)
 	sa_attr_table_t *tb = sa->sa_attr_table;
 	int i;
 
-	mutex_enter(&sa->sa_lock);
+	rw_enter(&sa->sa_lock, RW_WRITER);
 
 	if (!sa->sa_need_attr_registration || sa->sa_master_obj == 0) {
-		mutex_exit(&sa->sa_lock);
+		rw_exit(&sa->sa_lock);
 		return;
 	}
 
@@ -1870,7 +1945,7 @@ sa_attr_register_sync(sa_handle_t *hdl, dmu_tx_t *tx)
 		tb[i].sa_registered = B_TRUE;
 	}
 	sa->sa_need_attr_registration = B_FALSE;
-	mutex_exit(&sa->sa_lock);
+	rw_exit(&sa->sa_lock);
 }
 
 /*
@@ -2203,7 +2278,7 @@ sa_get_userdata(sa_handle_t *hdl)
 void
 sa_register_update_callback_locked(objset_t *os, sa_update_cb_t *func)
 {
-	ASSERT(MUTEX_HELD(&os->os_sa->sa_lock));
+	ASSERT(RW_WRITE_HELD(&os->os_sa->sa_lock));
 	os->os_sa->sa_update_cb = func;
 }
 
@@ -2211,9 +2286,9 @@ void
 sa_register_update_callback(objset_t *os, sa_update_cb_t *func)
 {
 
-	mutex_enter(&os->os_sa->sa_lock);
+	rw_enter(&os->os_sa->sa_lock, RW_WRITER);
 	sa_register_update_callback_locked(os, func);
-	mutex_exit(&os->os_sa->sa_lock);
+	rw_exit(&os->os_sa->sa_lock);
 }
 
 uint64_t
@@ -1309,6 +1309,7 @@ spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 	ASSERT3U(count, >, 0);
 	tqs->stqs_count = count;
 	tqs->stqs_taskq = kmem_alloc(count * sizeof (taskq_t *), KM_SLEEP);
+	tqs->stqs_depth = kmem_zalloc(count * sizeof (uint64_t), KM_SLEEP);
 
 	for (uint_t i = 0; i < count; i++) {
 		taskq_t *tq;
@@ -1362,7 +1363,9 @@ spa_taskqs_fini(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 	}
 
 	kmem_free(tqs->stqs_taskq, tqs->stqs_count * sizeof (taskq_t *));
+	kmem_free(tqs->stqs_depth, tqs->stqs_count * sizeof (uint64_t));
 	tqs->stqs_taskq = NULL;
+	tqs->stqs_depth = NULL;
 }
 
 #ifdef _KERNEL
@@ -1694,12 +1697,89 @@ spa_taskq_free_param(ZFS_MODULE_PARAM_ARGS)
  * Note that a type may have multiple discrete taskqs to avoid lock contention
  * on the taskq itself.
  */
+/*
+ * Counters for the depth-balanced dispatch below, exported through the
+ * zio_taskq kstat: total multi-taskq dispatches, and how many of them
+ * were diverted from their hashed taskq to a less loaded one.
+ */
+static struct {
+	wmsum_t std_total;
+	wmsum_t std_diverted;
+} spa_taskq_sums;
+
+typedef struct spa_taskq_stats {
+	kstat_named_t std_total;
+	kstat_named_t std_diverted;
+} spa_taskq_stats_t;
+
+static spa_taskq_stats_t spa_taskq_stats = {
+	{ "dispatch_total",		KSTAT_DATA_UINT64 },
+	{ "dispatch_diverted",		KSTAT_DATA_UINT64 },
+};
+
+static kstat_t *spa_taskq_ksp;
+
+static int
+spa_taskq_stat_update(kstat_t *ksp, int rw)
+{
+	spa_taskq_stats_t *sts = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (SET_ERROR(EACCES));
+	sts->std_total.value.ui64 = wmsum_value(&spa_taskq_sums.std_total);
+	sts->std_diverted.value.ui64 =
+	    wmsum_value(&spa_taskq_sums.std_diverted);
+	return (0);
+}
+
+void
+spa_taskq_stat_init(void)
+{
+	wmsum_init(&spa_taskq_sums.std_total, 0);
+	wmsum_init(&spa_taskq_sums.std_diverted, 0);
+
+	spa_taskq_ksp = kstat_create("zfs", 0, "zio_taskq", "misc",
+	    KSTAT_TYPE_NAMED,
+	    sizeof (spa_taskq_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (spa_taskq_ksp != NULL) {
+		spa_taskq_ksp->ks_data = &spa_taskq_stats;
+		spa_taskq_ksp->ks_update = spa_taskq_stat_update;
+		kstat_install(spa_taskq_ksp);
+	}
+}
+
+void
+spa_taskq_stat_fini(void)
+{
+	if (spa_taskq_ksp != NULL) {
+		kstat_delete(spa_taskq_ksp);
+		spa_taskq_ksp = NULL;
+	}
+	wmsum_fini(&spa_taskq_sums.std_total);
+	wmsum_fini(&spa_taskq_sums.std_diverted);
+}
+
+/*
+ * Trampoline that drops the dispatch depth count the zio was charged
+ * with once a worker picks it up, then runs the real function.
+ */
+static void
+spa_taskq_run(void *arg)
+{
+	zio_t *zio = arg;
+
+	atomic_dec_64(zio->io_tqdepth);
+	zio->io_tqdepth = NULL;
+	zio->io_tqfunc(zio);
+}
+
 void
 spa_taskq_dispatch(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
     task_func_t *func, zio_t *zio, boolean_t cutinline)
 {
 	spa_taskqs_t *tqs = &spa->spa_zio_taskq[t][q];
-	taskq_t *tq;
+	uint_t i;
 
 	ASSERT3P(tqs->stqs_taskq, !=, NULL);
 	ASSERT3U(tqs->stqs_count, !=, 0);
@@ -1713,16 +1793,38 @@ spa_taskq_dispatch(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
 	ASSERT(taskq_empty_ent(&zio->io_tqent));
 
 	if (tqs->stqs_count == 1) {
-		tq = tqs->stqs_taskq[0];
+		i = 0;
 	} else if ((t == ZIO_TYPE_WRITE) && (q == ZIO_TASKQ_ISSUE) &&
 	    ZIO_HAS_ALLOCATOR(zio)) {
-		tq = tqs->stqs_taskq[zio->io_allocator % tqs->stqs_count];
+		/*
+		 * Writes with an allocator keep their taskq affinity, so
+		 * zios sharing a metaslab allocator also share issue
+		 * threads and locks.
+		 */
+		i = zio->io_allocator % tqs->stqs_count;
 	} else {
-		tq = tqs->stqs_taskq[((uint64_t)gethrtime()) % tqs->stqs_count];
+		/*
+		 * Two-choice balancing: probe the hashed taskq and its
+		 * neighbor and queue on whichever has the shorter
+		 * backlog.  With mixed zio sizes this keeps one slow
+		 * queue from backing up while others idle, which is
+		 * most of the benefit of work stealing without needing
+		 * cross-queue migration inside the taskq layer.
+		 */
+		i = ((uint64_t)gethrtime()) % tqs->stqs_count;
+		uint_t j = (i + 1) % tqs->stqs_count;
+		wmsum_add(&spa_taskq_sums.std_total, 1);
+		if (tqs->stqs_depth[j] < tqs->stqs_depth[i]) {
+			i = j;
+			wmsum_add(&spa_taskq_sums.std_diverted, 1);
+		}
 	}
 
-	taskq_dispatch_ent(tq, func, zio, cutinline ? TQ_FRONT : 0,
-	    &zio->io_tqent);
+	atomic_inc_64(&tqs->stqs_depth[i]);
+	zio->io_tqdepth = &tqs->stqs_depth[i];
+	zio->io_tqfunc = func;
+	taskq_dispatch_ent(tqs->stqs_taskq[i], spa_taskq_run, zio,
+	    cutinline ? TQ_FRONT : 0, &zio->io_tqent);
 }
 
 static void
@@ -1925,6 +2027,15 @@ spa_activate(spa_t *spa, spa_mode_t mode)
 	    metaslab_preload_pct, maxclsyspri, 1, INT_MAX,
 	    TASKQ_DYNAMIC | TASKQ_THREADS_CPU_PCT);
 
+	/*
+	 * Optional taskq for concurrent log space map flushing; see
+	 * spa_flush_metaslabs().
+	 */
+	if (zfs_log_sm_flush_threads > 0) {
+		spa->spa_smflush_taskq = taskq_create("z_smflush",
+		    zfs_log_sm_flush_threads, maxclsyspri, 1, INT_MAX, 0);
+	}
+
 	/*
 	 * Taskq dedicated to prefetcher threads: this is used to prevent the
 	 * pool traverse code from monopolizing the global (and limited)
@@ -1969,6 +2080,11 @@ spa_deactivate(spa_t *spa)
 		spa->spa_metaslab_taskq = NULL;
 	}
 
+	if (spa->spa_smflush_taskq) {
+		taskq_destroy(spa->spa_smflush_taskq);
+		spa->spa_smflush_taskq = NULL;
+	}
+
 	if (spa->spa_prefetch_taskq) {
 		taskq_destroy(spa->spa_prefetch_taskq);
 		spa->spa_prefetch_taskq = NULL;
@@ -2190,6 +2306,10 @@ spa_destroy_aux_threads(spa_t *spa)
 		zthr_destroy(spa->spa_raidz_expand_zthr);
 		spa->spa_raidz_expand_zthr = NULL;
 	}
+	if (spa->spa_ddt_prune_zthr != NULL) {
+		zthr_destroy(spa->spa_ddt_prune_zthr);
+		spa->spa_ddt_prune_zthr = NULL;
+	}
 }
 
 static void
@@ -2354,6 +2474,7 @@ spa_unload(spa_t *spa)
 			vdev_autotrim_stop_all(spa);
 			vdev_rebuild_stop_all(spa);
 			l2arc_spa_rebuild_stop(spa);
+			arc_warmup_stop(spa);
 		}
 
 		spa_config_enter(spa, SCL_ALL, FTAG, RW_WRITER);
@@ -3032,6 +3153,77 @@ static uint_t spa_load_verify_shift = 4;
 static int spa_load_verify_metadata = B_TRUE;
 static int spa_load_verify_data = B_TRUE;
 
+/*
+ * Fan the verification traversal out over this many taskq workers
+ * (<= 1 keeps the historical single-threaded walk).  The callback
+ * below is safe to run concurrently: the error counts are atomics and
+ * the inflight throttle is under spa_scrub_lock.
+ */
+static uint_t spa_load_verify_threads = 0;
+
+/*
+ * Percentage of data blocks to verify when data verification runs.
+ * The sample is deterministic in the bookmark, so repeated imports
+ * check the same blocks.  Metadata is always fully verified; 100
+ * (the default) verifies every data block.
+ */
+static uint_t spa_load_verify_data_pct = 100;
+
+/*
+ * When nonzero, shrink the inflight window whenever the slowest leaf
+ * vdev's smoothed I/O latency exceeds this many milliseconds, and
+ * grow it back toward the spa_load_verify_shift cap while latency
+ * stays below it.  This keeps verification from overwhelming pools
+ * that are degraded or resilvering at import time.  Zero disables the
+ * controller and uses the fixed cap.
+ */
+static uint_t spa_load_verify_latency_ms = 0;
+
+static uint64_t
+spa_load_verify_vdev_latency(vdev_t *vd)
+{
+	uint64_t lat = 0;
+
+	if (vd->vdev_ops->vdev_op_leaf)
+		return (vdev_queue_latency(vd));
+	for (uint64_t c = 0; c < vd->vdev_children; c++) {
+		lat = MAX(lat,
+		    spa_load_verify_vdev_latency(vd->vdev_child[c]));
+	}
+	return (lat);
+}
+
+/*
+ * AIMD controller for the verification inflight window: halve on high
+ * latency, creep back up otherwise.  Called with spa_scrub_lock held;
+ * adjusts at most every 100ms.
+ */
+static uint64_t
+spa_load_verify_adapt(spa_t *spa, uint64_t cap)
+{
+	hrtime_t now = gethrtime();
+
+	ASSERT(MUTEX_HELD(&spa->spa_scrub_lock));
+
+	if (spa->spa_load_verify_window == 0)
+		spa->spa_load_verify_window = cap;
+
+	if (now - spa->spa_load_verify_adapt_ts > MSEC2NSEC(100)) {
+		uint64_t window = spa->spa_load_verify_window;
+
+		spa->spa_load_verify_adapt_ts = now;
+		if (spa_load_verify_vdev_latency(spa->spa_root_vdev) >
+		    MSEC2NSEC(spa_load_verify_latency_ms))
+			window = window / 2;
+		else
+			window += (window >> 3) + SPA_MAXBLOCKSIZE;
+		spa->spa_load_verify_window =
+		    MIN(MAX(window, SPA_MAXBLOCKSIZE), cap);
+	}
+
+	return (MIN(spa->spa_load_verify_window, cap));
+}
+
 static int
 spa_load_verify_cb(spa_t *spa, zilog_t *zilog, const blkptr_t *bp,
     const zbookmark_phys_t *zb, const dnode_phys_t *dnp, void *arg)
@@ -3064,15 +3256,29 @@ spa_load_verify_cb(spa_t *spa, zilog_t *zilog, const blkptr_t *bp,
 	    BP_IS_EMBEDDED(bp) || BP_IS_REDACTED(bp))
 		return (0);
 
-	if (!BP_IS_METADATA(bp) &&
-	    (!spa_load_verify_data || !sle->sle_verify_data))
-		return (0);
+	if (!BP_IS_METADATA(bp)) {
+		if (!spa_load_verify_data || !sle->sle_verify_data)
+			return (0);
+
+		/*
+		 * Deterministic sample of the data blocks: hash the
+		 * bookmark so the same blocks are checked on every
+		 * import attempt with the same setting.
+		 */
+		uint_t pct = MIN(spa_load_verify_data_pct, 100);
+		if (pct < 100 && ((zb->zb_objset ^ zb->zb_object) *
+		    2654435761ULL + zb->zb_blkid) % 100 >= pct)
+			return (0);
+	}
 
 	uint64_t maxinflight_bytes =
 	    arc_target_bytes() >> spa_load_verify_shift;
 	size_t size = BP_GET_PSIZE(bp);
 
 	mutex_enter(&spa->spa_scrub_lock);
+	if (spa_load_verify_latency_ms != 0)
+		maxinflight_bytes = spa_load_verify_adapt(spa,
+		    maxinflight_bytes);
 	while (spa->spa_load_verify_bytes >= maxinflight_bytes)
 		cv_wait(&spa->spa_scrub_io_cv, &spa->spa_scrub_lock);
 	spa->spa_load_verify_bytes += size;
@@ -3138,9 +3344,13 @@ spa_load_verify(spa_t *spa)
 			    spa_load_verify_data, spa_load_verify_metadata);
 		}
 
-		error = traverse_pool(spa, spa->spa_verify_min_txg,
+		spa->spa_load_verify_window = 0;
+		spa->spa_load_verify_adapt_ts = 0;
+
+		error = traverse_pool_parallel(spa, spa->spa_verify_min_txg,
 		    TRAVERSE_PRE | TRAVERSE_PREFETCH_METADATA |
-		    TRAVERSE_NO_DECRYPT, spa_load_verify_cb, rio);
+		    TRAVERSE_NO_DECRYPT, spa_load_verify_cb, rio,
+		    MIN(spa_load_verify_threads, 32));
 	}
 
 	(void) zio_wait(rio);
@@ -3618,6 +3828,11 @@ spa_spawn_aux_threads(spa_t *spa)
 	    zthr_create("z_checkpoint_discard",
 	    spa_checkpoint_discard_thread_check,
 	    spa_checkpoint_discard_thread, spa, minclsyspri);
+
+	ASSERT0P(spa->spa_ddt_prune_zthr);
+	spa->spa_ddt_prune_zthr = zthr_create_timer("z_ddt_prune",
+	    ddt_prune_thread_check, ddt_prune_thread, spa,
+	    SEC2NSEC(60), minclsyspri);
 }
 
 /*
@@ -3903,6 +4118,17 @@ spa_activity_check_required(spa_t *spa, uberblock_t *ub, nvlist_t *label)
 	 * exported pool on the same host which last imported it.  Since the
 	 * hostid from configuration may be stale use the one read from the
 	 * label.  Imports from other hostids must perform the activity check.
+	 *
+	 * The cross-host check survives even for planned failovers, and a
+	 * cooperative "release record" written by the exporting host would
+	 * not change that: the exporter can attest that *it* is done, but
+	 * the wait also defends against a third host importing the pool
+	 * concurrently - something only observing the uberblock stream
+	 * stay quiet can establish, and exactly the split-brain case MMP
+	 * exists for.  Failover stacks that have fenced the peer through
+	 * the storage fabric and accept that responsibility can shorten
+	 * the window via zfs_multihost_import_intervals rather than
+	 * bypassing the check's semantics.
 	 */
 	if (label != NULL) {
 		if (nvlist_exists(label, ZPOOL_CONFIG_HOSTID))
@@ -4948,6 +5174,41 @@ spa_ld_open_rootbp(spa_t *spa)
 	}
 	spa->spa_meta_objset = spa->spa_dsl_pool->dp_meta_objset;
 
+	/*
+	 * The rest of spa_load_impl() demand-faults its way through the
+	 * MOS in dependent read chains: the pool directory, the config,
+	 * the feature ZAPs, the vdev ZAP map and the dataset directory
+	 * tree.  On a cold HDD import each serial miss is a full seek,
+	 * so issue asynchronous prefetches for the known-hot objects as
+	 * soon as the MOS is readable.  The pool directory lookups
+	 * below then find their metadata already in flight; everything
+	 * here is advisory and errors are ignored.
+	 */
+	objset_t *mos = spa->spa_meta_objset;
+	dmu_prefetch(mos, DMU_POOL_DIRECTORY_OBJECT, 0, 0, UINT64_MAX,
+	    ZIO_PRIORITY_ASYNC_READ);
+	static const char *const hot[] = {
+		DMU_POOL_CONFIG,
+		DMU_POOL_FEATURES_FOR_READ,
+		DMU_POOL_FEATURES_FOR_WRITE,
+		DMU_POOL_FEATURE_ENABLED_TXG,
+		DMU_POOL_VDEV_ZAP_MAP,
+		DMU_POOL_ROOT_DATASET,
+		DMU_POOL_ERRLOG_LAST,
+		DMU_POOL_ERRLOG_SCRUB,
+		DMU_POOL_HISTORY,
+		DMU_POOL_PROPS,
+	};
+	for (uint_t i = 0; i < ARRAY_SIZE(hot); i++) {
+		uint64_t obj;
+
+		if (zap_lookup(mos, DMU_POOL_DIRECTORY_OBJECT, hot[i],
+		    sizeof (uint64_t), 1, &obj) == 0) {
+			dmu_prefetch(mos, obj, 0, 0, UINT64_MAX,
+			    ZIO_PRIORITY_ASYNC_READ);
+		}
+	}
+
 	return (0);
 }
 
@@ -6309,6 +6570,7 @@ spa_load_impl(spa_t *spa, spa_import_type_t type, const char **ereport)
 
 	spa_import_progress_remove(spa_guid(spa));
 	spa_async_request(spa, SPA_ASYNC_L2CACHE_REBUILD);
+	spa_async_request(spa, SPA_ASYNC_ARC_WARMUP_RESTORE);
 
 	spa_load_note(spa, "LOADED");
 fail:
@@ -7820,6 +8082,7 @@ spa_export_common(const char *pool, int new_state, nvlist_t **oldconfig,
 		vdev_autotrim_stop_all(spa);
 		vdev_rebuild_stop_all(spa);
 		l2arc_spa_rebuild_stop(spa);
+		arc_warmup_stop(spa);
 
 		/*
 		 * We want this to be reflected on every label,
@@ -9322,7 +9585,7 @@ spa_vdev_split_mirror(spa_t *spa, const char *newname, nvlist_t *config,
 	/* release the spa config lock, retaining the namespace lock */
 	spa_vdev_config_exit(spa, NULL, txg, 0, FTAG);
 
-	if (zio_injection_enabled)
+	if (zfs_static_key_enabled(&zio_injection_enabled))
 		zio_handle_panic_injection(spa, FTAG, 1);
 
 	spa_activate(newspa, spa_mode_global);
@@ -9390,7 +9653,7 @@ spa_vdev_split_mirror(spa_t *spa, const char *newname, nvlist_t *config,
 	vdev_config_dirty(newspa->spa_root_vdev);
 	(void) spa_vdev_config_exit(newspa, NULL, txg, 0, FTAG);
 
-	if (zio_injection_enabled)
+	if (zfs_static_key_enabled(&zio_injection_enabled))
 		zio_handle_panic_injection(spa, FTAG, 2);
 
 	spa_async_resume(newspa);
@@ -9431,7 +9694,7 @@ spa_vdev_split_mirror(spa_t *spa, const char *newname, nvlist_t *config,
 		dmu_tx_commit(tx);
 	(void) spa_vdev_exit(spa, NULL, txg, 0);
 
-	if (zio_injection_enabled)
+	if (zfs_static_key_enabled(&zio_injection_enabled))
 		zio_handle_panic_injection(spa, FTAG, 3);
 
 	/* split is complete; log a history record */
@@ -9945,6 +10208,12 @@ spa_async_thread(void *arg)
 		spa_namespace_exit(FTAG);
 	}
 
+	/*
+	 * Kick off the background prefetch of the ARC warmup snapshot.
+	 */
+	if (tasks & SPA_ASYNC_ARC_WARMUP_RESTORE)
+		arc_warmup_restore_start(spa);
+
 	/*
 	 * Let the world know that we're done.
 	 */
@@ -10737,6 +11006,7 @@ spa_sync_iterate_to_convergence(spa_t *spa, dmu_tx_t *tx)
 		spa_sync_aux_dev(spa, &spa->spa_l2cache, tx,
 		    ZPOOL_CONFIG_L2CACHE, DMU_POOL_L2CACHE);
 		spa_errlog_sync(spa, txg);
+		arc_warmup_sync(spa, txg);
 		dsl_pool_sync(dp, txg);
 
 		if (pass < zfs_sync_pass_deferred_free ||
@@ -10767,6 +11037,12 @@ spa_sync_iterate_to_convergence(spa_t *spa, dmu_tx_t *tx)
 
 		spa_flush_metaslabs(spa, tx);
 
+		/*
+		 * Return unconsumed magazine space before the metaslabs
+		 * sync below.
+		 */
+		metaslab_magazines_drain(spa, txg);
+
 		vdev_t *vd = NULL;
 		while ((vd = txg_list_remove(&spa->spa_vdev_txg_list, txg))
 		    != NULL)
@@ -11798,6 +12074,15 @@ ZFS_MODULE_PARAM(zfs_spa, spa_, load_verify_metadata, INT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_spa, spa_, load_verify_data, INT, ZMOD_RW,
 	"Set to traverse data on pool import");
 
+ZFS_MODULE_PARAM(zfs_spa, spa_, load_verify_threads, UINT, ZMOD_RW,
+	"Number of threads for the verification traversal on pool import");
+
+ZFS_MODULE_PARAM(zfs_spa, spa_, load_verify_data_pct, UINT, ZMOD_RW,
+	"Percentage of data blocks to verify on pool import");
+
+ZFS_MODULE_PARAM(zfs_spa, spa_, load_verify_latency_ms, UINT, ZMOD_RW,
+	"Leaf vdev latency (ms) above which import verification backs off");
+
 ZFS_MODULE_PARAM(zfs_spa, spa_, load_print_vdev_tree, INT, ZMOD_RW,
 	"Print vdev tree to zfs_dbgmsg during pool import");
 
@@ -279,9 +279,9 @@ spa_checkpoint_accounting_verify(spa_t *spa)
 #endif
 
 static void
-spa_checkpoint_discard_thread_sync(void *arg, dmu_tx_t *tx)
+spa_checkpoint_discard_thread_sync(vdev_t *vd, uint64_t budget,
+    dmu_tx_t *tx)
 {
-	vdev_t *vd = arg;
 	int error;
 
 	/*
@@ -299,7 +299,7 @@ spa_checkpoint_discard_thread_sync(void *arg, dmu_tx_t *tx)
 	 * entry is two-word.
 	 */
 	uint64_t max_entry_limit =
-	    (zfs_spa_discard_memory_limit / (2 * sizeof (uint64_t))) >> 1;
+	    (budget / (2 * sizeof (uint64_t))) >> 1;
 
 	/*
 	 * Iterate from the end of the space map towards the beginning,
@@ -396,51 +396,116 @@ spa_checkpoint_discard_thread_check(void *arg, zthr_t *zthr)
 	return (B_TRUE);
 }
 
+/*
+ * Synctask wrapper: discard one memory-limited chunk from every vdev
+ * that still has a checkpoint space map, all within one txg.  The
+ * freeing itself is sync-context work either way; batching the vdevs
+ * means one txg round trip retires a chunk from each of them instead
+ * of the old one-chunk-per-vdev-per-txg cadence, which made discard
+ * time scale with the vdev count on wide pools.
+ */
+typedef struct spa_checkpoint_discard_all_arg {
+	spa_t		*scda_spa;
+	uint64_t	scda_budget;	/* per-vdev byte budget */
+} spa_checkpoint_discard_all_arg_t;
+
+static void
+spa_checkpoint_discard_thread_sync_all(void *arg, dmu_tx_t *tx)
+{
+	spa_checkpoint_discard_all_arg_t *scda = arg;
+	vdev_t *rvd = scda->scda_spa->spa_root_vdev;
+
+	for (uint64_t c = 0; c < rvd->vdev_children; c++) {
+		vdev_t *vd = rvd->vdev_child[c];
+
+		if (vd->vdev_checkpoint_sm != NULL) {
+			spa_checkpoint_discard_thread_sync(vd,
+			    scda->scda_budget, tx);
+		}
+	}
+}
+
 void
 spa_checkpoint_discard_thread(void *arg, zthr_t *zthr)
 {
 	spa_t *spa = arg;
 	vdev_t *rvd = spa->spa_root_vdev;
+	boolean_t more = B_TRUE;
+
+	while (more) {
+		uint64_t children = rvd->vdev_children;
+		int *numbufs = kmem_zalloc(children * sizeof (int), KM_SLEEP);
+		dmu_buf_t ***dbp = kmem_zalloc(children *
+		    sizeof (dmu_buf_t **), KM_SLEEP);
+		uint64_t nsm = 0;
+
+		if (zthr_iscancelled(zthr)) {
+			kmem_free(numbufs, children * sizeof (int));
+			kmem_free(dbp, children * sizeof (dmu_buf_t **));
+			return;
+		}
 
-	for (uint64_t c = 0; c < rvd->vdev_children; c++) {
-		vdev_t *vd = rvd->vdev_child[c];
+		for (uint64_t c = 0; c < children; c++) {
+			if (rvd->vdev_child[c]->vdev_checkpoint_sm != NULL)
+				nsm++;
+		}
+		if (nsm == 0) {
+			kmem_free(numbufs, children * sizeof (int));
+			kmem_free(dbp, children * sizeof (dmu_buf_t **));
+			break;
+		}
 
-		while (vd->vdev_checkpoint_sm != NULL) {
+		/*
+		 * Split the memory budget across the vdevs that still
+		 * have checkpoint space maps, and prefetch each one's
+		 * tail chunk so the synctask below never blocks on
+		 * reads.  One txg then retires a chunk from every vdev,
+		 * instead of the old one-chunk-per-vdev-per-txg cadence
+		 * that made discard time scale with the vdev count.
+		 */
+		uint64_t budget =
+		    MAX(zfs_spa_discard_memory_limit / nsm, SPA_MINBLOCKSIZE);
+
+		for (uint64_t c = 0; c < children; c++) {
+			vdev_t *vd = rvd->vdev_child[c];
 			space_map_t *checkpoint_sm = vd->vdev_checkpoint_sm;
-			int numbufs;
-			dmu_buf_t **dbp;
 
-			if (zthr_iscancelled(zthr))
-				return;
+			if (checkpoint_sm == NULL)
+				continue;
 
 			ASSERT3P(vd->vdev_ops, !=, &vdev_indirect_ops);
 
 			uint64_t size = MIN(space_map_length(checkpoint_sm),
-			    zfs_spa_discard_memory_limit);
+			    budget);
 			uint64_t offset =
 			    space_map_length(checkpoint_sm) - size;
 
-			/*
-			 * Ensure that the part of the space map that will
-			 * be destroyed by the synctask, is prefetched in
-			 * memory before the synctask runs.
-			 */
 			int error = dmu_buf_hold_array_by_bonus(
 			    checkpoint_sm->sm_dbuf, offset, size,
-			    B_TRUE, FTAG, &numbufs, &dbp, DMU_READ_PREFETCH);
+			    B_TRUE, FTAG, &numbufs[c], &dbp[c],
+			    DMU_READ_PREFETCH);
 			if (error != 0) {
 				zfs_panic_recover("zfs: error %d was returned "
 				    "while prefetching checkpoint space map "
 				    "entries of vdev %llu\n",
 				    error, vd->vdev_id);
 			}
+		}
 
-			VERIFY0(dsl_sync_task(spa->spa_name, NULL,
-			    spa_checkpoint_discard_thread_sync, vd,
-			    0, ZFS_SPACE_CHECK_NONE));
-
-			dmu_buf_rele_array(dbp, numbufs, FTAG);
+		spa_checkpoint_discard_all_arg_t scda = {
+			.scda_spa = spa,
+			.scda_budget = budget,
+		};
+		VERIFY0(dsl_sync_task(spa->spa_name, NULL,
+		    spa_checkpoint_discard_thread_sync_all, &scda,
+		    0, ZFS_SPACE_CHECK_NONE));
+
+		for (uint64_t c = 0; c < children; c++) {
+			if (dbp[c] != NULL)
+				dmu_buf_rele_array(dbp[c], numbufs[c], FTAG);
 		}
+		kmem_free(numbufs, children * sizeof (int));
+		kmem_free(dbp, children * sizeof (dmu_buf_t **));
 	}
 
 	VERIFY(spa_checkpoint_discard_is_done(spa));
@@ -86,6 +86,20 @@ typedef struct clones {
  */
 static uint_t spa_upgrade_errlog_limit = 0;
 
+/*
+ * Cap on the number of distinct error-list entries held in memory
+ * between txg syncs.  A failing device can report millions of checksum
+ * errors per second; each distinct bookmark costs an allocation here
+ * and a MOS errlog entry at sync, so an uncapped storm bloats memory,
+ * the errlog ZAP, and sync itself.  Entries past the cap are counted
+ * but not recorded individually - per-vdev error counters and zevents
+ * still reflect every error, so nothing is lost for fault diagnosis,
+ * only per-block detail beyond what zpool status -v could usefully
+ * show.  Run-compressing dense error ranges in the on-disk log would
+ * be an errlog format change and is not attempted here.
+ */
+static uint_t zfs_errlog_max_entries = 100000;
+
 /*
  * Convert a bookmark to a string.
  */
@@ -212,6 +226,21 @@ spa_log_error(spa_t *spa, const zbookmark_phys_t *zb, const uint64_t birth)
 		return;
 	}
 
+	/*
+	 * Bound the in-memory list during error storms; see
+	 * zfs_errlog_max_entries above.
+	 */
+	if (spa->spa_errlist_count >= zfs_errlog_max_entries) {
+		if (spa->spa_errlist_dropped++ == 0) {
+			zfs_dbgmsg("too many distinct errors on %s, "
+			    "dropping detailed error log entries",
+			    spa_name(spa));
+		}
+		mutex_exit(&spa->spa_errlist_lock);
+		return;
+	}
+	spa->spa_errlist_count++;
+
 	new = kmem_zalloc(sizeof (spa_error_entry_t), KM_SLEEP);
 	new->se_bookmark = *zb;
 
@@ -1157,6 +1186,9 @@ spa_errlog_drain(spa_t *spa)
 	    &cookie)) != NULL)
 		kmem_free(se, sizeof (spa_error_entry_t));
 
+	spa->spa_errlist_count = 0;
+	spa->spa_errlist_dropped = 0;
+
 	mutex_exit(&spa->spa_errlist_lock);
 }
 
@@ -1282,6 +1314,12 @@ spa_errlog_sync(spa_t *spa, uint64_t txg)
 	spa_get_errlists(spa, &last, &scrub);
 	scrub_finished = spa->spa_scrub_finished;
 	spa->spa_scrub_finished = B_FALSE;
+	spa->spa_errlist_count = 0;
+	if (spa->spa_errlist_dropped != 0) {
+		zfs_dbgmsg("dropped %llu detailed error log entries on %s",
+		    (u_longlong_t)spa->spa_errlist_dropped, spa_name(spa));
+		spa->spa_errlist_dropped = 0;
+	}
 
 	mutex_exit(&spa->spa_errlist_lock);
 
@@ -1495,3 +1533,6 @@ EXPORT_SYMBOL(name_to_errphys);
 ZFS_MODULE_PARAM(zfs_spa, spa_, upgrade_errlog_limit, UINT, ZMOD_RW,
 	"Limit the number of errors which will be upgraded to the new "
 	"on-disk error log when enabling head_errlog");
+
+ZFS_MODULE_PARAM(zfs, zfs_, errlog_max_entries, UINT, ZMOD_RW,
+	"Max distinct in-memory error log entries between syncs");
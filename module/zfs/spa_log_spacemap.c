@@ -753,6 +753,33 @@ spa_flush_all_logs_requested(spa_t *spa)
 	return (spa->spa_log_flushall_txg != 0);
 }
 
+/*
+ * Number of threads used to write distinct metaslabs' space maps
+ * concurrently while flushing; applied when a pool is activated.
+ * 0 flushes serially on the sync thread as before.
+ */
+uint_t zfs_log_sm_flush_threads = 0;
+
+/*
+ * Metaslabs whose space map writes run concurrently in one batch;
+ * their shared bookkeeping is completed serially after the batch.
+ */
+#define	SPA_FLUSH_BATCH	16
+
+typedef struct spa_flush_arg {
+	metaslab_t	*sfa_msp;
+	dmu_tx_t	*sfa_tx;
+	taskq_ent_t	sfa_ent;
+} spa_flush_arg_t;
+
+static void
+spa_flush_metaslab_task(void *arg)
+{
+	spa_flush_arg_t *sfa = arg;
+
+	metaslab_flush_write(sfa->sfa_msp, sfa->sfa_tx);
+}
+
 void
 spa_flush_metaslabs(spa_t *spa, dmu_tx_t *tx)
 {
@@ -820,6 +847,14 @@ spa_flush_metaslabs(spa_t *spa, dmu_tx_t *tx)
 	/* Used purely for verification purposes */
 	uint64_t visited = 0;
 
+	spa_flush_arg_t *batch = NULL;
+	uint_t nbatch = 0;
+
+	if (spa->spa_smflush_taskq != NULL) {
+		batch = kmem_zalloc(sizeof (spa_flush_arg_t) *
+		    SPA_FLUSH_BATCH, KM_SLEEP);
+	}
+
 	/*
 	 * Ideally we would only iterate through spa_metaslabs_by_flushed
 	 * using only one variable (curr). We can't do that because
@@ -850,18 +885,74 @@ spa_flush_metaslabs(spa_t *spa, dmu_tx_t *tx)
 		if (metaslab_unflushed_dirty(curr)) {
 			mutex_enter(&curr->ms_sync_lock);
 			mutex_enter(&curr->ms_lock);
-			metaslab_flush(curr, tx);
-			mutex_exit(&curr->ms_lock);
-			mutex_exit(&curr->ms_sync_lock);
+			if (spa->spa_smflush_taskq != NULL) {
+				/*
+				 * Parallel mode: mark the metaslab
+				 * flushing and queue only the space map
+				 * write; the serial finish pass below
+				 * does the shared bookkeeping.
+				 */
+				int started = metaslab_flush_start(curr, tx);
+				mutex_exit(&curr->ms_lock);
+				mutex_exit(&curr->ms_sync_lock);
+				if (started > 0) {
+					batch[nbatch].sfa_msp = curr;
+					batch[nbatch].sfa_tx = tx;
+					taskq_dispatch_ent(
+					    spa->spa_smflush_taskq,
+					    spa_flush_metaslab_task,
+					    &batch[nbatch], 0,
+					    &batch[nbatch].sfa_ent);
+					nbatch++;
+				}
+			} else {
+				metaslab_flush(curr, tx);
+				mutex_exit(&curr->ms_lock);
+				mutex_exit(&curr->ms_sync_lock);
+			}
 			if (want_to_flush > 0)
 				want_to_flush--;
 		} else
 			metaslab_unflushed_bump(curr, tx, B_FALSE);
 
 		visited++;
+
+		/*
+		 * Drain a full batch of parallel writes, then complete
+		 * their bookkeeping in order on this thread.  (A partial
+		 * final batch is drained after the loop.)
+		 */
+		if (nbatch == SPA_FLUSH_BATCH) {
+			taskq_wait(spa->spa_smflush_taskq);
+			for (uint_t i = 0; i < nbatch; i++) {
+				metaslab_t *msp = batch[i].sfa_msp;
+
+				mutex_enter(&msp->ms_sync_lock);
+				mutex_enter(&msp->ms_lock);
+				metaslab_flush_finish(msp, tx);
+				mutex_exit(&msp->ms_lock);
+				mutex_exit(&msp->ms_sync_lock);
+			}
+			nbatch = 0;
+		}
+	}
+	if (nbatch > 0) {
+		taskq_wait(spa->spa_smflush_taskq);
+		for (uint_t i = 0; i < nbatch; i++) {
+			metaslab_t *msp = batch[i].sfa_msp;
+
+			mutex_enter(&msp->ms_sync_lock);
+			mutex_enter(&msp->ms_lock);
+			metaslab_flush_finish(msp, tx);
+			mutex_exit(&msp->ms_lock);
+			mutex_exit(&msp->ms_sync_lock);
+		}
 	}
 	ASSERT3U(avl_numnodes(&spa->spa_metaslabs_by_flushed), >=, visited);
 
+	if (batch != NULL)
+		kmem_free(batch, sizeof (spa_flush_arg_t) * SPA_FLUSH_BATCH);
+
 	spa_log_sm_set_blocklimit(spa);
 }
 
@@ -1377,6 +1468,9 @@ ZFS_MODULE_PARAM(zfs, zfs_, unflushed_log_block_max, U64, ZMOD_RW,
 	"Hard limit (upper-bound) in the size of the space map log "
 	"in terms of blocks.");
 
+ZFS_MODULE_PARAM(zfs, zfs_, log_sm_flush_threads, UINT, ZMOD_RW,
+	"Concurrent metaslab space map flush writers (0=serial)");
+
 ZFS_MODULE_PARAM(zfs, zfs_, unflushed_log_block_min, U64, ZMOD_RW,
 	"Lower-bound limit for the maximum amount of blocks allowed in "
 	"log spacemap (see zfs_unflushed_log_block_max)");
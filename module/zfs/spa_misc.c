@@ -59,6 +59,7 @@
 #include <sys/fs/zfs.h>
 #include <sys/metaslab_impl.h>
 #include <sys/arc.h>
+#include <sys/bqueue.h>
 #include <sys/brt.h>
 #include <sys/ddt.h>
 #include <sys/kstat.h>
@@ -66,6 +67,7 @@
 #include <sys/btree.h>
 #include <sys/zfeature.h>
 #include <sys/qat.h>
+#include <sys/iaa.h>
 #include <sys/zstd/zstd.h>
 
 /*
@@ -237,6 +239,21 @@
  * locking is, always, based on spa_namespace_lock and spa_config_lock[].
  */
 
+/*
+ * On sharding spa_namespace_lock per pool: the lock's irreducible job
+ * is making name-to-spa_t resolution atomic against import, export,
+ * and rename, which all mutate the one avl below - so every spa_open
+ * by name would still take a global map lock, and a per-pool shard
+ * only helps once the spa_t is already in hand (where per-pool locks
+ * already take over).  The operational pain attributed to this lock -
+ * zpool list hanging behind a stuck import - is really about hold
+ * *duration*: import historically kept the namespace lock across
+ * device discovery and load.  Shrinking those hold windows (dropping
+ * the lock around I/O and re-verifying, as the load path increasingly
+ * does) is the fix that preserves the resolution atomicity; a sharded
+ * namespace would keep the same global choke point for exactly the
+ * operations that convoy.
+ */
 static avl_tree_t spa_namespace_avl;
 static kmutex_t spa_namespace_lock;
 static kcondvar_t spa_namespace_cv;
@@ -461,7 +478,7 @@ spa_config_lock_init(spa_t *spa)
 		cv_init(&scl->scl_cv, NULL, CV_DEFAULT, NULL);
 		scl->scl_writer = NULL;
 		scl->scl_write_wanted = 0;
-		scl->scl_count = 0;
+		wmsum_init(&scl->scl_rcount, 0);
 	}
 }
 
@@ -474,8 +491,47 @@ spa_config_lock_destroy(spa_t *spa)
 		cv_destroy(&scl->scl_cv);
 		ASSERT0P(scl->scl_writer);
 		ASSERT0(scl->scl_write_wanted);
-		ASSERT0(scl->scl_count);
+		ASSERT0(wmsum_value(&scl->scl_rcount));
+		wmsum_fini(&scl->scl_rcount);
+	}
+}
+
+/*
+ * Sum of all CPUs' reader holds; only writers (and asserts) pay this
+ * gather.  A concurrent enter/exit pair migrating between CPUs can make
+ * a transient sum read inexact, so waiters always re-sum after wakeups.
+ */
+static uint64_t
+spa_config_lock_readers(spa_config_lock_t *scl)
+{
+	return (wmsum_value(&scl->scl_rcount));
+}
+
+/*
+ * Lock-free read-side acquisition.  The add-then-recheck dance pairs
+ * with the writer's publish-then-sum (both separated by full barriers),
+ * so it is impossible for a reader to slip in unseen: either the reader
+ * observes the writer's claim and backs off, or the writer's sum
+ * observes the reader's hold and keeps waiting.
+ */
+static boolean_t
+spa_config_enter_reader_fast(spa_config_lock_t *scl, int priority_flag)
+{
+	if (scl->scl_writer != NULL ||
+	    (!priority_flag && scl->scl_write_wanted))
+		return (B_FALSE);
+	wmsum_add(&scl->scl_rcount, 1);
+	membar_sync();
+	if (scl->scl_writer != NULL ||
+	    (!priority_flag && scl->scl_write_wanted)) {
+		wmsum_add(&scl->scl_rcount, -1);
+		/* A waiting writer may have summed us; let it re-check. */
+		mutex_enter(&scl->scl_lock);
+		cv_broadcast(&scl->scl_cv);
+		mutex_exit(&scl->scl_lock);
+		return (B_FALSE);
 	}
+	return (B_TRUE);
 }
 
 int
@@ -485,25 +541,32 @@ spa_config_tryenter(spa_t *spa, int locks, const void *tag, krw_t rw)
 		spa_config_lock_t *scl = &spa->spa_config_lock[i];
 		if (!(locks & (1 << i)))
 			continue;
-		mutex_enter(&scl->scl_lock);
 		if (rw == RW_READER) {
-			if (scl->scl_writer || scl->scl_write_wanted) {
-				mutex_exit(&scl->scl_lock);
-				spa_config_exit(spa, locks & ((1 << i) - 1),
-				    tag);
-				return (0);
-			}
-		} else {
-			ASSERT(scl->scl_writer != curthread);
-			if (scl->scl_count != 0) {
-				mutex_exit(&scl->scl_lock);
+			if (!spa_config_enter_reader_fast(scl, 0)) {
 				spa_config_exit(spa, locks & ((1 << i) - 1),
 				    tag);
 				return (0);
 			}
-			scl->scl_writer = curthread;
+			continue;
+		}
+		mutex_enter(&scl->scl_lock);
+		ASSERT(scl->scl_writer != curthread);
+		if (scl->scl_writer != NULL ||
+		    spa_config_lock_readers(scl) != 0) {
+			mutex_exit(&scl->scl_lock);
+			spa_config_exit(spa, locks & ((1 << i) - 1), tag);
+			return (0);
+		}
+		scl->scl_writer = curthread;
+		membar_sync();
+		if (spa_config_lock_readers(scl) != 0) {
+			/* A reader raced in before seeing our claim. */
+			scl->scl_writer = NULL;
+			cv_broadcast(&scl->scl_cv);
+			mutex_exit(&scl->scl_lock);
+			spa_config_exit(spa, locks & ((1 << i) - 1), tag);
+			return (0);
 		}
-		scl->scl_count++;
 		mutex_exit(&scl->scl_lock);
 	}
 	return (1);
@@ -524,22 +587,42 @@ spa_config_enter_impl(spa_t *spa, int locks, const void *tag, krw_t rw,
 			wlocks_held |= (1 << i);
 		if (!(locks & (1 << i)))
 			continue;
-		mutex_enter(&scl->scl_lock);
 		if (rw == RW_READER) {
+			if (spa_config_enter_reader_fast(scl, priority_flag))
+				continue;
+			mutex_enter(&scl->scl_lock);
 			while (scl->scl_writer ||
 			    (!priority_flag && scl->scl_write_wanted)) {
 				cv_wait(&scl->scl_cv, &scl->scl_lock);
 			}
-		} else {
-			ASSERT(scl->scl_writer != curthread);
-			while (scl->scl_count != 0) {
-				scl->scl_write_wanted++;
+			/*
+			 * Writers claim and sum under scl_lock, which we
+			 * hold, so no recheck is needed here.
+			 */
+			wmsum_add(&scl->scl_rcount, 1);
+			mutex_exit(&scl->scl_lock);
+			continue;
+		}
+		mutex_enter(&scl->scl_lock);
+		ASSERT(scl->scl_writer != curthread);
+		scl->scl_write_wanted++;
+		membar_sync();
+		for (;;) {
+			while (scl->scl_writer != NULL ||
+			    spa_config_lock_readers(scl) != 0) {
 				cv_wait(&scl->scl_cv, &scl->scl_lock);
-				scl->scl_write_wanted--;
 			}
 			scl->scl_writer = curthread;
+			membar_sync();
+			if (spa_config_lock_readers(scl) == 0)
+				break;
+			/*
+			 * A (priority) reader raced in before seeing our
+			 * claim; back out and wait for it to drain.
+			 */
+			scl->scl_writer = NULL;
 		}
-		scl->scl_count++;
+		scl->scl_write_wanted--;
 		mutex_exit(&scl->scl_lock);
 	}
 	ASSERT3U(wlocks_held, <=, locks);
@@ -574,15 +657,26 @@ spa_config_exit(spa_t *spa, int locks, const void *tag)
 		spa_config_lock_t *scl = &spa->spa_config_lock[i];
 		if (!(locks & (1 << i)))
 			continue;
-		mutex_enter(&scl->scl_lock);
-		ASSERT(scl->scl_count > 0);
-		if (--scl->scl_count == 0) {
-			ASSERT(scl->scl_writer == NULL ||
-			    scl->scl_writer == curthread);
-			scl->scl_writer = NULL;	/* OK in either case */
+		if (scl->scl_writer == curthread) {
+			mutex_enter(&scl->scl_lock);
+			scl->scl_writer = NULL;
 			cv_broadcast(&scl->scl_cv);
+			mutex_exit(&scl->scl_lock);
+			continue;
+		}
+		wmsum_add(&scl->scl_rcount, -1);
+		membar_sync();
+		/*
+		 * Pairs with the writer's publish-then-sum: if a writer
+		 * set scl_write_wanted (or claimed scl_writer) before our
+		 * load here, wake it to re-sum; otherwise its sum is
+		 * guaranteed to observe our decrement.
+		 */
+		if (scl->scl_write_wanted || scl->scl_writer != NULL) {
+			mutex_enter(&scl->scl_lock);
+			cv_broadcast(&scl->scl_cv);
+			mutex_exit(&scl->scl_lock);
 		}
-		mutex_exit(&scl->scl_lock);
 	}
 }
 
@@ -595,7 +689,8 @@ spa_config_held(spa_t *spa, int locks, krw_t rw)
 		spa_config_lock_t *scl = &spa->spa_config_lock[i];
 		if (!(locks & (1 << i)))
 			continue;
-		if ((rw == RW_READER && scl->scl_count != 0) ||
+		if ((rw == RW_READER && (spa_config_lock_readers(scl) != 0 ||
+		    scl->scl_writer != NULL)) ||
 		    (rw == RW_WRITER && scl->scl_writer == curthread))
 			locks_held |= 1 << i;
 	}
@@ -769,8 +864,10 @@ spa_add(const char *name, nvlist_t *config, const char *altroot)
 	mutex_init(&spa->spa_flushed_ms_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&spa->spa_activities_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&spa->spa_txg_log_time_lock, NULL, MUTEX_DEFAULT, NULL);
+	mutex_init(&spa->spa_warmup_lock, NULL, MUTEX_DEFAULT, NULL);
 
 	cv_init(&spa->spa_async_cv, NULL, CV_DEFAULT, NULL);
+	cv_init(&spa->spa_warmup_cv, NULL, CV_DEFAULT, NULL);
 	cv_init(&spa->spa_evicting_os_cv, NULL, CV_DEFAULT, NULL);
 	cv_init(&spa->spa_proc_cv, NULL, CV_DEFAULT, NULL);
 	cv_init(&spa->spa_scrub_io_cv, NULL, CV_DEFAULT, NULL);
@@ -939,6 +1036,7 @@ spa_remove(spa_t *spa)
 	zio_checksum_templates_free(spa);
 
 	cv_destroy(&spa->spa_async_cv);
+	cv_destroy(&spa->spa_warmup_cv);
 	cv_destroy(&spa->spa_evicting_os_cv);
 	cv_destroy(&spa->spa_proc_cv);
 	cv_destroy(&spa->spa_scrub_io_cv);
@@ -948,6 +1046,7 @@ spa_remove(spa_t *spa)
 
 	mutex_destroy(&spa->spa_flushed_ms_lock);
 	mutex_destroy(&spa->spa_async_lock);
+	mutex_destroy(&spa->spa_warmup_lock);
 	mutex_destroy(&spa->spa_errlist_lock);
 	mutex_destroy(&spa->spa_errlog_lock);
 	mutex_destroy(&spa->spa_evicting_os_lock);
@@ -1376,7 +1475,7 @@ spa_vdev_config_exit(spa_t *spa, vdev_t *vd, uint64_t txg, int error,
 	 * is useful for ensuring that configurations are updated
 	 * transactionally.
 	 */
-	if (zio_injection_enabled)
+	if (zfs_static_key_enabled(&zio_injection_enabled))
 		zio_handle_panic_injection(spa, tag, 0);
 
 	/*
@@ -2117,6 +2216,20 @@ spa_special_has_ddt(spa_t *spa)
 /*
  * Locate an appropriate allocation class
  */
+/*
+ * On the recurring ask to demote cold small blocks off a full special
+ * vdev: class placement only exists at allocation time.  A written
+ * block's pointer is immutable and may be referenced by snapshots,
+ * clones, dedup entries, and incremental send bases, so "moving" it
+ * means rewriting it with a new birth txg - the general block-rewrite
+ * problem, which breaks incremental send chains and multiplies
+ * snapshot space, not a background maintenance task.  (BRT refcounts
+ * pointers; it does not relocate them.  Device removal's indirection
+ * remaps whole vdevs, not classes.)  The operational handles are
+ * sizing special_small_blocks so the special vdev holds the tier that
+ * stays hot, and zfs_special_class_metadata_reserve_pct, which keeps
+ * metadata placement from being crowded out as the class fills.
+ */
 metaslab_class_t *
 spa_preferred_class(spa_t *spa, const zio_t *zio)
 {
@@ -2681,7 +2794,13 @@ spa_init(spa_mode_t mode)
 	zpool_feature_init();
 	vdev_prop_init();
 	scan_init();
+	arc_warmup_init();
+	spa_taskq_stat_init();
+	vdev_queue_stat_init();
+	vdev_trim_stat_init();
+	bqueue_stats_init();
 	qat_init();
+	iaa_init();
 	spa_import_progress_init();
 	zap_init();
 }
@@ -2705,8 +2824,14 @@ spa_fini(void)
 	unique_fini();
 	zfs_refcount_fini();
 	fm_fini();
+	bqueue_stats_fini();
+	vdev_trim_stat_fini();
+	vdev_queue_stat_fini();
+	spa_taskq_stat_fini();
+	arc_warmup_fini();
 	scan_fini();
 	qat_fini();
+	iaa_fini();
 	spa_import_progress_destroy();
 	zap_fini();
 
@@ -904,6 +904,9 @@ static const spa_iostats_t spa_iostats_template = {
 	{ "direct_read_bytes",			KSTAT_DATA_UINT64 },
 	{ "direct_write_count",			KSTAT_DATA_UINT64 },
 	{ "direct_write_bytes",			KSTAT_DATA_UINT64 },
+	{ "gang_writes",			KSTAT_DATA_UINT64 },
+	{ "gang_multilevel",			KSTAT_DATA_UINT64 },
+	{ "gang_avoided_try_hard",		KSTAT_DATA_UINT64 },
 };
 
 #define	SPA_IOSTATS_ADD(stat, val) \
@@ -987,6 +990,39 @@ spa_iostats_write_add(spa_t *spa, uint64_t size, uint64_t iops,
 	}
 }
 
+/*
+ * Gang-block accounting: how often this pool fell back to ganging, how
+ * often those gangs nested, and how many would-be gangs the metaslab
+ * try-hard pass rescued.
+ */
+void
+spa_iostats_gang_add(spa_t *spa, boolean_t multilevel)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.iostats;
+	kstat_t *ksp = shk->kstat;
+
+	if (ksp == NULL)
+		return;
+
+	spa_iostats_t *iostats = ksp->ks_data;
+	SPA_IOSTATS_ADD(gang_writes, 1);
+	if (multilevel)
+		SPA_IOSTATS_ADD(gang_multilevel, 1);
+}
+
+void
+spa_iostats_gang_avoided_add(spa_t *spa)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.iostats;
+	kstat_t *ksp = shk->kstat;
+
+	if (ksp == NULL)
+		return;
+
+	spa_iostats_t *iostats = ksp->ks_data;
+	SPA_IOSTATS_ADD(gang_avoided_try_hard, 1);
+}
+
 static int
 spa_iostats_update(kstat_t *ksp, int rw)
 {
@@ -1037,6 +1073,274 @@ spa_iostats_destroy(spa_t *spa)
 	mutex_destroy(&shk->lock);
 }
 
+/*
+ * ==========================================================================
+ * I/O flight recorder; kstat zfs/<pool>/flight_recorder
+ * ==========================================================================
+ * An always-on, fixed-size, lock-free ring of the last N leaf-vdev zio
+ * completions (identity, type, size, latency, vdev guid).  Unlike the
+ * read history above it never allocates on the I/O path and costs one
+ * atomic increment plus a few stores per completion, so it can stay
+ * enabled in production and be dumped after an incident that interval
+ * kstats have already averaged away.  Readers take a snapshot of the
+ * ring through the raw kstat; a row being overwritten during a dump
+ * can present mixed fields, which a diagnostic consumer tolerates.
+ */
+typedef struct spa_flight_rec {
+	hrtime_t	fr_timestamp;	/* completion time, 0 = empty */
+	hrtime_t	fr_latency;	/* vdev queue service delta */
+	uint64_t	fr_objset;
+	uint64_t	fr_object;
+	uint64_t	fr_blkid;
+	uint64_t	fr_size;
+	uint64_t	fr_vdev_guid;
+	uint64_t	fr_type;
+} spa_flight_rec_t;
+
+typedef struct spa_flight {
+	spa_flight_rec_t	*sf_ring;
+	uint64_t		sf_mask;
+	uint64_t		sf_head;	/* next slot (free-running) */
+} spa_flight_t;
+
+/*
+ * Ring entries per pool (rounded up to a power of two; 0 disables the
+ * recorder for subsequently imported pools).  64 bytes per entry.
+ */
+static uint_t zfs_flight_recorder_entries = 1024;
+
+void
+spa_flight_record(spa_t *spa, zio_t *zio)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.flight;
+	spa_flight_t *sf = shk->priv;
+
+	if (sf == NULL)
+		return;
+
+	uint64_t idx = atomic_inc_64_nv(&sf->sf_head) - 1;
+	spa_flight_rec_t *fr = &sf->sf_ring[idx & sf->sf_mask];
+
+	fr->fr_latency = zio->io_delta;
+	fr->fr_objset = zio->io_bookmark.zb_objset;
+	fr->fr_object = zio->io_bookmark.zb_object;
+	fr->fr_blkid = zio->io_bookmark.zb_blkid;
+	fr->fr_size = zio->io_size;
+	fr->fr_vdev_guid = zio->io_vd != NULL ? zio->io_vd->vdev_guid : 0;
+	fr->fr_type = zio->io_type;
+	fr->fr_timestamp = gethrtime();
+}
+
+static int
+spa_flight_headers(char *buf, size_t size)
+{
+	(void) snprintf(buf, size, "%-16s %-12s %-4s %-10s %-16s "
+	    "%-8s %-8s %-8s\n", "time_ns", "latency_ns", "type",
+	    "size", "vdev_guid", "objset", "object", "blkid");
+	return (0);
+}
+
+static int
+spa_flight_data(char *buf, size_t size, void *data)
+{
+	spa_flight_rec_t *fr = data;
+
+	(void) snprintf(buf, size, "%-16llu %-12llu %-4llu %-10llu "
+	    "%-16llu %-8llu %-8llu %-8llu\n",
+	    (u_longlong_t)fr->fr_timestamp,
+	    (u_longlong_t)fr->fr_latency,
+	    (u_longlong_t)fr->fr_type,
+	    (u_longlong_t)fr->fr_size,
+	    (u_longlong_t)fr->fr_vdev_guid,
+	    (u_longlong_t)fr->fr_objset,
+	    (u_longlong_t)fr->fr_object,
+	    (u_longlong_t)fr->fr_blkid);
+	return (0);
+}
+
+static void *
+spa_flight_addr(kstat_t *ksp, loff_t n)
+{
+	spa_t *spa = ksp->ks_private;
+	spa_flight_t *sf = spa->spa_stats.flight.priv;
+
+	if (sf == NULL || n > sf->sf_mask)
+		return (NULL);
+
+	/*
+	 * Walk from the oldest slot still in the ring.  sf_head may
+	 * advance during the dump; rows are diagnostic snapshots.
+	 */
+	uint64_t head = sf->sf_head;
+	uint64_t first = head > sf->sf_mask ? head - sf->sf_mask - 1 : 0;
+	if (first + n >= head && head > 0)
+		return (NULL);
+	if (head == 0)
+		return (NULL);
+
+	spa_flight_rec_t *fr = &sf->sf_ring[(first + n) & sf->sf_mask];
+	if (fr->fr_timestamp == 0)
+		return (NULL);
+	return (fr);
+}
+
+static void
+spa_flight_init(spa_t *spa)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.flight;
+
+	mutex_init(&shk->lock, NULL, MUTEX_DEFAULT, NULL);
+	shk->priv = NULL;
+
+	uint64_t entries = zfs_flight_recorder_entries;
+	if (entries == 0)
+		return;
+	if (!ISP2(entries))
+		entries = 1ULL << highbit64(entries);
+	entries = MIN(entries, 1ULL << 20);
+
+	spa_flight_t *sf = kmem_zalloc(sizeof (*sf), KM_SLEEP);
+	sf->sf_ring = vmem_zalloc(entries * sizeof (spa_flight_rec_t),
+	    KM_SLEEP);
+	sf->sf_mask = entries - 1;
+
+	char *name = kmem_asprintf("zfs/%s", spa_name(spa));
+	kstat_t *ksp = kstat_create(name, 0, "flight_recorder", "misc",
+	    KSTAT_TYPE_RAW, 0, KSTAT_FLAG_VIRTUAL);
+	shk->kstat = ksp;
+	if (ksp != NULL) {
+		ksp->ks_lock = &shk->lock;
+		ksp->ks_ndata = UINT32_MAX;
+		ksp->ks_private = spa;
+		kstat_set_raw_ops(ksp, spa_flight_headers,
+		    spa_flight_data, spa_flight_addr);
+		kstat_install(ksp);
+		shk->priv = sf;
+	} else {
+		vmem_free(sf->sf_ring,
+		    (sf->sf_mask + 1) * sizeof (spa_flight_rec_t));
+		kmem_free(sf, sizeof (*sf));
+	}
+	kmem_strfree(name);
+}
+
+static void
+spa_flight_destroy(spa_t *spa)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.flight;
+	spa_flight_t *sf = shk->priv;
+
+	shk->priv = NULL;
+	if (shk->kstat != NULL)
+		kstat_delete(shk->kstat);
+	if (sf != NULL) {
+		vmem_free(sf->sf_ring,
+		    (sf->sf_mask + 1) * sizeof (spa_flight_rec_t));
+		kmem_free(sf, sizeof (*sf));
+	}
+	mutex_destroy(&shk->lock);
+}
+
+/*
+ * ==========================================================================
+ * ZIO pipeline stage accounting; kstat zfs/<pool>/zio_stages
+ * ==========================================================================
+ * Two rows per pipeline stage: the number of times a zio left the stage
+ * and the total wall-clock nanoseconds spent in it (queueing included,
+ * which is the point - the time between entering a stage and entering
+ * the next one is where a slow write actually went).  Only populated
+ * when zfs_zio_stage_accounting is set; see __zio_execute().
+ */
+
+/* Keep in sync with enum zio_stage in zio_impl.h (bit order) */
+static const char *const spa_zio_stage_names[] = {
+	"open", "read_bp_init", "write_bp_init", "free_bp_init",
+	"issue_async", "write_compress", "encrypt", "checksum_generate",
+	"nop_write", "brt_free", "ddt_read_start", "ddt_read_done",
+	"ddt_write", "ddt_free", "gang_assemble", "gang_issue",
+	"dva_throttle", "dva_allocate", "dva_free", "dva_claim",
+	"ready", "vdev_io_start", "vdev_io_done", "vdev_io_assess",
+	"checksum_verify", "dio_checksum_verify", "done",
+};
+
+#define	SPA_ZIO_STAGE_COUNT	ARRAY_SIZE(spa_zio_stage_names)
+
+void
+spa_zio_stage_add(spa_t *spa, uint_t stage_shift, uint64_t nsec)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.zio_stages;
+	kstat_t *ksp = shk->kstat;
+
+	if (ksp == NULL || stage_shift >= SPA_ZIO_STAGE_COUNT)
+		return;
+
+	kstat_named_t *kn = ksp->ks_data;
+	atomic_add_64(&kn[stage_shift * 2].value.ui64, 1);
+	atomic_add_64(&kn[stage_shift * 2 + 1].value.ui64, nsec);
+}
+
+static int
+spa_zio_stages_update(kstat_t *ksp, int rw)
+{
+	kstat_named_t *kn = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE) {
+		for (uint_t i = 0; i < SPA_ZIO_STAGE_COUNT * 2; i++)
+			kn[i].value.ui64 = 0;
+	}
+
+	return (0);
+}
+
+static void
+spa_zio_stages_init(spa_t *spa)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.zio_stages;
+
+	mutex_init(&shk->lock, NULL, MUTEX_DEFAULT, NULL);
+
+	char *name = kmem_asprintf("zfs/%s", spa_name(spa));
+	kstat_t *ksp = kstat_create(name, 0, "zio_stages", "misc",
+	    KSTAT_TYPE_NAMED, SPA_ZIO_STAGE_COUNT * 2, KSTAT_FLAG_VIRTUAL);
+
+	shk->kstat = ksp;
+	if (ksp) {
+		size_t size = SPA_ZIO_STAGE_COUNT * 2 *
+		    sizeof (kstat_named_t);
+		kstat_named_t *kn = kmem_zalloc(size, KM_SLEEP);
+
+		for (uint_t i = 0; i < SPA_ZIO_STAGE_COUNT; i++) {
+			(void) snprintf(kn[i * 2].name, KSTAT_STRLEN,
+			    "%s_count", spa_zio_stage_names[i]);
+			kn[i * 2].data_type = KSTAT_DATA_UINT64;
+			(void) snprintf(kn[i * 2 + 1].name, KSTAT_STRLEN,
+			    "%s_ns", spa_zio_stage_names[i]);
+			kn[i * 2 + 1].data_type = KSTAT_DATA_UINT64;
+		}
+		ksp->ks_lock = &shk->lock;
+		ksp->ks_private = spa;
+		ksp->ks_update = spa_zio_stages_update;
+		ksp->ks_data = kn;
+		kstat_install(ksp);
+	}
+
+	kmem_strfree(name);
+}
+
+static void
+spa_zio_stages_destroy(spa_t *spa)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.zio_stages;
+	kstat_t *ksp = shk->kstat;
+	if (ksp) {
+		kmem_free(ksp->ks_data, SPA_ZIO_STAGE_COUNT * 2 *
+		    sizeof (kstat_named_t));
+		kstat_delete(ksp);
+	}
+
+	mutex_destroy(&shk->lock);
+}
+
 void
 spa_stats_init(spa_t *spa)
 {
@@ -1047,11 +1351,15 @@ spa_stats_init(spa_t *spa)
 	spa_state_init(spa);
 	spa_guid_init(spa);
 	spa_iostats_init(spa);
+	spa_zio_stages_init(spa);
+	spa_flight_init(spa);
 }
 
 void
 spa_stats_destroy(spa_t *spa)
 {
+	spa_flight_destroy(spa);
+	spa_zio_stages_destroy(spa);
 	spa_iostats_destroy(spa);
 	spa_health_destroy(spa);
 	spa_tx_assign_destroy(spa);
@@ -1064,6 +1372,9 @@ spa_stats_destroy(spa_t *spa)
 ZFS_MODULE_PARAM(zfs, zfs_, read_history, UINT, ZMOD_RW,
 	"Historical statistics for the last N reads");
 
+ZFS_MODULE_PARAM(zfs, zfs_, flight_recorder_entries, UINT, ZMOD_RW,
+	"Per-pool I/O flight recorder ring entries (0 disables)");
+
 ZFS_MODULE_PARAM(zfs, zfs_, read_history_hits, INT, ZMOD_RW,
 	"Include cache hits in read history");
 
@@ -108,6 +108,19 @@
  * the root of the tree of blocks that comprise all state stored on the ZFS
  * pool. Finally, if there is a quiesced txg waiting, we signal that it can
  * now transition to the syncing state.
+ *
+ * Exactly one txg may be syncing at a time, and this is load-bearing
+ * well beyond this file: every structure indexed by (txg & TXG_MASK) -
+ * per-metaslab allocating and freeing trees, dirty dnode multilists,
+ * ZIL sequence tracking, and so on - relies on the syncing slot
+ * belonging to a single txg whose sync completes before the slot is
+ * reused.  Proposals to overlap two txgs' sync phases (for example,
+ * starting the next txg's dsl_pool_sync() while the previous txg's
+ * zios drain before its uberblock write) would require giving all of
+ * that state a second syncing generation.  The pipelining that is safe
+ * already exists: the open and quiescing states proceed concurrently
+ * with the syncing one, and within a sync most work is spread over the
+ * sync taskqs.
  */
 
 static __attribute__((noreturn)) void txg_sync_thread(void *arg);
@@ -607,6 +620,18 @@ txg_sync_thread(void *arg)
 		tx->tx_synced_txg = txg;
 		tx->tx_syncing_txg = 0;
 		DTRACE_PROBE2(txg__synced, dsl_pool_t *, dp, uint64_t, txg);
+		/*
+		 * This broadcast is periodically blamed for fsync-herd
+		 * wakeup spikes, but directed per-txg wakeups would not
+		 * change who wakes: fsync and friends wait in
+		 * zil_commit() on per-waiter ZIL condvars and never reach
+		 * this cv - the waiters here are the few callers of
+		 * txg_wait_synced() (admin ops, ENOSPC retries, ZIL
+		 * fallback), and almost all of them target the txg that
+		 * just finished, so a per-txg list would wake the same
+		 * set.  A waiter for a future txg simply re-checks and
+		 * sleeps again, which is the cheap case.
+		 */
 		cv_broadcast(&tx->tx_sync_done_cv);
 
 		/*
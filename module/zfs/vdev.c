@@ -2208,7 +2208,7 @@ vdev_open(vdev_t *vd)
 	 * the vdev on error.
 	 */
 	vd->vdev_reopening = B_FALSE;
-	if (zio_injection_enabled && error == 0)
+	if (zfs_static_key_enabled(&zio_injection_enabled) && error == 0)
 		error = zio_handle_device_injection(vd, NULL, SET_ERROR(ENXIO));
 
 	if (error) {
@@ -3757,7 +3757,7 @@ vdev_dtl_required(vdev_t *vd)
 	vd->vdev_cant_read = cant_read;
 	vdev_dtl_reassess_impl(tvd, 0, 0, B_FALSE, B_FALSE, faulting);
 
-	if (!required && zio_injection_enabled) {
+	if (!required && zfs_static_key_enabled(&zio_injection_enabled)) {
 		required = !!zio_handle_device_injection(vd, NULL,
 		    SET_ERROR(ECHILD));
 	}
@@ -3840,7 +3840,9 @@ vdev_load(vdev_t *vd)
 	/*
 	 * It's only worthwhile to use the taskq for the root vdev, because the
 	 * slow part is metaslab_init, and that only happens for top-level
-	 * vdevs.
+	 * vdevs.  With one worker per child, import-time load latency
+	 * scales with the slowest top-level vdev rather than the sum;
+	 * per-child errors are aggregated through vdev_load_error below.
 	 */
 	if (vd->vdev_ops == &vdev_root_ops && vd->vdev_children > 0) {
 		tq = taskq_create("vdev_load", children, minclsyspri,
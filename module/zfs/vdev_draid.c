@@ -681,6 +681,18 @@ vdev_draid_lookup_map(uint64_t children, const draid_map_t **mapp)
  * Lookup the permutation array and iteration id for the provided offset.
  */
 static void
+/*
+ * Look up the permutation row for a logical offset.  Note that this is
+ * already table-driven: the full set of shuffled child orderings is
+ * expanded once from the on-disk seed by vdev_draid_generate_perms()
+ * when the vdev configuration is initialized, and held in vdc_perms
+ * for the life of the vdev.  Per I/O, translating logical position to
+ * child disk is this pair of index computations plus the array loads
+ * in vdev_draid_permute_id() - nothing is rederived from the seed on
+ * the I/O path.  The per-I/O allocation that remains is the raidz map
+ * itself, which is sized by the I/O and no more cacheable here than it
+ * is for plain raidz.
+ */
 vdev_draid_get_perm(vdev_draid_config_t *vdc, uint64_t pindex,
     uint8_t **base, uint64_t *iter)
 {
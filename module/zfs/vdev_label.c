@@ -2056,6 +2056,20 @@ vdev_label_sync_list(spa_t *spa, int l, uint64_t txg, int flags)
  * Moreover, vdev_config_sync() is designed to be idempotent: if it fails
  * at any time, you can just call it again, and it will resume its work.
  */
+/*
+ * On quorum-tiered commit (landing the uberblock on a fast subset and
+ * catching the stragglers up later): uberblock placement is the import
+ * protocol, not just durability bookkeeping.  Import takes the newest
+ * uberblock found on the labels it can read; if only a fast quorum
+ * carried txg N and those devices are the ones missing at the next
+ * import, the pool silently comes up at N-1 while blocks born in N
+ * exist - the rollback-after-write corruption the all-vdev write
+ * exists to prevent.  The writes below already go out in parallel, so
+ * commit latency is one round of max(leaf) per txg, and the latency
+ * applications feel for synchronous work is carried by the ZIL, not by
+ * this path.  A persistently slow disk is a fault-management problem
+ * (see vdev sit-out and slow-I/O ereports), not a commit-protocol one.
+ */
 int
 vdev_config_sync(vdev_t **svd, int svdcount, uint64_t txg)
 {
@@ -54,6 +54,8 @@ typedef struct mirror_stats {
 
 	kstat_named_t vdev_mirror_stat_preferred_found;
 	kstat_named_t vdev_mirror_stat_preferred_not_found;
+
+	kstat_named_t vdev_mirror_stat_latency_penalty;
 } mirror_stats_t;
 
 static mirror_stats_t mirror_stats = {
@@ -71,6 +73,8 @@ static mirror_stats_t mirror_stats = {
 	{ "preferred_found",			KSTAT_DATA_UINT64 },
 	/* Preferred child vdev not found or equal load  */
 	{ "preferred_not_found",		KSTAT_DATA_UINT64 },
+	/* Latency outlier penalty applied to a child's load */
+	{ "latency_penalty",			KSTAT_DATA_UINT64 },
 
 };
 
@@ -136,6 +140,16 @@ static const int vdev_mirror_shift = 21;
  * to have a higher performance.
  */
 
+/*
+ * Shift converting a child's estimated queueing delay - pending queue
+ * depth plus one, times its recent latency EWMA in nanoseconds - into
+ * load units, so read selection weighs children by how long a new
+ * request would actually wait on them rather than by queue depth
+ * alone.  With the default of 17, a millisecond of estimated delay
+ * adds about eight load points.  0 disables the weighting.
+ */
+static int zfs_vdev_mirror_latency_shift = 17;
+
 /* Rotating media load calculation configuration. */
 static int zfs_vdev_mirror_rotating_inc = 0;
 static int zfs_vdev_mirror_rotating_seek_inc = 5;
@@ -204,6 +218,28 @@ vdev_mirror_load(mirror_map_t *mm, vdev_t *vd, uint64_t zio_offset)
 	load = vdev_queue_length(vd);
 	last_offset = vdev_queue_last_offset(vd);
 
+	/*
+	 * Weight children by their estimated queueing delay: the depth a
+	 * new request would wait behind times the child's recent per-I/O
+	 * latency average, scaled into load units.  A fast child keeps
+	 * winning the selection - and so absorbs more reads - until its
+	 * estimated delay has grown to match its slower sibling's, which
+	 * is the natural share split for mixed-generation mirrors, and a
+	 * degraded device with a short queue stops poisoning tail
+	 * latency as soon as its latency average degrades.
+	 */
+	if (zfs_vdev_mirror_latency_shift > 0) {
+		uint64_t wait = (uint64_t)(load + 1) *
+		    vdev_queue_latency(vd);
+		int penalty = MIN(wait >> zfs_vdev_mirror_latency_shift,
+		    INT_MAX / 2);
+
+		if (penalty > 0) {
+			MIRROR_BUMP(vdev_mirror_stat_latency_penalty);
+			load += penalty;
+		}
+	}
+
 	if (vd->vdev_nonrot) {
 		/* Non-rotating media. */
 		if (last_offset == zio_offset) {
@@ -1046,6 +1082,9 @@ vdev_ops_t vdev_spare_ops = {
 	.vdev_op_leaf = B_FALSE			/* not a leaf vdev */
 };
 
+ZFS_MODULE_PARAM(zfs_vdev_mirror, zfs_vdev_mirror_, latency_shift, INT,
+	ZMOD_RW, "Shift converting child latency EWMA into load units");
+
 ZFS_MODULE_PARAM(zfs_vdev_mirror, zfs_vdev_mirror_, rotating_inc, INT, ZMOD_RW,
 	"Rotating media load increment for non-seeking I/Os");
 
@@ -124,6 +124,15 @@
  */
 static uint_t zfs_vdev_max_active = 1000;
 
+/*
+ * Non-rotational devices resolve many small concurrent I/Os faster
+ * than one large aggregate, so they get their own queue profile:
+ * an independent overall active limit and smaller gap limits, next to
+ * the existing zfs_vdev_aggregation_limit_non_rotating.  A value of 0
+ * for the active limit falls back to zfs_vdev_max_active.
+ */
+static uint_t zfs_vdev_max_active_non_rotating = 0;
+
 /*
  * Per-queue limits on the number of i/os active to each device.  If the
  * number of active i/os is < zfs_vdev_max_active, then the min_active comes
@@ -203,6 +212,8 @@ static uint_t zfs_vdev_aggregation_limit = 1 << 20;
 static uint_t zfs_vdev_aggregation_limit_non_rotating = SPA_OLD_MAXBLOCKSIZE;
 static uint_t zfs_vdev_read_gap_limit = 32 << 10;
 static uint_t zfs_vdev_write_gap_limit = 4 << 10;
+static uint_t zfs_vdev_read_gap_limit_non_rotating = 4 << 10;
+static uint_t zfs_vdev_write_gap_limit_non_rotating = 0;
 
 static int
 vdev_queue_offset_compare(const void *x1, const void *x2)
@@ -411,7 +422,10 @@ vdev_queue_class_to_issue(vdev_queue_t *vq)
 	uint32_t cq = vq->vq_cqueued;
 	zio_priority_t p, p1;
 
-	if (cq == 0 || vq->vq_active >= zfs_vdev_max_active)
+	uint_t max_active = zfs_vdev_max_active;
+	if (vq->vq_vdev->vdev_nonrot && zfs_vdev_max_active_non_rotating != 0)
+		max_active = zfs_vdev_max_active_non_rotating;
+	if (cq == 0 || vq->vq_active >= max_active)
 		return (ZIO_PRIORITY_NUM_QUEUEABLE);
 
 	/*
@@ -475,6 +489,8 @@ vdev_queue_init(vdev_t *vd)
 	    offsetof(struct zio, io_offset_node));
 
 	vq->vq_last_offset = 0;
+	vq->vq_incoming = NULL;
+	vq->vq_incoming_count = 0;
 	list_create(&vq->vq_active_list, sizeof (struct zio),
 	    offsetof(struct zio, io_queue_node.l));
 	mutex_init(&vq->vq_lock, NULL, MUTEX_DEFAULT, NULL);
@@ -495,9 +511,123 @@ vdev_queue_fini(vdev_t *vd)
 	avl_destroy(&vq->vq_write_offset_tree);
 
 	list_destroy(&vq->vq_active_list);
+	ASSERT0P(vq->vq_incoming);
+	ASSERT0(vq->vq_incoming_count);
 	mutex_destroy(&vq->vq_lock);
 }
 
+/*
+ * Counters for the lock-free submission ring, exported through the
+ * vdev_queue_ring kstat.  The current global ring occupancy is the
+ * difference between pushes and drains.
+ */
+static struct {
+	wmsum_t vqs_ring_pushes;
+	wmsum_t vqs_ring_drains;
+	wmsum_t vqs_ring_handoffs;
+} vdev_queue_sums;
+
+typedef struct vdev_queue_stats {
+	kstat_named_t vqs_ring_pushes;
+	kstat_named_t vqs_ring_drains;
+	kstat_named_t vqs_ring_occupancy;
+	kstat_named_t vqs_ring_handoffs;
+} vdev_queue_stats_t;
+
+static vdev_queue_stats_t vdev_queue_stats = {
+	{ "ring_pushes",		KSTAT_DATA_UINT64 },
+	{ "ring_drains",		KSTAT_DATA_UINT64 },
+	{ "ring_occupancy",		KSTAT_DATA_UINT64 },
+	{ "ring_handoffs",		KSTAT_DATA_UINT64 },
+};
+
+static kstat_t *vdev_queue_ksp;
+
+static int
+vdev_queue_stat_update(kstat_t *ksp, int rw)
+{
+	vdev_queue_stats_t *vqs = ksp->ks_data;
+	uint64_t pushes, drains;
+
+	if (rw == KSTAT_WRITE)
+		return (SET_ERROR(EACCES));
+	pushes = wmsum_value(&vdev_queue_sums.vqs_ring_pushes);
+	drains = wmsum_value(&vdev_queue_sums.vqs_ring_drains);
+	vqs->vqs_ring_pushes.value.ui64 = pushes;
+	vqs->vqs_ring_drains.value.ui64 = drains;
+	vqs->vqs_ring_occupancy.value.ui64 =
+	    (pushes > drains) ? pushes - drains : 0;
+	vqs->vqs_ring_handoffs.value.ui64 =
+	    wmsum_value(&vdev_queue_sums.vqs_ring_handoffs);
+	return (0);
+}
+
+void
+vdev_queue_stat_init(void)
+{
+	wmsum_init(&vdev_queue_sums.vqs_ring_pushes, 0);
+	wmsum_init(&vdev_queue_sums.vqs_ring_drains, 0);
+	wmsum_init(&vdev_queue_sums.vqs_ring_handoffs, 0);
+
+	vdev_queue_ksp = kstat_create("zfs", 0, "vdev_queue_ring", "misc",
+	    KSTAT_TYPE_NAMED,
+	    sizeof (vdev_queue_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (vdev_queue_ksp != NULL) {
+		vdev_queue_ksp->ks_data = &vdev_queue_stats;
+		vdev_queue_ksp->ks_update = vdev_queue_stat_update;
+		kstat_install(vdev_queue_ksp);
+	}
+}
+
+void
+vdev_queue_stat_fini(void)
+{
+	if (vdev_queue_ksp != NULL) {
+		kstat_delete(vdev_queue_ksp);
+		vdev_queue_ksp = NULL;
+	}
+	wmsum_fini(&vdev_queue_sums.vqs_ring_pushes);
+	wmsum_fini(&vdev_queue_sums.vqs_ring_drains);
+	wmsum_fini(&vdev_queue_sums.vqs_ring_handoffs);
+}
+
+static void vdev_queue_io_add(vdev_queue_t *vq, zio_t *zio);
+
+/*
+ * Move everything pushed onto the lock-free submission ring into the
+ * class queues.  The ring is pushed LIFO, so reverse it back to
+ * arrival order first.
+ */
+static void
+vdev_queue_drain_incoming(vdev_queue_t *vq)
+{
+	zio_t *zio, *next, *rev = NULL;
+	uint64_t n = 0;
+
+	ASSERT(MUTEX_HELD(&vq->vq_lock));
+
+	if (vq->vq_incoming == NULL)
+		return;
+	zio = atomic_swap_ptr((volatile void *)&vq->vq_incoming, NULL);
+	ASSERT3P(zio, !=, NULL);
+
+	while (zio != NULL) {
+		next = zio->io_vq_next;
+		zio->io_vq_next = rev;
+		rev = zio;
+		zio = next;
+	}
+	while ((zio = rev) != NULL) {
+		rev = zio->io_vq_next;
+		zio->io_vq_next = NULL;
+		vdev_queue_io_add(vq, zio);
+		n++;
+	}
+	atomic_add_64(&vq->vq_incoming_count, -(int64_t)n);
+	wmsum_add(&vdev_queue_sums.vqs_ring_drains, n);
+}
+
 static void
 vdev_queue_io_add(vdev_queue_t *vq, zio_t *zio)
 {
@@ -591,6 +721,13 @@ vdev_queue_agg_io_done(zio_t *aio)
  * child ZIOs. The gang ABD also accounts for gaps between adjacent
  * io_offsets by simply getting the zero ABD for writes or allocating
  * a new ABD for reads and placing them in the gang ABD as well.
+ *
+ * This makes aggregation zero-copy in both directions: writes gather
+ * the children's pages directly into the device I/O, and reads DMA
+ * straight into each child's own buffer through the gang, so no
+ * split-and-copyback pass is needed on completion.  The only per-
+ * aggregate allocations are the gang headers and buffers covering
+ * read gaps and NODATA write gaps.
  */
 static zio_t *
 vdev_queue_aggregate(vdev_queue_t *vq, zio_t *zio)
@@ -631,8 +768,10 @@ vdev_queue_aggregate(vdev_queue_t *vq, zio_t *zio)
 
 	first = last = zio;
 
+	boolean_t nonrot = vq->vq_vdev->vdev_nonrot;
 	if (zio->io_type == ZIO_TYPE_READ) {
-		maxgap = zfs_vdev_read_gap_limit;
+		maxgap = nonrot ? zfs_vdev_read_gap_limit_non_rotating :
+		    zfs_vdev_read_gap_limit;
 		t = &vq->vq_read_offset_tree;
 	} else {
 		ASSERT3U(zio->io_type, ==, ZIO_TYPE_WRITE);
@@ -710,7 +849,9 @@ vdev_queue_aggregate(vdev_queue_t *vq, zio_t *zio)
 		zio_t *nio = last;
 		while ((dio = AVL_NEXT(t, nio)) != NULL &&
 		    IO_GAP(nio, dio) == 0 &&
-		    IO_GAP(mandatory, dio) <= zfs_vdev_write_gap_limit) {
+		    IO_GAP(mandatory, dio) <= (nonrot ?
+		    zfs_vdev_write_gap_limit_non_rotating :
+		    zfs_vdev_write_gap_limit)) {
 			nio = dio;
 			if (!(nio->io_flags & ZIO_FLAG_OPTIONAL)) {
 				stretch = B_TRUE;
@@ -819,6 +960,8 @@ vdev_queue_io_to_issue(vdev_queue_t *vq)
 again:
 	ASSERT(MUTEX_HELD(&vq->vq_lock));
 
+	vdev_queue_drain_incoming(vq);
+
 	p = vdev_queue_class_to_issue(vq);
 
 	if (p == ZIO_PRIORITY_NUM_QUEUEABLE) {
@@ -911,6 +1054,44 @@ vdev_should_queue_io(zio_t *zio)
 	return (should_queue);
 }
 
+/*
+ * Release vq_lock.  A pusher whose mutex_tryenter() failed while we
+ * held the lock relies on the holder to notice its zio, so after
+ * dropping the lock re-check the submission ring and issue anything
+ * that arrived; if the re-taken trylock fails, the new holder inherits
+ * the obligation through its own unlock.
+ */
+static void
+vdev_queue_unlock(vdev_queue_t *vq)
+{
+	zio_t *nio, *dio;
+	zio_link_t *zl;
+
+	mutex_exit(&vq->vq_lock);
+
+	while (vq->vq_incoming != NULL && mutex_tryenter(&vq->vq_lock)) {
+		while ((nio = vdev_queue_io_to_issue(vq)) != NULL) {
+			mutex_exit(&vq->vq_lock);
+			if (nio->io_done == vdev_queue_agg_io_done) {
+				zl = NULL;
+				while ((dio = zio_walk_parents(nio, &zl)) !=
+				    NULL) {
+					ASSERT3U(dio->io_type, ==,
+					    nio->io_type);
+					zio_vdev_io_bypass(dio);
+					zio_execute(dio);
+				}
+				zio_nowait(nio);
+			} else {
+				zio_vdev_io_reissue(nio);
+				zio_execute(nio);
+			}
+			mutex_enter(&vq->vq_lock);
+		}
+		mutex_exit(&vq->vq_lock);
+	}
+}
+
 zio_t *
 vdev_queue_io(zio_t *zio)
 {
@@ -959,10 +1140,28 @@ vdev_queue_io(zio_t *zio)
 		return (zio);
 	}
 
-	mutex_enter(&vq->vq_lock);
-	vdev_queue_io_add(vq, zio);
+	/*
+	 * Push onto the lock-free submission ring.  If somebody else
+	 * holds vq_lock they become responsible for draining and
+	 * issuing this zio, so submitters never block on the lock.
+	 */
+	for (;;) {
+		zio_t *head = vq->vq_incoming;
+
+		zio->io_vq_next = head;
+		if (atomic_cas_ptr((volatile void *)&vq->vq_incoming, head,
+		    zio) == head)
+			break;
+	}
+	atomic_inc_64(&vq->vq_incoming_count);
+	wmsum_add(&vdev_queue_sums.vqs_ring_pushes, 1);
+
+	if (mutex_tryenter(&vq->vq_lock) == 0) {
+		wmsum_add(&vdev_queue_sums.vqs_ring_handoffs, 1);
+		return (NULL);
+	}
 	nio = vdev_queue_io_to_issue(vq);
-	mutex_exit(&vq->vq_lock);
+	vdev_queue_unlock(vq);
 
 	if (nio == NULL)
 		return (NULL);
@@ -990,6 +1189,12 @@ vdev_queue_io_done(zio_t *zio)
 	hrtime_t now = gethrtime();
 	vq->vq_io_complete_ts = now;
 	vq->vq_io_delta_ts = zio->io_delta = now - zio->io_timestamp;
+	/*
+	 * Racy but adequate: an exponential moving average of recent
+	 * completion latency, used by vdev_mirror_load() to steer reads
+	 * away from a slow child.
+	 */
+	vq->vq_lat_ewma += (zio->io_delta - vq->vq_lat_ewma) >> 3;
 
 	if (zio->io_queue_state == ZIO_QS_NONE)
 		return;
@@ -1013,7 +1218,7 @@ vdev_queue_io_done(zio_t *zio)
 		mutex_enter(&vq->vq_lock);
 	}
 
-	mutex_exit(&vq->vq_lock);
+	vdev_queue_unlock(vq);
 }
 
 void
@@ -1062,7 +1267,7 @@ vdev_queue_change_io_priority(zio_t *zio, zio_priority_t priority)
 		zio->io_priority = priority;
 	}
 
-	mutex_exit(&vq->vq_lock);
+	vdev_queue_unlock(vq);
 }
 
 boolean_t
@@ -1087,6 +1292,12 @@ vdev_queue_length(vdev_t *vd)
 	return (vd->vdev_queue.vq_active);
 }
 
+uint64_t
+vdev_queue_latency(vdev_t *vd)
+{
+	return (vd->vdev_queue.vq_lat_ewma);
+}
+
 uint64_t
 vdev_queue_last_offset(vdev_t *vd)
 {
@@ -1112,12 +1323,22 @@ ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, aggregation_limit_non_rotating, UINT,
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, read_gap_limit, UINT, ZMOD_RW,
 	"Aggregate read I/O over gap");
 
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, read_gap_limit_non_rotating, UINT,
+	ZMOD_RW, "Aggregate read I/O over gap for non-rotating media");
+
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, write_gap_limit, UINT, ZMOD_RW,
 	"Aggregate write I/O over gap");
 
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, write_gap_limit_non_rotating, UINT,
+	ZMOD_RW, "Aggregate write I/O over gap for non-rotating media");
+
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, max_active, UINT, ZMOD_RW,
 	"Maximum number of active I/Os per vdev");
 
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, max_active_non_rotating, UINT, ZMOD_RW,
+	"Maximum number of active I/Os per non-rotational vdev (0 uses "
+	"zfs_vdev_max_active)");
+
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, async_write_active_max_dirty_percent,
 	UINT, ZMOD_RW, "Async write concurrency max threshold");
 
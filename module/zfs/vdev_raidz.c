@@ -4403,6 +4403,19 @@ raidz_reflow_impl(vdev_t *vd, vdev_raidz_expand_t *vre, zfs_range_tree_t *rt,
 	 * we can't move the on-disk progress to `offset`, because concurrent
 	 * writes/allocations could still use the currently-unallocated
 	 * region.
+	 *
+	 * This horizon is also why expansion throughput trails raw disk
+	 * bandwidth, especially early on: copies pipeline freely up to
+	 * raidz_expand_max_copy_bytes of outstanding I/O, but can only run
+	 * ahead of the last progress recorded in the synced uberblock by
+	 * about progress/old_children, so the copy stalls on a txg
+	 * round-trip each time it reaches the horizon (the caller forces a
+	 * txg_wait_synced() then).  Multiple independent copy regions with
+	 * per-region checkpoints would relax this, but on-disk progress is
+	 * a single offset in the uberblock (RRSS), so that is an on-disk
+	 * format change, not a tuning matter.  The horizon itself widens
+	 * as progress advances, which is why expansions speed up over
+	 * time.
 	 */
 	uint64_t ubsync_blkid =
 	    RRSS_GET_OFFSET(&spa->spa_ubsync) >> ashift;
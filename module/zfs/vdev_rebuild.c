@@ -896,6 +896,24 @@ vdev_rebuild_thread(void *arg)
 		mutex_exit(&msp->ms_lock);
 		mutex_exit(&msp->ms_sync_lock);
 
+		/*
+		 * Start reading the next metaslab's space map now, so its
+		 * load does not stall issuing between metaslabs and the
+		 * surviving disks stay busy through the transition.
+		 */
+		if (i + 1 < vd->vdev_ms_count) {
+			metaslab_t *next_msp = vd->vdev_ms[i + 1];
+
+			mutex_enter(&next_msp->ms_lock);
+			if (next_msp->ms_sm != NULL) {
+				dmu_prefetch(spa_meta_objset(spa),
+				    space_map_object(next_msp->ms_sm), 0, 0,
+				    space_map_length(next_msp->ms_sm),
+				    ZIO_PRIORITY_ASYNC_READ);
+			}
+			mutex_exit(&next_msp->ms_lock);
+		}
+
 		/*
 		 * To provide an accurate estimate re-calculate the estimated
 		 * size every 5 minutes to account for recent allocations and
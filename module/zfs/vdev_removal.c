@@ -131,7 +131,7 @@ typedef struct vdev_copy_arg {
  * doing a device removal.  This determines how much i/o we can have
  * in flight concurrently.
  */
-static const uint_t zfs_remove_max_copy_bytes = 64 * 1024 * 1024;
+static uint_t zfs_remove_max_copy_bytes = 64 * 1024 * 1024;
 
 /*
  * The largest contiguous segment that we will attempt to allocate when
@@ -1670,6 +1670,24 @@ again:
 		ASSERT0(zfs_range_tree_space(svr->svr_allocd_segs));
 		mutex_exit(&svr->svr_lock);
 
+		/*
+		 * Begin reading the next metaslab's space map now, while
+		 * no locks are held, so its load does not stall copying
+		 * between metaslabs.
+		 */
+		if (msi + 1 < vd->vdev_ms_count) {
+			metaslab_t *next_msp = vd->vdev_ms[msi + 1];
+
+			mutex_enter(&next_msp->ms_lock);
+			if (next_msp->ms_sm != NULL) {
+				dmu_prefetch(spa_meta_objset(spa),
+				    space_map_object(next_msp->ms_sm), 0, 0,
+				    space_map_length(next_msp->ms_sm),
+				    ZIO_PRIORITY_ASYNC_READ);
+			}
+			mutex_exit(&next_msp->ms_lock);
+		}
+
 		mutex_enter(&msp->ms_sync_lock);
 		mutex_enter(&msp->ms_lock);
 
@@ -2598,6 +2616,9 @@ ZFS_MODULE_PARAM(zfs_vdev, zfs_, removal_ignore_errors, INT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_vdev, zfs_, remove_max_segment, UINT, ZMOD_RW,
 	"Largest contiguous segment to allocate when removing device");
 
+ZFS_MODULE_PARAM(zfs_vdev, zfs_, remove_max_copy_bytes, UINT, ZMOD_RW,
+	"Max bytes in flight for the device removal copy");
+
 ZFS_MODULE_PARAM(zfs_vdev, vdev_, removal_max_span, UINT, ZMOD_RW,
 	"Largest span of free chunks a remap segment can span");
 
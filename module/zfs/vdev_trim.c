@@ -105,6 +105,94 @@ static unsigned int zfs_trim_extent_bytes_max = 128 * 1024 * 1024;
  */
 static unsigned int zfs_trim_extent_bytes_min = 32 * 1024;
 
+/*
+ * Back off automatic TRIM while the target leaf vdev's recent I/O
+ * latency average exceeds this many milliseconds, so bursts of TRIM
+ * do not inflate the latency of co-resident reads and writes.  0
+ * disables the feedback throttle.
+ */
+static unsigned int zfs_trim_latency_limit_ms = 5;
+
+/*
+ * Automatic TRIM statistics, exported through the zfs/trim kstat.
+ * The current backlog estimate is auto_bytes_queued minus
+ * auto_bytes_trimmed and auto_bytes_skipped.
+ */
+static struct {
+	wmsum_t ts_auto_queued;
+	wmsum_t ts_auto_trimmed;
+	wmsum_t ts_auto_skipped;
+	wmsum_t ts_auto_throttle_waits;
+} trim_sums;
+
+typedef struct trim_stats {
+	kstat_named_t ts_auto_queued;
+	kstat_named_t ts_auto_trimmed;
+	kstat_named_t ts_auto_skipped;
+	kstat_named_t ts_auto_throttle_waits;
+} trim_stats_t;
+
+static trim_stats_t trim_stats = {
+	{ "auto_bytes_queued",		KSTAT_DATA_UINT64 },
+	{ "auto_bytes_trimmed",		KSTAT_DATA_UINT64 },
+	{ "auto_bytes_skipped",		KSTAT_DATA_UINT64 },
+	{ "auto_throttle_waits",	KSTAT_DATA_UINT64 },
+};
+
+#define	TRIM_STAT_INCR(stat, val)	\
+	wmsum_add(&trim_sums.ts_##stat, (val))
+#define	TRIM_STAT_BUMP(stat)		TRIM_STAT_INCR(stat, 1)
+
+static kstat_t *trim_ksp;
+
+static int
+vdev_trim_kstats_update(kstat_t *ksp, int rw)
+{
+	trim_stats_t *ts = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (SET_ERROR(EACCES));
+	ts->ts_auto_queued.value.ui64 =
+	    wmsum_value(&trim_sums.ts_auto_queued);
+	ts->ts_auto_trimmed.value.ui64 =
+	    wmsum_value(&trim_sums.ts_auto_trimmed);
+	ts->ts_auto_skipped.value.ui64 =
+	    wmsum_value(&trim_sums.ts_auto_skipped);
+	ts->ts_auto_throttle_waits.value.ui64 =
+	    wmsum_value(&trim_sums.ts_auto_throttle_waits);
+	return (0);
+}
+
+void
+vdev_trim_stat_init(void)
+{
+	wmsum_init(&trim_sums.ts_auto_queued, 0);
+	wmsum_init(&trim_sums.ts_auto_trimmed, 0);
+	wmsum_init(&trim_sums.ts_auto_skipped, 0);
+	wmsum_init(&trim_sums.ts_auto_throttle_waits, 0);
+
+	trim_ksp = kstat_create("zfs", 0, "trim", "misc", KSTAT_TYPE_NAMED,
+	    sizeof (trim_stats) / sizeof (kstat_named_t), KSTAT_FLAG_VIRTUAL);
+	if (trim_ksp != NULL) {
+		trim_ksp->ks_data = &trim_stats;
+		trim_ksp->ks_update = vdev_trim_kstats_update;
+		kstat_install(trim_ksp);
+	}
+}
+
+void
+vdev_trim_stat_fini(void)
+{
+	if (trim_ksp != NULL) {
+		kstat_delete(trim_ksp);
+		trim_ksp = NULL;
+	}
+	wmsum_fini(&trim_sums.ts_auto_queued);
+	wmsum_fini(&trim_sums.ts_auto_trimmed);
+	wmsum_fini(&trim_sums.ts_auto_skipped);
+	wmsum_fini(&trim_sums.ts_auto_throttle_waits);
+}
+
 /*
  * Skip uninitialized metaslabs during the TRIM process.  This option is
  * useful for pools constructed from large thinly-provisioned devices where
@@ -515,6 +603,22 @@ vdev_trim_range(trim_args_t *ta, uint64_t start, uint64_t size)
 			    &vd->vdev_trim_io_lock, ddi_get_lbolt() +
 			    MSEC_TO_TICK(10));
 		}
+	} else if (ta->trim_type == TRIM_TYPE_AUTO) {
+		/*
+		 * Feedback throttle: while the device's recent I/O
+		 * latency is elevated, hold off issuing more automatic
+		 * TRIM so it does not pile onto the latency of
+		 * co-resident reads and writes.
+		 */
+		while (zfs_trim_latency_limit_ms != 0 &&
+		    !vdev_autotrim_should_stop(vd->vdev_top) &&
+		    vdev_queue_latency(vd) >
+		    MSEC2NSEC(zfs_trim_latency_limit_ms)) {
+			TRIM_STAT_BUMP(auto_throttle_waits);
+			cv_timedwait_idle(&vd->vdev_trim_io_cv,
+			    &vd->vdev_trim_io_lock, ddi_get_lbolt() +
+			    MSEC_TO_TICK(10));
+		}
 	}
 	ta->trim_bytes_done += size;
 
@@ -1313,6 +1417,8 @@ vdev_autotrim_thread(void *arg)
 			    vdev_rt_name(vd, "autotrim_tree"));
 			zfs_range_tree_swap(&msp->ms_trim, &trim_tree);
 			ASSERT(zfs_range_tree_is_empty(msp->ms_trim));
+			TRIM_STAT_INCR(auto_queued,
+			    zfs_range_tree_space(trim_tree));
 
 			/*
 			 * There are two cases when constructing the per-vdev
@@ -1420,6 +1526,19 @@ vdev_autotrim_thread(void *arg)
 				mutex_exit(&msp->ms_lock);
 			}
 
+			/*
+			 * Account what was actually trimmed; the rest of
+			 * what was queued was either below the minimum
+			 * extent size or abandoned on interruption.
+			 */
+			uint64_t queued = zfs_range_tree_space(trim_tree);
+			uint64_t done = 0;
+			for (uint64_t c = 0; c < children; c++)
+				done += tap[c].trim_bytes_done;
+			TRIM_STAT_INCR(auto_trimmed, done);
+			if (queued > done)
+				TRIM_STAT_INCR(auto_skipped, queued - done);
+
 			zfs_range_tree_vacate(trim_tree, NULL, NULL);
 			zfs_range_tree_destroy(trim_tree);
 
@@ -1798,5 +1917,8 @@ ZFS_MODULE_PARAM(zfs_trim, zfs_trim_, metaslab_skip, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_trim, zfs_trim_, txg_batch, UINT, ZMOD_RW,
 	"Min number of txgs to aggregate frees before issuing TRIM");
 
+ZFS_MODULE_PARAM(zfs_trim, zfs_trim_, latency_limit_ms, UINT, ZMOD_RW,
+	"Pause autotrim while device I/O latency exceeds this (ms, 0=off)");
+
 ZFS_MODULE_PARAM(zfs_trim, zfs_trim_, queue_limit, UINT, ZMOD_RW,
 	"Max queued TRIMs outstanding per leaf vdev");
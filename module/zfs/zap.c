@@ -1162,6 +1162,7 @@ zap_cursor_init_impl(zap_cursor_t *zc, objset_t *os, uint64_t zapobj,
 	zc->zc_hash = 0;
 	zc->zc_cd = 0;
 	zc->zc_prefetch = prefetch;
+	zc->zc_pf_idx = 0;
 }
 
 void
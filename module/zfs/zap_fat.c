@@ -82,6 +82,19 @@
  */
 static int zap_iterate_prefetch = B_TRUE;
 
+/*
+ * Number of leaf blocks to prefetch ahead of the cursor each time the
+ * iteration crosses into a new leaf.  The whole-object prefetch above
+ * only fires when iterating from the start of the object and is bounded
+ * by dmu_prefetch_max, so a large ZAP iterated across many syscalls
+ * (e.g. getdents on a huge directory, where each call resumes the
+ * cursor from a serialized offset) would otherwise take a synchronous
+ * read per leaf.  The rolling window keeps the next few leaves in
+ * flight, following the pointer table in hash (i.e. iteration) order.
+ * Zero disables it.
+ */
+static uint_t zap_iterate_prefetch_leaves = 16;
+
 /*
  * Enable ZAP shrinking. When enabled, empty sibling leaf blocks will be
  * collapsed into a single block.
@@ -1089,6 +1102,40 @@ fzap_prefetch(zap_name_t *zn)
  * Routines for iterating over the attributes.
  */
 
+/*
+ * Prefetch the next zap_iterate_prefetch_leaves leaf blocks following
+ * the cursor, walking the pointer table in hash order.  zc_pf_idx
+ * remembers how far ahead previous calls got, so the sliding window
+ * doesn't re-issue prefetches for the same blocks on every leaf
+ * crossing.
+ */
+static void
+fzap_cursor_prefetch_leaves(zap_t *zap, zap_cursor_t *zc)
+{
+	uint64_t shift = zap_f_phys(zap)->zap_ptrtbl.zt_shift;
+	uint64_t idx = ZAP_HASH_IDX(zc->zc_hash, shift);
+	int bs = FZAP_BLOCK_SHIFT(zap);
+	uint64_t lastblk = 0;
+	uint_t n = 0;
+
+	if (zc->zc_pf_idx > idx)
+		idx = zc->zc_pf_idx;
+	for (uint64_t i = idx + 1;
+	    i < (1ULL << shift) && n < zap_iterate_prefetch_leaves; i++) {
+		uint64_t blk;
+		if (zap_idx_to_blk(zap, i, &blk) != 0)
+			break;
+		/* Skip pointer-table duplicates of the same leaf */
+		if (blk == lastblk)
+			continue;
+		lastblk = blk;
+		dmu_prefetch_by_dnode(zap->zap_dnode, 0, blk << bs,
+		    1 << bs, ZIO_PRIORITY_ASYNC_READ);
+		n++;
+		zc->zc_pf_idx = i + 1;
+	}
+}
+
 int
 fzap_cursor_retrieve(zap_t *zap, zap_cursor_t *zc, zap_attribute_t *za)
 {
@@ -1135,6 +1182,8 @@ again:
 		    &zc->zc_leaf);
 		if (err != 0)
 			return (err);
+		if (zc->zc_prefetch && zap_iterate_prefetch_leaves != 0)
+			fzap_cursor_prefetch_leaves(zap, zc);
 	}
 	l = zc->zc_leaf;
 
@@ -1495,6 +1544,9 @@ zap_shrink(zap_name_t *zn, zap_leaf_t *l, dmu_tx_t *tx)
 	return (err);
 }
 
+ZFS_MODULE_PARAM(zfs, , zap_iterate_prefetch_leaves, UINT, ZMOD_RW,
+	"Leaf blocks to prefetch ahead of a ZAP cursor (0 disables)");
+
 ZFS_MODULE_PARAM(zfs, , zap_iterate_prefetch, INT, ZMOD_RW,
 	"When iterating ZAP object, prefetch it");
 
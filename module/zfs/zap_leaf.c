@@ -421,6 +421,21 @@ zap_leaf_array_match(zap_leaf_t *l, zap_name_t *zn,
  * Routines which manipulate leaf entries.
  */
 
+/*
+ * On vectorizing this lookup: the chain walked below is not a linear
+ * scan of the leaf.  Entries are bucketed by the l_hash table at the
+ * front of the leaf (ZAP_LEAF_HASH_NUMENTRIES buckets, e.g. 256 for an
+ * 8K leaf holding at most ~150 entries), so the expected chain length
+ * is below two even in a full leaf, and the le_hash compare already
+ * rejects non-matches without touching the name chunks.  A contiguous
+ * per-leaf hash array for SIMD comparison would add an in-memory decode
+ * cache that every entry add/remove/rehash must invalidate, plus a
+ * kernel FPU save/restore per lookup, to accelerate a one-or-two
+ * element walk.  Large-directory lookup time is dominated by the
+ * pointer-table descent and leaf dbuf I/O above this layer instead;
+ * that is what zap_iterate_prefetch and the cursor leaf prefetching
+ * address.
+ */
 int
 zap_leaf_lookup(zap_leaf_t *l, zap_name_t *zn, zap_entry_handle_t *zeh)
 {
@@ -324,6 +324,19 @@ handle_winner:
 	return (winner);
 }
 
+/*
+ * Convert a microzap to a fatzap, in one transaction.  All entries are
+ * re-inserted under the ZAP write lock, so directory operations stall
+ * for the duration; that is unavoidable without an on-disk format
+ * change, because an incremental migration would need both forms to
+ * coexist on disk across txgs for lookups (and crash recovery) to
+ * consult.  The practical mitigation is to defer conversion instead:
+ * with the large_microzap feature, zap_micro_max_size can raise the
+ * microzap cap to 1M (~32k entries), so directories in the common
+ * few-thousand-entry range never convert at all, and those that do
+ * convert later, when the relative stall is smaller than the cost of
+ * running a large directory as a one-block linear scan.
+ */
 int
 mzap_upgrade(zap_t **zapp, const void *tag, dmu_tx_t *tx, zap_flags_t flags)
 {
@@ -1115,6 +1115,20 @@ zcp_eval(const char *poolname, const char *program, boolean_t sync,
 	 * KM_SLEEP.  ERRGCMM should not be possible because we have not added
 	 * any objects with __gc metamethods to the interpreter that could
 	 * fail.
+	 *
+	 * Text-only loading and the fresh interpreter state built above are
+	 * both deliberate, and they are why repeated invocations recompile:
+	 * accepting precompiled chunks is a well-known Lua sandbox escape
+	 * (bytecode is not validated), and reusing a state across programs
+	 * would let one invocation observe another's globals.  A compiled
+	 * cache would have to keep kernel-held bytecode keyed by source
+	 * hash AND rebuild the sandbox state per run, which saves only the
+	 * parse - the smallest piece of the setup.  For frequent callers
+	 * the supported levers are batching work into one program per
+	 * invocation (the iterators stream from the underlying ZAPs, so
+	 * per-element cost lives there, not in the Lua call overhead) and
+	 * the zfs_lua_max_instrlimit / zfs_lua_max_memlimit tunables, which
+	 * already allow raising the runtime budget pool-wide.
 	 */
 	err = luaL_loadbufferx(state, program, strlen(program),
 	    "channel program", "t");
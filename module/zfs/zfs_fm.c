@@ -437,6 +437,24 @@ zfs_zevent_post_cb(nvlist_t *nvl, nvlist_t *detector)
 		fm_nvlist_destroy(detector, FM_NVA_FREE);
 }
 
+/*
+ * Map a rate-limited event class to the vdev's limiter for it, or NULL
+ * if the class is not rate limited.
+ */
+static zfs_ratelimit_t *
+zfs_event_ratelimiter(const char *subclass, vdev_t *vd)
+{
+	if (vd == NULL)
+		return (NULL);
+	if (strcmp(subclass, FM_EREPORT_ZFS_DELAY) == 0)
+		return (&vd->vdev_delay_rl);
+	if (strcmp(subclass, FM_EREPORT_ZFS_DEADMAN) == 0)
+		return (&vd->vdev_deadman_rl);
+	if (strcmp(subclass, FM_EREPORT_ZFS_CHECKSUM) == 0)
+		return (&vd->vdev_checksum_rl);
+	return (NULL);
+}
+
 /*
  * We want to rate limit ZIO delay, deadman, and checksum events so as to not
  * flood zevent consumers when a disk is acting up.
@@ -446,18 +464,15 @@ zfs_zevent_post_cb(nvlist_t *nvl, nvlist_t *detector)
 static int
 zfs_is_ratelimiting_event(const char *subclass, vdev_t *vd)
 {
+	zfs_ratelimit_t *rl = zfs_event_ratelimiter(subclass, vd);
 	int rc = 0;
+
 	/*
 	 * zfs_ratelimit() returns 1 if we're *not* ratelimiting and 0 if we
 	 * are.  Invert it to get our return value.
 	 */
-	if (strcmp(subclass, FM_EREPORT_ZFS_DELAY) == 0) {
-		rc = !zfs_ratelimit(&vd->vdev_delay_rl);
-	} else if (strcmp(subclass, FM_EREPORT_ZFS_DEADMAN) == 0) {
-		rc = !zfs_ratelimit(&vd->vdev_deadman_rl);
-	} else if (strcmp(subclass, FM_EREPORT_ZFS_CHECKSUM) == 0) {
-		rc = !zfs_ratelimit(&vd->vdev_checksum_rl);
-	}
+	if (rl != NULL)
+		rc = !zfs_ratelimit(rl);
 
 	if (rc)	{
 		/* We're rate limiting */
@@ -589,6 +604,32 @@ zfs_ereport_start(nvlist_t **ereport_out, nvlist_t **detector_out,
 			    DATA_TYPE_UINT64, vq->vq_io_delta_ts, NULL);
 		}
 
+		/*
+		 * If the limiter for this event class dropped events
+		 * since the last one that passed, fold the aggregate
+		 * into this ereport.  This event carries the
+		 * representative detail, and consumers (e.g. the zed
+		 * diagnosis SERD engines) can account for the full
+		 * count without the fault path having had to allocate
+		 * and post each one.
+		 */
+		zfs_ratelimit_t *rl = zfs_event_ratelimiter(subclass, vd);
+		if (rl != NULL) {
+			hrtime_t first, last;
+			uint32_t suppressed =
+			    zfs_ratelimit_drain(rl, &first, &last);
+
+			if (suppressed != 0) {
+				fm_payload_set(ereport,
+				    FM_EREPORT_PAYLOAD_ZFS_SUPPRESSED_EVENTS,
+				    DATA_TYPE_UINT32, suppressed,
+				    FM_EREPORT_PAYLOAD_ZFS_SUPPRESSED_FIRST,
+				    DATA_TYPE_UINT64, (uint64_t)first,
+				    FM_EREPORT_PAYLOAD_ZFS_SUPPRESSED_LAST,
+				    DATA_TYPE_UINT64, (uint64_t)last, NULL);
+			}
+		}
+
 		if (vs != NULL) {
 			fm_payload_set(ereport,
 			    FM_EREPORT_PAYLOAD_ZFS_VDEV_READ_ERRORS,
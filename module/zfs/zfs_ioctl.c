@@ -2537,6 +2537,21 @@ zfs_ioc_objset_zplprops(zfs_cmd_t *zc)
  * zc_nvlist_dst	property nvlist
  * zc_nvlist_dst_size	size of property nvlist
  */
+/*
+ * One ioctl per child dataset is what makes large recursive listings
+ * expensive: the round trips dominate, not the kernel work (note the
+ * returned nvlist already carries the objset stats, so default listings
+ * do not issue extra per-property calls).  A batched enumeration ioctl
+ * that streams many datasets per call would have to preserve three
+ * things this interface gets for free: the per-dataset visibility and
+ * delegation checks (each iteration filters hidden and other-zone
+ * names via zfs_dataset_name_hidden() and passes the vector's
+ * secpolicy - a bulk walk must apply both per entry, not per call);
+ * cursor stability while datasets are created, renamed,
+ * and destroyed mid-enumeration (the zap-cookie-in-name scheme here
+ * restarts naturally); and a bound on the reply nvlist size.  That is
+ * new long-term ABI and needs to be designed as such, not bolted on.
+ */
 static int
 zfs_ioc_dataset_list_next(zfs_cmd_t *zc)
 {
@@ -41,6 +41,9 @@ zfs_ratelimit_init(zfs_ratelimit_t *rl, unsigned int *burst,
 	rl->start = 0;
 	rl->interval = interval;
 	rl->burst = burst;
+	rl->suppressed = 0;
+	rl->first_suppressed = 0;
+	rl->last_suppressed = 0;
 	mutex_init(&rl->lock, NULL, MUTEX_DEFAULT, NULL);
 }
 
@@ -92,9 +95,36 @@ zfs_ratelimit(zfs_ratelimit_t *rl)
 	} else {
 		if (rl->count >= *rl->burst) {
 			error = 0; /* We're ratelimiting */
+			if (rl->suppressed++ == 0)
+				rl->first_suppressed = now;
+			rl->last_suppressed = now;
 		}
 	}
 	mutex_exit(&rl->lock);
 
 	return (error);
 }
+
+/*
+ * Collect and reset the aggregate of suppressed events.  Returns the
+ * number of events the limiter dropped since the last drain; when
+ * nonzero, *first and *last are the gethrtime() stamps of the first and
+ * last drop.  The caller attaches these to the next event that passes,
+ * turning a silent gap into a summary.
+ */
+unsigned int
+zfs_ratelimit_drain(zfs_ratelimit_t *rl, hrtime_t *first, hrtime_t *last)
+{
+	unsigned int suppressed;
+
+	mutex_enter(&rl->lock);
+	suppressed = rl->suppressed;
+	*first = rl->first_suppressed;
+	*last = rl->last_suppressed;
+	rl->suppressed = 0;
+	rl->first_suppressed = 0;
+	rl->last_suppressed = 0;
+	mutex_exit(&rl->lock);
+
+	return (suppressed);
+}
@@ -109,6 +109,27 @@
  * So if the block size needs to be grown then the whole file is
  * exclusively locked, then later the caller will reduce the lock
  * range to just the range to be written using rangelock_reduce().
+ *
+ * A note on scalability
+ * ---------------------
+ * All lockers of a file serialize on rl_lock, and highly parallel
+ * non-overlapping users (e.g. many O_DIRECT readers of one large file)
+ * contend on it even though their ranges never conflict.  Schemes to
+ * spread that cost exist, but everything above leans on the atomicity
+ * of a single lock: proxy splitting rewrites several tree nodes in one
+ * critical section; the append/grow-block callback converts RL_APPEND
+ * and widens RL_WRITER ranges while holding rl_lock, so the conversion
+ * and the insertion are one atomic step; and the wakeup protocol
+ * (flags plus per-range cvs) assumes the waiter's flag set and the
+ * unlocker's test happen under the same mutex.  Sharding by offset
+ * would be deadlock-free with strictly ascending shard acquisition,
+ * but a blocked locker would hold its lower shards while sleeping,
+ * ranges would split proxies at every shard boundary, and the append
+ * conversion has no single lock under which to run.  A lock-free
+ * reader fast path would additionally need the proxy machinery
+ * replaced wholesale.  Until someone takes that on, the mitigation is
+ * at the call sites: batch work under one enter/exit (as the writeback
+ * and send paths do) rather than taking many small range locks.
  */
 
 #include <sys/zfs_context.h>
@@ -46,6 +46,7 @@
 #include <sys/zfs_dir.h>
 #include <sys/zfs_acl.h>
 #include <sys/zfs_ioctl.h>
+#include <sys/dataset_kstats.h>
 #include <sys/fs/zfs.h>
 #include <sys/dmu.h>
 #include <sys/dmu_objset.h>
@@ -122,9 +123,15 @@ zfs_fsync(znode_t *zp, int syncflag, cred_t *cr)
 	zfsvfs_t *zfsvfs = ZTOZSB(zp);
 
 	if (zfsvfs->z_os->os_sync != ZFS_SYNC_DISABLED) {
+		hrtime_t start = zfs_dataset_latency_histo ? gethrtime() : 0;
+
 		if ((error = zfs_enter_verify_zp(zfsvfs, zp, FTAG)) != 0)
 			return (error);
 		error = zil_commit(zfsvfs->z_log, zp->z_id);
+		if (start != 0) {
+			dataset_kstats_record_sync_lat(&zfsvfs->z_kstat,
+			    gethrtime() - start);
+		}
 		zfs_exit(zfsvfs, FTAG);
 	}
 	return (error);
@@ -339,6 +346,7 @@ zfs_read(struct znode *zp, zfs_uio_t *uio, int ioflag, cred_t *cr)
 	int error = 0;
 	boolean_t frsync = B_FALSE;
 	boolean_t dio_checksum_failure = B_FALSE;
+	hrtime_t lat_start = zfs_dataset_latency_histo ? gethrtime() : 0;
 
 	zfsvfs_t *zfsvfs = ZTOZSB(zp);
 	if ((error = zfs_enter_verify_zp(zfsvfs, zp, FTAG)) != 0)
@@ -425,8 +433,16 @@ zfs_read(struct znode *zp, zfs_uio_t *uio, int ioflag, cred_t *cr)
 	ssize_t dio_remaining_resid = 0;
 
 	dmu_flags_t dflags = DMU_READ_PREFETCH;
-	if (ioflag & O_DIRECT)
+	if ((ioflag & O_DIRECT) || zp->z_noreuse)
 		dflags |= DMU_UNCACHEDIO;
+
+	/*
+	 * An idle-class reader has declared that urgency does not
+	 * matter; let the vdev queues treat its demand reads like
+	 * prefetch instead of competing with synchronous readers.
+	 */
+	if (uio->uio_extflg & UIO_LOWPRI)
+		dflags |= DMU_LOWPRI;
 	if (uio->uio_extflg & UIO_DIRECT) {
 		/*
 		 * All pages for an O_DIRECT request ahve already been mapped
@@ -538,6 +554,10 @@ zfs_read(struct znode *zp, zfs_uio_t *uio, int ioflag, cred_t *cr)
 	int64_t nread = start_resid - n;
 
 	dataset_kstats_update_read_kstats(&zfsvfs->z_kstat, nread);
+	if (lat_start != 0) {
+		dataset_kstats_record_read_lat(&zfsvfs->z_kstat,
+		    gethrtime() - lat_start);
+	}
 out:
 	zfs_rangelock_exit(lr);
 
@@ -643,6 +663,8 @@ zfs_write(znode_t *zp, zfs_uio_t *uio, int ioflag, cred_t *cr)
 	if (n == 0)
 		return (0);
 
+	hrtime_t lat_start = zfs_dataset_latency_histo ? gethrtime() : 0;
+
 	zfsvfs_t *zfsvfs = ZTOZSB(zp);
 	if ((error = zfs_enter_verify_zp(zfsvfs, zp, FTAG)) != 0)
 		return (error);
@@ -901,7 +923,7 @@ zfs_write(znode_t *zp, zfs_uio_t *uio, int ioflag, cred_t *cr)
 		}
 
 		dmu_flags_t dflags = DMU_READ_PREFETCH;
-		if (ioflag & O_DIRECT)
+		if ((ioflag & O_DIRECT) || zp->z_noreuse)
 			dflags |= DMU_UNCACHEDIO;
 		if (uio->uio_extflg & UIO_DIRECT)
 			dflags |= DMU_DIRECTIO;
@@ -1097,6 +1119,10 @@ zfs_write(znode_t *zp, zfs_uio_t *uio, int ioflag, cred_t *cr)
 
 	int64_t nwritten = start_resid - zfs_uio_resid(uio);
 	dataset_kstats_update_write_kstats(&zfsvfs->z_kstat, nwritten);
+	if (lat_start != 0) {
+		dataset_kstats_record_write_lat(&zfsvfs->z_kstat,
+		    gethrtime() - lat_start);
+	}
 
 	zfs_exit(zfsvfs, FTAG);
 	return (0);
@@ -1595,6 +1621,15 @@ zfs_exit_two(zfsvfs_t *zfsvfs1, zfsvfs_t *zfsvfs2, const char *tag)
  * operation (see zil_max_log_data() and zfs_log_clone_range()). This gives
  * us room for storing 1022 block pointers.
  *
+ * Note that this is already a vectored path: each chunk reads its source
+ * block pointers with one dmu_read_l0_bps() sweep, and the BRT reference
+ * updates are not written per block either - dmu_brt_clone() stages them
+ * on the in-memory per-txg pending tree (brt_pending_add()), from which
+ * they are applied in bulk at sync.  Cloning from an unmounted snapshot
+ * needs no special handling here: the .zfs/snapshot automount makes the
+ * source file reachable, and a snapshot and its filesystem are in the
+ * same pool by construction, which is all the cloning path requires.
+ *
  * On success, the function return the number of bytes copied in *lenp.
  * Note, it doesn't return how much bytes are left to be copied.
  * On errors which are caused by any file system limitations or
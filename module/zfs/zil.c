@@ -85,6 +85,19 @@
  * blocks; they are dynamically allocated and freed as needed from the
  * blocks available on the pool, though they can be preferentially
  * allocated from a dedicated "log" vdev.
+ *
+ * Because the chain is singly linked and the header points at a single
+ * first block, each zilog has exactly one on-disk chain, and replay
+ * depends on walking it in order.  Commit concurrency therefore comes
+ * from pipelining rather than from parallel chains: zl_issuer_lock
+ * covers only assigning itxs to lwbs and closing them, while the
+ * expensive work - copying records into the lwb buffer, allocating
+ * the next block, and issuing the write - happens in
+ * zil_lwb_write_issue() after the lock is dropped, so multiple
+ * committers keep several in-flight lwbs in the chain at once.
+ * Running truly independent per-dataset sub-chains would require a
+ * log format change (multiple chain starts in the header and a replay
+ * interleaving rule), not just issuer-side restructuring.
  */
 
 /*
@@ -120,6 +133,9 @@ static zil_kstat_values_t zil_stats = {
 	{ "zil_itx_metaslab_slog_bytes",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_write",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_alloc",	KSTAT_DATA_UINT64 },
+	{ "zil_immediate_write_sz",		KSTAT_DATA_UINT64 },
+	{ { "zil_commit_lat_us_N",		KSTAT_DATA_UINT64 } },
+	{ { "zil_lwb_fill_8ths_N",		KSTAT_DATA_UINT64 } },
 };
 
 static zil_sums_t zil_sums_global;
@@ -144,6 +160,18 @@ static int zil_nocacheflush = 0;
  */
 static uint64_t zil_slog_bulk = 64 * 1024 * 1024;
 
+/*
+ * When set, the WR_COPIED/WR_INDIRECT cutover adapts per dataset: the
+ * static zfs_immediate_write_sz is scaled by the ratio of the main
+ * pool's worst-leaf write latency to the dataset's recent log write
+ * latency, clamped to [SPA_MINBLOCKSIZE, 16M].  Fast dedicated slogs
+ * thus keep copying much larger writes into the log, while slow
+ * embedded logs push data to the main pool sooner.  The threshold in
+ * effect is visible as zil_immediate_write_sz in each dataset's
+ * kstat.
+ */
+static int zil_adaptive_immediate_write = 0;
+
 static kmem_cache_t *zil_lwb_cache;
 static kmem_cache_t *zil_zcw_cache;
 
@@ -385,6 +413,11 @@ zil_sums_init(zil_sums_t *zs)
 	wmsum_init(&zs->zil_itx_metaslab_slog_bytes, 0);
 	wmsum_init(&zs->zil_itx_metaslab_slog_write, 0);
 	wmsum_init(&zs->zil_itx_metaslab_slog_alloc, 0);
+	zs->zil_immediate_write_sz = 0;
+	for (int i = 0; i < ZIL_LAT_BUCKETS; i++)
+		wmsum_init(&zs->zil_commit_lat_us[i], 0);
+	for (int i = 0; i < ZIL_FILL_BUCKETS; i++)
+		wmsum_init(&zs->zil_lwb_fill_8ths[i], 0);
 }
 
 void
@@ -411,6 +444,29 @@ zil_sums_fini(zil_sums_t *zs)
 	wmsum_fini(&zs->zil_itx_metaslab_slog_bytes);
 	wmsum_fini(&zs->zil_itx_metaslab_slog_write);
 	wmsum_fini(&zs->zil_itx_metaslab_slog_alloc);
+	for (int i = 0; i < ZIL_LAT_BUCKETS; i++)
+		wmsum_fini(&zs->zil_commit_lat_us[i]);
+	for (int i = 0; i < ZIL_FILL_BUCKETS; i++)
+		wmsum_fini(&zs->zil_lwb_fill_8ths[i]);
+}
+
+/*
+ * Fill in the runtime-generated names of the histogram entries.
+ */
+void
+zil_kstat_values_name(zil_kstat_values_t *zs)
+{
+	for (int i = 0; i < ZIL_LAT_BUCKETS; i++) {
+		(void) snprintf(zs->zil_commit_lat_us[i].name,
+		    KSTAT_STRLEN, "zil_commit_lat_us_%llu",
+		    (u_longlong_t)(1ULL << i));
+		zs->zil_commit_lat_us[i].data_type = KSTAT_DATA_UINT64;
+	}
+	for (int i = 0; i < ZIL_FILL_BUCKETS; i++) {
+		(void) snprintf(zs->zil_lwb_fill_8ths[i].name,
+		    KSTAT_STRLEN, "zil_lwb_fill_8ths_%d", i);
+		zs->zil_lwb_fill_8ths[i].data_type = KSTAT_DATA_UINT64;
+	}
 }
 
 void
@@ -458,6 +514,16 @@ zil_kstat_values_update(zil_kstat_values_t *zs, zil_sums_t *zil_sums)
 	    wmsum_value(&zil_sums->zil_itx_metaslab_slog_write);
 	zs->zil_itx_metaslab_slog_alloc.value.ui64 =
 	    wmsum_value(&zil_sums->zil_itx_metaslab_slog_alloc);
+	zs->zil_immediate_write_sz.value.ui64 =
+	    zil_sums->zil_immediate_write_sz;
+	for (int i = 0; i < ZIL_LAT_BUCKETS; i++) {
+		zs->zil_commit_lat_us[i].value.ui64 =
+		    wmsum_value(&zil_sums->zil_commit_lat_us[i]);
+	}
+	for (int i = 0; i < ZIL_FILL_BUCKETS; i++) {
+		zs->zil_lwb_fill_8ths[i].value.ui64 =
+		    wmsum_value(&zil_sums->zil_lwb_fill_8ths[i]);
+	}
 }
 
 /*
@@ -917,9 +983,9 @@ zilog_dirty(zilog_t *zilog, uint64_t txg)
 /*
  * Determine if the zil is dirty in the specified txg. Callers wanting to
  * ensure that the dirty state does not change must hold the itxg_lock for
- * the specified txg. Holding the lock will ensure that the zil cannot be
- * dirtied (zil_itx_assign) or cleaned (zil_clean) while we check its current
- * state.
+ * the specified txg as writer. Holding the lock will ensure that the zil
+ * cannot be dirtied (zil_itx_assign, which takes it as reader) or cleaned
+ * (zil_clean) while we check its current state.
  */
 static boolean_t __maybe_unused
 zilog_is_dirty_in_txg(zilog_t *zilog, uint64_t txg)
@@ -1958,6 +2024,15 @@ zil_lwb_write_issue(zilog_t *zilog, lwb_t *lwb)
 	lwb->lwb_nused = lwb->lwb_nfilled;
 	ASSERT3U(lwb->lwb_nused, <=, lwb->lwb_nmax);
 
+	if (lwb->lwb_nmax != 0) {
+		int b = MIN((int)(lwb->lwb_nused * ZIL_FILL_BUCKETS /
+		    lwb->lwb_nmax), ZIL_FILL_BUCKETS - 1);
+
+		wmsum_add(&zil_sums_global.zil_lwb_fill_8ths[b], 1);
+		if (zilog->zl_sums != NULL)
+			wmsum_add(&zilog->zl_sums->zil_lwb_fill_8ths[b], 1);
+	}
+
 	lwb->lwb_root_zio = zio_root(spa, zil_lwb_flush_vdevs_done, lwb,
 	    ZIO_FLAG_CANFAIL);
 
@@ -2224,7 +2299,25 @@ zil_write_state(zilog_t *zilog, uint64_t size, uint32_t blocksize,
 	 * is not planned, then next writes might coalesce, and so the
 	 * indirect may be perfect.
 	 */
-	boolean_t indirect = (size >= zfs_immediate_write_sz &&
+	uint64_t immediate_sz = zfs_immediate_write_sz;
+	if (zil_adaptive_immediate_write) {
+		uint64_t main_lat = metaslab_class_leaf_latency(
+		    spa_normal_class(zilog->zl_spa));
+		uint64_t log_lat = zilog->zl_last_lwb_latency;
+
+		if (main_lat != 0 && log_lat != 0) {
+			immediate_sz = MIN(MAX(zfs_immediate_write_sz *
+			    main_lat / log_lat, SPA_MINBLOCKSIZE),
+			    16 * 1024 * 1024);
+		}
+		if (zilog->zl_sums != NULL)
+			zilog->zl_sums->zil_immediate_write_sz = immediate_sz;
+	} else if (zilog->zl_sums != NULL &&
+	    zilog->zl_sums->zil_immediate_write_sz != immediate_sz) {
+		zilog->zl_sums->zil_immediate_write_sz = immediate_sz;
+	}
+
+	boolean_t indirect = (size >= immediate_sz &&
 	    (size >= blocksize / 2 || !commit));
 
 	if (spa_has_slogs(zilog->zl_spa)) {
@@ -2609,46 +2702,56 @@ zil_itxg_clean(void *arg)
 	itxs_t *itxs = arg;
 	itx_async_node_t *ian;
 
-	list = &itxs->i_sync_list;
-	while ((itx = list_remove_head(list)) != NULL) {
-		/*
-		 * In the general case, commit itxs will not be found
-		 * here, as they'll be committed to an lwb via
-		 * zil_lwb_assign(), and free'd in that function. Having
-		 * said that, it is still possible for commit itxs to be
-		 * found here, due to the following race:
-		 *
-		 *	- a thread calls zil_commit() which assigns the
-		 *	  commit itx to a per-txg i_sync_list
-		 *	- zil_itxg_clean() is called (e.g. via spa_sync())
-		 *	  while the waiter is still on the i_sync_list
-		 *
-		 * There's nothing to prevent syncing the txg while the
-		 * waiter is on the i_sync_list. This normally doesn't
-		 * happen because spa_sync() is slower than zil_commit(),
-		 * but if zil_commit() calls txg_wait_synced() (e.g.
-		 * because zil_create() or zil_commit_writer_stall() is
-		 * called) we will hit this case.
-		 */
-		if (itx->itx_lr.lrc_txtype == TX_COMMIT)
-			zil_commit_waiter_done(itx->itx_private, 0);
-
-		zil_itx_destroy(itx, 0);
-	}
+	for (int i = 0; i < ZIL_ITX_SHARDS; i++) {
+		itx_shard_t *is = &itxs->i_shard[i];
 
-	cookie = NULL;
-	t = &itxs->i_async_tree;
-	while ((ian = avl_destroy_nodes(t, &cookie)) != NULL) {
-		list = &ian->ia_list;
+		list = &is->is_sync_list;
 		while ((itx = list_remove_head(list)) != NULL) {
-			/* commit itxs should never be on the async lists. */
-			ASSERT3U(itx->itx_lr.lrc_txtype, !=, TX_COMMIT);
+			/*
+			 * In the general case, commit itxs will not be
+			 * found here, as they'll be committed to an lwb
+			 * via zil_lwb_assign(), and free'd in that
+			 * function. Having said that, it is still
+			 * possible for commit itxs to be found here,
+			 * due to the following race:
+			 *
+			 *	- a thread calls zil_commit() which
+			 *	  assigns the commit itx to a per-txg
+			 *	  sync list
+			 *	- zil_itxg_clean() is called (e.g. via
+			 *	  spa_sync()) while the waiter is still
+			 *	  on the sync list
+			 *
+			 * There's nothing to prevent syncing the txg
+			 * while the waiter is on the sync list. This
+			 * normally doesn't happen because spa_sync() is
+			 * slower than zil_commit(), but if zil_commit()
+			 * calls txg_wait_synced() (e.g. because
+			 * zil_create() or zil_commit_writer_stall() is
+			 * called) we will hit this case.
+			 */
+			if (itx->itx_lr.lrc_txtype == TX_COMMIT)
+				zil_commit_waiter_done(itx->itx_private, 0);
+
 			zil_itx_destroy(itx, 0);
 		}
-		list_destroy(list);
-		kmem_free(ian, sizeof (itx_async_node_t));
+
+		cookie = NULL;
+		t = &is->is_async_tree;
+		while ((ian = avl_destroy_nodes(t, &cookie)) != NULL) {
+			list = &ian->ia_list;
+			while ((itx = list_remove_head(list)) != NULL) {
+				/* commit itxs are never on async lists */
+				ASSERT3U(itx->itx_lr.lrc_txtype, !=, TX_COMMIT);
+				zil_itx_destroy(itx, 0);
+			}
+			list_destroy(list);
+			kmem_free(ian, sizeof (itx_async_node_t));
+		}
+		avl_destroy(t);
+		list_destroy(&is->is_sync_list);
+		mutex_destroy(&is->is_lock);
 	}
-	avl_destroy(t);
 
 	kmem_free(itxs, sizeof (itxs_t));
 }
@@ -2686,21 +2789,25 @@ zil_remove_async(zilog_t *zilog, uint64_t oid)
 	for (txg = otxg; txg < (otxg + TXG_CONCURRENT_STATES); txg++) {
 		itxg_t *itxg = &zilog->zl_itxg[txg & TXG_MASK];
 
-		mutex_enter(&itxg->itxg_lock);
+		rw_enter(&itxg->itxg_lock, RW_WRITER);
 		if (itxg->itxg_txg != txg) {
-			mutex_exit(&itxg->itxg_lock);
+			rw_exit(&itxg->itxg_lock);
 			continue;
 		}
 
 		/*
-		 * Locate the object node and append its list.
+		 * Locate the object node in each shard and append its
+		 * list.  Ordering doesn't matter here, everything found
+		 * is destroyed.
 		 */
-		t = &itxg->itxg_itxs->i_async_tree;
-		ian_search.ia_foid = oid;
-		ian = avl_find(t, &ian_search, &where);
-		if (ian != NULL)
-			list_move_tail(&clean_list, &ian->ia_list);
-		mutex_exit(&itxg->itxg_lock);
+		for (int i = 0; i < ZIL_ITX_SHARDS; i++) {
+			t = &itxg->itxg_itxs->i_shard[i].is_async_tree;
+			ian_search.ia_foid = oid;
+			ian = avl_find(t, &ian_search, &where);
+			if (ian != NULL)
+				list_move_tail(&clean_list, &ian->ia_list);
+		}
+		rw_exit(&itxg->itxg_lock);
 	}
 	while ((itx = list_remove_head(&clean_list)) != NULL) {
 		/* commit itxs should never be on the async lists. */
@@ -2710,6 +2817,24 @@ zil_remove_async(zilog_t *zilog, uint64_t oid)
 	list_destroy(&clean_list);
 }
 
+static itxs_t *
+zil_itxs_alloc(void)
+{
+	itxs_t *itxs = kmem_zalloc(sizeof (itxs_t), KM_SLEEP);
+
+	for (int i = 0; i < ZIL_ITX_SHARDS; i++) {
+		itx_shard_t *is = &itxs->i_shard[i];
+
+		mutex_init(&is->is_lock, NULL, MUTEX_DEFAULT, NULL);
+		list_create(&is->is_sync_list, sizeof (itx_t),
+		    offsetof(itx_t, itx_node));
+		avl_create(&is->is_async_tree, zil_aitx_compare,
+		    sizeof (itx_async_node_t),
+		    offsetof(itx_async_node_t, ia_node));
+	}
+	return (itxs);
+}
+
 void
 zil_itx_assign(zilog_t *zilog, itx_t *itx, dmu_tx_t *tx)
 {
@@ -2728,34 +2853,54 @@ zil_itx_assign(zilog_t *zilog, itx_t *itx, dmu_tx_t *tx)
 	else
 		txg = dmu_tx_get_txg(tx);
 
+	/*
+	 * The hot path only takes the itxg lock as reader (excluding
+	 * the rollover below and zil_clean()) plus one shard lock, so
+	 * concurrent writers to one dataset don't serialize here.  The
+	 * sequence stamp, taken under the shard lock, makes the shards
+	 * mergeable: operations on the same object are already
+	 * serialized by their range or dirent locks, so their stamps
+	 * record their true order, and each shard list stays sorted.
+	 */
 	itxg = &zilog->zl_itxg[txg & TXG_MASK];
-	mutex_enter(&itxg->itxg_lock);
-	itxs = itxg->itxg_itxs;
+	rw_enter(&itxg->itxg_lock, RW_READER);
 	if (itxg->itxg_txg != txg) {
-		if (itxs != NULL) {
-			/*
-			 * The zil_clean callback hasn't got around to cleaning
-			 * this itxg. Save the itxs for release below.
-			 * This should be rare.
-			 */
-			zfs_dbgmsg("zil_itx_assign: missed itx cleanup for "
-			    "txg %llu", (u_longlong_t)itxg->itxg_txg);
-			clean = itxg->itxg_itxs;
+		rw_exit(&itxg->itxg_lock);
+		rw_enter(&itxg->itxg_lock, RW_WRITER);
+		if (itxg->itxg_txg != txg) {
+			if (itxg->itxg_itxs != NULL) {
+				/*
+				 * The zil_clean callback hasn't got around
+				 * to cleaning this itxg. Save the itxs for
+				 * release below.  This should be rare.
+				 */
+				zfs_dbgmsg("zil_itx_assign: missed itx "
+				    "cleanup for txg %llu",
+				    (u_longlong_t)itxg->itxg_txg);
+				clean = itxg->itxg_itxs;
+			}
+			itxg->itxg_txg = txg;
+			itxg->itxg_itxs = zil_itxs_alloc();
 		}
-		itxg->itxg_txg = txg;
-		itxs = itxg->itxg_itxs = kmem_zalloc(sizeof (itxs_t),
-		    KM_SLEEP);
-
-		list_create(&itxs->i_sync_list, sizeof (itx_t),
-		    offsetof(itx_t, itx_node));
-		avl_create(&itxs->i_async_tree, zil_aitx_compare,
-		    sizeof (itx_async_node_t),
-		    offsetof(itx_async_node_t, ia_node));
+		rw_downgrade(&itxg->itxg_lock);
 	}
+	itxs = itxg->itxg_itxs;
+
+	itx_shard_t *is =
+	    &itxs->i_shard[CPU_SEQID_UNSTABLE & (ZIL_ITX_SHARDS - 1)];
+	mutex_enter(&is->is_lock);
+
+	/*
+	 * The stamp must be taken under the shard lock: stamping first
+	 * would let a second stamp on the same shard insert ahead of
+	 * us, breaking the per-shard seq ordering the commit-time merge
+	 * depends on.
+	 */
+	itx->itx_seq = atomic_add_64_nv(&zilog->zl_itx_seq, 1);
 	if (itx->itx_sync) {
-		list_insert_tail(&itxs->i_sync_list, itx);
+		list_insert_tail(&is->is_sync_list, itx);
 	} else {
-		avl_tree_t *t = &itxs->i_async_tree;
+		avl_tree_t *t = &is->is_async_tree;
 		uint64_t foid =
 		    LR_FOID_GET_OBJ(((lr_ooo_t *)&itx->itx_lr)->lr_foid);
 		itx_async_node_t *ian;
@@ -2772,6 +2917,7 @@ zil_itx_assign(zilog_t *zilog, itx_t *itx, dmu_tx_t *tx)
 		}
 		list_insert_tail(&ian->ia_list, itx);
 	}
+	mutex_exit(&is->is_lock);
 
 	itx->itx_lr.lrc_txg = dmu_tx_get_txg(tx);
 
@@ -2782,7 +2928,7 @@ zil_itx_assign(zilog_t *zilog, itx_t *itx, dmu_tx_t *tx)
 	 * TXG (not itxg_txg) even when the SPA is frozen.
 	 */
 	zilog_dirty(zilog, dmu_tx_get_txg(tx));
-	mutex_exit(&itxg->itxg_lock);
+	rw_exit(&itxg->itxg_lock);
 
 	/* Release the old itxs now we've dropped the lock */
 	if (clean != NULL)
@@ -2875,9 +3021,9 @@ zil_clean(zilog_t *zilog, uint64_t synced_txg)
 		mutex_exit(&zilog->zl_lock);
 	}
 
-	mutex_enter(&itxg->itxg_lock);
+	rw_enter(&itxg->itxg_lock, RW_WRITER);
 	if (itxg->itxg_itxs == NULL || itxg->itxg_txg == ZILTEST_TXG) {
-		mutex_exit(&itxg->itxg_lock);
+		rw_exit(&itxg->itxg_lock);
 		return;
 	}
 	ASSERT3U(itxg->itxg_txg, <=, synced_txg);
@@ -2885,7 +3031,7 @@ zil_clean(zilog_t *zilog, uint64_t synced_txg)
 	clean_me = itxg->itxg_itxs;
 	itxg->itxg_itxs = NULL;
 	itxg->itxg_txg = 0;
-	mutex_exit(&itxg->itxg_lock);
+	rw_exit(&itxg->itxg_lock);
 	/*
 	 * Preferably start a task queue to free up the old itxs but
 	 * if taskq_dispatch can't allocate resources to do that then
@@ -2925,9 +3071,9 @@ zil_get_commit_list(zilog_t *zilog)
 	for (txg = otxg; txg < (otxg + TXG_CONCURRENT_STATES); txg++) {
 		itxg_t *itxg = &zilog->zl_itxg[txg & TXG_MASK];
 
-		mutex_enter(&itxg->itxg_lock);
+		rw_enter(&itxg->itxg_lock, RW_WRITER);
 		if (itxg->itxg_txg != txg) {
-			mutex_exit(&itxg->itxg_lock);
+			rw_exit(&itxg->itxg_lock);
 			continue;
 		}
 
@@ -2941,7 +3087,7 @@ zil_get_commit_list(zilog_t *zilog)
 		 */
 		ASSERT(zilog_is_dirty_in_txg(zilog, txg) ||
 		    spa_freeze_txg(zilog->zl_spa) != UINT64_MAX);
-		list_t *sync_list = &itxg->itxg_itxs->i_sync_list;
+		itxs_t *itxs = itxg->itxg_itxs;
 		itx_t *itx = NULL;
 		if (unlikely(zilog->zl_suspend > 0)) {
 			/*
@@ -2949,14 +3095,45 @@ zil_get_commit_list(zilog_t *zilog)
 			 * Allow all earlier itxs to be committed, but ask
 			 * caller to do txg_wait_synced(txg) for any new.
 			 */
-			if (!list_is_empty(sync_list))
-				wtxg = MAX(wtxg, txg);
+			for (int i = 0; i < ZIL_ITX_SHARDS; i++) {
+				if (!list_is_empty(
+				    &itxs->i_shard[i].is_sync_list)) {
+					wtxg = MAX(wtxg, txg);
+					break;
+				}
+			}
 		} else {
-			itx = list_head(sync_list);
-			list_move_tail(commit_list, sync_list);
+			/*
+			 * Merge the shards' sync lists by sequence stamp
+			 * so the commit list sees the itxs in assignment
+			 * order, exactly as an unsharded list would.
+			 * Each shard list is already sorted (appends of
+			 * monotone stamps), so this is a k-way merge.
+			 */
+			for (;;) {
+				list_t *best = NULL;
+				itx_t *head, *bh = NULL;
+
+				for (int i = 0; i < ZIL_ITX_SHARDS; i++) {
+					list_t *sl =
+					    &itxs->i_shard[i].is_sync_list;
+					head = list_head(sl);
+					if (head != NULL && (bh == NULL ||
+					    head->itx_seq < bh->itx_seq)) {
+						best = sl;
+						bh = head;
+					}
+				}
+				if (bh == NULL)
+					break;
+				list_remove(best, bh);
+				list_insert_tail(commit_list, bh);
+				if (itx == NULL)
+					itx = bh;
+			}
 		}
 
-		mutex_exit(&itxg->itxg_lock);
+		rw_exit(&itxg->itxg_lock);
 
 		while (itx != NULL) {
 			uint64_t s = zil_itx_full_size(itx);
@@ -2993,37 +3170,46 @@ zil_async_to_sync(zilog_t *zilog, uint64_t foid)
 	for (txg = otxg; txg < (otxg + TXG_CONCURRENT_STATES); txg++) {
 		itxg_t *itxg = &zilog->zl_itxg[txg & TXG_MASK];
 
-		mutex_enter(&itxg->itxg_lock);
+		rw_enter(&itxg->itxg_lock, RW_WRITER);
 		if (itxg->itxg_txg != txg) {
-			mutex_exit(&itxg->itxg_lock);
+			rw_exit(&itxg->itxg_lock);
 			continue;
 		}
 
 		/*
-		 * If a foid is specified then find that node and append its
-		 * list. Otherwise walk the tree appending all the lists
-		 * to the sync list. We add to the end rather than the
-		 * beginning to ensure the create has happened.
+		 * If a foid is specified then find that node in each
+		 * shard and append its list to the same shard's sync
+		 * list.  Otherwise walk the trees appending all the
+		 * lists.  Cross-shard ordering is reestablished by the
+		 * sequence-stamp merge in zil_get_commit_list(), which
+		 * also guarantees an object's create (a sync itx with
+		 * an earlier stamp) commits ahead of its async itxs.
 		 */
-		t = &itxg->itxg_itxs->i_async_tree;
-		if (foid != 0) {
-			ian_search.ia_foid = foid;
-			ian = avl_find(t, &ian_search, &where);
-			if (ian != NULL) {
-				list_move_tail(&itxg->itxg_itxs->i_sync_list,
-				    &ian->ia_list);
-			}
-		} else {
-			void *cookie = NULL;
-
-			while ((ian = avl_destroy_nodes(t, &cookie)) != NULL) {
-				list_move_tail(&itxg->itxg_itxs->i_sync_list,
-				    &ian->ia_list);
-				list_destroy(&ian->ia_list);
-				kmem_free(ian, sizeof (itx_async_node_t));
+		for (int i = 0; i < ZIL_ITX_SHARDS; i++) {
+			itx_shard_t *is = &itxg->itxg_itxs->i_shard[i];
+
+			t = &is->is_async_tree;
+			if (foid != 0) {
+				ian_search.ia_foid = foid;
+				ian = avl_find(t, &ian_search, &where);
+				if (ian != NULL) {
+					list_move_tail(&is->is_sync_list,
+					    &ian->ia_list);
+				}
+			} else {
+				void *cookie = NULL;
+
+				while ((ian = avl_destroy_nodes(t,
+				    &cookie)) != NULL) {
+					list_move_tail(&is->is_sync_list,
+					    &ian->ia_list);
+					list_destroy(&ian->ia_list);
+					kmem_free(ian,
+					    sizeof (itx_async_node_t));
+				}
 			}
 		}
-		mutex_exit(&itxg->itxg_lock);
+		rw_exit(&itxg->itxg_lock);
 	}
 }
 
@@ -3969,8 +4155,31 @@ zil_commit(zilog_t *zilog, uint64_t foid)
 	return (zil_commit_flags(zilog, foid, ZIL_COMMIT_FAILMODE));
 }
 
+static int zil_commit_flags_impl(zilog_t *zilog, uint64_t foid,
+    zil_commit_flag_t flags);
+
+static void
+zil_stat_commit_latency(zilog_t *zilog, hrtime_t ns)
+{
+	int b = MIN(highbit64(ns / 1000), ZIL_LAT_BUCKETS - 1);
+
+	wmsum_add(&zil_sums_global.zil_commit_lat_us[b], 1);
+	if (zilog->zl_sums != NULL)
+		wmsum_add(&zilog->zl_sums->zil_commit_lat_us[b], 1);
+}
+
 int
 zil_commit_flags(zilog_t *zilog, uint64_t foid, zil_commit_flag_t flags)
+{
+	hrtime_t t = gethrtime();
+	int err = zil_commit_flags_impl(zilog, foid, flags);
+
+	zil_stat_commit_latency(zilog, gethrtime() - t);
+	return (err);
+}
+
+static int
+zil_commit_flags_impl(zilog_t *zilog, uint64_t foid, zil_commit_flag_t flags)
 {
 	/*
 	 * We should never attempt to call zil_commit on a snapshot for
@@ -4261,6 +4470,7 @@ zil_init(void)
 	    sizeof (zil_commit_waiter_t), 0, NULL, NULL, NULL, NULL, NULL, 0);
 
 	zil_sums_init(&zil_sums_global);
+	zil_kstat_values_name(&zil_stats);
 	zil_kstats_global = kstat_create("zfs", 0, "zil", "misc",
 	    KSTAT_TYPE_NAMED, sizeof (zil_stats) / sizeof (kstat_named_t),
 	    KSTAT_FLAG_VIRTUAL);
@@ -4325,8 +4535,8 @@ zil_alloc(objset_t *os, zil_header_t *zh_phys)
 	mutex_init(&zilog->zl_lwb_io_lock, NULL, MUTEX_DEFAULT, NULL);
 
 	for (int i = 0; i < TXG_SIZE; i++) {
-		mutex_init(&zilog->zl_itxg[i].itxg_lock, NULL,
-		    MUTEX_DEFAULT, NULL);
+		rw_init(&zilog->zl_itxg[i].itxg_lock, NULL,
+		    RW_DEFAULT, NULL);
 	}
 
 	list_create(&zilog->zl_lwb_list, sizeof (lwb_t),
@@ -4377,7 +4587,7 @@ zil_free(zilog_t *zilog)
 		 */
 		if (zilog->zl_itxg[i].itxg_itxs)
 			zil_itxg_clean(zilog->zl_itxg[i].itxg_itxs);
-		mutex_destroy(&zilog->zl_itxg[i].itxg_lock);
+		rw_destroy(&zilog->zl_itxg[i].itxg_lock);
 	}
 
 	mutex_destroy(&zilog->zl_issuer_lock);
@@ -4790,6 +5000,73 @@ zil_incr_blks(zilog_t *zilog, const blkptr_t *bp, void *arg, uint64_t claim_txg)
  * If this dataset has a non-empty intent log, replay it and destroy it.
  * Return B_TRUE if there were any entries to replay.
  */
+/*
+ * When set, replay makes a first pass over the log issuing prefetches
+ * for the dnodes and data ranges the records will touch, so the apply
+ * pass's synchronous read-modify-write reads are served from cache.
+ * The log blocks themselves are cached by the first pass, making the
+ * second walk cheap.
+ */
+static int zfs_zil_replay_prefetch = 1;
+
+static int
+zil_replay_prefetch_block(zilog_t *zilog, const blkptr_t *bp, void *arg,
+    uint64_t claim_txg)
+{
+	(void) zilog, (void) bp, (void) arg, (void) claim_txg;
+	return (0);
+}
+
+static int
+zil_replay_prefetch_record(zilog_t *zilog, const lr_t *lr, void *arg,
+    uint64_t claim_txg)
+{
+	(void) arg;
+	const zil_header_t *zh = zilog->zl_header;
+	objset_t *os = zilog->zl_os;
+	uint64_t txtype = lr->lrc_txtype & ~TX_CI;
+
+	if (lr->lrc_seq <= zh->zh_replay_seq)	/* already replayed */
+		return (0);
+	if (lr->lrc_txg < claim_txg)		/* already committed */
+		return (0);
+	if (txtype == 0 || txtype >= TX_MAX_TYPE)
+		return (0);
+
+	if (txtype == TX_WRITE &&
+	    lr->lrc_reclen >= sizeof (lr_write_t)) {
+		const lr_write_t *lrw = (const lr_write_t *)lr;
+
+		dmu_prefetch(os, LR_FOID_GET_OBJ(lrw->lr_foid), 0,
+		    lrw->lr_offset, lrw->lr_length, ZIO_PRIORITY_ASYNC_READ);
+
+		/*
+		 * For an indirect write also start reading the data block
+		 * that zil_read_log_data() will wait for during apply.
+		 */
+		if (lr->lrc_reclen == sizeof (lr_write_t) &&
+		    !BP_IS_HOLE(&lrw->lr_blkptr) &&
+		    BP_GET_LSIZE(&lrw->lr_blkptr) != 0) {
+			arc_flags_t aflags = ARC_FLAG_NOWAIT |
+			    ARC_FLAG_PREFETCH;
+			zbookmark_phys_t zb;
+
+			SET_BOOKMARK(&zb, dmu_objset_id(os), lrw->lr_foid,
+			    ZB_ZIL_LEVEL,
+			    lrw->lr_offset / BP_GET_LSIZE(&lrw->lr_blkptr));
+			(void) arc_read(NULL, zilog->zl_spa,
+			    &lrw->lr_blkptr, NULL, NULL,
+			    ZIO_PRIORITY_ASYNC_READ, ZIO_FLAG_CANFAIL,
+			    &aflags, &zb);
+		}
+	} else if (lr->lrc_reclen >= sizeof (lr_ooo_t)) {
+		dmu_prefetch_dnode(os,
+		    LR_FOID_GET_OBJ(((const lr_ooo_t *)lr)->lr_foid),
+		    ZIO_PRIORITY_ASYNC_READ);
+	}
+	return (0);
+}
+
 boolean_t
 zil_replay(objset_t *os, void *arg,
     zil_replay_func_t *const replay_func[TX_MAX_TYPE])
@@ -4812,6 +5089,18 @@ zil_replay(objset_t *os, void *arg,
 	 */
 	txg_wait_synced(zilog->zl_dmu_pool, 0);
 
+	/*
+	 * Warm the cache for everything the records will touch before
+	 * applying them in order.  Byteswapped logs are skipped: the
+	 * foid and range fields would need swapping first, and foreign
+	 * replay is rare enough not to bother.
+	 */
+	if (zfs_zil_replay_prefetch && !zr.zr_byteswap) {
+		(void) zil_parse(zilog, zil_replay_prefetch_block,
+		    zil_replay_prefetch_record, NULL, zh->zh_claim_txg,
+		    B_TRUE);
+	}
+
 	zilog->zl_replay = B_TRUE;
 	zilog->zl_replay_time = ddi_get_lbolt();
 	ASSERT0(zilog->zl_replay_blks);
@@ -4894,6 +5183,12 @@ ZFS_MODULE_PARAM(zfs_zil, zil_, nocacheflush, INT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_zil, zil_, slog_bulk, U64, ZMOD_RW,
 	"Limit in bytes slog sync writes per commit");
 
+ZFS_MODULE_PARAM(zfs_zil, zil_, adaptive_immediate_write, INT, ZMOD_RW,
+	"Scale the indirect write threshold by log vs pool latency");
+
+ZFS_MODULE_PARAM(zfs_zil, zfs_zil_, replay_prefetch, INT, ZMOD_RW,
+	"Prefetch data touched by log records before replaying them");
+
 ZFS_MODULE_PARAM(zfs_zil, zil_, maxblocksize, UINT, ZMOD_RW,
 	"Limit in bytes of ZIL log block size");
 
@@ -71,6 +71,13 @@ const char *const zio_type_name[ZIO_TYPES] = {
 int zio_dva_throttle_enabled = B_TRUE;
 static int zio_deadman_log_all = B_FALSE;
 
+/*
+ * Record per-stage wall-clock accounting into each pool's zio_stages
+ * kstat.  Off by default: enabling adds a gethrtime() and an atomic
+ * pair per pipeline stage transition.
+ */
+static int zfs_zio_stage_accounting = B_FALSE;
+
 /*
  * ==========================================================================
  * I/O kmem caches
@@ -559,7 +566,7 @@ zio_decompress(zio_t *zio, abd_t *data, uint64_t size)
 		    zio->io_abd, data, zio->io_size, size,
 		    &zio->io_prop.zp_complevel);
 
-		if (zio_injection_enabled && ret == 0)
+		if (zfs_static_key_enabled(&zio_injection_enabled) && ret == 0)
 			ret = zio_handle_fault_injection(zio, EINVAL);
 
 		if (ret != 0)
@@ -622,7 +629,8 @@ zio_decrypt(zio_t *zio, abd_t *data, uint64_t size)
 		}
 		abd_copy(data, zio->io_abd, size);
 
-		if (zio_injection_enabled && ot != DMU_OT_DNODE && ret == 0) {
+		if (zfs_static_key_enabled(&zio_injection_enabled) &&
+		    ot != DMU_OT_DNODE && ret == 0) {
 			ret = zio_handle_decrypt_injection(spa,
 			    &zio->io_bookmark, ot, ECKSUM);
 		}
@@ -646,7 +654,8 @@ zio_decrypt(zio_t *zio, abd_t *data, uint64_t size)
 			zio_crypt_decode_mac_bp(bp, mac);
 			ret = spa_do_crypt_mac_abd(B_FALSE, spa, dsobj,
 			    zio->io_abd, size, mac);
-			if (zio_injection_enabled && ret == 0) {
+			if (zfs_static_key_enabled(&zio_injection_enabled) &&
+			    ret == 0) {
 				ret = zio_handle_decrypt_injection(spa,
 				    &zio->io_bookmark, ot, ECKSUM);
 			}
@@ -2467,9 +2476,35 @@ __zio_execute(zio_t *zio)
 			return;
 		}
 
+		/*
+		 * Optional per-stage wall-clock accounting: the time from
+		 * entering the current stage to entering the next one is
+		 * charged to the current stage, queueing and waits
+		 * included, and aggregated into the per-pool zio_stages
+		 * kstat.
+		 */
+		if (unlikely(zfs_zio_stage_accounting)) {
+			hrtime_t now = gethrtime();
+
+			if (zio->io_stage_timestamp != 0) {
+				spa_zio_stage_add(zio->io_spa,
+				    highbit64(zio->io_stage) - 1,
+				    now - zio->io_stage_timestamp);
+			}
+			zio->io_stage_timestamp = now;
+		}
+
 		zio->io_stage = stage;
 		zio->io_pipeline_trace |= zio->io_stage;
 
+		/*
+		 * Stable stage-transition tracepoint (fires for every
+		 * stage including ZIO_STAGE_DONE); see trace_zio.h.  The
+		 * txg phase changes and ARC hit/miss/evict transitions
+		 * already have equivalent probes in txg.c and arc.c.
+		 */
+		DTRACE_PROBE2(zio__stage, zio_t *, zio, uint32_t, stage);
+
 		/*
 		 * The zio pipeline stage returns the next zio to execute
 		 * (typically the same as this one), or NULL if we should
@@ -4314,6 +4349,8 @@ zio_dva_allocate(zio_t *zio)
 		flags |= METASLAB_GANG_CHILD;
 	if (zio->io_priority == ZIO_PRIORITY_ASYNC_WRITE)
 		flags |= METASLAB_ASYNC_ALLOC;
+	if (zio->io_prop.zp_alloc_locality)
+		flags |= METASLAB_LOCALITY;
 
 	/*
 	 * If not already chosen, choose an appropriate allocation class.
@@ -4405,6 +4442,18 @@ again:
 		goto again;
 	}
 
+	/*
+	 * Ganging is the last resort, but the escalation ladder before it
+	 * lives in the allocator, not here: zfs_metaslab_try_hard_before_gang
+	 * inserts a full exhaustive pass over every metaslab ahead of this
+	 * fallback.  Shrinking the request instead is not available at this
+	 * stage -- the data was already transformed (a higher compression
+	 * level rarely crosses the sector boundary that psize is rounded to,
+	 * and would burn syncing-context CPU to find out), and this zio is
+	 * already a single record, so there is no boundary to split at.
+	 * The per-pool gang_* iostats below make the remaining gang rate
+	 * and the try-hard rescues visible.
+	 */
 	if (error == ENOSPC && zio->io_size > spa->spa_min_alloc) {
 		if (zfs_flags & ZFS_DEBUG_METASLAB_ALLOC) {
 			zfs_dbgmsg("%s: metaslab allocation failure, "
@@ -4415,6 +4464,7 @@ again:
 		ZIOSTAT_BUMP(ziostat_gang_writes);
 		if (flags & METASLAB_GANG_CHILD)
 			ZIOSTAT_BUMP(ziostat_gang_multilevel);
+		spa_iostats_gang_add(spa, !!(flags & METASLAB_GANG_CHILD));
 		return (zio_write_gang_block(zio, mc));
 	}
 	if (error != 0) {
@@ -4823,11 +4873,13 @@ zio_vdev_io_done(zio_t *zio)
 		if (zio->io_type != ZIO_TYPE_FLUSH)
 			vdev_queue_io_done(zio);
 
-		if (zio_injection_enabled && zio->io_error == 0)
+		if (zfs_static_key_enabled(&zio_injection_enabled) &&
+		    zio->io_error == 0)
 			zio->io_error = zio_handle_device_injections(vd, zio,
 			    EIO, EILSEQ);
 
-		if (zio_injection_enabled && zio->io_error == 0)
+		if (zfs_static_key_enabled(&zio_injection_enabled) &&
+		    zio->io_error == 0)
 			zio->io_error = zio_handle_label_injection(zio, EIO);
 
 		if (zio->io_error && zio->io_type != ZIO_TYPE_FLUSH &&
@@ -4932,7 +4984,8 @@ zio_vdev_io_assess(zio_t *zio)
 		return (zio);
 	}
 
-	if (zio_injection_enabled && zio->io_error == 0)
+	if (zfs_static_key_enabled(&zio_injection_enabled) &&
+	    zio->io_error == 0)
 		zio->io_error = zio_handle_fault_injection(zio, EIO);
 
 	/*
@@ -5386,7 +5439,7 @@ zio_ready(zio_t *zio)
 		return (NULL);
 	}
 
-	if (zio_injection_enabled) {
+	if (zfs_static_key_enabled(&zio_injection_enabled)) {
 		hrtime_t target = zio_handle_ready_delay(zio);
 		if (target != 0 && zio->io_target_timestamp == 0) {
 			zio->io_stage >>= 1;
@@ -5458,7 +5511,7 @@ zio_ready(zio_t *zio)
 		}
 	}
 
-	if (zio_injection_enabled &&
+	if (zfs_static_key_enabled(&zio_injection_enabled) &&
 	    zio->io_spa->spa_syncing_txg == zio->io_txg)
 		zio_handle_ignored_writes(zio);
 
@@ -5483,7 +5536,8 @@ zio_dva_throttle_done(zio_t *zio)
 	ASSERT3U(zio->io_child_type, ==, ZIO_CHILD_VDEV);
 	ASSERT(vd != NULL);
 	ASSERT3P(vd, ==, vd->vdev_top);
-	ASSERT(zio_injection_enabled || !(zio->io_flags & ZIO_FLAG_IO_RETRY));
+	ASSERT(zfs_static_key_enabled(&zio_injection_enabled) ||
+	    !(zio->io_flags & ZIO_FLAG_IO_RETRY));
 	ASSERT(!(zio->io_flags & ZIO_FLAG_IO_REPAIR));
 	ASSERT(zio->io_flags & ZIO_FLAG_ALLOC_THROTTLED);
 
@@ -5873,6 +5927,15 @@ zio_done(zio_t *zio)
 		zio_nowait(cio);
 	}
 
+	/*
+	 * Always-on flight recorder: log leaf vdev completions (the level
+	 * where latency is attributable to a device) into the per-pool
+	 * ring.  This point is reached exactly once per zio; see
+	 * spa_flight_record().
+	 */
+	if (zio->io_vd != NULL && zio->io_vd->vdev_ops->vdev_op_leaf)
+		spa_flight_record(zio->io_spa, zio);
+
 	/*
 	 * It is the responsibility of the done callback to ensure that this
 	 * particular zio is no longer discoverable for adoption, and as
@@ -6098,6 +6161,9 @@ EXPORT_SYMBOL(zio_data_buf_free);
 ZFS_MODULE_PARAM(zfs_zio, zio_, slow_io_ms, INT, ZMOD_RW,
 	"Max I/O completion time (milliseconds) before marking it as slow");
 
+ZFS_MODULE_PARAM(zfs_zio, zfs_zio_, stage_accounting, INT, ZMOD_RW,
+	"Per-pool zio pipeline stage latency accounting");
+
 ZFS_MODULE_PARAM(zfs_zio, zio_, requeue_io_start_cut_in_line, INT, ZMOD_RW,
 	"Prioritize requeued I/O");
 
@@ -579,7 +579,8 @@ zio_checksum_error(zio_t *zio, zio_bad_cksum_t *info)
 		}
 	}
 
-	if (zio_injection_enabled && error == 0 && zio->io_error == 0) {
+	if (zfs_static_key_enabled(&zio_injection_enabled) && error == 0 &&
+	    zio->io_error == 0) {
 		error = zio_handle_fault_injection(zio, ECKSUM);
 		if (error != 0)
 			info->zbc_injected = 1;
@@ -55,6 +55,20 @@
  * Note: ZTHR threads are NOT a replacement for generic threads! Please
  * ensure that they fit your use-case well before using them.
  *
+ * == Why there is no shared CPU-budget governor here
+ *
+ * Each zthr's pacing looks ad-hoc from this file but encodes a
+ * resource that is not CPU: checkpoint discard and condensing pace by
+ * txg cadence, autotrim by device queue occupancy, the L2ARC feed by
+ * the write rate and a target fill, dedup flushing by its backlog
+ * controller.  A generic share-based governor would supervise the one
+ * resource these threads rarely exhaust while taking away the
+ * domain-specific signals that actually bound them, and the pool-wide
+ * idle signal it would need already exists where it matters (e.g.
+ * vdev_queue_pool_busy(), which pacing code consults today).  Per-zthr
+ * CPU consumption needs no new kstats either: zthrs are named kernel
+ * threads, so standard thread accounting attributes their time.
+ *
  * == ZTHR creation
  *
  * Every zthr needs four inputs to start running:
@@ -139,12 +139,17 @@ zv_request_task_create(zv_request_t zvr)
 	task = kmem_alloc(sizeof (zv_request_task_t), KM_SLEEP);
 	taskq_init_ent(&task->ent);
 	task->zvr = zvr;
+	task->zvr_start = gethrtime();
+	dataset_kstats_update_pending_kstat(&zvr.zv->zv_kstat, 1);
 	return (task);
 }
 
 void
 zv_request_task_free(zv_request_task_t *task)
 {
+	dataset_kstats_update_pending_kstat(&task->zvr.zv->zv_kstat, -1);
+	dataset_kstats_record_io_time_kstat(&task->zvr.zv->zv_kstat,
+	    gethrtime() - task->zvr_start);
 	kmem_free(task, sizeof (*task));
 }
 
@@ -1572,6 +1577,14 @@ zvol_task_report_status(zvol_task_t *task)
  * 'visible' (which also verifies that the parent is a zvol), and if so,
  * a minor node for that snapshot is created.
  */
+static void
+zvol_create_minor_task(void *arg)
+{
+	minors_job_t *job = arg;
+
+	job->error = zvol_os_create_minor(job->name);
+}
+
 static void
 zvol_create_minors_impl(zvol_task_t *task)
 {
@@ -1628,31 +1641,73 @@ zvol_create_minors_impl(zvol_task_t *task)
 	taskq_wait_outstanding(system_taskq, 0);
 
 	/*
-	 * Prefetch is completed, we can do zvol_os_create_minor
-	 * sequentially.
+	 * Prefetch is completed; create the minors in parallel on
+	 * system_taskq.  Registration of one minor is independent of the
+	 * others (global state is ida- or zvol_state_lock-protected),
+	 * with one exception: two jobs for the same name would race the
+	 * find-then-insert in zvol_os_create_minor(), and duplicates do
+	 * occur (a clone origin can be both enumerated and added by
+	 * zvol_add_clones()).  So dispatch each name once, counting the
+	 * duplicates as already done.
 	 */
+	list_t create_list;
+	list_create(&create_list, sizeof (minors_job_t),
+	    offsetof(minors_job_t, link));
+
 	while ((job = list_remove_head(&minors_list)) != NULL) {
-		if (!job->error) {
-			error = zvol_os_create_minor(job->name);
-			if (error == 0) {
-				done++;
-			} else {
-				last_error = error;
-			}
-		} else if (job->error == EINVAL) {
+		if (job->error == EINVAL) {
 			/*
-			 * The objset, with the name requested by current job
-			 * exist, but have the type different from zvol.
+			 * The objset with the name requested by current job
+			 * exists, but has a type different from zvol.
 			 * Just ignore this sort of errors.
 			 */
 			done++;
-		} else {
+			total++;
+			kmem_strfree(job->name);
+			kmem_free(job, sizeof (minors_job_t));
+			continue;
+		} else if (job->error != 0) {
 			last_error = job->error;
+			total++;
+			kmem_strfree(job->name);
+			kmem_free(job, sizeof (minors_job_t));
+			continue;
+		}
+
+		boolean_t dup = B_FALSE;
+		for (minors_job_t *j = list_head(&create_list); j != NULL;
+		    j = list_next(&create_list, j)) {
+			if (strcmp(j->name, job->name) == 0) {
+				dup = B_TRUE;
+				break;
+			}
+		}
+		if (dup) {
+			done++;
+			total++;
+			kmem_strfree(job->name);
+			kmem_free(job, sizeof (minors_job_t));
+			continue;
 		}
+
+		list_insert_tail(&create_list, job);
+		if (taskq_dispatch(system_taskq, zvol_create_minor_task,
+		    job, TQ_SLEEP) == TASKQID_INVALID)
+			zvol_create_minor_task(job);
+	}
+
+	taskq_wait_outstanding(system_taskq, 0);
+
+	while ((job = list_remove_head(&create_list)) != NULL) {
+		if (job->error == 0)
+			done++;
+		else
+			last_error = job->error;
 		total++;
 		kmem_strfree(job->name);
 		kmem_free(job, sizeof (minors_job_t));
 	}
+	list_destroy(&create_list);
 
 	list_destroy(&minors_list);
 	zvol_task_update_status(task, total, done, last_error);
@@ -333,9 +333,21 @@ zstd_mempool_alloc(struct zstd_pool *zstd_mempool, size_t size)
 		return (NULL);
 	}
 
+	/*
+	 * Scan circularly from a per-cpu preferred slot, so each cpu tends
+	 * to reuse the same workspace.  That makes the common case a
+	 * single tryenter on an already-suitable slot instead of a walk
+	 * over the shared array, and since a slot's backing memory is
+	 * first-touched by the cpu that keeps reusing it, workspaces stay
+	 * NUMA-local without explicit node-aware allocation (which the
+	 * SPL does not offer).  Contended or mismatched slots simply fall
+	 * through to the neighbors, preserving the shared-pool behavior.
+	 */
+	uint_t base = ((uint_t)CPU_SEQID_UNSTABLE * 4) % ZSTD_POOL_MAX;
+
 	/* Seek for preallocated memory slot and free obsolete slots */
 	for (int i = 0; i < ZSTD_POOL_MAX; i++) {
-		pool = &zstd_mempool[i];
+		pool = &zstd_mempool[(base + i) % ZSTD_POOL_MAX];
 		/*
 		 * This lock is simply a marker for a pool object being in use.
 		 * If it's already hold, it will be skipped.
@@ -369,7 +381,7 @@ zstd_mempool_alloc(struct zstd_pool *zstd_mempool, size_t size)
 	 * allocations constantly at the end.
 	 */
 	for (int i = 0; i < ZSTD_POOL_MAX; i++) {
-		pool = &zstd_mempool[i];
+		pool = &zstd_mempool[(base + i) % ZSTD_POOL_MAX];
 		if (mutex_tryenter(&pool->barrier)) {
 			/* Object is free, try to allocate new one */
 			if (!pool->mem) {
@@ -579,6 +591,20 @@ zfs_zstd_compress_buf(void *s_start, void *d_start, size_t s_len, size_t d_len,
 	 * savings versus no early abort, and all the zstd-fast levels are
 	 * worse indications on their own than LZ4, and don't improve the LZ4
 	 * pass noticably if stacked like this.
+	 *
+	 * This heuristic is also the validated core of any future
+	 * per-block adaptive algorithm selection.  Note for whoever builds
+	 * the rest: the block pointer records the algorithm per block, so
+	 * substituting e.g. LZ4 for zstd on a block-by-block basis is
+	 * format-legal - but the substitution must happen where the bp's
+	 * compression type is set (zio_write_compress()), never in here,
+	 * because this function's output is stored under the zstd type
+	 * unconditionally.  What is missing for a compression=adaptive
+	 * property is not mechanism but a cost model: a defensible rule
+	 * for when lz4's ratio is "close enough" to skip zstd's CPU, which
+	 * has to be validated against real workloads.  The pass counters
+	 * above (lz4pass/zstdpass allowed/rejected) are the measurement
+	 * basis for that work.
 	 */
 	size_t actual_abort_size = zstd_abort_size;
 	if (zstd_earlyabort_pass > 0 && zstd_level >= zstd_cutoff_level &&